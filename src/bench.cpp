@@ -0,0 +1,468 @@
+/****************************************************************************
+ * bench.cpp
+ *
+ * 板上基准测试实现
+ * 每项测试记录每次调用的耗时 (DWT周期换算为微秒)，结束后排序求最小/平均/p99/最大值；
+ * per_sec为按调用耗时折算的每秒次数 (回放时即每秒能处理的历元数，不含等待)。
+ * 测试数据都是确定的，同一条轨迹在不同固件上的结果可以直接比较
+ * ***************************************************************************/
+#include "bench.h"
+#include "perf_probe.h"
+#include "sd_io.h"
+#include "display.h"
+#include "file_system.h"
+#include "lyrics.h"
+#include "ui_screens.h"
+#include "music_index.h"
+#include "gnss_data.h"
+#include "gnss_distance.h"
+#include "gnss_screens.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// 一项测试的耗时样本 (微秒)
+struct BenchSamples {
+  std::vector<uint32_t> us;
+  uint64_t total_us;
+};
+
+// CSV结果，全部测试结束后一次写出
+static std::string g_csv;
+
+/**
+ * 清空样本
+ */
+static void bench_clear(BenchSamples* s)
+{
+  s->us.clear();
+  s->total_us = 0;
+}
+
+/**
+ * 记录从start开始的一次耗时
+ */
+static void bench_sample(BenchSamples* s, uint32_t start)
+{
+  uint32_t us = (perf_now() - start) / PERF_CPU_MHZ;
+  s->us.push_back(us);
+  s->total_us += us;
+}
+
+/**
+ * 汇总一项测试，打印并追加到CSV
+ */
+static void bench_report(const char* name, BenchSamples* s)
+{
+  uint32_t count = (uint32_t)s->us.size();
+  if (count == 0) {
+    printf("[BENCH] %s: 没有样本\n", name);
+    return;
+  }
+
+  std::sort(s->us.begin(), s->us.end());
+  uint32_t avg = (uint32_t)(s->total_us / count);
+  uint32_t p99 = s->us[count - 1 - count / 100];
+  double per_sec = s->total_us > 0 ? count * 1e6 / s->total_us : 0.0;
+
+  printf("[BENCH] %-20s n=%-6u min=%u avg=%u p99=%u max=%u us, %.1f/s\n",
+         name, (unsigned)count, (unsigned)s->us.front(), (unsigned)avg,
+         (unsigned)p99, (unsigned)s->us.back(), per_sec);
+
+  char line[128];
+  snprintf(line, sizeof(line), "%s,%u,%u,%u,%u,%u,%.1f\n",
+           name, (unsigned)count, (unsigned)s->us.front(), (unsigned)avg,
+           (unsigned)p99, (unsigned)s->us.back(), per_sec);
+  g_csv += line;
+}
+
+/**
+ * 写出CSV
+ */
+static bool bench_write_csv(const char* path)
+{
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    printf("[BENCH] 创建文件失败: %s\n", path);
+    return false;
+  }
+
+  fputs("name,count,min_us,avg_us,p99_us,max_us,per_sec\n", f);
+  fputs(g_csv.c_str(), f);
+  fclose(f);
+  printf("[BENCH] 结果已写入 %s\n", path);
+  return true;
+}
+
+/**
+ * 回放轨迹，对每次gnss_get_position计时 (含滤波、里程、分段和加速计时)
+ */
+static void bench_gnss(const char* trk_path, uint32_t rate_hz, uint32_t speedup)
+{
+  uint32_t rate_ms = rate_hz > 0 ? 1000 / rate_hz : 0;
+  if (!gnss_start_replay(trk_path, rate_ms, speedup)) return;
+
+  gnss_start_recording();
+
+  BenchSamples s;
+  bench_clear(&s);
+  GnssPoint point;
+  int wait_ms;
+  while ((wait_ms = gnss_replay_wait()) >= 0) {
+    if (wait_ms > 0) usleep(wait_ms * 1000);
+
+    uint32_t start = perf_now();
+    gnss_get_position(&point);
+    bench_sample(&s, start);
+
+    // 和GNSS线程一样，写卡放在计时之外
+    gnss_flush_track();
+  }
+
+  gnss_end_current_segment();
+  gnss_stop_recording();
+  gnss_stop_replay();
+
+  char name[32];
+  if (rate_hz > 0) {
+    snprintf(name, sizeof(name), "gnss_replay_%uhz", (unsigned)rate_hz);
+  } else {
+    snprintf(name, sizeof(name), "gnss_replay_rec");
+  }
+  bench_report(name, &s);
+}
+
+/**
+ * 分段JSON：保存 (生成JSON并提交给I/O线程) 和加载，使用最近一次回放的行程
+ */
+static void bench_json()
+{
+  BenchSamples s;
+  bench_clear(&s);
+
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    uint32_t start = perf_now();
+    bool ok = gnss_save_segment_data_to_json();
+    bench_sample(&s, start);
+    if (!ok) return;
+  }
+  bench_report("segment_json_save", &s);
+
+  // 等待写卡完成
+  bench_clear(&s);
+  uint32_t start = perf_now();
+  sd_io_flush(10000);
+  bench_sample(&s, start);
+  bench_report("segment_json_flush", &s);
+
+  std::vector<std::string> files = gnss_get_segment_history_files();
+  if (files.empty()) return;
+
+  bench_clear(&s);
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    std::vector<SegmentData> segments;
+    start = perf_now();
+    gnss_load_segment_data_from_file(files[0].c_str(), segments);
+    bench_sample(&s, start);
+  }
+  bench_report("segment_json_load", &s);
+}
+
+/**
+ * 第index首测试歌曲的路径 (不含扩展名)
+ */
+static std::string bench_track_base(int index)
+{
+  char name[64];
+  snprintf(name, sizeof(name), BENCH_MUSIC_DIR "/bench_%03d", index);
+  return name;
+}
+
+/**
+ * 生成测试歌词
+ */
+static std::string bench_make_lrc(int index)
+{
+  std::string lrc;
+  char line[96];
+
+  snprintf(line, sizeof(line), "[ti:Bench Track %d]\n[ar:Bench Artist]\n[offset:0]\n", index);
+  lrc += line;
+
+  for (int i = 0; i < BENCH_LRC_LINES; i++) {
+    uint32_t ms = i * 2500;
+    // 每10行有一行带两个时间标签 (副歌)
+    if (i % 10 == 9) {
+      uint32_t ms2 = ms + BENCH_LRC_LINES * 2500;
+      snprintf(line, sizeof(line), "[%02u:%02u.%02u][%02u:%02u.%02u]",
+               ms / 60000, ms / 1000 % 60, ms / 10 % 100,
+               ms2 / 60000, ms2 / 1000 % 60, ms2 / 10 % 100);
+    } else {
+      snprintf(line, sizeof(line), "[%02u:%02u.%02u]", ms / 60000, ms / 1000 % 60, ms / 10 % 100);
+    }
+    lrc += line;
+    snprintf(line, sizeof(line), "测试歌词第%d行 Bench lyric line %d\n", i + 1, i + 1);
+    lrc += line;
+  }
+  return lrc;
+}
+
+/**
+ * 生成测试音乐库 (已存在的文件不重写)
+ * MP3为固定码率的空帧加ID3v1标签，每首都有同名歌词
+ */
+static bool bench_prepare_library()
+{
+  mkdir(BENCH_ROOT, 0777);
+  mkdir(BENCH_MUSIC_DIR, 0777);
+
+  // MPEG1 Layer3 128kbps 44.1kHz，无填充时每帧417字节
+  static uint8_t frame[417];
+  frame[0] = 0xFF;
+  frame[1] = 0xFB;
+  frame[2] = 0x90;
+  frame[3] = 0x00;
+
+  for (int i = 0; i < BENCH_MUSIC_FILES; i++) {
+    std::string base = bench_track_base(i);
+    std::string mp3 = base + ".mp3";
+    struct stat st;
+    if (stat(mp3.c_str(), &st) == 0) continue;
+
+    FILE* f = fopen(mp3.c_str(), "wb");
+    if (!f) {
+      printf("[BENCH] 创建文件失败: %s\n", mp3.c_str());
+      return false;
+    }
+    for (int n = 0; n < BENCH_MP3_FRAMES; n++) {
+      fwrite(frame, 1, sizeof(frame), f);
+    }
+
+    char tag[128];
+    memset(tag, 0, sizeof(tag));
+    memcpy(tag, "TAG", 3);
+    snprintf(tag + 3, 30, "Bench Track %d", i);
+    snprintf(tag + 33, 30, "Bench Artist");
+    snprintf(tag + 63, 30, "Bench Album");
+    fwrite(tag, 1, sizeof(tag), f);
+    fclose(f);
+
+    std::string lrc = bench_make_lrc(i);
+    f = fopen((base + ".lrc").c_str(), "wb");
+    if (!f) return false;
+    fwrite(lrc.data(), 1, lrc.size(), f);
+    fclose(f);
+  }
+  return true;
+}
+
+/**
+ * 音乐库扫描：冷扫描 (删除索引，逐个解析MP3) 和热扫描 (索引命中)
+ */
+static void bench_library()
+{
+  if (!bench_prepare_library()) return;
+
+  std::string index_path = combine_path(BENCH_MUSIC_DIR, MUSIC_INDEX_NAME);
+  std::vector<MusicFile> files;
+  BenchSamples cold, warm;
+  bench_clear(&cold);
+  bench_clear(&warm);
+
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    unlink(index_path.c_str());
+
+    uint32_t start = perf_now();
+    scan_music_directory(BENCH_MUSIC_DIR, &files);
+    bench_sample(&cold, start);
+
+    start = perf_now();
+    scan_music_directory(BENCH_MUSIC_DIR, &files);
+    bench_sample(&warm, start);
+  }
+
+  bench_report("library_scan_cold", &cold);
+  bench_report("library_scan_warm", &warm);
+}
+
+/**
+ * 歌词：读取并解析整个LRC文件，以及播放中的逐帧查找和随机定位
+ */
+static void bench_lyrics()
+{
+  if (!bench_prepare_library()) return;
+
+  std::string path = bench_track_base(0) + ".lrc";
+  Lyrics lyrics;
+  lyrics_init(&lyrics);
+  BenchSamples s;
+  bench_clear(&s);
+
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    uint32_t start = perf_now();
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+      printf("[BENCH] 打开歌词失败: %s\n", path.c_str());
+      return;
+    }
+    std::vector<char> data;
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+      data.insert(data.end(), buf, buf + n);
+    }
+    fclose(f);
+    lyrics_parse(data.data(), data.size(), &lyrics);
+    bench_sample(&s, start);
+  }
+  bench_report("lyrics_load", &s);
+
+  // 按30fps顺序播放
+  uint32_t end_ms = BENCH_LRC_LINES * 2500 * 2;
+  bench_clear(&s);
+  for (uint32_t ms = 0; ms < end_ms; ms += 33) {
+    uint32_t start = perf_now();
+    lyrics_update(&lyrics, ms);
+    bench_sample(&s, start);
+  }
+  bench_report("lyrics_update_play", &s);
+
+  // 随机定位 (固定种子)
+  bench_clear(&s);
+  srand(1);
+  for (int i = 0; i < 1000; i++) {
+    uint32_t ms = (uint32_t)rand() % end_ms;
+    uint32_t start = perf_now();
+    lyrics_update(&lyrics, ms);
+    bench_sample(&s, start);
+  }
+  bench_report("lyrics_update_seek", &s);
+}
+
+/**
+ * 界面绘制：在离屏缓冲区中绘制GNSS和播放器的主要界面
+ * 每帧改变速度和时间，帧合成照常比较和"发送"变化的块
+ */
+static void bench_render()
+{
+  // 还没有发布过快照时用空的行程数据绘制
+  TripData trip = TripData();
+  gnss_get_trip_snapshot(&trip);
+
+  GnssPoint point;
+  memset(&point, 0, sizeof(point));
+  point.latitude = 35.6812;
+  point.longitude = 139.7671;
+  point.altitude = 40.0;
+  point.num_satellites = 12;
+  point.fix_type = FIX_3D;
+
+  MusicFile file;
+  file.filepath = bench_track_base(0) + ".mp3";
+  file.filename = "bench_000.mp3";
+  file.metadata.title = "测试歌曲 Bench Track with a long scrolling title";
+  file.metadata.artist = "Bench Artist";
+  file.metadata.duration_ms = 240000;
+  file.has_lrc = true;
+
+  Lyrics lyrics;
+  lyrics_init(&lyrics);
+  std::string lrc = bench_make_lrc(0);
+  lyrics_parse(lrc.data(), lrc.size(), &lyrics);
+
+  static const char* const NAMES[] = {
+    "render_odometer", "render_compass", "render_tracking",
+    "render_trip_data", "render_accel_test", "render_player", "render_lyrics"
+  };
+  const int screen_count = sizeof(NAMES) / sizeof(NAMES[0]);
+
+  for (int screen = 0; screen < screen_count; screen++) {
+    BenchSamples s;
+    bench_clear(&s);
+    lcd_invalidate();
+
+    for (int i = 0; i < BENCH_RENDER_FRAMES; i++) {
+      point.speed = (i % 400) * 0.1f;
+      point.course = (i * 3) % 360;
+      uint32_t ms = i * 100;
+
+      uint32_t start = perf_now();
+      switch (screen) {
+        case 0: gnss_draw_odometer(&point, &trip, true); break;
+        case 1: gnss_draw_compass(&point); break;
+        case 2: gnss_draw_tracking(true, (uint32_t)i, &trip); break;
+        case 3: gnss_draw_trip_data(&trip); break;
+        case 4: gnss_draw_accel_test(&trip, point.speed); break;
+        case 5: ui_draw_player_screen(file, ms, 50, LOOP_SEQUENTIAL, EQ_FLAT, 80, false); break;
+        default: ui_draw_lyrics_screen(&lyrics, ms * 10, file.metadata.title.c_str()); break;
+      }
+      bench_sample(&s, start);
+    }
+    bench_report(NAMES[screen], &s);
+  }
+}
+
+/**
+ * 回放1/5/10Hz或指定的频率
+ */
+static void bench_gnss_args(int argc, char* argv[])
+{
+  const char* trk = argv[2];
+  if (argc > 3) {
+    bench_gnss(trk, (uint32_t)atoi(argv[3]), argc > 4 ? (uint32_t)atoi(argv[4]) : 0);
+    return;
+  }
+
+  static const uint32_t RATES[] = { 1, 5, 10 };
+  for (uint32_t rate : RATES) {
+    bench_gnss(trk, rate, 0);
+  }
+}
+
+/**
+ * 命令行入口
+ */
+int bench_main(int argc, char* argv[])
+{
+  const char* test = argc > 1 ? argv[1] : "distance";
+
+  // 兼容原来的 bench [次数]
+  if (strcmp(test, "distance") == 0 || (test[0] >= '0' && test[0] <= '9')) {
+    const char* count = test[0] >= '0' && test[0] <= '9' ? test : (argc > 2 ? argv[2] : nullptr);
+    gnss_distance_benchmark(count ? (uint32_t)atoi(count) : 1000);
+    return 0;
+  }
+
+  bool all = strcmp(test, "all") == 0;
+  bool needs_track = all || strcmp(test, "gnss") == 0;
+  if (needs_track && argc < 3) {
+    printf("[BENCH] 用法: bench %s <轨迹.trk>%s\n", test, all ? "" : " [Hz] [倍速]");
+    return 1;
+  }
+
+  sd_io_start();
+  lcd_init_offscreen();
+  gnss_screens_init();
+  g_csv.clear();
+
+  if (all || strcmp(test, "gnss") == 0) bench_gnss_args(argc, argv);
+  if (all || strcmp(test, "json") == 0) bench_json();
+  if (all || strcmp(test, "render") == 0) bench_render();
+  if (all || strcmp(test, "library") == 0) bench_library();
+  if (all || strcmp(test, "lyrics") == 0) bench_lyrics();
+
+  if (g_csv.empty()) {
+    printf("[BENCH] 未知的测试项: %s\n", test);
+  } else {
+    bench_write_csv(BENCH_CSV_PATH);
+  }
+
+  sd_io_flush(10000);
+  sd_io_stop();
+  return 0;
+}
@@ -0,0 +1,43 @@
+/****************************************************************************
+ * bench.h
+ *
+ * 板上基准测试：回放录下的轨迹代替接收机，在SD卡上生成固定的测试音乐库，
+ * 对定位处理、分段JSON保存/加载、音乐库扫描、歌词解析和界面绘制 (离屏缓冲区)
+ * 分别计时。每项结果写成一行CSV，便于比较不同固件版本
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 结果文件：name,count,min_us,avg_us,p99_us,max_us,per_sec
+#define BENCH_CSV_PATH "/sd/bench.csv"
+
+// 测试数据目录 (第一次运行时生成，之后复用)
+#define BENCH_ROOT "/sd/BENCH"
+#define BENCH_MUSIC_DIR BENCH_ROOT "/MUSIC"
+
+// 测试音乐库的文件数
+#define BENCH_MUSIC_FILES 50
+
+// 每个测试MP3的帧数 (128kbps/44.1kHz，约1秒)
+#define BENCH_MP3_FRAMES 40
+
+// 测试歌词的行数
+#define BENCH_LRC_LINES 200
+
+// 扫描、JSON和歌词测试的重复次数
+#define BENCH_ROUNDS 20
+
+// 每个界面绘制的帧数
+#define BENCH_RENDER_FRAMES 200
+
+// 命令行入口: bench [次数] | bench <测试项> [参数...]
+//   distance [次数]           距离计算
+//   gnss <轨迹> [Hz] [倍速]   回放轨迹 (Hz为0时按记录，倍速为0时不等待，默认1/5/10Hz全部尽快回放)
+//   json                      分段JSON保存/加载 (使用当前行程)
+//   library                   音乐库冷/热扫描
+//   lyrics                    歌词读取解析和查找
+//   render                    界面绘制
+//   all <轨迹>                依次运行以上全部
+int bench_main(int argc, char* argv[]);
@@ -0,0 +1,333 @@
+/****************************************************************************
+ * gnss_accel_log.cpp
+ *
+ * 加速记录日志实现
+ * 第n条记录 (从1开始) 位于槽 (n-1) % 容量，文件头的总数就是最新记录的序号；
+ * 写入先写记录再写文件头，都交给SD卡I/O线程。启动时I/O线程读入整个日志，
+ * 核对最新记录的序号，断电造成两者不一致时扫描一遍所有记录找回最新的序号；
+ * 导入旧版JSON和按新容量重建也在I/O线程的读取回调中完成
+ * ***************************************************************************/
+#include "gnss_accel_log.h"
+#include "gnss_json.h"
+#include "sd_io.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <vector>
+
+#define ACCEL_LOG_MAGIC "ACCL"
+#define ACCEL_LOG_VERSION 1
+
+// 文件头
+struct AccelLogHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t capacity;
+  uint32_t total;         // 已写入的记录总数
+};
+
+// 记录
+struct AccelLogRecord {
+  uint32_t seq;           // 序号，0表示空槽
+  int32_t timestamp;
+  float time_0_30;
+  float time_0_50;
+  float max_speed;
+  char date_time[20];
+};
+
+static_assert(sizeof(AccelLogHeader) == 16, "AccelLogHeader大小不对");
+static_assert(sizeof(AccelLogRecord) == 40, "AccelLogRecord大小不对");
+
+#define ACCEL_LOG_FILE_SIZE (sizeof(AccelLogHeader) + ACCEL_LOG_CAPACITY * sizeof(AccelLogRecord))
+
+static bool g_loaded = false;                         // 日志是否已读入内存
+static uint32_t g_total = 0;                          // 已写入的记录总数
+static AccelLogRecord g_records[ACCEL_LOG_CAPACITY];  // 全部记录 (按槽存放，与文件相同)
+static std::vector<AccelerationData> g_pending;       // 读取完成前追加的记录
+static pthread_mutex_t g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t record_slot(uint32_t seq)
+{
+  return (seq - 1) % ACCEL_LOG_CAPACITY;
+}
+
+static uint32_t record_offset(uint32_t seq)
+{
+  return sizeof(AccelLogHeader) + record_slot(seq) * sizeof(AccelLogRecord);
+}
+
+static void to_record(const AccelerationData& data, uint32_t seq, AccelLogRecord* rec)
+{
+  memset(rec, 0, sizeof(*rec));
+  rec->seq = seq;
+  rec->timestamp = (int32_t)data.timestamp;
+  rec->time_0_30 = data.time_0_30;
+  rec->time_0_50 = data.time_0_50;
+  rec->max_speed = data.max_speed_reached;
+  snprintf(rec->date_time, sizeof(rec->date_time), "%s", data.date_time_str);
+}
+
+static void from_record(const AccelLogRecord& rec, AccelerationData* data)
+{
+  data->timestamp = rec.timestamp;
+  data->time_0_30 = rec.time_0_30;
+  data->time_0_50 = rec.time_0_50;
+  data->max_speed_reached = rec.max_speed;
+  memcpy(data->date_time_str, rec.date_time, sizeof(data->date_time_str));
+  data->date_time_str[sizeof(data->date_time_str) - 1] = '\0';
+}
+
+static void make_header(uint32_t total, AccelLogHeader* header)
+{
+  memcpy(header->magic, ACCEL_LOG_MAGIC, 4);
+  header->version = ACCEL_LOG_VERSION;
+  header->record_size = sizeof(AccelLogRecord);
+  header->capacity = ACCEL_LOG_CAPACITY;
+  header->total = total;
+}
+
+/**
+ * 读取旧版JSON历史，返回最新的在前的记录 (在I/O线程中调用)
+ */
+static void load_legacy_json(std::vector<AccelerationData>* history)
+{
+  JsonReader reader;
+  if (!json_open(&reader, ACCEL_LEGACY_JSON_PATH)) return;
+
+  if (json_next(&reader) == JSON_ARRAY_START) {
+    while (json_next(&reader) == JSON_OBJECT_START) {
+      AccelerationData data;
+      data.timestamp = 0;
+      data.time_0_30 = -1;
+      data.time_0_50 = -1;
+      data.max_speed_reached = 0;
+      data.date_time_str[0] = '\0';
+
+      while (json_next_key(&reader)) {
+        char key[JSON_TOKEN_MAX];
+        snprintf(key, sizeof(key), "%s", reader.text);
+        json_next(&reader);
+        if (!json_skip_value(&reader)) break;
+
+        if (strcmp(key, "timestamp") == 0) {
+          data.timestamp = (time_t)json_number(&reader, 0);
+        } else if (strcmp(key, "time_0_30") == 0) {
+          data.time_0_30 = json_number(&reader, -1);
+        } else if (strcmp(key, "time_0_50") == 0) {
+          data.time_0_50 = json_number(&reader, -1);
+        } else if (strcmp(key, "max_speed") == 0) {
+          data.max_speed_reached = json_number(&reader, 0);
+        } else if (strcmp(key, "date_time") == 0) {
+          json_copy_string(&reader, data.date_time_str, sizeof(data.date_time_str));
+        }
+      }
+      if (reader.token != JSON_OBJECT_END) break;
+
+      history->push_back(data);
+    }
+  }
+
+  json_close(&reader);
+}
+
+/**
+ * 用最旧在前的记录重建日志 (调用者持有锁)
+ * 内存中的记录立即生效，整个文件交给I/O线程替换
+ */
+static void rebuild_locked(const std::vector<AccelerationData>& records)
+{
+  uint32_t total = records.size() < ACCEL_LOG_CAPACITY ? records.size() : ACCEL_LOG_CAPACITY;
+  size_t first = records.size() - total;
+
+  memset(g_records, 0, sizeof(g_records));
+  for (uint32_t seq = 1; seq <= total; seq++) {
+    to_record(records[first + seq - 1], seq, &g_records[record_slot(seq)]);
+  }
+  g_total = total;
+
+  std::vector<char> image(ACCEL_LOG_FILE_SIZE);
+  AccelLogHeader header;
+  make_header(total, &header);
+  memcpy(image.data(), &header, sizeof(header));
+  memcpy(image.data() + sizeof(header), g_records, sizeof(g_records));
+  sd_io_write_file(ACCEL_LOG_PATH, image.data(), image.size(), SD_IO_STATS);
+}
+
+/**
+ * 解析读入的日志 (调用者持有锁)，文件不存在时导入旧版JSON，
+ * 容量配置改变时保留最新的记录重建日志
+ */
+static void parse_locked(const char* data, size_t len)
+{
+  AccelLogHeader header;
+  bool valid = data && len >= sizeof(header);
+  if (valid) {
+    memcpy(&header, data, sizeof(header));
+    valid = memcmp(header.magic, ACCEL_LOG_MAGIC, 4) == 0 &&
+            header.version == ACCEL_LOG_VERSION &&
+            header.record_size == sizeof(AccelLogRecord) &&
+            header.capacity > 0;
+  }
+
+  if (!data) {
+    // 还没有日志：导入旧版JSON (旧版最新的在前，日志按写入顺序存放)
+    mkdir("/sd/acceleration", 0777);
+    std::vector<AccelerationData> legacy;
+    load_legacy_json(&legacy);
+    rebuild_locked(std::vector<AccelerationData>(legacy.rbegin(), legacy.rend()));
+    if (!legacy.empty()) {
+      printf("[GNSS] 已导入 %zu 条旧版加速度记录\n", legacy.size());
+    }
+    return;
+  }
+
+  if (!valid) {
+    printf("[GNSS] 加速度记录文件无效, 重新创建\n");
+    rebuild_locked(std::vector<AccelerationData>());
+    return;
+  }
+
+  // 读不全的槽按空槽处理
+  auto read_slot = [&](uint32_t slot, AccelLogRecord* rec) {
+    size_t offset = sizeof(AccelLogHeader) + (size_t)slot * sizeof(AccelLogRecord);
+    if (offset + sizeof(*rec) > len) {
+      memset(rec, 0, sizeof(*rec));
+      return;
+    }
+    memcpy(rec, data + offset, sizeof(*rec));
+  };
+
+  if (header.capacity != ACCEL_LOG_CAPACITY) {
+    // 容量改变：按旧容量取出最新的记录，重建日志
+    std::vector<AccelerationData> records;
+    uint32_t count = header.total < header.capacity ? header.total : header.capacity;
+    for (uint32_t i = count; i > 0; i--) {
+      uint32_t seq = header.total - i + 1;
+      AccelLogRecord rec;
+      read_slot((seq - 1) % header.capacity, &rec);
+      if (rec.seq == seq) {
+        AccelerationData item;
+        from_record(rec, &item);
+        records.push_back(item);
+      }
+    }
+    rebuild_locked(records);
+    printf("[GNSS] 加速度记录容量改为 %u\n", (unsigned)ACCEL_LOG_CAPACITY);
+    return;
+  }
+
+  for (uint32_t i = 0; i < ACCEL_LOG_CAPACITY; i++) {
+    read_slot(i, &g_records[i]);
+  }
+  g_total = header.total;
+
+  // 文件头与最新记录不一致时扫描所有槽找出最大序号
+  if (g_total > 0 && g_records[record_slot(g_total)].seq != g_total) {
+    uint32_t max_seq = 0;
+    for (uint32_t i = 0; i < ACCEL_LOG_CAPACITY; i++) {
+      uint32_t seq = g_records[i].seq;
+      if (seq > max_seq && record_slot(seq) == i) max_seq = seq;
+    }
+    printf("[GNSS] 加速度记录文件头已修复: %u -> %u\n", (unsigned)g_total, (unsigned)max_seq);
+    g_total = max_seq;
+  }
+}
+
+/**
+ * 追加一条记录 (调用者持有锁，日志已读入)
+ */
+static bool append_locked(const AccelerationData& data)
+{
+  uint32_t seq = g_total + 1;
+  AccelLogRecord* rec = &g_records[record_slot(seq)];
+  to_record(data, seq, rec);
+  g_total = seq;
+
+  // 先写记录再写文件头，同一类别的请求按顺序执行
+  AccelLogHeader header;
+  make_header(seq, &header);
+  bool ok = sd_io_write_at(ACCEL_LOG_PATH, record_offset(seq), rec, sizeof(*rec), SD_IO_STATS);
+  ok = ok && sd_io_write_at(ACCEL_LOG_PATH, 0, &header, sizeof(header), SD_IO_STATS);
+
+  if (ok) printf("[GNSS] 保存加速度记录 #%u\n", (unsigned)seq);
+  return ok;
+}
+
+/**
+ * 日志读取完成 (在I/O线程中调用)
+ */
+static void log_loaded(void* ctx, char* data, size_t len)
+{
+  (void)ctx;
+
+  pthread_mutex_lock(&g_log_mutex);
+  parse_locked(data, len);
+  g_loaded = true;
+
+  for (const AccelerationData& item : g_pending) {
+    append_locked(item);
+  }
+  g_pending.clear();
+  pthread_mutex_unlock(&g_log_mutex);
+}
+
+/**
+ * 在I/O线程中读取日志
+ */
+void accel_log_init()
+{
+  pthread_mutex_lock(&g_log_mutex);
+  bool loaded = g_loaded;
+  pthread_mutex_unlock(&g_log_mutex);
+  if (loaded) return;
+
+  if (!sd_io_read_file(ACCEL_LOG_PATH, SD_IO_STATS, log_loaded, nullptr)) {
+    printf("[GNSS] 读取加速度记录失败\n");
+  }
+}
+
+/**
+ * 追加一条记录
+ */
+bool accel_log_append(const AccelerationData& data)
+{
+  pthread_mutex_lock(&g_log_mutex);
+  bool ok = true;
+  if (g_loaded) {
+    ok = append_locked(data);
+  } else {
+    g_pending.push_back(data);
+  }
+  pthread_mutex_unlock(&g_log_mutex);
+  return ok;
+}
+
+/**
+ * 记录数
+ */
+uint32_t accel_log_count()
+{
+  pthread_mutex_lock(&g_log_mutex);
+  uint32_t count = g_total < ACCEL_LOG_CAPACITY ? g_total : ACCEL_LOG_CAPACITY;
+  pthread_mutex_unlock(&g_log_mutex);
+  return count;
+}
+
+/**
+ * 读取第index条记录 (0为最新)
+ */
+bool accel_log_get(uint32_t index, AccelerationData* data)
+{
+  if (!data) return false;
+
+  pthread_mutex_lock(&g_log_mutex);
+  uint32_t count = g_total < ACCEL_LOG_CAPACITY ? g_total : ACCEL_LOG_CAPACITY;
+  uint32_t seq = g_total - index;
+  bool ok = index < count && g_records[record_slot(seq)].seq == seq;
+  if (ok) from_record(g_records[record_slot(seq)], data);
+  pthread_mutex_unlock(&g_log_mutex);
+  return ok;
+}
@@ -0,0 +1,39 @@
+/****************************************************************************
+ * gnss_accel_log.h
+ *
+ * 加速记录日志：固定数量的定长记录组成环形文件，文件头保存已写入的总数，
+ * 新记录覆盖最旧的一条，只写一个记录和文件头，不再重写整个历史。
+ * 启动时由SD卡I/O线程读入整个日志 (容量 x 40字节)，之后读取记录只访问内存，
+ * 界面线程从不等待SD卡
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+
+// 保留的记录数
+#ifdef CONFIG_SPRESENSEWONG_ACCEL_HISTORY_SIZE
+#define ACCEL_LOG_CAPACITY CONFIG_SPRESENSEWONG_ACCEL_HISTORY_SIZE
+#else
+#define ACCEL_LOG_CAPACITY 50
+#endif
+
+// 日志文件
+#define ACCEL_LOG_PATH "/sd/acceleration/accel_history.log"
+
+// 旧版JSON历史 (第一次打开日志时导入)
+#define ACCEL_LEGACY_JSON_PATH "/sd/acceleration/accel_history.json"
+
+// 在I/O线程中读取日志 (没有日志时导入旧版JSON)，启动时调用一次
+// 读取完成前记录数为0，期间追加的记录在读取完成后写入
+void accel_log_init();
+
+// 追加一条记录
+bool accel_log_append(const AccelerationData& data);
+
+// 记录数
+uint32_t accel_log_count();
+
+// 读取第index条记录 (0为最新，只访问内存)
+bool accel_log_get(uint32_t index, AccelerationData* data);
@@ -0,0 +1,235 @@
+/****************************************************************************
+ * gnss_accel_timer.cpp
+ *
+ * 加速计时实现
+ * 越过阈值的时刻用最近几个样本拟合的直线求解，并限制在前后两个历元之间，
+ * 单个样本的速度噪声被平均掉；起步时刻用起步后的样本拟合外推到零速，
+ * 并限制在最后一个静止样本之后
+ * ***************************************************************************/
+#include "gnss_accel_timer.h"
+#include <string.h>
+
+// 各阈值的速度 (km/h)，与AccelThreshold对应
+static const float THRESHOLD_KMH[ACCEL_KMH_COUNT] = { 30.0f, 50.0f, 60.0f, 100.0f };
+
+/**
+ * 清空计时器
+ */
+void accel_timer_reset(AccelTimer* timer)
+{
+  memset(timer, 0, sizeof(*timer));
+  timer->state = ACCEL_TIMER_IDLE;
+  timer->start_ms = -1;
+  for (int i = 0; i < ACCEL_KMH_COUNT; i++) timer->cross_ms[i] = -1;
+}
+
+/**
+ * 第back个历史样本 (0为最新)
+ */
+static const AccelSample& sample_at(const AccelTimer* timer, int back)
+{
+  int index = (timer->head + ACCEL_TIMER_HISTORY - 1 - back) % ACCEL_TIMER_HISTORY;
+  return timer->history[index];
+}
+
+// 拟合越过时刻使用的样本数
+#define CROSS_FIT_SAMPLES 4
+
+/**
+ * 对最新的n个样本做最小二乘直线拟合，在[lo, hi]内求速度等于v的时刻
+ * 时间以最新样本为零点，单精度也有足够的分辨率；拟合失败返回false
+ */
+static bool fit_time(const AccelTimer* timer, int n, float v, int64_t lo, int64_t hi, int64_t* time_ms)
+{
+  if (n > timer->count) n = timer->count;
+  if (n < 2) return false;
+
+  int64_t t_ref = sample_at(timer, 0).time_ms;
+  float sx = 0.0f, sy = 0.0f, sxx = 0.0f, sxy = 0.0f;
+  for (int back = 0; back < n; back++) {
+    const AccelSample& s = sample_at(timer, back);
+    float x = (float)(s.time_ms - t_ref);
+    sx += x;
+    sy += s.speed_kmh;
+    sxx += x * x;
+    sxy += x * s.speed_kmh;
+  }
+
+  float denom = n * sxx - sx * sx;
+  if (denom <= 0.0f) return false;
+  float slope = (n * sxy - sx * sy) / denom;
+  if (slope <= 0.0f) return false;
+  float intercept = (sy - slope * sx) / n;
+
+  int64_t t = t_ref + (int64_t)((v - intercept) / slope);
+  if (t < lo) t = lo;
+  if (t > hi) t = hi;
+  *time_ms = t;
+  return true;
+}
+
+/**
+ * 在a和b之间插值出速度等于v的时刻
+ */
+static int64_t interpolate_ms(const AccelSample& a, const AccelSample& b, float v)
+{
+  float dv = b.speed_kmh - a.speed_kmh;
+  if (dv <= 0.0f) return b.time_ms;
+  float ratio = (v - a.speed_kmh) / dv;
+  return a.time_ms + (int64_t)(ratio * (float)(b.time_ms - a.time_ms) + 0.5f);
+}
+
+/**
+ * 估计起步时刻
+ * 找到最后一个静止样本，用它之后的运动样本拟合外推到零速；
+ * 只有一个运动样本时只能取静止样本的时刻
+ */
+static int64_t estimate_start(const AccelTimer* timer)
+{
+  int rest = -1;
+  for (int back = 1; back < timer->count; back++) {
+    if (sample_at(timer, back).speed_kmh < ACCEL_TIMER_STOP_KMH) {
+      rest = back;
+      break;
+    }
+  }
+
+  // 低速蠕行太久，静止样本已经不在历史中
+  if (rest < 0) return sample_at(timer, timer->count - 1).time_ms;
+
+  // 低于静止阈值不代表完全静止，零速时刻可能在静止样本之前一个历元内
+  const AccelSample& r = sample_at(timer, rest);
+  const AccelSample& n1 = sample_at(timer, rest - 1);
+  int64_t lo = r.time_ms - (n1.time_ms - r.time_ms);
+  if (rest + 1 < timer->count) lo = sample_at(timer, rest + 1).time_ms;
+
+  int64_t t0;
+  if (!fit_time(timer, rest, 0.0f, lo, n1.time_ms, &t0)) return r.time_ms;
+  return t0;
+}
+
+/**
+ * 检查上一个样本到当前样本之间越过的阈值
+ */
+static uint32_t check_crossings(AccelTimer* timer)
+{
+  const AccelSample& prev = sample_at(timer, 1);
+  const AccelSample& cur = sample_at(timer, 0);
+
+  uint32_t events = 0;
+  for (int i = 0; i < ACCEL_KMH_COUNT; i++) {
+    float v = THRESHOLD_KMH[i];
+    if (timer->cross_ms[i] < 0 && prev.speed_kmh < v && cur.speed_kmh >= v) {
+      // 拟合失败 (速度不单调) 时退回到相邻两点插值
+      if (!fit_time(timer, CROSS_FIT_SAMPLES, v, prev.time_ms, cur.time_ms, &timer->cross_ms[i])) {
+        timer->cross_ms[i] = interpolate_ms(prev, cur, v);
+      }
+      events |= ACCEL_EVENT_CROSS;
+    }
+  }
+  return events;
+}
+
+/**
+ * 结束本次计时
+ */
+static uint32_t finish(AccelTimer* timer, bool aborted)
+{
+  timer->state = ACCEL_TIMER_DONE;
+  timer->aborted = aborted;
+  return ACCEL_EVENT_END;
+}
+
+/**
+ * 输入一个历元的速度
+ */
+uint32_t accel_timer_update(AccelTimer* timer, int64_t time_ms, float speed_kmh)
+{
+  uint32_t events = 0;
+
+  if (timer->count > 0) {
+    int64_t gap = time_ms - sample_at(timer, 0).time_ms;
+    if (gap <= 0) return 0;  // 重复或倒退的历元
+
+    // 间隔太长无法插值，丢弃历史重新开始
+    if (gap > ACCEL_TIMER_MAX_GAP_MS) {
+      if (timer->state == ACCEL_TIMER_RUNNING) events |= finish(timer, true);
+      timer->count = 0;
+      if (timer->state == ACCEL_TIMER_ARMED) timer->state = ACCEL_TIMER_IDLE;
+    }
+  }
+
+  timer->history[timer->head].time_ms = time_ms;
+  timer->history[timer->head].speed_kmh = speed_kmh;
+  timer->head = (timer->head + 1) % ACCEL_TIMER_HISTORY;
+  if (timer->count < ACCEL_TIMER_HISTORY) timer->count++;
+
+  switch (timer->state) {
+    case ACCEL_TIMER_IDLE:
+    case ACCEL_TIMER_DONE:
+      if (speed_kmh < ACCEL_TIMER_STOP_KMH) timer->state = ACCEL_TIMER_ARMED;
+      return events;
+
+    case ACCEL_TIMER_ARMED:
+      if (speed_kmh < ACCEL_TIMER_LAUNCH_KMH || timer->count < 2) return events;
+
+      // 起步：清空上一次的结果
+      timer->start_ms = estimate_start(timer);
+      for (int i = 0; i < ACCEL_KMH_COUNT; i++) timer->cross_ms[i] = -1;
+      timer->max_kmh = 0.0f;
+      timer->aborted = false;
+      timer->state = ACCEL_TIMER_RUNNING;
+      events |= ACCEL_EVENT_START;
+      break;
+
+    case ACCEL_TIMER_RUNNING:
+      break;
+  }
+
+  // 计时中
+  events |= check_crossings(timer);
+  if (speed_kmh > timer->max_kmh) timer->max_kmh = speed_kmh;
+
+  if (timer->cross_ms[ACCEL_KMH_COUNT - 1] >= 0) {
+    events |= finish(timer, false);
+  } else if (speed_kmh < timer->max_kmh - ACCEL_TIMER_LIFT_KMH) {
+    events |= finish(timer, false);
+  } else if (time_ms - timer->start_ms > ACCEL_TIMER_TIMEOUT_MS) {
+    events |= finish(timer, true);
+  }
+
+  return events;
+}
+
+/**
+ * 阈值速度对应的序号
+ */
+static int threshold_index(float kmh)
+{
+  for (int i = 0; i < ACCEL_KMH_COUNT; i++) {
+    if (THRESHOLD_KMH[i] == kmh) return i;
+  }
+  return -1;
+}
+
+/**
+ * from_kmh到to_kmh的用时
+ */
+float accel_timer_time(const AccelTimer& timer, float from_kmh, float to_kmh)
+{
+  if (timer.start_ms < 0) return -1.0f;
+
+  int to = threshold_index(to_kmh);
+  if (to < 0 || timer.cross_ms[to] < 0) return -1.0f;
+
+  int64_t from_ms;
+  if (from_kmh == 0.0f) {
+    from_ms = timer.start_ms;
+  } else {
+    int from = threshold_index(from_kmh);
+    if (from < 0 || timer.cross_ms[from] < 0) return -1.0f;
+    from_ms = timer.cross_ms[from];
+  }
+
+  return (float)(timer.cross_ms[to] - from_ms) / 1000.0f;
+}
@@ -0,0 +1,79 @@
+/****************************************************************************
+ * gnss_accel_timer.h
+ *
+ * 加速计时：用接收机的历元时间 (UTC毫秒) 而不是time(NULL)计时，
+ * 保留最近几个速度样本，在相邻两个历元之间线性插值出速度越过各个
+ * 阈值的时刻。起步时刻由起步后的前两个样本外推到零速得到，
+ * 一次起步同时得到0-30、0-50、0-60、0-100和60-100等分段时间
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 保留的速度样本数 (10Hz下1.6秒)
+#define ACCEL_TIMER_HISTORY 16
+
+// 低于该速度 (km/h) 视为静止，可以开始下一次计时
+#define ACCEL_TIMER_STOP_KMH 2.0f
+
+// 从静止超过该速度 (km/h) 视为起步
+#define ACCEL_TIMER_LAUNCH_KMH 5.0f
+
+// 速度低于本次最高速度这么多 (km/h) 视为松油门，计时结束
+#define ACCEL_TIMER_LIFT_KMH 5.0f
+
+// 单次计时的最长时间 (毫秒)
+#define ACCEL_TIMER_TIMEOUT_MS 60000
+
+// 历元间隔超过该值 (毫秒) 时不再插值，计时作废
+#define ACCEL_TIMER_MAX_GAP_MS 1500
+
+// 记录越过时刻的速度阈值
+enum AccelThreshold {
+  ACCEL_KMH_30 = 0,
+  ACCEL_KMH_50,
+  ACCEL_KMH_60,
+  ACCEL_KMH_100,
+  ACCEL_KMH_COUNT
+};
+
+// 计时状态
+enum AccelTimerState {
+  ACCEL_TIMER_IDLE = 0,    // 等待静止
+  ACCEL_TIMER_ARMED,       // 静止，等待起步
+  ACCEL_TIMER_RUNNING,     // 计时中
+  ACCEL_TIMER_DONE         // 本次计时结束，结果保留到下一次起步
+};
+
+// accel_timer_update返回的事件
+#define ACCEL_EVENT_START 0x01   // 起步
+#define ACCEL_EVENT_CROSS 0x02   // 越过了某个阈值
+#define ACCEL_EVENT_END   0x04   // 计时结束
+
+// 速度样本
+struct AccelSample {
+  int64_t time_ms;
+  float speed_kmh;
+};
+
+// 计时器状态
+struct AccelTimer {
+  AccelSample history[ACCEL_TIMER_HISTORY];
+  uint8_t head;                       // 下一个写入位置
+  uint8_t count;
+  AccelTimerState state;
+  bool aborted;                       // 因中断或超时结束
+  int64_t start_ms;                   // 起步时刻
+  int64_t cross_ms[ACCEL_KMH_COUNT];  // 越过各阈值的时刻，-1表示未达到
+  float max_kmh;                      // 本次最高速度
+};
+
+// 清空计时器
+void accel_timer_reset(AccelTimer* timer);
+
+// 输入一个历元的速度，返回ACCEL_EVENT_*的组合
+uint32_t accel_timer_update(AccelTimer* timer, int64_t time_ms, float speed_kmh);
+
+// from_kmh到to_kmh的用时 (秒)，from_kmh为0表示从起步开始；未达到或阈值不在表中返回-1
+float accel_timer_time(const AccelTimer& timer, float from_kmh, float to_kmh);
@@ -4,37 +4,69 @@
  * GNSS 数据管理模块实现 - 处理GNSS数据、计算距离、速度、存储轨迹等
  * ***************************************************************************/
 #include "gnss_data.h"
+#include "gnss_ring.h"
+#include "gnss_track_store.h"
+#include "gnss_track_writer.h"
+#include "gnss_accel_log.h"
+#include "gnss_json.h"
+#include "gnss_worker.h"
+#include "gnss_filter.h"
+#include "gnss_accel_timer.h"
+#include "gnss_stats.h"
+#include "gnss_replay.h"
+#include "gnss_distance.h"
+#include "perf_probe.h"
+#include "sd_io.h"
 #include "cxd56_gnss.h"
 #include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <errno.h>
 #include <math.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <pthread.h>
 #include <arch/chip/gnss.h>
+#include <algorithm>
 
 // Spresense GNSS操作全局变量
 static int g_fd = -1;             // 文件描述符
 static GnssUpdateRate g_rate = GNSS_RATE_1HZ;  // 默认1Hz
+static uint32_t g_cycle_ms = GNSS_RATE_1HZ;    // 接收机当前的定位周期 (低速率时大于g_rate，分析线程读)
+static GnssPowerMode g_power_mode = GNSS_POWER_FULL;
+static uint32_t g_last_moving_sec = 0;         // 最后一次运动的时间 (单调时钟秒，分析线程写)
 static bool g_running = false;    // 是否已启动
+// 接收机的启停和配置 (更新频率在主线程设置，省电档位在GNSS线程切换) 都在这把锁内完成，
+// 停止-设置周期-启动不会交错；g_running/g_rate/g_power_mode只在锁内修改
+static pthread_mutex_t g_receiver_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool g_recording = false;  // 是否记录轨迹
 static GnssPoint g_last_point;    // 上一个定位点
 static GnssPoint g_current_point; // 当前定位点
 static bool g_has_last_point = false;  // 是否有上一个点
+static uint64_t g_last_epoch_timestamp = 0; // 上一个已处理历元的时间戳(用于去重)
+static DistanceCache g_distance_cache;      // 里程累计用的cos(纬度)缓存
+static GnssFilter g_filter;                 // 位置/速度/加速度滤波 (只在分析线程中使用)
+static GnssReplay g_replay;                 // 轨迹回放 (打开时代替接收机)
 
-// 用于百米加速计算
-static bool g_accel_start = false;  // 已开始加速测试
-static float g_accel_start_time = 0;  // 加速开始时间
-static float g_speed_threshold_kmh = 5.0f; // 开始加速的速度阈值 (km/h)
-
-// 加速度测量历史记录
-static std::vector<AccelerationData> g_acceleration_history;
+// 加速计时 (百米加速和30/50加速测量共用)
+static AccelTimer g_accel_timer;
+static time_t g_last_fix_time = 0;    // 最后一次有效定位的接收时刻
 
 // 行程数据
-static TripData g_trip_data;
-static std::vector<GnssPoint> g_track_points;  // 轨迹点记录
+static TripData g_trip_data;               // 轨迹点记录在gnss_track_store中
+static StatsAccum g_trip_stats;            // 行程累计统计
+static StatsAccum g_segment_stats;         // 当前分段累计统计
+static StatsWindow g_window_1km;           // 最近1公里
+static StatsWindow g_window_5min;          // 最近5分钟
+
+// 行程数据快照：GNSS线程每个历元发布一次，其他线程只读快照
+static pthread_mutex_t g_snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TripData g_trip_snapshot;
+static bool g_snapshot_valid = false;
 
 // 分段相关变量
 static SegmentSettings g_segment_settings = {
@@ -46,29 +78,76 @@ static time_t g_last_gps_time = 0;       // 最后一次有效GPS定位的时间
 static time_t g_last_segment_time = 0;   // 上一次分段的时间
 static bool g_has_lost_fix = false;      // 是否已失去定位
 
-// 计算两点的距离(米)
-static double calculate_distance(double lat1, double lon1, double lat2, double lon2)
+static void process_epoch(const GnssRawEpoch& epoch);
+
+/**
+ * 发布行程数据快照
+ * 使用trylock，读者正在拷贝时跳过本次发布，GNSS线程从不阻塞
+ */
+static void publish_trip_snapshot()
 {
-  // 将经纬度转换为弧度
-  double lat1_rad = lat1 * M_PI / 180.0;
-  double lon1_rad = lon1 * M_PI / 180.0;
-  double lat2_rad = lat2 * M_PI / 180.0;
-  double lon2_rad = lon2 * M_PI / 180.0;
+  if (pthread_mutex_trylock(&g_snapshot_mutex) != 0) {
+    return;
+  }
   
-  // Haversine公式
-  double dlon = lon2_rad - lon1_rad;
-  double dlat = lat2_rad - lat1_rad;
-  double a = sin(dlat/2) * sin(dlat/2) + cos(lat1_rad) * cos(lat2_rad) * sin(dlon/2) * sin(dlon/2);
-  double c = 2 * atan2(sqrt(a), sqrt(1-a));
-  double distance = 6371000.0 * c;  // 地球半径约为6371km
+  g_trip_snapshot = g_trip_data;
+  g_snapshot_valid = true;
+  pthread_mutex_unlock(&g_snapshot_mutex);
+}
+
+/**
+ * 把接收机的UTC日期时间转换为time_t (不依赖时区和RTC)
+ */
+static time_t make_utc_time(const struct cxd56_gnss_date_s& date,
+                            const struct cxd56_gnss_time_s& tm)
+{
+  // 接收机未授时时日期为默认值
+  if (date.year < 2000) return 0;
+  
+  // 公历日期转换为1970-01-01起的天数
+  int y = date.year;
+  int m = date.month;
+  if (m <= 2) y--;
+  int era = y / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + date.day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  long days = (long)era * 146097 + doe - 719468;
+  
+  return (time_t)(days * 86400L + tm.hour * 3600L + tm.minute * 60L + tm.sec);
+}
+
+/**
+ * 单调时钟 (秒)
+ */
+static uint32_t monotonic_sec()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)ts.tv_sec;
+}
+
+/**
+ * 设置接收机的定位周期 (接收机必须已停止)
+ */
+static bool set_cycle(uint32_t cycle_ms)
+{
+  struct cxd56_gnss_ope_mode_param_s mode_param;
+  memset(&mode_param, 0, sizeof(mode_param));
+  mode_param.mode = 0;   // 正常模式
+  mode_param.cycle = cycle_ms;
   
-  return distance;
+  if (ioctl(g_fd, CXD56_GNSS_IOCTL_SET_OPE_MODE, (unsigned long)&mode_param) < 0) {
+    return false;
+  }
+  __atomic_store_n(&g_cycle_ms, cycle_ms, __ATOMIC_RELAXED);
+  return true;
 }
 
 /**
- * 初始化GNSS
+ * 初始化GNSS (调用者持有g_receiver_mutex)
  */
-bool gnss_init()
+static bool init_locked()
 {
   // 检查是否已初始化
   if (g_fd >= 0) return true;
@@ -84,12 +163,9 @@ bool gnss_init()
   gnss_reset_trip();
   
   // 配置默认设置
-  struct cxd56_gnss_ope_mode_param_s mode_param;
-  memset(&mode_param, 0, sizeof(mode_param));
-  mode_param.mode = 0;   // 正常模式
-  mode_param.cycle = g_rate;  // 默认更新频率
-  
-  if (ioctl(g_fd, CXD56_GNSS_IOCTL_SET_OPE_MODE, (unsigned long)&mode_param) < 0) {
+  g_power_mode = GNSS_POWER_FULL;
+  __atomic_store_n(&g_last_moving_sec, monotonic_sec(), __ATOMIC_RELAXED);
+  if (!set_cycle(g_rate)) {
     printf("[GNSS] 设置操作模式失败\n");
     close(g_fd);
     g_fd = -1;
@@ -100,18 +176,32 @@ bool gnss_init()
   return true;
 }
 
+static bool start_locked();
+static void stop_locked();
+
+/**
+ * 初始化GNSS
+ */
+bool gnss_init()
+{
+  pthread_mutex_lock(&g_receiver_mutex);
+  bool ok = init_locked();
+  pthread_mutex_unlock(&g_receiver_mutex);
+  return ok;
+}
+
 /**
  * 关闭GNSS
  */
 void gnss_deinit()
 {
+  pthread_mutex_lock(&g_receiver_mutex);
   if (g_fd >= 0) {
-    if (g_running) {
-      gnss_stop();
-    }
+    stop_locked();
     close(g_fd);
     g_fd = -1;
   }
+  pthread_mutex_unlock(&g_receiver_mutex);
 }
 
 /**
@@ -119,86 +209,292 @@ void gnss_deinit()
  */
 bool gnss_set_update_rate(GnssUpdateRate rate)
 {
+  pthread_mutex_lock(&g_receiver_mutex);
+  
   // 必须先停止GNSS再设置
   bool was_running = g_running;
   if (was_running) {
-    gnss_stop();
+    stop_locked();
   }
   
   g_rate = rate;
   
-  // 重新设置操作模式
-  struct cxd56_gnss_ope_mode_param_s mode_param;
-  memset(&mode_param, 0, sizeof(mode_param));
-  mode_param.mode = 0;   // 正常模式
-  mode_param.cycle = g_rate;
-  
-  if (ioctl(g_fd, CXD56_GNSS_IOCTL_SET_OPE_MODE, (unsigned long)&mode_param) < 0) {
+  // 低速率和暂停时只记下设置，恢复全速率时生效
+  bool ok = true;
+  if (g_fd >= 0 && g_power_mode == GNSS_POWER_FULL && !set_cycle(g_rate)) {
     printf("[GNSS] 设置更新频率失败\n");
-    return false;
+    ok = false;
   }
   
-  // 如果之前在运行，则重新启动
+  // 如果之前在运行，则重新启动 (设置失败时也不能让接收机停着)
   if (was_running) {
-    return gnss_start();
+    ok = start_locked() && ok;
   }
   
-  return true;
+  pthread_mutex_unlock(&g_receiver_mutex);
+  return ok;
 }
 
 /**
- * 启动定位
+ * 获取当前更新频率
  */
-bool gnss_start()
+GnssUpdateRate gnss_get_update_rate()
+{
+  pthread_mutex_lock(&g_receiver_mutex);
+  GnssUpdateRate rate = g_rate;
+  pthread_mutex_unlock(&g_receiver_mutex);
+  return rate;
+}
+
+/**
+ * 接收机当前的定位周期 (毫秒)
+ */
+uint32_t gnss_get_cycle_ms()
+{
+  return g_cycle_ms;
+}
+
+/**
+ * 启动定位 (调用者持有g_receiver_mutex)
+ * 热启动：接收机保留的星历和时间仍有效时几秒内定位，失效时接收机自动按冷启动处理
+ */
+static bool start_locked()
 {
   if (g_fd < 0) {
-    if (!gnss_init()) return false;
+    if (!init_locked()) return false;
   }
   
   if (!g_running) {
-    if (ioctl(g_fd, CXD56_GNSS_IOCTL_START, 0) < 0) {
+    if (ioctl(g_fd, CXD56_GNSS_IOCTL_START, CXD56_GNSS_STMOD_HOT) < 0) {
       printf("[GNSS] 启动失败\n");
       return false;
     }
-    g_running = true;
+    __atomic_store_n(&g_running, true, __ATOMIC_RELAXED);
     printf("[GNSS] 开始定位\n");
+    
+    gnss_filter_reset(&g_filter);
+    
+    // 没有分析线程时在读取线程中直接分析
+    gnss_worker_start(process_epoch);
   }
   
   return true;
 }
 
 /**
- * 停止定位
+ * 停止定位 (调用者持有g_receiver_mutex)
  */
-void gnss_stop()
+static void stop_locked()
 {
   if (g_fd >= 0 && g_running) {
+    gnss_worker_stop();
     ioctl(g_fd, CXD56_GNSS_IOCTL_STOP, 0);
-    g_running = false;
+    __atomic_store_n(&g_running, false, __ATOMIC_RELAXED);
     printf("[GNSS] 停止定位\n");
   }
 }
 
 /**
- * 获取最新的定位数据
+ * 启动定位
  */
-bool gnss_get_position(GnssPoint* point)
+bool gnss_start()
 {
-  if (g_fd < 0 || !g_running) return false;
+  pthread_mutex_lock(&g_receiver_mutex);
+  bool ok = start_locked();
+  pthread_mutex_unlock(&g_receiver_mutex);
+  return ok;
+}
+
+/**
+ * 停止定位
+ */
+void gnss_stop()
+{
+  pthread_mutex_lock(&g_receiver_mutex);
+  stop_locked();
+  pthread_mutex_unlock(&g_receiver_mutex);
+}
+
+/**
+ * 设置省电档位
+ */
+bool gnss_set_power_mode(GnssPowerMode mode)
+{
+  pthread_mutex_lock(&g_receiver_mutex);
+  if (g_fd < 0 || mode == g_power_mode) {
+    pthread_mutex_unlock(&g_receiver_mutex);
+    return true;
+  }
   
-  struct cxd56_gnss_positiondata_s posdat;
-  int ret = read(g_fd, &posdat, sizeof(posdat));
+  GnssPowerMode old_mode = g_power_mode;
+  g_power_mode = mode;
   
-  if (ret < 0) {
-    printf("[GNSS] 读取位置数据失败: %d\n", errno);
-    return false;
-  } else if (ret != sizeof(posdat)) {
-    printf("[GNSS] 读取数据大小不匹配, 期望 %zu, 实际 %d\n", sizeof(posdat), ret);
-    return false;
+  if (mode == GNSS_POWER_SLEEP) {
+    // 保存星历等备份数据，恢复时热启动
+    ioctl(g_fd, CXD56_GNSS_IOCTL_SAVE_BACKUP_DATA, 0);
+    stop_locked();
+    pthread_mutex_unlock(&g_receiver_mutex);
+    return true;
   }
   
-  // 获取当前时间
-  time_t current_time = time(NULL);
+  // 从暂停恢复时重新开始计算静止时长，不会马上又降为低速率
+  if (old_mode == GNSS_POWER_SLEEP) {
+    __atomic_store_n(&g_last_moving_sec, monotonic_sec(), __ATOMIC_RELAXED);
+  }
+  
+  // 周期取锁内的g_rate，期间修改的更新频率不会被覆盖
+  stop_locked();
+  uint32_t cycle = (mode == GNSS_POWER_ECO) ? GNSS_POWER_ECO_CYCLE_MS : (uint32_t)g_rate;
+  bool ok = set_cycle(cycle);
+  if (!ok) {
+    printf("[GNSS] 设置定位周期失败: %u ms\n", (unsigned)cycle);
+  }
+  ok = start_locked() && ok;
+  
+  pthread_mutex_unlock(&g_receiver_mutex);
+  return ok;
+}
+
+/**
+ * 当前省电档位
+ */
+GnssPowerMode gnss_get_power_mode()
+{
+  pthread_mutex_lock(&g_receiver_mutex);
+  GnssPowerMode mode = g_power_mode;
+  pthread_mutex_unlock(&g_receiver_mutex);
+  return mode;
+}
+
+/**
+ * 连续静止的时长 (秒)
+ */
+uint32_t gnss_get_idle_seconds()
+{
+  return monotonic_sec() - __atomic_load_n(&g_last_moving_sec, __ATOMIC_RELAXED);
+}
+
+/**
+ * 把接收机数据换算成原始历元
+ */
+static void make_epoch(const struct cxd56_gnss_positiondata_s& posdat, GnssRawEpoch* epoch)
+{
+  GnssPoint& point = epoch->point;
+  
+  epoch->data_timestamp = posdat.data_timestamp;
+  epoch->fixmode = posdat.receiver.pos_fixmode;
+  epoch->hdop = posdat.receiver.pos_dop.hdop;
+  
+  point.latitude = posdat.receiver.latitude;
+  point.longitude = posdat.receiver.longitude;
+  point.altitude = posdat.receiver.altitude;
+  point.speed = posdat.receiver.velocity;
+  point.course = posdat.receiver.direction;
+  point.num_satellites = posdat.receiver.pos_svs;
+  point.timestamp = time(NULL);
+  point.acceleration = 0.0f;
+  point.utc_time = make_utc_time(posdat.receiver.date, posdat.receiver.time);
+  point.utc_msec = (uint16_t)(posdat.receiver.time.usec / 1000);
+  
+  // 设置定位类型
+  switch (posdat.receiver.pos_fixmode) {
+    case 1:
+      point.fix_type = FIX_NONE;
+      break;
+    case 2:
+      point.fix_type = FIX_2D;
+      break;
+    case 3:
+    case 4:
+      point.fix_type = FIX_3D;
+      break;
+    default:
+      point.fix_type = FIX_NONE;
+      break;
+  }
+}
+
+/**
+ * 自动加速测量：从静止起步时开始，测量中逐点检查，失去定位超过20秒时取消
+ */
+static void update_acceleration_measurement(const GnssPoint& point, time_t now)
+{
+  if (point.fix_type != FIX_NONE) {
+    g_last_fix_time = now;
+    
+    // 接收机授时后才有毫秒级的历元时间
+    uint32_t events = 0;
+    if (point.utc_time != 0) {
+      int64_t epoch_ms = (int64_t)point.utc_time * 1000 + point.utc_msec;
+      events = accel_timer_update(&g_accel_timer, epoch_ms, point.speed * 3.6f);
+    }
+    
+    if ((events & ACCEL_EVENT_START) && !g_trip_data.measuring_acceleration) {
+      printf("[GNSS] 检测到从静止到移动，自动开始加速度测量\n");
+      gnss_start_acceleration_measurement();
+    }
+    
+    gnss_detect_acceleration();
+    if (g_trip_data.measuring_acceleration) {
+      gnss_check_acceleration_measurement(point);
+    }
+  } else if (g_trip_data.measuring_acceleration && difftime(now, g_last_fix_time) > 20) {
+    gnss_stop_acceleration_measurement(false);
+  }
+}
+
+/**
+ * 相邻两个定位点的间隔 (毫秒)
+ * 授时后用UTC毫秒，否则按更新周期；间隔过长 (失去定位) 时不计时
+ */
+static uint32_t epoch_interval_ms(const GnssPoint& last, const GnssPoint& point)
+{
+  uint32_t cycle = __atomic_load_n(&g_cycle_ms, __ATOMIC_RELAXED);
+  if (last.utc_time == 0 || point.utc_time == 0) return cycle;
+  
+  // 省电档位的定位周期可能比中断阈值长，阈值至少放宽到两个周期
+  int64_t max_gap = GNSS_STATS_MAX_GAP_MS;
+  if (max_gap < 2 * (int64_t)cycle) max_gap = 2 * (int64_t)cycle;
+  
+  int64_t dt = ((int64_t)point.utc_time - last.utc_time) * 1000 + point.utc_msec - last.utc_msec;
+  if (dt <= 0 || dt > max_gap) return 0;
+  return (uint32_t)dt;
+}
+
+/**
+ * 把一个历元累加到行程和当前分段的统计中
+ */
+static void update_trip_stats(const StatsSample& sample, const GnssPoint& point)
+{
+  stats_add(&g_trip_stats, sample);
+  stats_window_add(&g_window_1km, sample);
+  stats_window_add(&g_window_5min, sample);
+  
+  stats_apply_trip(g_trip_stats, &g_trip_data);
+  g_trip_data.end_time = point.timestamp;
+  g_trip_data.avg_speed_1km = stats_window_avg_speed(g_window_1km);
+  g_trip_data.avg_speed_5min = stats_window_avg_speed(g_window_5min);
+  
+  if (g_trip_data.segments.empty()) return;
+  
+  SegmentData& segment = g_trip_data.segments.back();
+  stats_add(&g_segment_stats, sample);
+  stats_apply_segment(g_segment_stats, &segment);
+  segment.end_time = point.timestamp;
+  segment.end_lat = point.latitude;
+  segment.end_lon = point.longitude;
+}
+
+/**
+ * 处理一个历元：里程、分段、加速测量，结果发布给各消费者
+ * 分析线程运行时在分析线程中调用
+ */
+static void process_epoch(const GnssRawEpoch& epoch)
+{
+  PERF_SCOPE(PERF_TRIP_UPDATE);
+  
+  // 接收时刻
+  time_t current_time = epoch.point.timestamp;
   
   // 如果当前在记录模式且启用了分段功能
   if (g_recording && g_segment_settings.enabled && g_last_gps_time > 0) {
@@ -216,92 +512,211 @@ bool gnss_get_position(GnssPoint* point)
   }
   
   // 检查是否有有效定位
-  if (posdat.receiver.pos_fixmode != 0) {
-    // 更新数据点
-    GnssPoint new_point;
-    new_point.latitude = posdat.receiver.latitude;
-    new_point.longitude = posdat.receiver.longitude;
-    new_point.altitude = posdat.receiver.altitude;
-    new_point.speed = posdat.receiver.velocity;
-    new_point.course = posdat.receiver.direction;
-    new_point.num_satellites = posdat.receiver.pos_svs;
-    new_point.timestamp = time(NULL);
-    
-    // 设置定位类型
-    switch (posdat.receiver.pos_fixmode) {
-      case 1:
-        new_point.fix_type = FIX_NONE;
-        break;
-      case 2:
-        new_point.fix_type = FIX_2D;
-        break;
-      case 3:
-      case 4:
-        new_point.fix_type = FIX_3D;
-        break;
-      default:
-        new_point.fix_type = FIX_NONE;
-        break;
-    }
+  if (epoch.fixmode == 0) {
+    update_acceleration_measurement(epoch.point, current_time);
+    return;
+  }
+  
+  // 滤波后的位置、速度和加速度供里程、分段和加速测量使用
+  GnssPoint new_point = epoch.point;
+  if (new_point.fix_type != FIX_NONE) {
+    gnss_filter_update(&g_filter, &new_point, epoch.hdop,
+                       __atomic_load_n(&g_cycle_ms, __ATOMIC_RELAXED) / 1000.0f);
+  }
+  
+  // 省电调度用的静止时长：没有定位时不知道是否在动，按静止计
+  if (new_point.fix_type != FIX_NONE && new_point.speed >= GNSS_POWER_MOVING_SPEED) {
+    __atomic_store_n(&g_last_moving_sec, monotonic_sec(), __ATOMIC_RELAXED);
+  }
+  
+  // 保存位置数据
+  if (g_has_last_point) {
+    // 保存上一个点
+    g_last_point = g_current_point;
     
-    // 保存位置数据
-    if (g_has_last_point) {
-      // 保存上一个点
-      g_last_point = g_current_point;
+    // 如果正在记录，计算距离和保存轨迹点
+    if (g_recording && new_point.fix_type != FIX_NONE) {
+      // 静止时滤波器冻结位置，不计抖动；刚重新初始化的历元是原始定位，同样不计
+      StatsSample sample;
+      sample.moving = !g_filter.stationary && !g_filter.just_reset;
+      sample.distance = sample.moving ? gnss_distance_fast(&g_distance_cache,
+        g_last_point.latitude, g_last_point.longitude,
+        new_point.latitude, new_point.longitude
+      ) : 0.0f;
+      sample.dt_ms = epoch_interval_ms(g_last_point, new_point);
+      sample.speed = new_point.speed;
+      sample.altitude = (float)new_point.altitude;
+      sample.has_altitude = (new_point.fix_type == FIX_3D);
+      
+      // 重置无GPS定位计时
+      g_last_gps_time = new_point.timestamp;
       
-      // 如果正在记录，计算距离和保存轨迹点
-      if (g_recording && new_point.fix_type != FIX_NONE) {
-        double distance = calculate_distance(
-          g_last_point.latitude, g_last_point.longitude,
-          new_point.latitude, new_point.longitude
-        );
-        
-        // 更新行程累计距离
-        if (distance > 0.5) {  // 忽略小于0.5米的变动（减少噪声）
-          g_trip_data.total_distance += distance;
-          
-          // 更新当前分段的累计距离
-          if (!g_trip_data.segments.empty()) {
-            g_trip_data.segments.back().distance += distance;
-            g_trip_data.segments.back().end_time = new_point.timestamp;
-            g_trip_data.segments.back().duration = 
-              g_trip_data.segments.back().end_time - g_trip_data.segments.back().start_time;
-            g_trip_data.segments.back().point_count++;
-            
-            // 计算分段平均速度
-            if (g_trip_data.segments.back().duration > 0) {
-              g_trip_data.segments.back().avg_speed = 
-                g_trip_data.segments.back().distance / g_trip_data.segments.back().duration;
-            }
-          }
-          
-          // 重置无GPS定位计时
-          g_last_gps_time = new_point.timestamp;
-          
-          // 如果之前失去过定位，并已经满足分段时间，创建新分段
-          if (g_has_lost_fix && g_segment_settings.enabled) {
-            uint32_t segment_time = g_segment_settings.option == SEGMENT_TIME_CUSTOM ? 
-                             g_segment_settings.custom_time_sec : 
-                             (uint32_t)g_segment_settings.option;
-            gnss_create_new_segment();
-            g_last_segment_time = new_point.timestamp;
-            g_has_lost_fix = false;
-            printf("[GNSS] 检测到GPS重新获得定位，创建新分段\n");
-          }
-        }
-        
-        // 记录轨迹点
-        g_track_points.push_back(new_point);
+      // 如果之前失去过定位，并已经满足分段时间，创建新分段
+      if (g_has_lost_fix && g_segment_settings.enabled) {
+        gnss_create_new_segment();
+        g_last_segment_time = new_point.timestamp;
+        g_has_lost_fix = false;
+        printf("[GNSS] 检测到GPS重新获得定位，创建新分段\n");
       }
+      
+      update_trip_stats(sample, new_point);
+      
+      // 轨迹存储保留全速率的点，抽稀只用于gnss_track_writer写入的轨迹文件
+      track_store_append(new_point);
     }
-    
-    // 检测百米加速
-    gnss_detect_acceleration();
   }
   
+  // 更新当前点
+  g_current_point = new_point;
+  g_has_last_point = true;
+  
+  // 加速计时，检测百米加速和30/50加速测量
+  update_acceleration_measurement(new_point, current_time);
+  
+  // 发布给SD轨迹记录 (界面和统计读取快照)
+  if (new_point.fix_type != FIX_NONE) {
+    gnss_ring_push(new_point);
+  }
+  publish_trip_snapshot();
+}
+
+/**
+ * 分发一个历元：分析交给分析线程 (未启动时直接处理)
+ */
+static bool dispatch_epoch(const GnssRawEpoch& epoch, GnssPoint* point)
+{
+  // 同一历元只处理一次，避免10Hz下重复计入
+  if (epoch.data_timestamp == g_last_epoch_timestamp) {
+    return false;
+  }
+  g_last_epoch_timestamp = epoch.data_timestamp;
+  
+  if (!gnss_worker_running()) {
+    process_epoch(epoch);
+  } else {
+    gnss_worker_post(epoch);
+  }
+  
+  if (epoch.fixmode == 0) return false;
+  
+  if (point) {
+    *point = epoch.point;
+  }
+  return epoch.point.fix_type != FIX_NONE;
+}
+
+/**
+ * 获取最新的定位数据
+ * 这里只读取和换算历元，回放时从轨迹文件取历元
+ */
+bool gnss_get_position(GnssPoint* point)
+{
+  GnssRawEpoch epoch;
+  
+  if (g_replay.open) {
+    uint32_t read_start = perf_now();
+    bool ok = gnss_replay_next(&g_replay, &epoch);
+    PERF_RECORD(PERF_GNSS_READ, read_start);
+    return ok && dispatch_epoch(epoch, point);
+  }
+  
+  if (g_fd < 0 || !__atomic_load_n(&g_running, __ATOMIC_RELAXED)) return false;
+  
+  struct cxd56_gnss_positiondata_s posdat;
+  uint32_t read_start = perf_now();
+  int ret = read(g_fd, &posdat, sizeof(posdat));
+  PERF_RECORD(PERF_GNSS_READ, read_start);
+  
+  if (ret < 0) {
+    printf("[GNSS] 读取位置数据失败: %d\n", errno);
+    return false;
+  } else if (ret != sizeof(posdat)) {
+    printf("[GNSS] 读取数据大小不匹配, 期望 %zu, 实际 %d\n", sizeof(posdat), ret);
+    return false;
+  }
+  
+  make_epoch(posdat, &epoch);
+  return dispatch_epoch(epoch, point);
+}
+
+/**
+ * 等待下一个定位历元并处理
+ * 事件驱动模式下阻塞在/dev/gps的poll()上，定位就绪时唤醒，每次只处理一个历元；
+ * 否则按更新周期的一半定时轮询
+ */
+bool gnss_wait_position(GnssPoint* point, int timeout_ms)
+{
+  if (g_replay.open) {
+    int wait_ms = gnss_replay_wait_ms(&g_replay);
+    if (wait_ms < 0 || wait_ms > timeout_ms) {
+      usleep(timeout_ms * 1000);
+      return false;
+    }
+    usleep(wait_ms * 1000);
+    return gnss_get_position(point);
+  }
+  
+  if (g_fd < 0 || !__atomic_load_n(&g_running, __ATOMIC_RELAXED)) {
+    usleep(timeout_ms * 1000);
+    return false;
+  }
+  
+#ifdef CONFIG_SPRESENSEWONG_GNSS_EVENT_DRIVEN
+  struct pollfd fds;
+  fds.fd = g_fd;
+  fds.events = POLLIN;
+  fds.revents = 0;
+  
+  int ret = poll(&fds, 1, timeout_ms);
+  if (ret < 0) {
+    if (errno != EINTR) {
+      printf("[GNSS] 等待定位数据失败: %d\n", errno);
+    }
+    return false;
+  } else if (ret == 0 || !(fds.revents & POLLIN)) {
+    // 超时，本周期没有新的历元
+    return false;
+  }
+#else
+  int wait_ms = (int)g_cycle_ms / 2;
+  usleep((wait_ms < timeout_ms ? wait_ms : timeout_ms) * 1000);
+#endif
+  
+  return gnss_get_position(point);
+}
+
+/**
+ * 开始回放轨迹
+ */
+bool gnss_start_replay(const char* trk_path, uint32_t rate_ms, uint32_t speedup)
+{
+  gnss_stop_replay();
+  if (!gnss_replay_open(&g_replay, trk_path, rate_ms, speedup)) return false;
+  
+  // 滤波器和统计按定位周期判断中断，重采样时同步 (不改变接收机设置)
+  if (rate_ms > 0) {
+    __atomic_store_n(&g_cycle_ms, rate_ms, __ATOMIC_RELAXED);
+  }
+  g_last_epoch_timestamp = 0;
   return true;
 }
 
+/**
+ * 结束回放
+ */
+void gnss_stop_replay()
+{
+  gnss_replay_close(&g_replay);
+}
+
+/**
+ * 距下一个回放历元的毫秒数
+ */
+int gnss_replay_wait()
+{
+  return gnss_replay_wait_ms(&g_replay);
+}
+
 /**
  * 检查是否定位成功
  */
@@ -323,9 +738,11 @@ int gnss_satellite_count()
  */
 void gnss_start_recording()
 {
+  if (gnss_worker_run([](void*) { gnss_start_recording(); }, nullptr)) return;
+  
   if (!g_recording) {
     g_recording = true;
-    g_track_points.clear();
+    track_store_open();
     gnss_reset_trip();
     g_trip_data.start_time = time(NULL);
     g_trip_data.end_time = g_trip_data.start_time;
@@ -342,9 +759,12 @@ void gnss_start_recording()
  */
 void gnss_stop_recording()
 {
+  if (gnss_worker_run([](void*) { gnss_stop_recording(); }, nullptr)) return;
+  
   if (g_recording) {
     g_recording = false;
-    printf("[GNSS] 停止记录轨迹，总点数: %zu\n", g_track_points.size());
+    track_store_close();
+    printf("[GNSS] 停止记录轨迹，总点数: %u\n", (unsigned)track_store_count());
   }
 }
 
@@ -357,11 +777,36 @@ bool gnss_is_recording()
 }
 
 /**
- * 获取当前行程数据
+ * 获取已记录的轨迹点数
  */
-const TripData* gnss_get_trip_data()
+uint32_t gnss_get_track_point_count()
 {
-  return &g_trip_data;
+  return track_store_count();
+}
+
+/**
+ * 把写满的轨迹块溢出到SD卡
+ */
+void gnss_flush_track()
+{
+  track_store_flush_pending();
+}
+
+/**
+ * 获取行程数据快照
+ */
+bool gnss_get_trip_snapshot(TripData* trip)
+{
+  if (!trip) return false;
+  
+  pthread_mutex_lock(&g_snapshot_mutex);
+  bool valid = g_snapshot_valid;
+  if (valid) {
+    *trip = g_trip_snapshot;
+  }
+  pthread_mutex_unlock(&g_snapshot_mutex);
+  
+  return valid;
 }
 
 /**
@@ -369,6 +814,9 @@ const TripData* gnss_get_trip_data()
  */
 void gnss_reset_trip()
 {
+  if (gnss_worker_run([](void*) { gnss_reset_trip(); }, nullptr)) return;
+  
+  gnss_distance_reset(&g_distance_cache);
   g_trip_data.total_distance = 0.0;
   g_trip_data.max_speed = 0.0;
   g_trip_data.avg_speed = 0.0;
@@ -377,8 +825,21 @@ void gnss_reset_trip()
   g_trip_data.end_time = 0;
   g_trip_data.has_0_100_time = false;
   g_trip_data.time_0_100 = 0.0f;
+  g_trip_data.has_60_100_time = false;
+  g_trip_data.time_60_100 = 0.0f;
   g_trip_data.max_altitude = 0.0;
   g_trip_data.min_altitude = 0.0;
+  g_trip_data.moving_time = 0;
+  g_trip_data.idle_time = 0;
+  g_trip_data.moving_avg_speed = 0.0f;
+  g_trip_data.elevation_gain = 0.0f;
+  g_trip_data.elevation_loss = 0.0f;
+  g_trip_data.avg_speed_1km = 0.0f;
+  g_trip_data.avg_speed_5min = 0.0f;
+  stats_reset(&g_trip_stats);
+  stats_reset(&g_segment_stats);
+  stats_window_init(&g_window_1km, true, GNSS_STATS_WINDOW_DISTANCE_M);
+  stats_window_init(&g_window_5min, false, GNSS_STATS_WINDOW_TIME_MS);
   
   // 重置分段数据
   g_trip_data.segment_count = 0;
@@ -387,8 +848,7 @@ void gnss_reset_trip()
   g_last_gps_time = 0;
   g_has_lost_fix = false;
   
-  g_accel_start = false;
-  g_accel_start_time = 0.0f;
+  accel_timer_reset(&g_accel_timer);
 }
 
 /**
@@ -398,79 +858,102 @@ double gnss_get_last_point_distance()
 {
   if (!g_has_last_point) return 0.0;
   
-  return calculate_distance(
+  DistanceCache cache;
+  gnss_distance_reset(&cache);
+  return gnss_distance_fast(&cache,
     g_last_point.latitude, g_last_point.longitude,
     g_current_point.latitude, g_current_point.longitude
   );
 }
 
+/**
+ * 格式化追加到字符串
+ */
+static void append_format(std::string* out, const char* fmt, ...)
+{
+  char buf[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  
+  if (n > 0) out->append(buf, ((size_t)n < sizeof(buf)) ? n : sizeof(buf) - 1);
+}
+
 /**
  * 保存轨迹到文件
+ * 先提交文件头替换旧文件，轨迹点按块追加，写卡由I/O线程完成
  */
 bool gnss_save_track(const char* filename)
 {
-  if (g_track_points.empty()) {
+  uint32_t point_count = track_store_count();
+  if (point_count == 0) {
     printf("[GNSS] 没有轨迹点可保存\n");
     return false;
   }
   
-  FILE* f = fopen(filename, "w");
-  if (!f) {
+  // 写入GPX格式的轨迹文件
+  std::string out;
+  append_format(&out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  append_format(&out, "<gpx version=\"1.1\" creator=\"Spresense GNSS Odometer\">\n");
+  append_format(&out, "<trk><name>Track %ld</name><trkseg>\n", (long)time(NULL));
+  if (!sd_io_write_file(filename, out.data(), out.size(), SD_IO_STATS)) {
     printf("[GNSS] 创建文件失败: %s\n", filename);
     return false;
   }
-  
-  // 写入GPX格式的轨迹文件
-  fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-  fprintf(f, "<gpx version=\"1.1\" creator=\"Spresense GNSS Odometer\">\n");
-  fprintf(f, "<trk><name>Track %ld</name><trkseg>\n", (long)time(NULL));
-  
-  // 写入轨迹点
-  for (const auto& pt : g_track_points) {
-    fprintf(f, "<trkpt lat=\"%.9f\" lon=\"%.9f\"><ele>%.2f</ele>", 
-            pt.latitude, pt.longitude, pt.altitude);
-    fprintf(f, "<time>%04d-%02d-%02dT%02d:%02d:%02dZ</time>",
-            2000, 1, 1, 0, 0, 0); // 简化版时间
-    fprintf(f, "<speed>%.2f</speed></trkpt>\n", pt.speed);
+  out.clear();
+  
+  // 写入轨迹点 (按块从溢出文件和内存中顺序读取)
+  TrackIterator it;
+  GnssPoint pt;
+  track_iter_begin(&it);
+  char line[192];
+  bool ok = true;
+  while (track_iter_next(&it, &pt)) {
+    int n = track_format_gpx_point(line, sizeof(line), pt);
+    out.append(line, n);
+    if (out.size() >= SD_IO_COALESCE_MAX) {
+      ok = sd_io_append(filename, out.data(), out.size(), SD_IO_STATS) && ok;
+      out.clear();
+    }
   }
   
-  fprintf(f, "</trkseg></trk></gpx>\n");
-  fclose(f);
+  track_iter_end(&it);
   
-  printf("[GNSS] 保存轨迹到: %s, %zu 个点\n", filename, g_track_points.size());
-  return true;
+  append_format(&out, "</trkseg></trk></gpx>\n");
+  ok = sd_io_append(filename, out.data(), out.size(), SD_IO_STATS) && ok;
+  sd_io_close(filename, SD_IO_STATS);
+  
+  printf("[GNSS] 保存轨迹到: %s, %u 个点\n", filename, (unsigned)point_count);
+  return ok;
 }
 
 /**
  * 检测百米加速
+ * 每次行程只记录第一次完整的0-100和60-100
  */
 void gnss_detect_acceleration()
 {
-  // 如果已经有记录，或无定位，则返回
-  if (g_trip_data.has_0_100_time || g_current_point.fix_type == FIX_NONE) {
+  if (g_current_point.fix_type == FIX_NONE) {
     return;
   }
   
-  // 速度转换为km/h
-  float speed_kmh = g_current_point.speed * 3.6f;
-  
-  // 开始加速检测
-  if (!g_accel_start && speed_kmh < g_speed_threshold_kmh) {
-    // 等待速度低于阈值
-    return;
-  } else if (!g_accel_start) {
-    // 开始记录加速
-    g_accel_start = true;
-    g_accel_start_time = g_trip_data.duration;
-    printf("[GNSS] 开始加速检测: %.1f s\n", g_accel_start_time);
+  if (!g_trip_data.has_0_100_time) {
+    float elapsed = accel_timer_time(g_accel_timer, 0.0f, 100.0f);
+    if (elapsed >= 0) {
+      g_trip_data.has_0_100_time = true;
+      g_trip_data.time_0_100 = elapsed;
+      printf("[GNSS] 0-100 km/h 加速时间: %.2f 秒\n", elapsed);
+    }
   }
   
-  // 检查是否达到100km/h
-  if (g_accel_start && speed_kmh >= 100.0f) {
-    float elapsed = g_trip_data.duration - g_accel_start_time;
-    g_trip_data.has_0_100_time = true;
-    g_trip_data.time_0_100 = elapsed;
-    printf("[GNSS] 0-100 km/h 加速时间: %.1f 秒\n", elapsed);
+  if (!g_trip_data.has_60_100_time) {
+    float elapsed = accel_timer_time(g_accel_timer, 60.0f, 100.0f);
+    if (elapsed >= 0) {
+      g_trip_data.has_60_100_time = true;
+      g_trip_data.time_60_100 = elapsed;
+      printf("[GNSS] 60-100 km/h 加速时间: %.2f 秒\n", elapsed);
+    }
   }
 }
 
@@ -479,6 +962,8 @@ void gnss_detect_acceleration()
  */
 void gnss_start_acceleration_measurement()
 {
+  if (gnss_worker_run([](void*) { gnss_start_acceleration_measurement(); }, nullptr)) return;
+  
   // 如果无定位或已在测量中，则返回
   if (g_current_point.fix_type == FIX_NONE || g_trip_data.measuring_acceleration) {
     return;
@@ -500,6 +985,10 @@ void gnss_start_acceleration_measurement()
  */
 void gnss_stop_acceleration_measurement(bool save_result)
 {
+  if (gnss_worker_run([](void* ctx) { gnss_stop_acceleration_measurement(*(bool*)ctx); }, &save_result)) {
+    return;
+  }
+  
   if (!g_trip_data.measuring_acceleration) {
     return;
   }
@@ -511,8 +1000,8 @@ void gnss_stop_acceleration_measurement(bool save_result)
     data.time_0_30 = g_trip_data.time_0_30;
     data.time_0_50 = g_trip_data.time_0_50;
     
-    // 计算测量期间达到的最大速度 (km/h)
-    data.max_speed_reached = g_trip_data.max_speed * 3.6f;
+    // 测量期间达到的最大速度 (km/h)
+    data.max_speed_reached = g_accel_timer.max_kmh;
     
     // 生成测量时间字符串
     struct tm* tm_info = localtime(&data.timestamp);
@@ -529,6 +1018,7 @@ void gnss_stop_acceleration_measurement(bool save_result)
 
 /**
  * 检查加速度测量
+ * 用时取自加速计时器，精确到历元之间的插值时刻
  */
 void gnss_check_acceleration_measurement(const GnssPoint& point)
 {
@@ -536,212 +1026,40 @@ void gnss_check_acceleration_measurement(const GnssPoint& point)
     return;
   }
   
-  // 速度转换为km/h
-  float speed_kmh = point.speed * 3.6f;
-  
   // 查看是否达到30km/h
-  if (!g_trip_data.reached_30kmh && speed_kmh >= 30.0f) {
-    time_t now = time(NULL);
-    float elapsed = difftime(now, g_trip_data.acceleration_start_time);
+  float elapsed = accel_timer_time(g_accel_timer, 0.0f, 30.0f);
+  if (!g_trip_data.reached_30kmh && elapsed >= 0) {
     g_trip_data.time_0_30 = elapsed;
     g_trip_data.reached_30kmh = true;
-    printf("[GNSS] 0-30 km/h 加速时间: %.1f 秒\n", elapsed);
+    printf("[GNSS] 0-30 km/h 加速时间: %.2f 秒\n", elapsed);
   }
   
   // 查看是否达到50km/h
-  if (!g_trip_data.reached_50kmh && speed_kmh >= 50.0f) {
-    time_t now = time(NULL);
-    float elapsed = difftime(now, g_trip_data.acceleration_start_time);
+  elapsed = accel_timer_time(g_accel_timer, 0.0f, 50.0f);
+  if (!g_trip_data.reached_50kmh && elapsed >= 0) {
     g_trip_data.time_0_50 = elapsed;
     g_trip_data.reached_50kmh = true;
-    printf("[GNSS] 0-50 km/h 加速时间: %.1f 秒\n", elapsed);
+    printf("[GNSS] 0-50 km/h 加速时间: %.2f 秒\n", elapsed);
     
     // 如果已达到50km/h，则算测量完成
     gnss_stop_acceleration_measurement(true);
+    return;
   }
   
-  // 如果测量超过60秒还没有达到50km/h，则放弃此次测量
-  time_t now = time(NULL);
-  if (difftime(now, g_trip_data.acceleration_start_time) > 60.0) {
-    printf("[GNSS] 测量超时，放弃\n");
+  // 松油门、中断或超过60秒还没有达到50km/h，则放弃此次测量
+  if (g_accel_timer.state != ACCEL_TIMER_RUNNING) {
+    printf("[GNSS] 加速中断，放弃\n");
     gnss_stop_acceleration_measurement(false);
   }
 }
 
 /**
  * 保存加速度测量结果
+ * 追加到环形日志，只写一条记录和文件头
  */
 bool gnss_save_acceleration_data(const AccelerationData& data)
 {
-  // 新增到列表开头，使得最新的在前面
-  g_acceleration_history.insert(g_acceleration_history.begin(), data);
-  
-  // 仅保留最近50条记录
-  if (g_acceleration_history.size() > 50) {
-    g_acceleration_history.resize(50);
-  }
-  
-  // 确保目录存在
-  struct stat st = {0};
-  if (stat("/sd/acceleration", &st) == -1) {
-    mkdir("/sd/acceleration", 0777);
-  }
-  
-  // 保存到JSON文件
-  char filename[64];
-  snprintf(filename, sizeof(filename), "/sd/acceleration/accel_history.json");
-  
-  FILE* f = fopen(filename, "w");
-  if (!f) {
-    printf("[GNSS] 创建加速度记录文件失败\n");
-    return false;
-  }
-  
-  // 写入JSON格式的数据
-  fprintf(f, "[\n");
-  for (size_t i = 0; i < g_acceleration_history.size(); i++) {
-    const AccelerationData& item = g_acceleration_history[i];
-    
-    fprintf(f, "  {\n");
-    fprintf(f, "    \"timestamp\": %ld,\n", (long)item.timestamp);
-    fprintf(f, "    \"time_0_30\": %.2f,\n", item.time_0_30);
-    fprintf(f, "    \"time_0_50\": %.2f,\n", item.time_0_50);
-    fprintf(f, "    \"max_speed\": %.2f,\n", item.max_speed_reached);
-    fprintf(f, "    \"date_time\": \"%s\"\n", item.date_time_str);
-    
-    // 最后一项不加逗号
-    fprintf(f, "  }%s\n", (i < g_acceleration_history.size() - 1) ? "," : "");
-  }
-  fprintf(f, "]\n");
-  
-  fclose(f);
-  printf("[GNSS] 保存加速度记录到: %s\n", filename);
-  return true;
-}
-
-/**
- * 获取加速度历史数据
- */
-std::vector<AccelerationData> gnss_get_acceleration_history()
-{
-  // 如果内存中有数据，直接返回
-  if (!g_acceleration_history.empty()) {
-    return g_acceleration_history;
-  }
-  
-  // 检查文件是否存在
-  char filename[64];
-  snprintf(filename, sizeof(filename), "/sd/acceleration/accel_history.json");
-  
-  FILE* f = fopen(filename, "r");
-  if (!f) {
-    printf("[GNSS] 加速度记录文件不存在\n");
-    return g_acceleration_history; // 返回空列表
-  }
-  
-  // 读取文件内容
-  fseek(f, 0, SEEK_END);
-  long fileSize = ftell(f);
-  rewind(f);
-  
-  char* buffer = (char*)malloc(fileSize + 1);
-  if (!buffer) {
-    printf("[GNSS] 内存分配失败\n");
-    fclose(f);
-    return g_acceleration_history;
-  }
-  
-  size_t bytesRead = fread(buffer, 1, fileSize, f);
-  fclose(f);
-  
-  if (bytesRead < fileSize) {
-    printf("[GNSS] 读取文件不完整\n");
-    free(buffer);
-    return g_acceleration_history;
-  }
-  
-  buffer[bytesRead] = '\0';
-  
-  // 简单解析JSON数组
-  try {
-    // 查找数组开始和结束
-    char* arr_start = strchr(buffer, '[');
-    char* arr_end = strrchr(buffer, ']');
-    
-    if (!arr_start || !arr_end || arr_end <= arr_start) {
-      throw std::runtime_error("Invalid JSON array");
-    }
-    
-    // 找到每个对象并解析
-    char* obj_start = arr_start + 1;
-    while (obj_start < arr_end) {
-      // 查找对象开始和结束
-      char* obj_begin = strchr(obj_start, '{');
-      if (!obj_begin || obj_begin > arr_end) break;
-      
-      char* obj_end = strchr(obj_begin, '}');
-      if (!obj_end || obj_end > arr_end) break;
-      
-      // 解析对象
-      AccelerationData data;
-      data.timestamp = 0;
-      data.time_0_30 = -1;
-      data.time_0_50 = -1;
-      data.max_speed_reached = 0;
-      strcpy(data.date_time_str, "");
-      
-      // 查找JSON字段
-      char* timestamp_str = strstr(obj_begin, "\"timestamp\":");
-      char* time_0_30_str = strstr(obj_begin, "\"time_0_30\":");
-      char* time_0_50_str = strstr(obj_begin, "\"time_0_50\":");
-      char* max_speed_str = strstr(obj_begin, "\"max_speed\":");
-      char* date_time_str = strstr(obj_begin, "\"date_time\":");
-      
-      // 解析时间戳
-      if (timestamp_str && timestamp_str < obj_end) {
-        data.timestamp = atol(timestamp_str + 12);
-      }
-      
-      // 解析加速时间
-      if (time_0_30_str && time_0_30_str < obj_end) {
-        data.time_0_30 = atof(time_0_30_str + 12);
-      }
-      
-      if (time_0_50_str && time_0_50_str < obj_end) {
-        data.time_0_50 = atof(time_0_50_str + 12);
-      }
-      
-      // 解析最大速度
-      if (max_speed_str && max_speed_str < obj_end) {
-        data.max_speed_reached = atof(max_speed_str + 13);
-      }
-      
-      // 解析日期时间字符串
-      if (date_time_str && date_time_str < obj_end) {
-        char* quote_start = strchr(date_time_str + 13, '"');
-        char* quote_end = quote_start ? strchr(quote_start + 1, '"') : NULL;
-        
-        if (quote_start && quote_end && quote_end > quote_start) {
-          int len = (quote_end - quote_start - 1) < 19 ? (quote_end - quote_start - 1) : 19;
-          strncpy(data.date_time_str, quote_start + 1, len);
-          data.date_time_str[len] = '\0';
-        }
-      }
-      
-      // 添加到列表
-      g_acceleration_history.push_back(data);
-      
-      // 移动到下一个对象
-      obj_start = obj_end + 1;
-    }
-    
-    printf("[GNSS] 从%s加载了%zu个加速度记录\n", filename, g_acceleration_history.size());
-  } catch (...) {
-    printf("[GNSS] 解析加速度记录JSON文件异常\n");
-  }
-  
-  free(buffer);
-  return g_acceleration_history;
+  return accel_log_append(data);
 }
 
 /**
@@ -749,29 +1067,20 @@ std::vector<AccelerationData> gnss_get_acceleration_history()
  */
 int gnss_get_acceleration_history_count()
 {
-  // 确保已加载历史数据
-  if (g_acceleration_history.empty()) {
-    gnss_get_acceleration_history();
-  }
-  
-  return g_acceleration_history.size();
+  return accel_log_count();
 }
 
 /**
- * 获取指定索引的加速度数据
+ * 获取指定索引的加速度数据 (0为最新)
+ * 返回的数据在下一次调用前有效
  */
 const AccelerationData* gnss_get_acceleration_data(uint32_t index)
 {
-  // 确保已加载历史数据
-  if (g_acceleration_history.empty()) {
-    gnss_get_acceleration_history();
-  }
-  
-  if (index >= g_acceleration_history.size()) {
+  static AccelerationData data;
+  if (!accel_log_get(index, &data)) {
     return nullptr;
   }
-  
-  return &g_acceleration_history[index];
+  return &data;
 }
 
 /**
@@ -856,18 +1165,11 @@ bool gnss_is_segment_enabled()
  */
 uint32_t gnss_get_segment_count()
 {
-  return g_trip_data.segment_count;
-}
-
-/**
- * 获取指定分段数据
- */
-const SegmentData* gnss_get_segment_data(uint32_t index)
-{
-  if (index < g_trip_data.segments.size()) {
-    return &g_trip_data.segments[index];
-  }
-  return nullptr;
+  // 分段由分析线程修改，其他线程从快照读取
+  pthread_mutex_lock(&g_snapshot_mutex);
+  uint32_t count = g_snapshot_valid ? g_trip_snapshot.segment_count : 0;
+  pthread_mutex_unlock(&g_snapshot_mutex);
+  return count;
 }
 
 /**
@@ -875,6 +1177,8 @@ const SegmentData* gnss_get_segment_data(uint32_t index)
  */
 void gnss_create_new_segment()
 {
+  if (gnss_worker_run([](void*) { gnss_create_new_segment(); }, nullptr)) return;
+  
   SegmentData segment;
   segment.distance = 0.0;
   segment.avg_speed = 0.0;
@@ -887,6 +1191,9 @@ void gnss_create_new_segment()
   segment.moving_time = 0;
   segment.idle_time = 0;
   segment.moving_avg_speed = 0.0f;
+  segment.max_speed = 0.0f;
+  segment.elevation_gain = 0.0f;
+  segment.elevation_loss = 0.0f;
   segment.start_lat = 0.0;
   segment.start_lon = 0.0;
   segment.end_lat = 0.0;
@@ -904,37 +1211,18 @@ void gnss_create_new_segment()
   
   g_trip_data.segments.push_back(segment);
   g_trip_data.segment_count = g_trip_data.segments.size();
+  stats_reset(&g_segment_stats);
   
   printf("[GNSS] 创建新分段 #%u\n", g_trip_data.segment_count);
 }
 
 /**
  * 计算两点间距离(米)
- * 使用Haversine公式计算球面距离
+ * 使用Haversine公式计算球面距离，相邻历元请使用gnss_distance_fast
  */
 double gnss_calculate_distance(double lat1, double lon1, double lat2, double lon2)
 {
-  // 地球半径（米）
-  const double earth_radius = 6371000.0;
-  
-  // 转化为弧度
-  double lat1_rad = lat1 * M_PI / 180.0;
-  double lon1_rad = lon1 * M_PI / 180.0;
-  double lat2_rad = lat2 * M_PI / 180.0;
-  double lon2_rad = lon2 * M_PI / 180.0;
-  
-  // 经纬度差值
-  double dlat = lat2_rad - lat1_rad;
-  double dlon = lon2_rad - lon1_rad;
-  
-  // Haversine公式
-  double a = sin(dlat/2) * sin(dlat/2) + 
-             cos(lat1_rad) * cos(lat2_rad) * 
-             sin(dlon/2) * sin(dlon/2);
-  double c = 2 * atan2(sqrt(a), sqrt(1-a));
-  double distance = earth_radius * c;
-  
-  return distance;
+  return gnss_distance_haversine(lat1, lon1, lat2, lon2);
 }
 
 /**
@@ -947,7 +1235,9 @@ double gnss_calculate_distance(double lat1, double lon1, double lat2, double lon
 bool gnss_is_idle_state(const GnssPoint& p1, const GnssPoint& p2, double threshold_meters)
 {
   // 如果两点间距离小于阈值，则认为处于停留状态
-  double distance = gnss_calculate_distance(
+  DistanceCache cache;
+  gnss_distance_reset(&cache);
+  double distance = gnss_distance_fast(&cache,
       p1.latitude, p1.longitude,
       p2.latitude, p2.longitude);
   
@@ -959,6 +1249,8 @@ bool gnss_is_idle_state(const GnssPoint& p1, const GnssPoint& p2, double thresho
  */
 void gnss_end_current_segment()
 {
+  if (gnss_worker_run([](void*) { gnss_end_current_segment(); }, nullptr)) return;
+  
   if (g_recording && !g_trip_data.segments.empty()) {
     // 更新当前分段的结束时间
     if (!g_trip_data.segments.empty()) {
@@ -1027,155 +1319,124 @@ std::vector<std::string> gnss_get_segment_history_files()
   return files;
 }
 
+/**
+ * 把"yyyy-mm-dd HH:MM:SS"转换为time_t，格式不对时返回0
+ */
+static time_t parse_local_time(const char* str)
+{
+  struct tm tm_val;
+  memset(&tm_val, 0, sizeof(tm_val));
+  if (sscanf(str, "%d-%d-%d %d:%d:%d", &tm_val.tm_year, &tm_val.tm_mon, &tm_val.tm_mday,
+             &tm_val.tm_hour, &tm_val.tm_min, &tm_val.tm_sec) < 5) {
+    return 0;
+  }
+  tm_val.tm_year -= 1900;
+  tm_val.tm_mon -= 1;
+  tm_val.tm_isdst = -1;
+  return mktime(&tm_val);
+}
+
+/**
+ * 解析一个分段对象 (对象开始记号已读取)
+ */
+static bool parse_segment_object(JsonReader* reader, SegmentData* segment)
+{
+  memset(segment, 0, sizeof(*segment));
+  
+  while (json_next_key(reader)) {
+    char key[JSON_TOKEN_MAX];
+    snprintf(key, sizeof(key), "%s", reader->text);
+    
+    JsonToken value = json_next(reader);
+    if (value == JSON_OBJECT_START || value == JSON_ARRAY_START) {
+      if (!json_skip_value(reader)) return false;
+      continue;
+    }
+    if (value == JSON_ERROR || value == JSON_END) return false;
+    
+    if (strcmp(key, "distance") == 0) {
+      segment->distance = json_number(reader, 0.0);
+    } else if (strcmp(key, "avg_speed") == 0) {
+      segment->avg_speed = json_number(reader, 0.0);
+    } else if (strcmp(key, "moving_avg_speed") == 0) {
+      segment->moving_avg_speed = json_number(reader, 0.0);
+    } else if (strcmp(key, "duration") == 0) {
+      segment->duration = (int32_t)json_number(reader, 0);
+    } else if (strcmp(key, "moving_time") == 0) {
+      segment->moving_time = (uint32_t)json_number(reader, 0);
+    } else if (strcmp(key, "idle_time") == 0) {
+      segment->idle_time = (uint32_t)json_number(reader, 0);
+    } else if (strcmp(key, "max_speed") == 0) {
+      segment->max_speed = json_number(reader, 0.0);
+    } else if (strcmp(key, "elevation_gain") == 0) {
+      segment->elevation_gain = json_number(reader, 0.0);
+    } else if (strcmp(key, "elevation_loss") == 0) {
+      segment->elevation_loss = json_number(reader, 0.0);
+    } else if (strcmp(key, "start_time") == 0) {
+      json_copy_string(reader, segment->start_time_str, sizeof(segment->start_time_str));
+      segment->start_time = parse_local_time(reader->text);
+    } else if (strcmp(key, "end_time") == 0) {
+      segment->end_time = parse_local_time(reader->text);
+    } else if (strcmp(key, "start_lat") == 0) {
+      segment->start_lat = json_number(reader, 0.0);
+    } else if (strcmp(key, "start_lon") == 0) {
+      segment->start_lon = json_number(reader, 0.0);
+    } else if (strcmp(key, "end_lat") == 0) {
+      segment->end_lat = json_number(reader, 0.0);
+    } else if (strcmp(key, "end_lon") == 0) {
+      segment->end_lon = json_number(reader, 0.0);
+    }
+  }
+  
+  return reader->token == JSON_OBJECT_END;
+}
+
 /**
  * 从文件加载分段数据
+ * 流式读取，只解析segments数组，一遍扫描完成
  */
 bool gnss_load_segment_data_from_file(const char* filename, std::vector<SegmentData>& segments)
 {
   // 清空原有数据
   segments.clear();
   
-  // 打开文件
-  FILE* f = fopen(filename, "r");
-  if (!f) {
+  JsonReader reader;
+  if (!json_open(&reader, filename)) {
     printf("[GNSS] 打开文件失败: %s\n", filename);
     return false;
   }
   
-  // 读取文件内容到内存
-  fseek(f, 0, SEEK_END);
-  long file_size = ftell(f);
-  fseek(f, 0, SEEK_SET);
-  
-  if (file_size <= 0) {
-    fclose(f);
-    printf("[GNSS] 文件内容为空: %s\n", filename);
-    return false;
-  }
-  
-  char* buffer = (char*)malloc(file_size + 1);
-  if (!buffer) {
-    fclose(f);
-    printf("[GNSS] 内存分配失败\n");
-    return false;
-  }
-  
-  size_t read_size = fread(buffer, 1, file_size, f);
-  buffer[read_size] = '\0';
-  fclose(f);
-  
-  if (read_size != file_size) {
-    free(buffer);
-    printf("[GNSS] 文件读取不完整: %s\n", filename);
+  if (!json_find_key(&reader, "segments") || json_next(&reader) != JSON_ARRAY_START) {
+    json_close(&reader);
+    printf("[GNSS] JSON格式错误: 找不到segments数组: %s\n", filename);
     return false;
   }
   
-  // 简易JSON解析
-  // 这里的实现非常简单，只支持我们自己生成的JSON格式
-  try {
-    // 查找"segments"字段
-    const char* segments_start = strstr(buffer, "\"segments\":");
-    if (!segments_start) {
-      free(buffer);
-      printf("[GNSS] JSON格式错误: 找不到segments字段\n");
-      return false;
+  // 解析每个分段数据
+  bool ok = true;
+  for (;;) {
+    JsonToken t = json_next(&reader);
+    if (t == JSON_ARRAY_END) break;
+    if (t != JSON_OBJECT_START) {
+      ok = false;
+      break;
     }
     
-    // 查找segments数组的开始和结束
-    const char* array_start = strchr(segments_start, '[');
-    if (!array_start) {
-      free(buffer);
-      printf("[GNSS] JSON格式错误: segments不是数组\n");
-      return false;
-    }
-    
-    const char* array_end = strrchr(buffer, ']');
-    if (!array_end || array_end < array_start) {
-      free(buffer);
-      printf("[GNSS] JSON格式错误: 找不到segments数组的结束\n");
-      return false;
+    SegmentData segment;
+    if (!parse_segment_object(&reader, &segment)) {
+      ok = false;
+      break;
     }
-    
-    // 解析每个分段数据
-    const char* obj_start = array_start;
-    while ((obj_start = strchr(obj_start, '{')) != NULL && obj_start < array_end) {
-      const char* obj_end = strchr(obj_start, '}');
-      if (!obj_end || obj_end > array_end) break;
-      
-      // 创建新分段
-      SegmentData segment;
-      segment.distance = 0.0;
-      segment.avg_speed = 0.0;
-      segment.duration = 0;
-      segment.moving_time = 0;
-      segment.idle_time = 0;
-      segment.moving_avg_speed = 0.0f;
-      segment.point_count = 0;
-      
-      // 从对象中提取数据
-      std::string obj_str(obj_start, obj_end - obj_start + 1);
-      
-      // 提取各个字段 (简化实现，只提取我们需要的字段)
-      const char* dist_pos = strstr(obj_str.c_str(), "\"distance\":");
-      if (dist_pos) {
-        segment.distance = atof(dist_pos + 12); // 12 = length of ""distance":"
-      }
-      
-      const char* avg_speed_pos = strstr(obj_str.c_str(), "\"avg_speed\":");
-      if (avg_speed_pos) {
-        segment.avg_speed = atof(avg_speed_pos + 13); // 13 = length of ""avg_speed":"
-      }
-      
-      const char* duration_pos = strstr(obj_str.c_str(), "\"duration\":");
-      if (duration_pos) {
-        segment.duration = atoi(duration_pos + 12); // 12 = length of ""duration":"
-      }
-      
-      const char* moving_time_pos = strstr(obj_str.c_str(), "\"moving_time\":");
-      if (moving_time_pos) {
-        segment.moving_time = atoi(moving_time_pos + 14); // 14 = length of ""moving_time":"
-      }
-      
-      const char* idle_time_pos = strstr(obj_str.c_str(), "\"idle_time\":");
-      if (idle_time_pos) {
-        segment.idle_time = atoi(idle_time_pos + 12); // 12 = length of ""idle_time":"
-      }
-      
-      const char* moving_avg_pos = strstr(obj_str.c_str(), "\"moving_avg_speed\":");
-      if (moving_avg_pos) {
-        segment.moving_avg_speed = atof(moving_avg_pos + 19); // 19 = length of ""moving_avg_speed":"
-      }
-      
-      const char* start_time_pos = strstr(obj_str.c_str(), "\"start_time\":");
-      if (start_time_pos) {
-        const char* quote_start = strchr(start_time_pos + 13, '\"');
-        const char* quote_end = strchr(quote_start + 1, '\"');
-        if (quote_start && quote_end && quote_end > quote_start) {
-          int len = (quote_end - quote_start - 1) < 19 ? (quote_end - quote_start - 1) : 19;
-          strncpy(segment.start_time_str, quote_start + 1, len);
-          segment.start_time_str[len] = '\0';
-          
-          // 将字符串时间转换为time_t(简化实现)
-          segment.start_time = time(NULL); // 用当前时间替代
-        }
-      }
-      
-      // 添加到列表
-      segments.push_back(segment);
-      
-      // 移动到下一个对象
-      obj_start = obj_end + 1;
-    }
-    
-    printf("[GNSS] 从%s加载了%zu个分段数据\n", filename, segments.size());
-    free(buffer);
-    return !segments.empty();
+    segments.push_back(segment);
   }
-  catch (...) {
-    free(buffer);
-    printf("[GNSS] 解析JSON文件异常: %s\n", filename);
-    return false;
+  
+  json_close(&reader);
+  
+  if (!ok) {
+    printf("[GNSS] 解析JSON文件出错: %s\n", filename);
   }
+  printf("[GNSS] 从%s加载了%zu个分段数据\n", filename, segments.size());
+  return !segments.empty();
 }
 
 /**
@@ -1202,68 +1463,72 @@ bool gnss_save_segment_data_to_json()
            tm_info->tm_year + 1900, tm_info->tm_mon + 1, tm_info->tm_mday,
            tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
   
-  // 打开文件
-  FILE* f = fopen(filename, "w");
-  if (!f) {
-    printf("[GNSS] 创建文件失败: %s\n", filename);
-    return false;
-  }
-  
-  // 写入JSON形式的数据
-  fprintf(f, "{\n");
-  fprintf(f, "  \"trip\": {\n");
-  fprintf(f, "    \"total_distance\": %.2f,\n", g_trip_data.total_distance);
-  fprintf(f, "    \"avg_speed\": %.2f,\n", g_trip_data.avg_speed);
-  fprintf(f, "    \"max_speed\": %.2f,\n", g_trip_data.max_speed);
-  fprintf(f, "    \"duration\": %d,\n", g_trip_data.duration);
+  // 生成JSON形式的数据，写卡由I/O线程完成
+  std::string out;
+  append_format(&out, "{\n");
+  append_format(&out, "  \"trip\": {\n");
+  append_format(&out, "    \"total_distance\": %.2f,\n", g_trip_data.total_distance);
+  append_format(&out, "    \"avg_speed\": %.2f,\n", g_trip_data.avg_speed);
+  append_format(&out, "    \"max_speed\": %.2f,\n", g_trip_data.max_speed);
+  append_format(&out, "    \"duration\": %d,\n", g_trip_data.duration);
+  append_format(&out, "    \"moving_time\": %u,\n", g_trip_data.moving_time);
+  append_format(&out, "    \"moving_avg_speed\": %.2f,\n", g_trip_data.moving_avg_speed);
+  append_format(&out, "    \"elevation_gain\": %.1f,\n", g_trip_data.elevation_gain);
+  append_format(&out, "    \"elevation_loss\": %.1f,\n", g_trip_data.elevation_loss);
   
   // 转换开始时间为可读字符串
   char start_time_str[64];
   struct tm *trip_start_tm = localtime(&g_trip_data.start_time);
   strftime(start_time_str, sizeof(start_time_str), "%Y-%m-%d %H:%M:%S", trip_start_tm);
-  fprintf(f, "    \"start_time\": \"%s\",\n", start_time_str);
+  append_format(&out, "    \"start_time\": \"%s\",\n", start_time_str);
   
   // 写入分段数据
-  fprintf(f, "    \"segments\": [\n");
+  append_format(&out, "    \"segments\": [\n");
   
   for (size_t i = 0; i < g_trip_data.segments.size(); i++) {
     const SegmentData& seg = g_trip_data.segments[i];
     
-    fprintf(f, "      {\n");
-    fprintf(f, "        \"id\": %zu,\n", i + 1);
-    fprintf(f, "        \"distance\": %.2f,\n", seg.distance);
-    fprintf(f, "        \"avg_speed\": %.2f,\n", seg.avg_speed);
-    fprintf(f, "        \"moving_avg_speed\": %.2f,\n", seg.moving_avg_speed);
-    fprintf(f, "        \"duration\": %d,\n", seg.duration);
-    fprintf(f, "        \"moving_time\": %u,\n", seg.moving_time);
-    fprintf(f, "        \"idle_time\": %u,\n", seg.idle_time);
+    append_format(&out, "      {\n");
+    append_format(&out, "        \"id\": %zu,\n", i + 1);
+    append_format(&out, "        \"distance\": %.2f,\n", seg.distance);
+    append_format(&out, "        \"avg_speed\": %.2f,\n", seg.avg_speed);
+    append_format(&out, "        \"moving_avg_speed\": %.2f,\n", seg.moving_avg_speed);
+    append_format(&out, "        \"duration\": %d,\n", seg.duration);
+    append_format(&out, "        \"moving_time\": %u,\n", seg.moving_time);
+    append_format(&out, "        \"idle_time\": %u,\n", seg.idle_time);
+    append_format(&out, "        \"max_speed\": %.2f,\n", seg.max_speed);
+    append_format(&out, "        \"elevation_gain\": %.1f,\n", seg.elevation_gain);
+    append_format(&out, "        \"elevation_loss\": %.1f,\n", seg.elevation_loss);
     
     // 开始时间
     char seg_time_str[64];
     struct tm *seg_start_tm = localtime(&seg.start_time);
     strftime(seg_time_str, sizeof(seg_time_str), "%Y-%m-%d %H:%M:%S", seg_start_tm);
-    fprintf(f, "        \"start_time\": \"%s\",\n", seg_time_str);
+    append_format(&out, "        \"start_time\": \"%s\",\n", seg_time_str);
     
     // 结束时间
     struct tm *seg_end_tm = localtime(&seg.end_time);
     strftime(seg_time_str, sizeof(seg_time_str), "%Y-%m-%d %H:%M:%S", seg_end_tm);
-    fprintf(f, "        \"end_time\": \"%s\",\n", seg_time_str);
+    append_format(&out, "        \"end_time\": \"%s\",\n", seg_time_str);
     
     // 起终点位置
-    fprintf(f, "        \"start_lat\": %.6f,\n", seg.start_lat);
-    fprintf(f, "        \"start_lon\": %.6f,\n", seg.start_lon);
-    fprintf(f, "        \"end_lat\": %.6f,\n", seg.end_lat);
-    fprintf(f, "        \"end_lon\": %.6f\n", seg.end_lon);
+    append_format(&out, "        \"start_lat\": %.6f,\n", seg.start_lat);
+    append_format(&out, "        \"start_lon\": %.6f,\n", seg.start_lon);
+    append_format(&out, "        \"end_lat\": %.6f,\n", seg.end_lat);
+    append_format(&out, "        \"end_lon\": %.6f\n", seg.end_lon);
     
     // 如果不是最后一个分段，添加逗号
-    fprintf(f, "      }%s\n", (i < g_trip_data.segments.size() - 1) ? "," : "");
+    append_format(&out, "      }%s\n", (i < g_trip_data.segments.size() - 1) ? "," : "");
   }
   
-  fprintf(f, "    ]\n");
-  fprintf(f, "  }\n");
-  fprintf(f, "}\n");
+  append_format(&out, "    ]\n");
+  append_format(&out, "  }\n");
+  append_format(&out, "}\n");
   
-  fclose(f);
+  if (!sd_io_write_file(filename, out.data(), out.size(), SD_IO_STATS)) {
+    printf("[GNSS] 创建文件失败: %s\n", filename);
+    return false;
+  }
   
   printf("[GNSS] 保存分段数据到: %s\n", filename);
   return true;
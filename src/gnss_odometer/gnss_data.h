@@ -27,6 +27,23 @@ enum GnssFixType {
   FIX_3D                 // 3D定位
 };
 
+// 省电档位 (数值越大越省电)
+enum GnssPowerMode {
+  GNSS_POWER_FULL = 0,   // 按设定的更新频率定位
+  GNSS_POWER_ECO,        // 长周期跟踪 (停车时)
+  GNSS_POWER_SLEEP       // 暂停定位，保留星历以便热启动
+};
+
+// 低速率档位的定位周期 (毫秒)
+#ifdef CONFIG_SPRESENSEWONG_GNSS_ECO_CYCLE_MS
+#define GNSS_POWER_ECO_CYCLE_MS CONFIG_SPRESENSEWONG_GNSS_ECO_CYCLE_MS
+#else
+#define GNSS_POWER_ECO_CYCLE_MS 5000
+#endif
+
+// 速度超过该值 (m/s) 视为在运动，重新计算静止时长
+#define GNSS_POWER_MOVING_SPEED 1.0f
+
 // 定位数据点
 struct GnssPoint {
   double latitude;       // 纬度 (度)
@@ -38,6 +55,8 @@ struct GnssPoint {
   int32_t timestamp;     // 时间戳 (秒)
   GnssFixType fix_type;  // 定位类型
   float acceleration;    // 加速度 (m/s²)，由相邻点计算
+  time_t utc_time;       // GNSS授时的UTC时间 (秒)，0表示接收机尚未授时
+  uint16_t utc_msec;     // UTC时间的毫秒部分
 };
 
 // 分段数据
@@ -53,6 +72,9 @@ struct SegmentData {
   uint32_t moving_time;    // 运动时长(秒)
   uint32_t idle_time;      // 停留时长(秒)
   float moving_avg_speed;  // 运动时的平均速度
+  float max_speed;         // 最大速度 (m/s)
+  float elevation_gain;    // 累计爬升 (米)
+  float elevation_loss;    // 累计下降 (米)
   double start_lat;        // 起点纬度
   double start_lon;        // 起点经度
   double end_lat;          // 终点纬度
@@ -97,6 +119,8 @@ struct TripData {
   // 百米加速
   bool has_0_100_time;    // 是否有 0-100km/h 加速数据
   float time_0_100;       // 0-100km/h 加速时间 (秒)
+  bool has_60_100_time;   // 是否有 60-100km/h 加速数据
+  float time_60_100;      // 60-100km/h 加速时间 (秒)
   
   // 新增加速度测量
   bool measuring_acceleration; // 是否正在测量加速度
@@ -109,6 +133,13 @@ struct TripData {
   // 其他统计
   double max_altitude;    // 最大海拔 (米)
   double min_altitude;    // 最小海拔 (米)
+  uint32_t moving_time;   // 运动时长 (秒)
+  uint32_t idle_time;     // 停留时长 (秒)
+  float moving_avg_speed; // 运动时的平均速度 (m/s)
+  float elevation_gain;   // 累计爬升 (米)
+  float elevation_loss;   // 累计下降 (米)
+  float avg_speed_1km;    // 最近1公里的平均速度 (m/s)
+  float avg_speed_5min;   // 最近5分钟的平均速度 (m/s)
   
   // 分段数据
   uint32_t segment_count; // 分段数量
@@ -130,9 +161,32 @@ bool gnss_start();
 // 停止定位
 void gnss_stop();
 
-// 获取最新的定位数据
+// 获取当前更新频率
+GnssUpdateRate gnss_get_update_rate();
+
+// 接收机当前的定位周期 (毫秒，低速率档位时大于更新频率)
+uint32_t gnss_get_cycle_ms();
+
+// 省电档位 (见gnss_power.h的调度)
+bool gnss_set_power_mode(GnssPowerMode mode);
+GnssPowerMode gnss_get_power_mode();
+
+// 连续静止的时长 (秒)
+uint32_t gnss_get_idle_seconds();
+
+// 获取最新的定位数据 (读取一个定位历元，有新的有效定位时返回true)
 bool gnss_get_position(GnssPoint* point);
 
+// 等待下一个定位历元并处理 (事件驱动，超时或无有效定位返回false)
+bool gnss_wait_position(GnssPoint* point, int timeout_ms);
+
+// 回放二进制轨迹代替接收机 (见gnss_replay.h)，rate_ms为0时按记录输出，speedup为0时不等待
+bool gnss_start_replay(const char* trk_path, uint32_t rate_ms, uint32_t speedup);
+void gnss_stop_replay();
+
+// 距下一个回放历元的毫秒数 (已到期为0，没有回放或回放结束为-1)
+int gnss_replay_wait();
+
 // 检查是否定位成功
 bool gnss_has_fix();
 
@@ -144,8 +198,14 @@ void gnss_start_recording();
 void gnss_stop_recording();
 bool gnss_is_recording();
 
-// 获取当前行程数据
-const TripData* gnss_get_trip_data();
+// 获取已记录的轨迹点数
+uint32_t gnss_get_track_point_count();
+
+// 把写满的轨迹块溢出到SD卡 (在定位解析路径之外调用)
+void gnss_flush_track();
+
+// 获取行程数据快照 (线程安全，不会读到更新了一半的数据；行程数据只由分析线程修改)
+bool gnss_get_trip_snapshot(TripData* trip);
 
 // 重置行程数据
 void gnss_reset_trip();
@@ -153,7 +213,7 @@ void gnss_reset_trip();
 // 获取最后点和当前点的距离
 double gnss_get_last_point_distance();
 
-// 保存轨迹到文件
+// 导出已记录的整条轨迹到GPX文件 (记录过程中的实时写入见gnss_track_writer.h)
 bool gnss_save_track(const char* filename);
 
 // 检测百米加速
@@ -171,10 +231,7 @@ void gnss_check_acceleration_measurement(const GnssPoint& point);
 // 保存加速度测量结果
 bool gnss_save_acceleration_data(const AccelerationData& data);
 
-// 获取加速度历史数据
-std::vector<AccelerationData> gnss_get_acceleration_history();
-
-// 加速度记录界面显示相关
+// 加速度记录界面显示相关 (0为最新，按序号直接读取单条记录)
 int gnss_get_acceleration_history_count();
 const AccelerationData* gnss_get_acceleration_data(uint32_t index);
 
@@ -199,12 +256,9 @@ void gnss_enable_segment(bool enable);
 // 获取分段是否启用
 bool gnss_is_segment_enabled();
 
-// 获取当前分段数量
+// 获取当前分段数量 (来自行程数据快照)
 uint32_t gnss_get_segment_count();
 
-// 获取指定分段数据
-const SegmentData* gnss_get_segment_data(uint32_t index);
-
 // 创建新分段
 void gnss_create_new_segment();
 
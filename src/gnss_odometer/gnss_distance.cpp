@@ -0,0 +1,138 @@
+/****************************************************************************
+ * gnss_distance.cpp
+ *
+ * 距离计算引擎实现
+ * 差值先用双精度相减再转单精度：纬度绝对值用float只有约0.2米分辨率，
+ * 而相邻点的差值很小，转换后几乎没有精度损失
+ * ***************************************************************************/
+#include "gnss_distance.h"
+#include "perf_probe.h"
+#include <stdio.h>
+#include <math.h>
+
+#define DEG_TO_RAD (M_PI / 180.0)
+
+// 每度对应的弧长 (米)
+static const float M_PER_DEG = (float)(GNSS_EARTH_RADIUS_M * DEG_TO_RAD);
+
+/**
+ * 清空缓存
+ */
+void gnss_distance_reset(DistanceCache* cache)
+{
+  if (cache) cache->valid = false;
+}
+
+/**
+ * 按参考纬度刷新cos(纬度)缓存
+ */
+static void refresh_cache(DistanceCache* cache, double lat)
+{
+  cache->ref_lat = lat;
+  cache->m_per_deg_lat = M_PER_DEG;
+  cache->m_per_deg_lon = M_PER_DEG * cosf((float)(lat * DEG_TO_RAD));
+  cache->valid = true;
+}
+
+/**
+ * 双精度Haversine球面距离
+ */
+double gnss_distance_haversine(double lat1, double lon1, double lat2, double lon2)
+{
+  double lat1_rad = lat1 * DEG_TO_RAD;
+  double lat2_rad = lat2 * DEG_TO_RAD;
+  double dlat = (lat2 - lat1) * DEG_TO_RAD;
+  double dlon = (lon2 - lon1) * DEG_TO_RAD;
+
+  double a = sin(dlat / 2) * sin(dlat / 2) +
+             cos(lat1_rad) * cos(lat2_rad) * sin(dlon / 2) * sin(dlon / 2);
+  double c = 2 * atan2(sqrt(a), sqrt(1 - a));
+
+  return GNSS_EARTH_RADIUS_M * c;
+}
+
+/**
+ * 相邻点快速距离
+ */
+float gnss_distance_fast(DistanceCache* cache, double lat1, double lon1, double lat2, double lon2)
+{
+  double dlat = lat2 - lat1;
+  double dlon = lon2 - lon1;
+
+  // 跨越180度经线
+  if (dlon > 180.0) dlon -= 360.0;
+  else if (dlon < -180.0) dlon += 360.0;
+
+  if (fabs(dlat) > GNSS_FAST_DISTANCE_MAX_DEG || fabs(dlon) > GNSS_FAST_DISTANCE_MAX_DEG) {
+    return (float)gnss_distance_haversine(lat1, lon1, lat2, lon2);
+  }
+
+  double mid_lat = lat1 + dlat * 0.5;
+  if (!cache->valid || fabs(mid_lat - cache->ref_lat) > GNSS_COS_LAT_REFRESH_DEG) {
+    refresh_cache(cache, mid_lat);
+  }
+
+  float dy = (float)dlat * cache->m_per_deg_lat;
+  float dx = (float)dlon * cache->m_per_deg_lon;
+
+  return sqrtf(dx * dx + dy * dy);
+}
+
+/**
+ * 基准测试
+ * 模拟10Hz、约30m/s的轨迹，在不同纬度下比较两种算法
+ */
+void gnss_distance_benchmark(uint32_t iterations)
+{
+  static const double test_lats[] = {0.0, 31.2, 45.0, 60.0, 75.0};
+  static const int lat_count = sizeof(test_lats) / sizeof(test_lats[0]);
+
+  if (iterations == 0) iterations = 1000;
+
+  // 计时用性能探针的周期计数器 (非ARM平台由单调时钟换算)
+  perf_init();
+
+  printf("[BENCH] 距离计算基准测试: %u 次/纬度\n", (unsigned)iterations);
+
+  for (int l = 0; l < lat_count; l++) {
+    DistanceCache cache;
+    gnss_distance_reset(&cache);
+
+    double lat = test_lats[l];
+    double lon = 121.4;
+    double max_err = 0.0;
+    double sum_fast = 0.0, sum_ref = 0.0;
+    uint32_t fast_ticks = 0, ref_ticks = 0;
+
+    for (uint32_t i = 0; i < iterations; i++) {
+      // 每步约3米，方向缓慢变化
+      double heading = i * 0.01;
+      double lat2 = lat + 2.7e-5 * cos(heading);
+      double lon2 = lon + 2.7e-5 * sin(heading);
+
+      uint32_t t0 = perf_now();
+      float d_fast = gnss_distance_fast(&cache, lat, lon, lat2, lon2);
+      uint32_t t1 = perf_now();
+      double d_ref = gnss_distance_haversine(lat, lon, lat2, lon2);
+      uint32_t t2 = perf_now();
+
+      fast_ticks += t1 - t0;
+      ref_ticks += t2 - t1;
+      sum_fast += d_fast;
+      sum_ref += d_ref;
+
+      double err = fabs(d_fast - d_ref);
+      if (err > max_err) max_err = err;
+
+      lat = lat2;
+      lon = lon2;
+    }
+
+    printf("[BENCH] 纬度%5.1f: 快速 %u 周期/次, Haversine %u 周期/次, "
+           "单步最大误差 %.4f m, 累计误差 %.3f m / %.1f m\n",
+           test_lats[l],
+           (unsigned)(fast_ticks / iterations),
+           (unsigned)(ref_ticks / iterations),
+           max_err, fabs(sum_fast - sum_ref), sum_ref);
+  }
+}
@@ -0,0 +1,41 @@
+/****************************************************************************
+ * gnss_distance.h
+ *
+ * 距离计算引擎：每个历元都要算一次相邻点距离，是GNSS线程最热的调用。
+ * Cortex-M4F只有单精度FPU，双精度三角函数全靠软件模拟，
+ * 因此相邻点使用单精度局部平面(等距圆柱)近似，cos(纬度)按路段缓存，
+ * 只有间隔很大的两点才回退到双精度Haversine
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 超过该经纬度差(度)时回退到Haversine (0.05度约5.5km，近似误差远小于1米)
+#define GNSS_FAST_DISTANCE_MAX_DEG 0.05
+
+// 参考纬度漂移超过该值(度)时重新计算cos(纬度) (约1km)
+#define GNSS_COS_LAT_REFRESH_DEG 0.01
+
+// 地球平均半径 (米)
+#define GNSS_EARTH_RADIUS_M 6371000.0
+
+// 每条路段的cos(纬度)缓存
+struct DistanceCache {
+  double ref_lat;      // 计算缓存时的纬度
+  float m_per_deg_lat; // 每度纬度对应的米数
+  float m_per_deg_lon; // 每度经度对应的米数 (含cos(纬度))
+  bool valid;
+};
+
+// 清空缓存 (开始新路段时调用)
+void gnss_distance_reset(DistanceCache* cache);
+
+// 相邻点快速距离(米)，间隔过大时自动回退到Haversine
+float gnss_distance_fast(DistanceCache* cache, double lat1, double lon1, double lat2, double lon2);
+
+// 双精度Haversine球面距离(米)
+double gnss_distance_haversine(double lat1, double lon1, double lat2, double lon2);
+
+// 基准测试：比较快速路径和Haversine的误差与耗时，结果打印到串口
+void gnss_distance_benchmark(uint32_t iterations);
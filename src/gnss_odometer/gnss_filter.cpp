@@ -0,0 +1,251 @@
+/****************************************************************************
+ * gnss_filter.cpp
+ *
+ * 定位滤波实现
+ * 位置和速度的观测噪声互不相关，依次做两次标量更新即等价于一次矢量更新，
+ * 不需要矩阵求逆；东、北两个方向相互独立，各自只是3x3的运算
+ * ***************************************************************************/
+#include "gnss_filter.h"
+#include <string.h>
+#include <math.h>
+
+#define DEG_TO_RAD (M_PI / 180.0)
+
+// 每度对应的弧长 (米)
+static const float M_PER_DEG = (float)(6371000.0 * DEG_TO_RAD);
+
+// 初始加速度标准差 (m/s²)
+static const float INIT_ACCEL_SIGMA = 2.0f;
+
+// 低于该速度 (m/s) 时不用估计值计算航向
+static const float COURSE_MIN_SPEED = 0.5f;
+
+/**
+ * 清空滤波器
+ */
+void gnss_filter_reset(GnssFilter* filter)
+{
+  memset(filter, 0, sizeof(*filter));
+}
+
+/**
+ * 用观测值初始化一个方向
+ */
+static void axis_init(GnssFilterAxis* axis, float pos, float vel, float pos_var, float vel_var)
+{
+  memset(axis, 0, sizeof(*axis));
+  axis->x[0] = pos;
+  axis->x[1] = vel;
+  axis->P[0][0] = pos_var;
+  axis->P[1][1] = vel_var;
+  axis->P[2][2] = INIT_ACCEL_SIGMA * INIT_ACCEL_SIGMA;
+}
+
+/**
+ * 预测：x = F x, P = F P F' + Q (常加速度模型，白噪声加加速度)
+ */
+static void axis_predict(GnssFilterAxis* axis, float dt, float q)
+{
+  float dt2 = dt * dt;
+  float half_dt2 = 0.5f * dt2;
+
+  float* x = axis->x;
+  x[0] += x[1] * dt + x[2] * half_dt2;
+  x[1] += x[2] * dt;
+
+  // A = F P
+  float (*P)[3] = axis->P;
+  float A[3][3];
+  for (int j = 0; j < 3; j++) {
+    A[0][j] = P[0][j] + dt * P[1][j] + half_dt2 * P[2][j];
+    A[1][j] = P[1][j] + dt * P[2][j];
+    A[2][j] = P[2][j];
+  }
+
+  // P = A F'
+  for (int i = 0; i < 3; i++) {
+    P[i][0] = A[i][0] + dt * A[i][1] + half_dt2 * A[i][2];
+    P[i][1] = A[i][1] + dt * A[i][2];
+    P[i][2] = A[i][2];
+  }
+
+  float dt3 = dt2 * dt;
+  float dt4 = dt3 * dt;
+  float dt5 = dt4 * dt;
+  P[0][0] += q * dt5 / 20.0f;
+  P[0][1] += q * dt4 / 8.0f;
+  P[0][2] += q * dt3 / 6.0f;
+  P[1][1] += q * dt3 / 3.0f;
+  P[1][2] += q * dt2 / 2.0f;
+  P[2][2] += q * dt;
+  P[1][0] = P[0][1];
+  P[2][0] = P[0][2];
+  P[2][1] = P[1][2];
+}
+
+/**
+ * 对第i个状态做一次标量观测更新
+ */
+static void axis_update(GnssFilterAxis* axis, int i, float z, float r)
+{
+  float (*P)[3] = axis->P;
+  float s = P[i][i] + r;
+  if (s <= 0.0f) return;
+
+  float k[3];
+  for (int j = 0; j < 3; j++) k[j] = P[j][i] / s;
+
+  float y = z - axis->x[i];
+  for (int j = 0; j < 3; j++) axis->x[j] += k[j] * y;
+
+  // P = (I - K H) P，H只选中第i行
+  float row[3] = { P[i][0], P[i][1], P[i][2] };
+  for (int a = 0; a < 3; a++) {
+    for (int b = 0; b < 3; b++) {
+      P[a][b] -= k[a] * row[b];
+    }
+  }
+}
+
+/**
+ * 把原点设到指定位置
+ */
+static void set_origin(GnssFilter* filter, double lat, double lon)
+{
+  filter->origin_lat = lat;
+  filter->origin_lon = lon;
+  filter->m_per_deg_lat = M_PER_DEG;
+  filter->m_per_deg_lon = M_PER_DEG * cosf((float)(lat * DEG_TO_RAD));
+  if (filter->m_per_deg_lon < 1.0f) filter->m_per_deg_lon = 1.0f;  // 极点附近
+}
+
+/**
+ * 经纬度换算到局部平面 (先用双精度求差再转单精度)
+ */
+static void to_local(const GnssFilter* filter, double lat, double lon, float* e, float* n)
+{
+  double dlon = lon - filter->origin_lon;
+  if (dlon > 180.0) dlon -= 360.0;
+  else if (dlon < -180.0) dlon += 360.0;
+
+  *e = (float)dlon * filter->m_per_deg_lon;
+  *n = (float)(lat - filter->origin_lat) * filter->m_per_deg_lat;
+}
+
+/**
+ * 以观测值重新初始化
+ */
+static void init_from(GnssFilter* filter, const GnssPoint& point, float ve, float vn, float pos_var, float vel_var)
+{
+  set_origin(filter, point.latitude, point.longitude);
+  axis_init(&filter->east, 0.0f, ve, pos_var, vel_var);
+  axis_init(&filter->north, 0.0f, vn, pos_var, vel_var);
+  filter->stationary = false;
+  filter->still_count = 0;
+  filter->valid = true;
+  filter->just_reset = true;
+}
+
+/**
+ * 用一个有效定位点更新滤波器
+ */
+void gnss_filter_update(GnssFilter* filter, GnssPoint* point, float hdop, float period_s)
+{
+  // 历元时间：接收机授时后用UTC，否则按标称周期推算
+  int64_t now_ms;
+  if (point->utc_time != 0) {
+    now_ms = (int64_t)point->utc_time * 1000 + point->utc_msec;
+  } else {
+    now_ms = filter->last_ms + (int64_t)(period_s * 1000.0f);
+  }
+
+  float dt = (float)(now_ms - filter->last_ms) / 1000.0f;
+  if (dt <= 0.0f) dt = period_s;
+  filter->last_ms = now_ms;
+
+  float course_rad = point->course * (float)DEG_TO_RAD;
+  float ve = point->speed * sinf(course_rad);
+  float vn = point->speed * cosf(course_rad);
+
+  if (hdop < 1.0f) hdop = 1.0f;
+  float pos_sigma = GNSS_FILTER_POS_SIGMA * hdop;
+  float pos_var = pos_sigma * pos_sigma;
+  float vel_var = GNSS_FILTER_VEL_SIGMA * GNSS_FILTER_VEL_SIGMA;
+
+  float max_gap = GNSS_FILTER_MAX_GAP_S;
+  if (max_gap < GNSS_FILTER_GAP_CYCLES * period_s) max_gap = GNSS_FILTER_GAP_CYCLES * period_s;
+  
+  filter->just_reset = false;
+  if (!filter->valid || dt > max_gap) {
+    if (filter->valid) filter->resets++;
+    init_from(filter, *point, ve, vn, pos_var, vel_var);
+    point->acceleration = 0.0f;
+    return;
+  }
+
+  float q = GNSS_FILTER_JERK_SIGMA * GNSS_FILTER_JERK_SIGMA;
+  axis_predict(&filter->east, dt, q);
+  axis_predict(&filter->north, dt, q);
+
+  float ze, zn;
+  to_local(filter, point->latitude, point->longitude, &ze, &zn);
+
+  // 定位跳变 (多径、重新捕获) 时不做平滑，直接从新位置开始
+  float de = ze - filter->east.x[0];
+  float dn = zn - filter->north.x[0];
+  if (de * de + dn * dn > GNSS_FILTER_JUMP_M * GNSS_FILTER_JUMP_M) {
+    filter->resets++;
+    init_from(filter, *point, ve, vn, pos_var, vel_var);
+    point->acceleration = 0.0f;
+    return;
+  }
+
+  // 静止判断：接收机速度连续几个历元都很低
+  if (point->speed < GNSS_FILTER_STILL_SPEED) {
+    if (filter->still_count < GNSS_FILTER_STILL_EPOCHS) filter->still_count++;
+  } else {
+    filter->still_count = 0;
+  }
+  filter->stationary = (filter->still_count >= GNSS_FILTER_STILL_EPOCHS);
+
+  if (filter->stationary) {
+    // 零速更新：不用位置观测，速度和加速度拉向0，位置保持不动
+    float zupt_var = 0.01f * vel_var;
+    axis_update(&filter->east, 1, 0.0f, zupt_var);
+    axis_update(&filter->north, 1, 0.0f, zupt_var);
+    axis_update(&filter->east, 2, 0.0f, zupt_var);
+    axis_update(&filter->north, 2, 0.0f, zupt_var);
+  } else {
+    axis_update(&filter->east, 0, ze, pos_var);
+    axis_update(&filter->north, 0, zn, pos_var);
+    axis_update(&filter->east, 1, ve, vel_var);
+    axis_update(&filter->north, 1, vn, vel_var);
+  }
+
+  float pe = filter->east.x[0];
+  float pn = filter->north.x[0];
+  point->latitude = filter->origin_lat + pn / filter->m_per_deg_lat;
+  point->longitude = filter->origin_lon + pe / filter->m_per_deg_lon;
+
+  float fe = filter->east.x[1];
+  float fn = filter->north.x[1];
+  float speed = sqrtf(fe * fe + fn * fn);
+  point->speed = filter->stationary ? 0.0f : speed;
+
+  // 航向和沿行进方向的加速度，低速时航向没有意义，保留接收机的值
+  if (speed >= COURSE_MIN_SPEED && !filter->stationary) {
+    float course = atan2f(fe, fn) / (float)DEG_TO_RAD;
+    if (course < 0.0f) course += 360.0f;
+    point->course = course;
+    point->acceleration = (filter->east.x[2] * fe + filter->north.x[2] * fn) / speed;
+  } else {
+    point->acceleration = 0.0f;
+  }
+
+  // 离原点太远时移动原点，状态平移到新的原点下
+  if (fabsf(pe) > GNSS_FILTER_REBASE_M || fabsf(pn) > GNSS_FILTER_REBASE_M) {
+    set_origin(filter, point->latitude, point->longitude);
+    filter->east.x[0] = 0.0f;
+    filter->north.x[0] = 0.0f;
+  }
+}
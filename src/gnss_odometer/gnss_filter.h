@@ -0,0 +1,66 @@
+/****************************************************************************
+ * gnss_filter.h
+ *
+ * 定位滤波：在以出发点为原点的局部平面上，东、北两个方向各用一个
+ * 常加速度模型的卡尔曼滤波器 (位置、速度、加速度)，每个历元先预测再
+ * 依次用接收机的位置和速度更新。全部为定长单精度运算，不分配内存。
+ * 静止时用零速更新冻结位置，停车时的定位抖动不再计入里程
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+
+// 加加速度(jerk)的标准差 (m/s³)，决定滤波器跟随速度变化的快慢
+#define GNSS_FILTER_JERK_SIGMA 1.5f
+
+// 位置观测标准差 (米，乘以HDOP)
+#define GNSS_FILTER_POS_SIGMA 2.5f
+
+// 速度观测标准差 (m/s)
+#define GNSS_FILTER_VEL_SIGMA 0.2f
+
+// 低于该速度 (m/s) 连续GNSS_FILTER_STILL_EPOCHS个历元视为静止
+#define GNSS_FILTER_STILL_SPEED 0.5f
+#define GNSS_FILTER_STILL_EPOCHS 3
+
+// 位置新息超过该值 (米) 时认为定位跳变，重新初始化
+#define GNSS_FILTER_JUMP_M 50.0f
+
+// 两个历元间隔超过该值 (秒) 且超过GNSS_FILTER_GAP_CYCLES个定位周期时重新初始化
+// (省电档位的定位周期比该值长，按周期放宽才不会每个历元都重新初始化)
+#define GNSS_FILTER_MAX_GAP_S 3.0f
+#define GNSS_FILTER_GAP_CYCLES 3
+
+// 离原点超过该距离 (米) 时把原点移到当前位置，保证单精度的分辨率
+#define GNSS_FILTER_REBASE_M 2000.0f
+
+// 单个方向的状态 [位置, 速度, 加速度] 和协方差
+struct GnssFilterAxis {
+  float x[3];
+  float P[3][3];
+};
+
+// 滤波器状态
+struct GnssFilter {
+  bool valid;
+  bool stationary;          // 当前是否静止
+  uint8_t still_count;      // 连续低速历元数
+  double origin_lat;        // 局部平面原点
+  double origin_lon;
+  float m_per_deg_lat;      // 原点处每度对应的米数
+  float m_per_deg_lon;
+  int64_t last_ms;          // 上一个历元的时间 (毫秒)
+  GnssFilterAxis east;
+  GnssFilterAxis north;
+  uint32_t resets;          // 重新初始化次数 (跳变或长时间中断)
+  bool just_reset;          // 本历元刚重新初始化，输出的是原始定位 (不应计入里程)
+};
+
+// 清空滤波器 (开始定位或丢失定位后调用)
+void gnss_filter_reset(GnssFilter* filter);
+
+// 用一个有效定位点更新滤波器，并把point的位置、速度、航向和加速度替换为估计值
+// period_s为接收机当前的定位周期，用于放宽中断判断，接收机未授时无法得到历元时间时也用它推算
+void gnss_filter_update(GnssFilter* filter, GnssPoint* point, float hdop, float period_s);
@@ -0,0 +1,280 @@
+/****************************************************************************
+ * gnss_json.cpp
+ *
+ * 流式JSON读取实现
+ * 只支持本程序写出的JSON：字符串中的转义只处理\" \\ \/ \n \t，\u保持原样
+ * ***************************************************************************/
+#include "gnss_json.h"
+#include "perf_probe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * 读入下一块 (缓冲已处理完时)
+ */
+static bool fill(JsonReader* r)
+{
+  if (r->pos < r->len) return true;
+  if (r->eof) return false;
+
+  ssize_t n;
+  {
+    PERF_SCOPE(PERF_FILE_IO);
+    do {
+      n = read(r->fd, r->buf, sizeof(r->buf));
+    } while (n < 0 && errno == EINTR);
+  }
+
+  r->pos = 0;
+  r->len = n > 0 ? n : 0;
+  if (n <= 0) r->eof = true;
+  return r->len > 0;
+}
+
+/**
+ * 查看下一个字符，文件结束返回-1
+ */
+static int peek(JsonReader* r)
+{
+  if (!fill(r)) return -1;
+  return (unsigned char)r->buf[r->pos];
+}
+
+static int get(JsonReader* r)
+{
+  if (!fill(r)) return -1;
+  return (unsigned char)r->buf[r->pos++];
+}
+
+/**
+ * 跳过空白和逗号
+ */
+static void skip_separators(JsonReader* r)
+{
+  for (;;) {
+    int c = peek(r);
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != ',') return;
+    r->pos++;
+  }
+}
+
+static void text_push(JsonReader* r, char c)
+{
+  if (r->text_len < JSON_TOKEN_MAX - 1) {
+    r->text[r->text_len++] = c;
+  }
+}
+
+/**
+ * 读取字符串 (开头的引号已消耗)
+ */
+static bool read_string(JsonReader* r)
+{
+  for (;;) {
+    int c = get(r);
+    if (c < 0) return false;
+    if (c == '"') return true;
+
+    if (c == '\\') {
+      c = get(r);
+      switch (c) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case '"': case '\\': case '/': break;
+        case -1: return false;
+        default:
+          text_push(r, '\\');
+          break;
+      }
+    }
+    text_push(r, (char)c);
+  }
+}
+
+/**
+ * 读取字母开头的字面量或数字
+ */
+static void read_bare(JsonReader* r)
+{
+  for (;;) {
+    int c = peek(r);
+    if (c < 0 || c == ',' || c == '}' || c == ']' || c == ':' ||
+        c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      return;
+    }
+    text_push(r, (char)c);
+    r->pos++;
+  }
+}
+
+/**
+ * 打开文件
+ */
+bool json_open(JsonReader* reader, const char* path)
+{
+  if (!reader || !path) return false;
+
+  reader->fd = open(path, O_RDONLY);
+  reader->pos = 0;
+  reader->len = 0;
+  reader->eof = false;
+  reader->token = JSON_END;
+  reader->text[0] = '\0';
+  reader->text_len = 0;
+  reader->depth = 0;
+
+  return reader->fd >= 0;
+}
+
+/**
+ * 关闭文件
+ */
+void json_close(JsonReader* reader)
+{
+  if (reader && reader->fd >= 0) {
+    close(reader->fd);
+    reader->fd = -1;
+  }
+}
+
+/**
+ * 读取下一个记号
+ */
+JsonToken json_next(JsonReader* r)
+{
+  skip_separators(r);
+  r->text_len = 0;
+  r->text[0] = '\0';
+
+  int c = get(r);
+  switch (c) {
+    case -1:
+      r->token = r->depth == 0 ? JSON_END : JSON_ERROR;
+      break;
+
+    case '{':
+      r->depth++;
+      r->token = JSON_OBJECT_START;
+      break;
+
+    case '[':
+      r->depth++;
+      r->token = JSON_ARRAY_START;
+      break;
+
+    case '}':
+    case ']':
+      r->depth--;
+      r->token = (c == '}') ? JSON_OBJECT_END : JSON_ARRAY_END;
+      break;
+
+    case '"':
+      if (!read_string(r)) {
+        r->token = JSON_ERROR;
+        break;
+      }
+      r->text[r->text_len] = '\0';
+
+      // 后面跟着冒号的是键
+      while (peek(r) == ' ' || peek(r) == '\t' || peek(r) == '\r' || peek(r) == '\n') r->pos++;
+      if (peek(r) == ':') {
+        r->pos++;
+        r->token = JSON_KEY;
+      } else {
+        r->token = JSON_STRING;
+      }
+      break;
+
+    default:
+      text_push(r, (char)c);
+      read_bare(r);
+      r->text[r->text_len] = '\0';
+
+      if (strcmp(r->text, "true") == 0) {
+        r->token = JSON_TRUE;
+      } else if (strcmp(r->text, "false") == 0) {
+        r->token = JSON_FALSE;
+      } else if (strcmp(r->text, "null") == 0) {
+        r->token = JSON_NULL;
+      } else if (c == '-' || (c >= '0' && c <= '9')) {
+        r->token = JSON_NUMBER;
+      } else {
+        r->token = JSON_ERROR;
+      }
+      break;
+  }
+
+  return r->token;
+}
+
+/**
+ * 当前记号是否为指定名字的键
+ */
+bool json_is_key(const JsonReader* reader, const char* name)
+{
+  return reader->token == JSON_KEY && strcmp(reader->text, name) == 0;
+}
+
+/**
+ * 跳过当前记号开始的值
+ */
+bool json_skip_value(JsonReader* reader)
+{
+  if (reader->token != JSON_OBJECT_START && reader->token != JSON_ARRAY_START) {
+    return reader->token != JSON_ERROR && reader->token != JSON_END;
+  }
+
+  int depth = reader->depth - 1;
+  while (reader->depth > depth) {
+    JsonToken t = json_next(reader);
+    if (t == JSON_ERROR || t == JSON_END) return false;
+  }
+  return true;
+}
+
+/**
+ * 向后查找指定名字的键
+ */
+bool json_find_key(JsonReader* reader, const char* name)
+{
+  for (;;) {
+    JsonToken t = json_next(reader);
+    if (t == JSON_ERROR || t == JSON_END) return false;
+    if (json_is_key(reader, name)) return true;
+  }
+}
+
+/**
+ * 读取当前对象的下一个键
+ */
+bool json_next_key(JsonReader* reader)
+{
+  return json_next(reader) == JSON_KEY;
+}
+
+/**
+ * 当前记号的数值
+ */
+double json_number(const JsonReader* reader, double def)
+{
+  if (reader->token != JSON_NUMBER) return def;
+  return strtod(reader->text, nullptr);
+}
+
+/**
+ * 复制当前字符串记号
+ */
+void json_copy_string(const JsonReader* reader, char* dst, size_t size)
+{
+  if (!dst || size == 0) return;
+  if (reader->token != JSON_STRING) {
+    dst[0] = '\0';
+    return;
+  }
+  snprintf(dst, size, "%s", reader->text);
+}
@@ -0,0 +1,72 @@
+/****************************************************************************
+ * gnss_json.h
+ *
+ * 流式JSON读取：按固定大小的块读取文件，一遍扫描逐个产生记号，
+ * 键名、字符串和数字放在读取器内的定长缓冲里，不分配内存也不生成中间字符串。
+ * 分段历史和旧版加速度记录都用它解析，内存占用与文件大小无关
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 每次从文件读取的字节数
+#define JSON_CHUNK_SIZE 256
+
+// 单个记号的最大长度 (更长的字符串被截断)
+#define JSON_TOKEN_MAX 64
+
+// 记号类型
+enum JsonToken {
+  JSON_END,            // 文件结束
+  JSON_ERROR,          // 格式错误或读取失败
+  JSON_OBJECT_START,   // {
+  JSON_OBJECT_END,     // }
+  JSON_ARRAY_START,    // [
+  JSON_ARRAY_END,      // ]
+  JSON_KEY,            // 对象的键 (已消耗后面的冒号)
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL
+};
+
+// 读取器
+struct JsonReader {
+  int fd;
+  char buf[JSON_CHUNK_SIZE];
+  size_t pos;                   // buf中下一个未处理的字节
+  size_t len;                   // buf中的有效字节
+  bool eof;
+  JsonToken token;              // 当前记号
+  char text[JSON_TOKEN_MAX];    // 当前记号的文本 (键、字符串、数字)
+  size_t text_len;
+  int depth;                    // 当前嵌套深度
+};
+
+// 打开/关闭文件
+bool json_open(JsonReader* reader, const char* path);
+void json_close(JsonReader* reader);
+
+// 读取下一个记号 (逗号被跳过)
+JsonToken json_next(JsonReader* reader);
+
+// 当前记号是否为指定名字的键
+bool json_is_key(const JsonReader* reader, const char* name);
+
+// 跳过当前记号开始的值 (对象或数组跳到对应的结束处)
+bool json_skip_value(JsonReader* reader);
+
+// 向后查找指定名字的键 (任意深度)，找到后下一个记号就是它的值
+bool json_find_key(JsonReader* reader, const char* name);
+
+// 读取当前对象的下一个键，遇到对象结束或出错时返回false
+bool json_next_key(JsonReader* reader);
+
+// 当前记号的数值 (不是数字时返回def)
+double json_number(const JsonReader* reader, double def);
+
+// 复制当前字符串记号 (不是字符串时复制空串)
+void json_copy_string(const JsonReader* reader, char* dst, size_t size);
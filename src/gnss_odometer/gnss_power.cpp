@@ -0,0 +1,74 @@
+/****************************************************************************
+ * gnss_power.cpp
+ *
+ * GNSS省电调度实现
+ * 档位按耗电从高到低排列 (全速率 < 低速率 < 暂停)，数值越大越省电
+ * ***************************************************************************/
+#include "gnss_power.h"
+#include <stdio.h>
+#include <time.h>
+
+static uint32_t g_last_key = 0;      // 最近一次按键 (秒，按键线程写，GNSS线程读)
+static uint32_t g_mode_since = 0;    // 进入当前档位的时间 (秒)
+
+/**
+ * 单调时钟 (秒)
+ */
+static uint32_t now_sec()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)ts.tv_sec;
+}
+
+/**
+ * 根据输入决定档位
+ */
+GnssPowerMode gnss_power_decide(const GnssPowerInputs& inputs)
+{
+  // 没有人需要定位数据：不在记录，也没有亮屏显示GNSS界面 (锁屏、音乐模式)
+  if (!inputs.recording && !inputs.viewing) return GNSS_POWER_SLEEP;
+
+  // 刚按过键或在运动中
+  if (inputs.since_key_sec < GNSS_POWER_WAKE_HOLD_SEC) return GNSS_POWER_FULL;
+  if (inputs.idle_sec < GNSS_POWER_IDLE_SEC) return GNSS_POWER_FULL;
+
+  // 停车：低速率跟踪，起步后立即恢复全速率
+  return GNSS_POWER_ECO;
+}
+
+/**
+ * 记录一次按键
+ */
+void gnss_power_notify_activity()
+{
+  __atomic_store_n(&g_last_key, now_sec(), __ATOMIC_RELAXED);
+}
+
+/**
+ * 按当前状态调度接收机
+ */
+void gnss_power_service(bool recording, bool viewing)
+{
+  uint32_t now = now_sec();
+
+  GnssPowerInputs inputs;
+  inputs.recording = recording;
+  inputs.viewing = viewing;
+  inputs.idle_sec = gnss_get_idle_seconds();
+  inputs.since_key_sec = now - __atomic_load_n(&g_last_key, __ATOMIC_RELAXED);
+
+  GnssPowerMode current = gnss_get_power_mode();
+  GnssPowerMode mode = gnss_power_decide(inputs);
+  if (mode == current) return;
+
+  // 降档前先在当前档位停留一段时间，升档立即执行
+  if (mode > current && now - g_mode_since < GNSS_POWER_MIN_DWELL_SEC) return;
+
+  static const char* const NAMES[] = { "全速率", "低速率", "暂停" };
+  printf("[GNSS] 省电调度: %s -> %s (静止 %u 秒)\n",
+         NAMES[current], NAMES[mode], (unsigned)inputs.idle_sec);
+
+  gnss_set_power_mode(mode);
+  g_mode_since = now;
+}
@@ -0,0 +1,43 @@
+/****************************************************************************
+ * gnss_power.h
+ *
+ * GNSS省电调度：根据是否在记录、是否亮屏显示GNSS界面、静止了多久和最近的按键，
+ * 在全速率、低速率(长周期跟踪，仍能发现起步)和暂停定位之间切换。
+ * 暂停前保存星历，恢复时热启动，几秒内即可重新定位。
+ * 升到更高的档位立即执行，降档前至少在当前档位停留一段时间，避免来回切换
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+
+// 连续静止超过该时间 (秒) 后降为低速率
+#ifdef CONFIG_SPRESENSEWONG_GNSS_IDLE_SEC
+#define GNSS_POWER_IDLE_SEC CONFIG_SPRESENSEWONG_GNSS_IDLE_SEC
+#else
+#define GNSS_POWER_IDLE_SEC 120
+#endif
+
+// 按键后保持全速率的时间 (秒)
+#define GNSS_POWER_WAKE_HOLD_SEC 30
+
+// 降档前在当前档位的最短停留时间 (秒)
+#define GNSS_POWER_MIN_DWELL_SEC 10
+
+// 调度的输入
+struct GnssPowerInputs {
+  bool recording;          // 正在记录轨迹
+  bool viewing;            // 当前显示GNSS界面且没有锁屏
+  uint32_t idle_sec;       // 连续静止的时长
+  uint32_t since_key_sec;  // 距最近一次按键的时长
+};
+
+// 根据输入决定档位 (不切换接收机)
+GnssPowerMode gnss_power_decide(const GnssPowerInputs& inputs);
+
+// 记录一次按键 (任意线程)
+void gnss_power_notify_activity();
+
+// 按当前状态调度接收机 (GNSS线程每个循环调用)
+void gnss_power_service(bool recording, bool viewing);
@@ -0,0 +1,177 @@
+/****************************************************************************
+ * gnss_replay.cpp
+ *
+ * 轨迹回放实现
+ * 始终保存当前时刻前后的两条记录，按输出时刻线性插值；
+ * 输出时刻按轨迹时间推进，倍速只决定什么时候到期，不改变输出的内容
+ * ***************************************************************************/
+#include "gnss_replay.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/**
+ * 单调时钟 (微秒)
+ */
+static uint64_t now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+/**
+ * 记录的轨迹时间 (毫秒)
+ */
+static int64_t point_ms(const GnssPoint& point)
+{
+  return (int64_t)point.utc_time * 1000 + point.utc_msec;
+}
+
+/**
+ * 读取下一条记录，后一条记录变为前一条
+ */
+static void shift(GnssReplay* replay)
+{
+  replay->prev = replay->next;
+  replay->prev_ms = replay->next_ms;
+
+  if (track_reader_next(&replay->reader, &replay->next)) {
+    replay->next_ms = point_ms(replay->next);
+  } else {
+    replay->next_ms = -1;
+  }
+}
+
+/**
+ * 打开轨迹
+ */
+bool gnss_replay_open(GnssReplay* replay, const char* trk_path, uint32_t rate_ms, uint32_t speedup)
+{
+  memset(replay, 0, sizeof(*replay));
+
+  if (!track_reader_open(&replay->reader, trk_path)) {
+    printf("[GNSS] 打开回放轨迹失败: %s\n", trk_path);
+    return false;
+  }
+
+  if (!track_reader_next(&replay->reader, &replay->next)) {
+    printf("[GNSS] 回放轨迹为空: %s\n", trk_path);
+    track_reader_close(&replay->reader);
+    return false;
+  }
+  replay->next_ms = point_ms(replay->next);
+  shift(replay);
+
+  replay->open = true;
+  replay->rate_ms = rate_ms;
+  replay->speedup = speedup;
+  replay->first_ms = replay->prev_ms;
+  replay->out_ms = replay->prev_ms;
+  replay->start_us = now_us();
+
+  printf("[GNSS] 开始回放: %s (间隔 %u ms, %u倍速)\n", trk_path,
+         (unsigned)rate_ms, (unsigned)speedup);
+  return true;
+}
+
+/**
+ * 关闭轨迹
+ */
+void gnss_replay_close(GnssReplay* replay)
+{
+  if (!replay->open) return;
+
+  track_reader_close(&replay->reader);
+  replay->open = false;
+  printf("[GNSS] 回放结束: %u 个历元\n", (unsigned)replay->epochs);
+}
+
+/**
+ * 距下一个历元到期的毫秒数
+ */
+int gnss_replay_wait_ms(const GnssReplay* replay)
+{
+  if (!replay->open || replay->finished) return -1;
+  if (replay->speedup == 0) return 0;
+
+  uint64_t due = replay->start_us +
+                 (uint64_t)(replay->out_ms - replay->first_ms) * 1000 / replay->speedup;
+  uint64_t now = now_us();
+  return due > now ? (int)((due - now + 999) / 1000) : 0;
+}
+
+/**
+ * 在前后两条记录之间插值
+ */
+static void interpolate(const GnssReplay* replay, int64_t t, GnssPoint* out)
+{
+  const GnssPoint& a = replay->prev;
+  const GnssPoint& b = replay->next;
+
+  *out = a;
+  if (replay->next_ms <= replay->prev_ms || t <= replay->prev_ms) return;
+
+  float f = (float)(t - replay->prev_ms) / (float)(replay->next_ms - replay->prev_ms);
+  out->latitude = a.latitude + (b.latitude - a.latitude) * f;
+  out->longitude = a.longitude + (b.longitude - a.longitude) * f;
+  out->altitude = a.altitude + (b.altitude - a.altitude) * f;
+  out->speed = a.speed + (b.speed - a.speed) * f;
+
+  // 航向按较小的夹角插值
+  float dc = b.course - a.course;
+  if (dc > 180.0f) dc -= 360.0f;
+  else if (dc < -180.0f) dc += 360.0f;
+  out->course = fmodf(a.course + dc * f + 360.0f, 360.0f);
+}
+
+/**
+ * 取下一个历元
+ */
+bool gnss_replay_next(GnssReplay* replay, GnssRawEpoch* epoch)
+{
+  if (gnss_replay_wait_ms(replay) != 0) return false;
+
+  int64_t t = replay->out_ms;
+  GnssPoint& point = epoch->point;
+
+  if (replay->rate_ms == 0) {
+    // 按记录输出
+    point = replay->prev;
+    if (replay->next_ms >= 0) {
+      shift(replay);
+      replay->out_ms = replay->prev_ms;
+    } else {
+      replay->finished = true;
+    }
+  } else {
+    while (replay->next_ms >= 0 && replay->next_ms <= t) {
+      shift(replay);
+    }
+
+    if (replay->next_ms < 0 && t > replay->prev_ms) {
+      replay->finished = true;
+      return false;
+    }
+
+    // 失去定位的间隔不插值，直接跳到间隔后的第一条记录
+    if (t > replay->prev_ms && replay->next_ms - replay->prev_ms > GNSS_REPLAY_MAX_GAP_MS) {
+      t = replay->next_ms;
+      shift(replay);
+    }
+
+    interpolate(replay, t, &point);
+    point.utc_time = (time_t)(t / 1000);
+    point.utc_msec = (uint16_t)(t % 1000);
+    point.timestamp = (int32_t)point.utc_time;
+    replay->out_ms = t + replay->rate_ms;
+  }
+
+  point.acceleration = 0.0f;
+  epoch->data_timestamp = (uint64_t)t;
+  epoch->fixmode = point.fix_type == FIX_3D ? 3 : point.fix_type == FIX_2D ? 2 : 1;
+  epoch->hdop = GNSS_REPLAY_HDOP;
+  replay->epochs++;
+  return true;
+}
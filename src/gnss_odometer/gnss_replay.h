@@ -0,0 +1,49 @@
+/****************************************************************************
+ * gnss_replay.h
+ *
+ * 轨迹回放：把录下的二进制轨迹 (.trk) 当作接收机输出的历元，
+ * 用于在板上重复跑同一段行程，比较不同固件版本的分析耗时和结果。
+ * 可按记录的时间回放，也可按1/5/10Hz重新插值；倍速为0时不等待，尽快输出
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+#include "gnss_track_codec.h"
+#include "gnss_worker.h"
+
+// 记录间隔超过该值 (毫秒) 视为失去定位，不跨过间隔插值
+#define GNSS_REPLAY_MAX_GAP_MS 5000
+
+// 轨迹中没有记录精度因子，回放时按良好定位处理
+#define GNSS_REPLAY_HDOP 1.0f
+
+// 回放状态
+struct GnssReplay {
+  TrackReader reader;
+  bool open;
+  bool finished;
+  uint32_t rate_ms;          // 输出历元的间隔，0表示按记录输出
+  uint32_t speedup;          // 倍速，0表示不等待
+  GnssPoint prev;            // 插值用的前后两条记录
+  GnssPoint next;
+  int64_t prev_ms;
+  int64_t next_ms;
+  int64_t out_ms;            // 下一个输出历元的轨迹时间 (毫秒)
+  int64_t first_ms;          // 第一个历元的轨迹时间
+  uint64_t start_us;         // 开始回放时的单调时钟 (微秒)
+  uint32_t epochs;           // 已输出的历元数
+};
+
+// 打开轨迹，rate_ms为0时按记录输出，speedup为0时不等待
+bool gnss_replay_open(GnssReplay* replay, const char* trk_path, uint32_t rate_ms, uint32_t speedup);
+
+// 关闭轨迹
+void gnss_replay_close(GnssReplay* replay);
+
+// 距下一个历元到期的毫秒数 (已到期为0，回放结束为-1)
+int gnss_replay_wait_ms(const GnssReplay* replay);
+
+// 取下一个历元，未到期或回放结束返回false
+bool gnss_replay_next(GnssReplay* replay, GnssRawEpoch* epoch);
@@ -0,0 +1,125 @@
+/****************************************************************************
+ * gnss_ring.cpp
+ *
+ * GNSS 历元环形缓冲实现
+ * 每个槽位带序号做顺序锁：生产者写入前先把序号置0，写完后再发布新序号；
+ * 消费者拷贝前后各读一次序号，不一致说明被覆盖，按丢失处理，不会读到半个历元
+ * ***************************************************************************/
+#include "gnss_ring.h"
+#include <string.h>
+
+static_assert((GNSS_RING_CAPACITY & (GNSS_RING_CAPACITY - 1)) == 0,
+              "GNSS_RING_CAPACITY必须为2的幂");
+
+#define GNSS_RING_MASK (GNSS_RING_CAPACITY - 1)
+
+// 槽位
+struct GnssRingSlot {
+  volatile uint32_t seq; // 槽位当前保存的历元序号，0表示正在写入
+  GnssPoint point;
+};
+
+static GnssRingSlot g_slots[GNSS_RING_CAPACITY];
+static volatile uint32_t g_head_seq = 0;  // 最新已发布的序号
+
+/**
+ * 写入一个历元
+ */
+uint32_t gnss_ring_push(const GnssPoint& point)
+{
+  uint32_t seq = g_head_seq + 1;
+  if (seq == 0) seq = 1;  // 序号回绕时跳过0
+
+  GnssRingSlot* slot = &g_slots[seq & GNSS_RING_MASK];
+
+  // 标记槽位正在写入
+  __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  memcpy(&slot->point, &point, sizeof(GnssPoint));
+
+  // 发布槽位和最新序号
+  __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+  __atomic_store_n(&g_head_seq, seq, __ATOMIC_RELEASE);
+
+  return seq;
+}
+
+/**
+ * 获取最新写入的序号
+ */
+uint32_t gnss_ring_head_seq()
+{
+  return __atomic_load_n(&g_head_seq, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * 初始化读游标
+ */
+void gnss_ring_reader_init(GnssRingReader* reader, bool from_latest)
+{
+  if (!reader) return;
+
+  uint32_t head = gnss_ring_head_seq();
+  if (from_latest || head < GNSS_RING_CAPACITY) {
+    reader->next_seq = from_latest ? head + 1 : 1;
+  } else {
+    reader->next_seq = head - GNSS_RING_CAPACITY + 1;
+  }
+  reader->dropped = 0;
+}
+
+/**
+ * 从槽位拷贝指定序号的历元，被覆盖时返回false
+ */
+static bool read_slot(uint32_t seq, GnssEpoch* epoch)
+{
+  const GnssRingSlot* slot = &g_slots[seq & GNSS_RING_MASK];
+
+  if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq) {
+    return false;
+  }
+
+  memcpy(&epoch->point, (const void*)&slot->point, sizeof(GnssPoint));
+
+  // 拷贝完成后再确认一次，期间被改写则丢弃
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+    return false;
+  }
+
+  epoch->seq = seq;
+  return true;
+}
+
+/**
+ * 读取下一个历元
+ */
+bool gnss_ring_read(GnssRingReader* reader, GnssEpoch* epoch)
+{
+  if (!reader || !epoch) return false;
+
+  while (true) {
+    uint32_t head = gnss_ring_head_seq();
+
+    // 没有新数据
+    if ((int32_t)(head - reader->next_seq) < 0) {
+      return false;
+    }
+
+    // 落后超过一圈，跳到仍然有效的最旧历元
+    if (head - reader->next_seq >= GNSS_RING_CAPACITY) {
+      uint32_t oldest = head - GNSS_RING_CAPACITY + 1;
+      reader->dropped += oldest - reader->next_seq;
+      reader->next_seq = oldest;
+    }
+
+    uint32_t seq = reader->next_seq++;
+    if (read_slot(seq, epoch)) {
+      return true;
+    }
+
+    // 读取时被生产者覆盖，计为丢失后继续
+    reader->dropped++;
+  }
+}
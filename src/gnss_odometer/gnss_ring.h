@@ -0,0 +1,43 @@
+/****************************************************************************
+ * gnss_ring.h
+ *
+ * GNSS 历元环形缓冲：单生产者(行程分析，每个有效定位发布一次)、多消费者。
+ * 目前的消费者是SD卡轨迹记录 (gnss_track_writer)，界面和行程统计使用TripData快照。
+ * 每个消费者持有自己的读游标，按各自节奏读取，生产者从不等待消费者
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+
+// 环形缓冲容量 (必须为2的幂)
+#ifdef CONFIG_SPRESENSEWONG_GNSS_RING_SIZE
+#define GNSS_RING_CAPACITY CONFIG_SPRESENSEWONG_GNSS_RING_SIZE
+#else
+#define GNSS_RING_CAPACITY 64
+#endif
+
+// 带序号的定位历元
+struct GnssEpoch {
+  uint32_t seq;          // 历元序号 (从1开始递增，0表示无效)
+  GnssPoint point;       // 定位数据
+};
+
+// 消费者读游标
+struct GnssRingReader {
+  uint32_t next_seq;     // 下一个要读取的序号
+  uint32_t dropped;      // 读取过慢被覆盖而丢失的历元数
+};
+
+// 写入一个历元 (仅行程分析调用)，返回分配的序号
+uint32_t gnss_ring_push(const GnssPoint& point);
+
+// 获取最新写入的序号 (0表示尚无数据)
+uint32_t gnss_ring_head_seq();
+
+// 初始化读游标，from_latest为true时只读取之后的新历元
+void gnss_ring_reader_init(GnssRingReader* reader, bool from_latest = true);
+
+// 读取下一个历元，没有新数据时返回false
+bool gnss_ring_read(GnssRingReader* reader, GnssEpoch* epoch);
@@ -54,6 +54,9 @@ void gnss_screens_set_orientation(ScreenOrientation orientation)
       u8g2_SetDisplayRotation(u8g2, U8G2_R3);
       break;
   }
+  
+  // 旋转后整屏内容都会变化
+  lcd_invalidate();
 }
 
 /**
@@ -151,7 +154,7 @@ static void format_distance(double distance_m, char* buf, size_t buf_size)
  */
 void gnss_draw_odometer(const GnssPoint* point, const TripData* trip, bool recording)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -194,7 +197,7 @@ void gnss_draw_odometer(const GnssPoint* point, const TripData* trip, bool recor
     u8g2_DrawStr(u8g2, 85, 64, "长按S:分段");
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -202,7 +205,7 @@ void gnss_draw_odometer(const GnssPoint* point, const TripData* trip, bool recor
  */
 void gnss_draw_compass(const GnssPoint* point)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -261,7 +264,7 @@ void gnss_draw_compass(const GnssPoint* point)
   
   u8g2_DrawStr(u8g2, 80, 64, time_buf);
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -269,7 +272,7 @@ void gnss_draw_compass(const GnssPoint* point)
  */
 void gnss_draw_tracking(bool recording, uint32_t points_count, const TripData* trip)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -303,7 +306,7 @@ void gnss_draw_tracking(bool recording, uint32_t points_count, const TripData* t
     u8g2_DrawStr(u8g2, 15, 64, "按后退键保存轨迹");
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -311,7 +314,7 @@ void gnss_draw_tracking(bool recording, uint32_t points_count, const TripData* t
  */
 void gnss_draw_trip_data(const TripData* trip)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -321,7 +324,7 @@ void gnss_draw_trip_data(const TripData* trip)
   
   if (!trip) {
     u8g2_DrawStr(u8g2, 25, 35, "无行程数据");
-    u8g2_SendBuffer(u8g2);
+    lcd_end_frame();
     return;
   }
   
@@ -356,7 +359,7 @@ void gnss_draw_trip_data(const TripData* trip)
   // 百米加速
   char accel_buf[32];
   if (trip->has_0_100_time) {
-    snprintf(accel_buf, sizeof(accel_buf), "%.1f 秒", trip->time_0_100);
+    snprintf(accel_buf, sizeof(accel_buf), "%.2f 秒", trip->time_0_100);
   } else {
     strcpy(accel_buf, "无数据");
   }
@@ -364,7 +367,7 @@ void gnss_draw_trip_data(const TripData* trip)
   u8g2_DrawStr(u8g2, 0, 62, "0-100:");
   u8g2_DrawStr(u8g2, 40, 62, accel_buf);
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -372,7 +375,7 @@ void gnss_draw_trip_data(const TripData* trip)
  */
 void gnss_draw_settings(GnssUpdateRate rate, int selected_index)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -419,7 +422,7 @@ void gnss_draw_settings(GnssUpdateRate rate, int selected_index)
   // 显示操作提示
   u8g2_DrawStr(u8g2, 5, 62, "上下键:选择  确认:进入");
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -427,7 +430,7 @@ void gnss_draw_settings(GnssUpdateRate rate, int selected_index)
  */
 void gnss_draw_segment_settings(bool enabled, SegmentTimeOption option, uint32_t custom_time, int selected_index)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -507,7 +510,7 @@ void gnss_draw_segment_settings(bool enabled, SegmentTimeOption option, uint32_t
   // 显示操作提示
   u8g2_DrawStr(u8g2, 10, 64, "上下键:选择 左右键:调整");
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -515,7 +518,7 @@ void gnss_draw_segment_settings(bool enabled, SegmentTimeOption option, uint32_t
  */
 void gnss_draw_accel_test(const TripData* trip, float current_speed)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
 {{ ... }}
@@ -535,16 +538,22 @@ void gnss_draw_accel_test(const TripData* trip, float current_speed)
   u8g2_SetFont(u8g2, u8g2_font_6x12_tr);
   if (trip && trip->has_0_100_time) {
     char time_buf[32];
-    snprintf(time_buf, sizeof(time_buf), "0-100 km/h: %.1f秒", trip->time_0_100);
+    snprintf(time_buf, sizeof(time_buf), "0-100 km/h: %.2f秒", trip->time_0_100);
     u8g2_DrawStr(u8g2, 15, 55, time_buf);
   } else {
     u8g2_DrawStr(u8g2, 15, 55, "等待开始加速测试...");
   }
   
-  // 操作提示
-  u8g2_DrawStr(u8g2, 5, 64, "从停止状态加速至100km/h");
+  // 60-100 km/h 时间，没有时显示操作提示
+  if (trip && trip->has_60_100_time) {
+    char time_buf[32];
+    snprintf(time_buf, sizeof(time_buf), "60-100 km/h: %.2f秒", trip->time_60_100);
+    u8g2_DrawStr(u8g2, 15, 64, time_buf);
+  } else {
+    u8g2_DrawStr(u8g2, 5, 64, "从停止状态加速至100km/h");
+  }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -552,7 +561,7 @@ void gnss_draw_accel_test(const TripData* trip, float current_speed)
  */
 void gnss_draw_history_list(const std::vector<std::string>& files, int selected_index)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -612,7 +621,7 @@ void gnss_draw_history_list(const std::vector<std::string>& files, int selected_
   // 显示导航提示
   u8g2_DrawStr(u8g2, 5, 64, "新前启：查看详情");
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -620,13 +629,13 @@ void gnss_draw_history_list(const std::vector<std::string>& files, int selected_
  */
 void gnss_draw_segment_detail(const std::vector<SegmentData>& segments, int selected_index)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
   if (segments.empty() || selected_index >= segments.size()) {
     u8g2_DrawStr(u8g2, 5, 32, "没有分段数据");
-    u8g2_SendBuffer(u8g2);
+    lcd_end_frame();
     return;
   }
   
@@ -679,7 +688,7 @@ void gnss_draw_segment_detail(const std::vector<SegmentData>& segments, int sele
   snprintf(nav_hint, sizeof(nav_hint), "< %d/%d >", selected_index + 1, (int)segments.size());
   u8g2_DrawStr(u8g2, 85, 57, nav_hint);
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -980,7 +989,7 @@ void gnss_handle_key(uint8_t key)
  */
 void gnss_draw_acceleration_history(int selected_index)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -996,7 +1005,7 @@ void gnss_draw_acceleration_history(int selected_index)
     // 没有历史数据
     u8g2_DrawStr(u8g2, 10, 35, "无加速度历史记录");
     u8g2_DrawStr(u8g2, 10, 50, "在行驶时自动记录");
-    u8g2_SendBuffer(u8g2);
+    lcd_end_frame();
     return;
   }
   
@@ -1009,7 +1018,7 @@ void gnss_draw_acceleration_history(int selected_index)
   const AccelerationData* data = gnss_get_acceleration_data(selected_index);
   if (!data) {
     u8g2_DrawStr(u8g2, 10, 35, "读取数据失败");
-    u8g2_SendBuffer(u8g2);
+    lcd_end_frame();
     return;
   }
   
@@ -1048,5 +1057,5 @@ void gnss_draw_acceleration_history(int selected_index)
   u8g2_DrawStr(u8g2, 0, 54, "最大速度:");
   u8g2_DrawStr(u8g2, 70, 54, max_speed);
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
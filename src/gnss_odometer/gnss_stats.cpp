@@ -0,0 +1,163 @@
+/****************************************************************************
+ * gnss_stats.cpp
+ *
+ * 行程统计引擎实现
+ * 爬升/下降以滞回方式累计：海拔离参考值超过阈值才计入并移动参考值，
+ * 静止时几米的垂直漂移不会累计成几百米的爬升
+ * ***************************************************************************/
+#include "gnss_stats.h"
+#include <string.h>
+
+/**
+ * 清空累计器
+ */
+void stats_reset(StatsAccum* accum)
+{
+  memset(accum, 0, sizeof(*accum));
+}
+
+/**
+ * 累加一个历元
+ */
+void stats_add(StatsAccum* accum, const StatsSample& sample)
+{
+  accum->samples++;
+  accum->distance += sample.distance;
+  accum->elapsed_ms += sample.dt_ms;
+
+  if (sample.moving) {
+    accum->moving_ms += sample.dt_ms;
+    accum->moving_distance += sample.distance;
+  } else {
+    accum->idle_ms += sample.dt_ms;
+  }
+
+  if (sample.speed > accum->max_speed) accum->max_speed = sample.speed;
+
+  if (!sample.has_altitude) return;
+
+  float alt = sample.altitude;
+  if (!accum->has_altitude) {
+    accum->has_altitude = true;
+    accum->max_altitude = alt;
+    accum->min_altitude = alt;
+    accum->elevation_ref = alt;
+    return;
+  }
+
+  if (alt > accum->max_altitude) accum->max_altitude = alt;
+  if (alt < accum->min_altitude) accum->min_altitude = alt;
+
+  if (alt > accum->elevation_ref + GNSS_STATS_ELEVATION_HYSTERESIS) {
+    accum->elevation_gain += alt - accum->elevation_ref;
+    accum->elevation_ref = alt;
+  } else if (alt < accum->elevation_ref - GNSS_STATS_ELEVATION_HYSTERESIS) {
+    accum->elevation_loss += accum->elevation_ref - alt;
+    accum->elevation_ref = alt;
+  }
+}
+
+/**
+ * 平均速度
+ */
+float stats_avg_speed(const StatsAccum& accum)
+{
+  if (accum.elapsed_ms == 0) return 0.0f;
+  return (float)(accum.distance * 1000.0 / accum.elapsed_ms);
+}
+
+/**
+ * 运动平均速度
+ */
+float stats_moving_avg_speed(const StatsAccum& accum)
+{
+  if (accum.moving_ms == 0) return 0.0f;
+  return (float)(accum.moving_distance * 1000.0 / accum.moving_ms);
+}
+
+/**
+ * 写入行程数据
+ */
+void stats_apply_trip(const StatsAccum& accum, TripData* trip)
+{
+  trip->total_distance = accum.distance;
+  trip->duration = (int32_t)(accum.elapsed_ms / 1000);
+  trip->avg_speed = stats_avg_speed(accum);
+  trip->max_speed = accum.max_speed;
+  trip->moving_time = accum.moving_ms / 1000;
+  trip->idle_time = accum.idle_ms / 1000;
+  trip->moving_avg_speed = stats_moving_avg_speed(accum);
+  trip->elevation_gain = accum.elevation_gain;
+  trip->elevation_loss = accum.elevation_loss;
+  if (accum.has_altitude) {
+    trip->max_altitude = accum.max_altitude;
+    trip->min_altitude = accum.min_altitude;
+  }
+}
+
+/**
+ * 写入分段数据
+ */
+void stats_apply_segment(const StatsAccum& accum, SegmentData* segment)
+{
+  segment->distance = accum.distance;
+  segment->duration = (int32_t)(accum.elapsed_ms / 1000);
+  segment->avg_speed = stats_avg_speed(accum);
+  segment->point_count = accum.samples;
+  segment->moving_time = accum.moving_ms / 1000;
+  segment->idle_time = accum.idle_ms / 1000;
+  segment->moving_avg_speed = stats_moving_avg_speed(accum);
+  segment->max_speed = accum.max_speed;
+  segment->elevation_gain = accum.elevation_gain;
+  segment->elevation_loss = accum.elevation_loss;
+}
+
+/**
+ * 初始化滑动窗口
+ */
+void stats_window_init(StatsWindow* window, bool by_distance, float span)
+{
+  memset(window, 0, sizeof(*window));
+  window->by_distance = by_distance;
+  window->bucket_span = span / GNSS_STATS_WINDOW_BUCKETS;
+  window->filled = 1;
+}
+
+/**
+ * 累加一个历元
+ * 当前桶满了就移到下一个桶，窗口已满时丢弃最旧的桶；
+ * 按距离的窗口只计运动时间，停车不会拉低最近1公里的速度
+ */
+void stats_window_add(StatsWindow* window, const StatsSample& sample)
+{
+  if (window->by_distance && !sample.moving) return;
+
+  uint8_t head = window->head;
+  window->distance[head] += sample.distance;
+  window->time_ms[head] += sample.dt_ms;
+  window->total_distance += sample.distance;
+  window->total_ms += sample.dt_ms;
+
+  float used = window->by_distance ? window->distance[head] : (float)window->time_ms[head];
+  if (used < window->bucket_span) return;
+
+  head = (head + 1) % GNSS_STATS_WINDOW_BUCKETS;
+  if (window->filled == GNSS_STATS_WINDOW_BUCKETS) {
+    window->total_distance -= window->distance[head];
+    window->total_ms -= window->time_ms[head];
+  } else {
+    window->filled++;
+  }
+  window->distance[head] = 0.0f;
+  window->time_ms[head] = 0;
+  window->head = head;
+}
+
+/**
+ * 窗口内的平均速度
+ */
+float stats_window_avg_speed(const StatsWindow& window)
+{
+  if (window.total_ms == 0) return 0.0f;
+  return (float)(window.total_distance * 1000.0 / window.total_ms);
+}
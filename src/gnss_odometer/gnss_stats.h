@@ -0,0 +1,88 @@
+/****************************************************************************
+ * gnss_stats.h
+ *
+ * 行程统计引擎：行程和当前分段各有一个累计器，每个历元只更新累计和、
+ * 最值、运动/停留时长和爬升/下降，O(1)且不保存轨迹点。
+ * 最近1公里、最近5分钟这类滑动窗口平均速度用定长分桶近似，
+ * 每个桶只记距离和时间，窗口边界的误差不超过一个桶
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+
+// 海拔变化超过该值 (米) 才计入爬升/下降，过滤垂直方向的定位噪声
+#define GNSS_STATS_ELEVATION_HYSTERESIS 3.0f
+
+// 相邻历元间隔超过该值 (毫秒) 时不计时 (失去定位期间)
+#define GNSS_STATS_MAX_GAP_MS 5000
+
+// 滑动窗口的桶数
+#define GNSS_STATS_WINDOW_BUCKETS 20
+
+// 滑动窗口：最近1公里、最近5分钟
+#define GNSS_STATS_WINDOW_DISTANCE_M 1000.0f
+#define GNSS_STATS_WINDOW_TIME_MS 300000
+
+// 一个历元的输入
+struct StatsSample {
+  uint32_t dt_ms;         // 距上一个历元的时间
+  float distance;         // 距上一个历元的距离 (米，静止时为0)
+  float speed;            // 速度 (m/s)
+  float altitude;         // 海拔 (米)
+  bool has_altitude;      // 海拔是否有效 (3D定位)
+  bool moving;            // 是否在运动
+};
+
+// 累计器
+struct StatsAccum {
+  double distance;        // 距离 (米)
+  double moving_distance; // 运动中的距离 (米)
+  uint32_t elapsed_ms;    // 计时时长
+  uint32_t moving_ms;     // 运动时长
+  uint32_t idle_ms;       // 停留时长
+  uint32_t samples;       // 样本数
+  float max_speed;        // 最大速度 (m/s)
+  bool has_altitude;
+  float max_altitude;
+  float min_altitude;
+  float elevation_ref;    // 爬升/下降的参考海拔
+  float elevation_gain;   // 累计爬升 (米)
+  float elevation_loss;   // 累计下降 (米)
+};
+
+// 滑动窗口
+struct StatsWindow {
+  float bucket_span;                              // 每个桶的跨度 (米或毫秒)
+  bool by_distance;                               // 按距离还是按时间分桶
+  uint8_t head;                                   // 当前桶
+  uint8_t filled;                                 // 已用的桶数
+  float distance[GNSS_STATS_WINDOW_BUCKETS];      // 每个桶的距离
+  uint32_t time_ms[GNSS_STATS_WINDOW_BUCKETS];    // 每个桶的时间
+  double total_distance;
+  uint32_t total_ms;
+};
+
+// 清空累计器
+void stats_reset(StatsAccum* accum);
+
+// 累加一个历元
+void stats_add(StatsAccum* accum, const StatsSample& sample);
+
+// 平均速度 (m/s) 和运动平均速度
+float stats_avg_speed(const StatsAccum& accum);
+float stats_moving_avg_speed(const StatsAccum& accum);
+
+// 把累计结果写入行程/分段数据
+void stats_apply_trip(const StatsAccum& accum, TripData* trip);
+void stats_apply_segment(const StatsAccum& accum, SegmentData* segment);
+
+// 初始化滑动窗口，span为窗口总跨度 (按距离为米，按时间为毫秒)
+void stats_window_init(StatsWindow* window, bool by_distance, float span);
+
+// 累加一个历元
+void stats_window_add(StatsWindow* window, const StatsSample& sample);
+
+// 窗口内的平均速度 (m/s)，没有数据返回0
+float stats_window_avg_speed(const StatsWindow& window);
@@ -0,0 +1,384 @@
+/****************************************************************************
+ * gnss_track_codec.cpp
+ *
+ * 紧凑二进制轨迹格式实现及GPX/JSON导出
+ * ***************************************************************************/
+#include "gnss_track_codec.h"
+#include "gnss_track_writer.h"
+#include "sd_io.h"
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <string>
+
+// 后台导出 (同一时间只有一个)
+static bool g_exporting = false;
+static char g_export_trk[SD_IO_PATH_MAX];
+static char g_export_out[SD_IO_PATH_MAX];
+static TrackExportFormat g_export_format = TRACK_EXPORT_GPX;
+
+/**
+ * 量化工具
+ */
+static int32_t to_e7(double deg)
+{
+  return (int32_t)lround(deg * 1e7);
+}
+
+static int64_t point_time_ms(const GnssPoint& point)
+{
+  time_t t = point.utc_time > 0 ? point.utc_time : (time_t)point.timestamp;
+  return (int64_t)t * 1000 + (point.utc_time > 0 ? point.utc_msec : 0);
+}
+
+static uint32_t zigzag(int32_t v)
+{
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static size_t put_varint(uint8_t* buf, uint32_t v)
+{
+  size_t n = 0;
+  while (v >= 0x80) {
+    buf[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  buf[n++] = (uint8_t)v;
+  return n;
+}
+
+static void put_u16(uint8_t* buf, uint16_t v)
+{
+  buf[0] = (uint8_t)v;
+  buf[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* buf, uint32_t v)
+{
+  buf[0] = (uint8_t)v;
+  buf[1] = (uint8_t)(v >> 8);
+  buf[2] = (uint8_t)(v >> 16);
+  buf[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t* buf)
+{
+  return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+         ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+/**
+ * 写入文件头
+ */
+size_t track_encode_header(uint8_t* buf, const GnssPoint& ref, TrackCodecState* state)
+{
+  state->lat_e7 = to_e7(ref.latitude);
+  state->lon_e7 = to_e7(ref.longitude);
+  state->alt_cm = (int32_t)lround(ref.altitude * 100.0);
+  state->time_ms = point_time_ms(ref) / 1000 * 1000;
+
+  memcpy(buf, TRACK_BIN_MAGIC, 4);
+  put_u16(buf + 4, TRACK_BIN_VERSION);
+  put_u16(buf + 6, 0);
+  put_u32(buf + 8, (uint32_t)state->lat_e7);
+  put_u32(buf + 12, (uint32_t)state->lon_e7);
+  put_u32(buf + 16, (uint32_t)state->alt_cm);
+  put_u32(buf + 20, (uint32_t)(state->time_ms / 1000));
+
+  return TRACK_BIN_HEADER_SIZE;
+}
+
+/**
+ * 编码一条记录
+ */
+size_t track_encode_point(uint8_t* buf, const GnssPoint& point, TrackCodecState* state)
+{
+  int32_t lat = to_e7(point.latitude);
+  int32_t lon = to_e7(point.longitude);
+  int32_t alt = (int32_t)lround(point.altitude * 100.0);
+  int64_t time_ms = point_time_ms(point);
+
+  // 时间只增不减，接收机跳变时按0处理
+  int64_t dt = time_ms - state->time_ms;
+  if (dt < 0) dt = 0;
+  if (dt > 0xFFFFFFFF) dt = 0xFFFFFFFF;
+
+  uint32_t speed_cms = point.speed > 0 ? (uint32_t)lroundf(point.speed * 100.0f) : 0;
+  uint32_t course = (uint32_t)lroundf(point.course * 10.0f) % 3600;
+  uint8_t sats = (point.num_satellites > 63 ? 63 : point.num_satellites) |
+                 ((uint8_t)point.fix_type << 6);
+
+  size_t n = 0;
+  n += put_varint(buf + n, (uint32_t)dt);
+  n += put_varint(buf + n, zigzag(lat - state->lat_e7));
+  n += put_varint(buf + n, zigzag(lon - state->lon_e7));
+  n += put_varint(buf + n, zigzag(alt - state->alt_cm));
+  n += put_varint(buf + n, speed_cms);
+  n += put_varint(buf + n, course);
+  buf[n++] = sats;
+
+  state->lat_e7 = lat;
+  state->lon_e7 = lon;
+  state->alt_cm = alt;
+  state->time_ms = state->time_ms + dt;
+
+  return n;
+}
+
+/**
+ * 读取一个varint，文件结束返回false
+ */
+static bool read_varint(FILE* f, uint32_t* value)
+{
+  uint32_t v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    int c = getc(f);
+    if (c == EOF) return false;
+    v |= (uint32_t)(c & 0x7F) << shift;
+    if (!(c & 0x80)) {
+      *value = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * 打开二进制轨迹
+ */
+bool track_reader_open(TrackReader* reader, const char* path)
+{
+  if (!reader || !path) return false;
+
+  reader->file = fopen(path, "rb");
+  if (!reader->file) {
+    printf("[GNSS] 打开轨迹文件失败: %s\n", path);
+    return false;
+  }
+
+  uint8_t header[TRACK_BIN_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) ||
+      memcmp(header, TRACK_BIN_MAGIC, 4) != 0 ||
+      (header[4] | (header[5] << 8)) != TRACK_BIN_VERSION) {
+    printf("[GNSS] 轨迹文件格式错误: %s\n", path);
+    fclose(reader->file);
+    reader->file = nullptr;
+    return false;
+  }
+
+  reader->state.lat_e7 = (int32_t)get_u32(header + 8);
+  reader->state.lon_e7 = (int32_t)get_u32(header + 12);
+  reader->state.alt_cm = (int32_t)get_u32(header + 16);
+  reader->state.time_ms = (int64_t)get_u32(header + 20) * 1000;
+
+  return true;
+}
+
+/**
+ * 读取下一条记录
+ */
+bool track_reader_next(TrackReader* reader, GnssPoint* point)
+{
+  if (!reader || !reader->file || !point) return false;
+
+  uint32_t dt, dlat, dlon, dalt, speed, course;
+  if (!read_varint(reader->file, &dt) ||
+      !read_varint(reader->file, &dlat) ||
+      !read_varint(reader->file, &dlon) ||
+      !read_varint(reader->file, &dalt) ||
+      !read_varint(reader->file, &speed) ||
+      !read_varint(reader->file, &course)) {
+    return false;
+  }
+
+  int sats = getc(reader->file);
+  if (sats == EOF) return false;
+
+  TrackCodecState* st = &reader->state;
+  st->time_ms += dt;
+  st->lat_e7 += unzigzag(dlat);
+  st->lon_e7 += unzigzag(dlon);
+  st->alt_cm += unzigzag(dalt);
+
+  memset(point, 0, sizeof(*point));
+  point->latitude = st->lat_e7 / 1e7;
+  point->longitude = st->lon_e7 / 1e7;
+  point->altitude = st->alt_cm / 100.0;
+  point->speed = speed / 100.0f;
+  point->course = course / 10.0f;
+  point->num_satellites = sats & 0x3F;
+  point->fix_type = (GnssFixType)((sats >> 6) & 0x03);
+  point->utc_time = (time_t)(st->time_ms / 1000);
+  point->utc_msec = (uint16_t)(st->time_ms % 1000);
+  point->timestamp = (int32_t)point->utc_time;
+
+  return true;
+}
+
+/**
+ * 关闭读取器
+ */
+void track_reader_close(TrackReader* reader)
+{
+  if (reader && reader->file) {
+    fclose(reader->file);
+    reader->file = nullptr;
+  }
+}
+
+/**
+ * 按源文件名生成导出文件名
+ */
+void track_export_path(const char* trk_path, TrackExportFormat format, char* out, size_t out_size)
+{
+  const char* ext = (format == TRACK_EXPORT_JSON) ? ".json" : ".gpx";
+  const char* dot = strrchr(trk_path, '.');
+  size_t base_len = dot ? (size_t)(dot - trk_path) : strlen(trk_path);
+
+  snprintf(out, out_size, "%.*s%s", (int)base_len, trk_path, ext);
+}
+
+/**
+ * 导出为GPX/JSON
+ */
+bool track_export(const char* trk_path, const char* out_path, TrackExportFormat format)
+{
+  if (!trk_path || !out_path) return false;
+
+  // 已导出且源文件没有更新时直接复用
+  struct stat src_st, dst_st;
+  if (stat(trk_path, &src_st) != 0) {
+    printf("[GNSS] 轨迹文件不存在: %s\n", trk_path);
+    return false;
+  }
+  if (stat(out_path, &dst_st) == 0 && dst_st.st_mtime >= src_st.st_mtime) {
+    return true;
+  }
+
+  TrackReader reader;
+  if (!track_reader_open(&reader, trk_path)) return false;
+
+  // 文件头替换旧的导出文件，轨迹点攒够一块再追加
+  std::string out;
+  char line[256];
+  int n;
+  if (format == TRACK_EXPORT_GPX) {
+    n = snprintf(line, sizeof(line),
+                 "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                 "<gpx version=\"1.1\" creator=\"Spresense GNSS Odometer\">\n"
+                 "<trk><name>Track %ld</name><trkseg>\n", (long)(reader.state.time_ms / 1000));
+  } else {
+    n = snprintf(line, sizeof(line), "{\n  \"points\": [\n");
+  }
+  if (!sd_io_write_file(out_path, line, n, SD_IO_STATS)) {
+    track_reader_close(&reader);
+    printf("[GNSS] 创建文件失败: %s\n", out_path);
+    return false;
+  }
+
+  GnssPoint pt;
+  uint32_t count = 0;
+  bool ok = true;
+
+  while (track_reader_next(&reader, &pt)) {
+    if (format == TRACK_EXPORT_GPX) {
+      n = track_format_gpx_point(line, sizeof(line), pt);
+    } else {
+      n = snprintf(line, sizeof(line),
+                   "%s    {\"t\": %ld.%03u, \"lat\": %.7f, \"lon\": %.7f, \"ele\": %.2f, "
+                   "\"speed\": %.2f, \"course\": %.1f, \"sats\": %u}",
+                   count > 0 ? ",\n" : "", (long)pt.utc_time, (unsigned)pt.utc_msec,
+                   pt.latitude, pt.longitude, pt.altitude, pt.speed, pt.course,
+                   (unsigned)pt.num_satellites);
+    }
+    if (n > 0) out.append(line, ((size_t)n < sizeof(line)) ? n : sizeof(line) - 1);
+    count++;
+
+    if (out.size() >= SD_IO_COALESCE_MAX) {
+      ok = sd_io_append(out_path, out.data(), out.size(), SD_IO_STATS) && ok;
+      out.clear();
+    }
+  }
+  track_reader_close(&reader);
+
+  out += (format == TRACK_EXPORT_GPX) ? "</trkseg></trk></gpx>\n" : "\n  ]\n}\n";
+  ok = sd_io_append(out_path, out.data(), out.size(), SD_IO_STATS) && ok;
+  sd_io_close(out_path, SD_IO_STATS);
+
+  if (!ok) {
+    printf("[GNSS] 导出轨迹失败: %s\n", out_path);
+    return false;
+  }
+
+  printf("[GNSS] 导出轨迹到: %s, %u 个点\n", out_path, (unsigned)count);
+  return true;
+}
+
+/**
+ * 导出线程：先等记录中的轨迹数据落盘再读取，
+ * 导出文件写完才结束，避免下一次导出和还在排队的旧内容混在一起
+ */
+static void* export_thread(void* arg)
+{
+  (void)arg;
+
+  sd_io_flush(TRACK_EXPORT_FLUSH_MS);
+  track_export(g_export_trk, g_export_out, g_export_format);
+  sd_io_flush(TRACK_EXPORT_FLUSH_MS);
+
+  __atomic_store_n(&g_exporting, false, __ATOMIC_RELEASE);
+  return nullptr;
+}
+
+/**
+ * 在后台线程中导出
+ */
+bool track_export_start(const char* trk_path, const char* out_path, TrackExportFormat format)
+{
+  if (!trk_path || !out_path) return false;
+  if (strlen(trk_path) >= SD_IO_PATH_MAX || strlen(out_path) >= SD_IO_PATH_MAX) return false;
+
+  if (__atomic_exchange_n(&g_exporting, true, __ATOMIC_ACQUIRE)) {
+    printf("[GNSS] 正在导出轨迹，请稍候\n");
+    return false;
+  }
+
+  strcpy(g_export_trk, trk_path);
+  strcpy(g_export_out, out_path);
+  g_export_format = format;
+
+  pthread_attr_t attr;
+  struct sched_param param;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, TRACK_EXPORT_STACK_SIZE);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  param.sched_priority = TRACK_EXPORT_PRIORITY;
+  pthread_attr_setschedparam(&attr, &param);
+
+  pthread_t tid;
+  int ret = pthread_create(&tid, &attr, export_thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    printf("[GNSS] 创建导出线程失败: %d\n", ret);
+    __atomic_store_n(&g_exporting, false, __ATOMIC_RELEASE);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * 是否有后台导出在进行
+ */
+bool track_export_busy()
+{
+  return __atomic_load_n(&g_exporting, __ATOMIC_ACQUIRE);
+}
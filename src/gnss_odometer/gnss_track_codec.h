@@ -0,0 +1,76 @@
+/****************************************************************************
+ * gnss_track_codec.h
+ *
+ * 紧凑二进制轨迹格式 (.trk)
+ *
+ * 文件头 (24字节，小端)：
+ *   "STRK" | 版本(u16) | 保留(u16) | 参考纬度(i32, 1e-7度) | 参考经度(i32, 1e-7度)
+ *   | 参考海拔(i32, 厘米) | 参考时间(u32, UTC秒)
+ * 每个历元一条记录，依次为以下varint字段：
+ *   时间增量(毫秒) | 纬度增量(zigzag, 1e-7度) | 经度增量(zigzag, 1e-7度)
+ *   | 海拔增量(zigzag, 厘米) | 速度(厘米/秒) | 航向(0.1度) | 卫星数|定位类型<<6
+ * 增量都相对上一条记录的量化值，误差不会累积。记录约10-14字节，GPX约150字节
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "gnss_data.h"
+
+#define TRACK_BIN_MAGIC       "STRK"
+#define TRACK_BIN_VERSION     1
+#define TRACK_BIN_HEADER_SIZE 24
+#define TRACK_BIN_MAX_RECORD  32    // 单条记录最大字节数
+
+// 后台导出线程优先级 (低于界面和音频) 和栈大小
+#define TRACK_EXPORT_PRIORITY   60
+#define TRACK_EXPORT_STACK_SIZE 4096
+
+// 导出前后等待SD卡写完的最长时间 (毫秒)
+#define TRACK_EXPORT_FLUSH_MS   5000
+
+// 编解码状态 (上一条记录的量化值)
+struct TrackCodecState {
+  int32_t lat_e7;
+  int32_t lon_e7;
+  int32_t alt_cm;
+  int64_t time_ms;
+};
+
+// 二进制轨迹读取器
+struct TrackReader {
+  FILE* file;
+  TrackCodecState state;
+};
+
+// 导出格式
+enum TrackExportFormat {
+  TRACK_EXPORT_GPX,
+  TRACK_EXPORT_JSON
+};
+
+// 以第一个点为参考写入文件头，返回字节数 (buf至少TRACK_BIN_HEADER_SIZE字节)
+size_t track_encode_header(uint8_t* buf, const GnssPoint& ref, TrackCodecState* state);
+
+// 编码一条记录，返回字节数 (buf至少TRACK_BIN_MAX_RECORD字节)
+size_t track_encode_point(uint8_t* buf, const GnssPoint& point, TrackCodecState* state);
+
+// 顺序读取二进制轨迹，文件末尾不完整的记录会被忽略
+bool track_reader_open(TrackReader* reader, const char* path);
+bool track_reader_next(TrackReader* reader, GnssPoint* point);
+void track_reader_close(TrackReader* reader);
+
+// 把二进制轨迹导出为GPX/JSON，目标文件比源文件新时直接复用
+// 输出按块交给I/O线程写入，读取轨迹仍在调用者线程中进行
+bool track_export(const char* trk_path, const char* out_path, TrackExportFormat format);
+
+// 在后台线程中导出 (不阻塞调用者)，已有导出在进行时返回false
+bool track_export_start(const char* trk_path, const char* out_path, TrackExportFormat format);
+
+// 是否有后台导出在进行
+bool track_export_busy();
+
+// 按源文件名生成导出文件名 (替换扩展名)
+void track_export_path(const char* trk_path, TrackExportFormat format, char* out, size_t out_size);
@@ -0,0 +1,150 @@
+/****************************************************************************
+ * gnss_track_simplify.cpp
+ *
+ * 在线轨迹抽稀实现
+ * 候选点坐标相对锚点保存为单精度米，距离按到线段 (而不是直线) 计算，
+ * 掉头折返的点不会因为落在延长线上被丢掉
+ * ***************************************************************************/
+#include "gnss_track_simplify.h"
+#include "gnss_distance.h"
+#include <string.h>
+#include <math.h>
+
+#define DEG_TO_RAD (M_PI / 180.0)
+
+// 每度纬度对应的米数
+static const float M_PER_DEG = (float)(GNSS_EARTH_RADIUS_M * DEG_TO_RAD);
+
+/**
+ * 初始化
+ */
+void track_simplify_init(TrackSimplifier* simplifier, float tolerance_m)
+{
+  memset(simplifier, 0, sizeof(*simplifier));
+  simplifier->tolerance = tolerance_m;
+}
+
+/**
+ * 设置锚点
+ */
+static void set_anchor(TrackSimplifier* simplifier, const GnssPoint& point)
+{
+  simplifier->anchor = point;
+  simplifier->has_anchor = true;
+  simplifier->m_per_deg_lon = M_PER_DEG * cosf((float)(point.latitude * DEG_TO_RAD));
+  simplifier->count = 0;
+}
+
+/**
+ * 换算为相对锚点的候选点
+ */
+static SimplifyCandidate make_candidate(const TrackSimplifier* simplifier, const GnssPoint& point)
+{
+  const GnssPoint& anchor = simplifier->anchor;
+  SimplifyCandidate c;
+
+  double dlon = point.longitude - anchor.longitude;
+  if (dlon > 180.0) dlon -= 360.0;
+  else if (dlon < -180.0) dlon += 360.0;
+
+  c.x = (float)dlon * simplifier->m_per_deg_lon;
+  c.y = (float)(point.latitude - anchor.latitude) * M_PER_DEG;
+  c.speed = point.speed;
+
+  // 授时后用UTC毫秒，否则只有秒级的接收时刻
+  if (point.utc_time != 0 && anchor.utc_time != 0) {
+    c.t_ms = (int32_t)((point.utc_time - anchor.utc_time) * 1000 + point.utc_msec - anchor.utc_msec);
+  } else {
+    c.t_ms = (point.timestamp - anchor.timestamp) * 1000;
+  }
+  return c;
+}
+
+/**
+ * 点q到线段(0,0)-end的距离
+ */
+static float segment_distance(const SimplifyCandidate& q, const SimplifyCandidate& end)
+{
+  float len2 = end.x * end.x + end.y * end.y;
+  float t = len2 > 0.0f ? (q.x * end.x + q.y * end.y) / len2 : 0.0f;
+  if (t < 0.0f) t = 0.0f;
+  else if (t > 1.0f) t = 1.0f;
+
+  float dx = q.x - t * end.x;
+  float dy = q.y - t * end.y;
+  return sqrtf(dx * dx + dy * dy);
+}
+
+/**
+ * 锚点到新点的连线能否代表所有候选点
+ */
+static bool window_fits(const TrackSimplifier* simplifier, const SimplifyCandidate& end)
+{
+  float anchor_speed = simplifier->anchor.speed;
+
+  for (uint16_t i = 0; i < simplifier->count; i++) {
+    const SimplifyCandidate& q = simplifier->window[i];
+
+    if (segment_distance(q, end) > simplifier->tolerance) return false;
+
+    // 速度按时间线性插值，没有可用的时间时按顺序
+    float ratio = end.t_ms > 0 ? (float)q.t_ms / end.t_ms
+                               : (float)(i + 1) / (simplifier->count + 1);
+    float expected = anchor_speed + (end.speed - anchor_speed) * ratio;
+    if (fabsf(q.speed - expected) > TRACK_SIMPLIFY_SPEED_TOLERANCE) return false;
+  }
+  return true;
+}
+
+/**
+ * 输入一个点
+ */
+bool track_simplify_push(TrackSimplifier* simplifier, const GnssPoint& point, GnssPoint* out)
+{
+  simplifier->input++;
+
+  if (simplifier->tolerance <= 0.0f) {
+    *out = point;
+    simplifier->output++;
+    return true;
+  }
+
+  // 第一个点直接保留
+  if (!simplifier->has_anchor) {
+    set_anchor(simplifier, point);
+    simplifier->last_pending = false;
+    *out = point;
+    simplifier->output++;
+    return true;
+  }
+
+  SimplifyCandidate c = make_candidate(simplifier, point);
+  bool emit = simplifier->count > 0 &&
+              (simplifier->count == TRACK_SIMPLIFY_WINDOW || !window_fits(simplifier, c));
+
+  if (emit) {
+    // 前一个点成为新的锚点，新点相对新锚点重新换算
+    *out = simplifier->last;
+    simplifier->output++;
+    set_anchor(simplifier, simplifier->last);
+    c = make_candidate(simplifier, point);
+  }
+
+  simplifier->window[simplifier->count++] = c;
+  simplifier->last = point;
+  simplifier->last_pending = true;
+  return emit;
+}
+
+/**
+ * 输出最后一个尚未保留的点
+ */
+bool track_simplify_flush(TrackSimplifier* simplifier, GnssPoint* out)
+{
+  if (!simplifier->last_pending) return false;
+
+  *out = simplifier->last;
+  simplifier->last_pending = false;
+  simplifier->output++;
+  return true;
+}
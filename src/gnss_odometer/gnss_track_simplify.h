@@ -0,0 +1,57 @@
+/****************************************************************************
+ * gnss_track_simplify.h
+ *
+ * 在线轨迹抽稀：从上一个保留点 (锚点) 开始累积候选点，每来一个新点就检查
+ * 所有候选点到"锚点-新点"连线的垂直距离和速度偏差，超出容差时保留前一个点
+ * 作为新锚点。直路匀速时几十个点只保留首尾，转弯和加减速处保持全速率。
+ * 候选窗口定长，每点的开销有上限；里程等统计仍使用全速率的点
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+
+// 位置容差 (米)，0表示不抽稀
+#ifdef CONFIG_SPRESENSEWONG_TRACK_SIMPLIFY_TOLERANCE
+#define TRACK_SIMPLIFY_TOLERANCE_M CONFIG_SPRESENSEWONG_TRACK_SIMPLIFY_TOLERANCE
+#else
+#define TRACK_SIMPLIFY_TOLERANCE_M 5
+#endif
+
+// 速度容差 (m/s)
+#define TRACK_SIMPLIFY_SPEED_TOLERANCE 1.5f
+
+// 候选窗口点数 (10Hz下6.4秒，窗口满时强制保留一个点)
+#define TRACK_SIMPLIFY_WINDOW 64
+
+// 候选点 (相对锚点的局部平面坐标)
+struct SimplifyCandidate {
+  float x;              // 东向 (米)
+  float y;              // 北向 (米)
+  float speed;          // 速度 (m/s)
+  int32_t t_ms;         // 相对锚点的时间 (毫秒)
+};
+
+// 抽稀状态
+struct TrackSimplifier {
+  float tolerance;                                   // 位置容差 (米)
+  bool has_anchor;
+  GnssPoint anchor;                                  // 上一个保留点
+  GnssPoint last;                                    // 最新的候选点
+  bool last_pending;                                 // 最新候选点尚未输出
+  float m_per_deg_lon;                               // 锚点处每度经度的米数
+  SimplifyCandidate window[TRACK_SIMPLIFY_WINDOW];
+  uint16_t count;                                    // 候选点数
+  uint32_t input;                                    // 输入点数
+  uint32_t output;                                   // 保留点数
+};
+
+// 初始化 (tolerance为0时所有点原样输出)
+void track_simplify_init(TrackSimplifier* simplifier, float tolerance_m);
+
+// 输入一个点，需要保留的点写入out并返回true (每次最多输出一个点)
+bool track_simplify_push(TrackSimplifier* simplifier, const GnssPoint& point, GnssPoint* out);
+
+// 结束时输出最后一个尚未保留的点，没有返回false
+bool track_simplify_flush(TrackSimplifier* simplifier, GnssPoint* out);
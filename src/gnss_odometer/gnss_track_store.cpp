@@ -0,0 +1,274 @@
+/****************************************************************************
+ * gnss_track_store.cpp
+ *
+ * 轨迹点分块存储实现
+ * 块池按环形使用：驻留块从g_first开始连续排列，最后一块为当前写入块，
+ * 溢出总是从最旧的块开始，因此点序号 = 已溢出点数 + 驻留块内偏移
+ * ***************************************************************************/
+#include "gnss_track_store.h"
+#include "perf_probe.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+static_assert(TRACK_BLOCK_COUNT >= 2, "TRACK_BLOCK_COUNT至少为2");
+
+// 点块
+struct TrackBlock {
+  GnssPoint points[TRACK_BLOCK_POINTS];
+  uint32_t count;
+};
+
+static TrackBlock g_blocks[TRACK_BLOCK_COUNT];
+static int g_first = 0;            // 最旧驻留块在块池中的位置
+static int g_resident = 0;         // 驻留块数量
+static uint32_t g_total = 0;       // 点总数
+static uint32_t g_spilled = 0;     // 已写入溢出文件的点数
+static FILE* g_spill = nullptr;    // 溢出文件 (写入)
+static pthread_mutex_t g_store_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * 当前写入块
+ */
+static TrackBlock* current_block()
+{
+  if (g_resident == 0) return nullptr;
+  return &g_blocks[(g_first + g_resident - 1) % TRACK_BLOCK_COUNT];
+}
+
+/**
+ * 把最旧的驻留块写入溢出文件并释放 (调用者持有锁)
+ */
+static void spill_oldest_locked()
+{
+  if (g_resident == 0) return;
+
+  PERF_SCOPE(PERF_FILE_IO);
+
+  TrackBlock* block = &g_blocks[g_first];
+  size_t written = 0;
+
+  if (g_spill && block->count > 0) {
+    written = fwrite(block->points, sizeof(GnssPoint), block->count, g_spill);
+    fflush(g_spill);
+  }
+
+  if (written == block->count) {
+    g_spilled += block->count;
+  } else {
+    // 写卡失败时丢弃整块 (包括已写入的部分)，溢出文件中的点数保持为整块，
+    // 迭代器按块换算的序号才不会错位；文件位置退回块的开头，下一块覆盖残留数据
+    printf("[GNSS] 轨迹溢出写入失败，丢弃 %u 个点\n", (unsigned)block->count);
+    if (g_spill) fseek(g_spill, (long)(g_spilled * sizeof(GnssPoint)), SEEK_SET);
+    g_total -= block->count;
+  }
+
+  block->count = 0;
+  g_first = (g_first + 1) % TRACK_BLOCK_COUNT;
+  g_resident--;
+}
+
+/**
+ * 开始新的轨迹存储
+ */
+bool track_store_open()
+{
+  track_store_clear();
+
+  mkdir("/sd/tracks", 0777);
+
+  pthread_mutex_lock(&g_store_mutex);
+  g_spill = fopen(TRACK_SPILL_PATH, "wb");
+  pthread_mutex_unlock(&g_store_mutex);
+
+  if (!g_spill) {
+    printf("[GNSS] 创建轨迹溢出文件失败: %s\n", TRACK_SPILL_PATH);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * 结束存储，把剩余的块全部写入溢出文件
+ */
+void track_store_close()
+{
+  pthread_mutex_lock(&g_store_mutex);
+
+  while (g_resident > 0) {
+    spill_oldest_locked();
+  }
+
+  if (g_spill) {
+    fclose(g_spill);
+    g_spill = nullptr;
+  }
+
+  pthread_mutex_unlock(&g_store_mutex);
+}
+
+/**
+ * 丢弃所有点并删除溢出文件
+ */
+void track_store_clear()
+{
+  pthread_mutex_lock(&g_store_mutex);
+
+  if (g_spill) {
+    fclose(g_spill);
+    g_spill = nullptr;
+  }
+  unlink(TRACK_SPILL_PATH);
+
+  g_first = 0;
+  g_resident = 0;
+  g_total = 0;
+  g_spilled = 0;
+
+  pthread_mutex_unlock(&g_store_mutex);
+}
+
+/**
+ * 追加一个点
+ */
+bool track_store_append(const GnssPoint& point)
+{
+  pthread_mutex_lock(&g_store_mutex);
+
+  TrackBlock* block = current_block();
+  if (!block || block->count >= TRACK_BLOCK_POINTS) {
+    // 块池耗尽，只能同步溢出最旧的块
+    if (g_resident == TRACK_BLOCK_COUNT) {
+      spill_oldest_locked();
+    }
+
+    block = &g_blocks[(g_first + g_resident) % TRACK_BLOCK_COUNT];
+    block->count = 0;
+    g_resident++;
+  }
+
+  block->points[block->count++] = point;
+  g_total++;
+
+  pthread_mutex_unlock(&g_store_mutex);
+  return true;
+}
+
+/**
+ * 把等待溢出的满块写入SD卡
+ */
+void track_store_flush_pending()
+{
+  pthread_mutex_lock(&g_store_mutex);
+
+  // 除当前写入块外，其余驻留块都已写满
+  while (g_resident > 1) {
+    spill_oldest_locked();
+  }
+
+  pthread_mutex_unlock(&g_store_mutex);
+}
+
+/**
+ * 点总数
+ */
+uint32_t track_store_count()
+{
+  pthread_mutex_lock(&g_store_mutex);
+  uint32_t count = g_total;
+  pthread_mutex_unlock(&g_store_mutex);
+  return count;
+}
+
+/**
+ * 已溢出到SD卡的点数
+ */
+uint32_t track_store_spilled_count()
+{
+  pthread_mutex_lock(&g_store_mutex);
+  uint32_t count = g_spilled;
+  pthread_mutex_unlock(&g_store_mutex);
+  return count;
+}
+
+/**
+ * 开始遍历
+ */
+bool track_iter_begin(TrackIterator* it)
+{
+  if (!it) return false;
+
+  it->index = 0;
+  it->chunk_base = 0;
+  it->chunk_count = 0;
+  it->spill = fopen(TRACK_SPILL_PATH, "rb");
+
+  return true;
+}
+
+/**
+ * 从溢出文件读取指定序号的点
+ */
+static bool read_spilled(TrackIterator* it, uint32_t index, GnssPoint* point)
+{
+  if (index < it->chunk_base || index >= it->chunk_base + it->chunk_count) {
+    if (!it->spill) return false;
+
+    if (fseek(it->spill, (long)index * sizeof(GnssPoint), SEEK_SET) != 0) {
+      return false;
+    }
+
+    it->chunk_base = index;
+    it->chunk_count = fread(it->chunk, sizeof(GnssPoint), TRACK_ITER_CHUNK, it->spill);
+    if (it->chunk_count == 0) return false;
+  }
+
+  *point = it->chunk[index - it->chunk_base];
+  return true;
+}
+
+/**
+ * 获取下一个点
+ */
+bool track_iter_next(TrackIterator* it, GnssPoint* point)
+{
+  if (!it || !point) return false;
+
+  pthread_mutex_lock(&g_store_mutex);
+
+  if (it->index >= g_total) {
+    pthread_mutex_unlock(&g_store_mutex);
+    return false;
+  }
+
+  uint32_t index = it->index;
+  bool ok;
+
+  if (index < g_spilled) {
+    pthread_mutex_unlock(&g_store_mutex);
+    ok = read_spilled(it, index, point);
+  } else {
+    uint32_t offset = index - g_spilled;
+    const TrackBlock* block =
+        &g_blocks[(g_first + offset / TRACK_BLOCK_POINTS) % TRACK_BLOCK_COUNT];
+    *point = block->points[offset % TRACK_BLOCK_POINTS];
+    pthread_mutex_unlock(&g_store_mutex);
+    ok = true;
+  }
+
+  if (ok) it->index++;
+  return ok;
+}
+
+/**
+ * 结束遍历
+ */
+void track_iter_end(TrackIterator* it)
+{
+  if (it && it->spill) {
+    fclose(it->spill);
+    it->spill = nullptr;
+  }
+}
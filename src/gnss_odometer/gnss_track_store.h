@@ -0,0 +1,65 @@
+/****************************************************************************
+ * gnss_track_store.h
+ *
+ * 轨迹点分块存储：固定大小的点块来自静态块池，写满的块溢出到SD卡文件后释放，
+ * 无论行程多长内存占用都是常数；迭代器可顺序遍历已溢出和仍在内存中的点
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "gnss_data.h"
+
+// 每块点数
+#ifdef CONFIG_SPRESENSEWONG_TRACK_BLOCK_POINTS
+#define TRACK_BLOCK_POINTS CONFIG_SPRESENSEWONG_TRACK_BLOCK_POINTS
+#else
+#define TRACK_BLOCK_POINTS 128
+#endif
+
+// 块池中的块数 (至少2块：一块写入，其余等待溢出)
+#ifdef CONFIG_SPRESENSEWONG_TRACK_BLOCK_COUNT
+#define TRACK_BLOCK_COUNT CONFIG_SPRESENSEWONG_TRACK_BLOCK_COUNT
+#else
+#define TRACK_BLOCK_COUNT 4
+#endif
+
+// 迭代器读取溢出文件时的缓冲点数
+#define TRACK_ITER_CHUNK 16
+
+// 溢出文件路径
+#define TRACK_SPILL_PATH "/sd/tracks/.track_spill.bin"
+
+// 轨迹迭代器
+struct TrackIterator {
+  uint32_t index;                    // 下一个点的序号
+  FILE* spill;                       // 溢出文件 (只读)
+  GnssPoint chunk[TRACK_ITER_CHUNK]; // 溢出数据读取缓冲
+  uint32_t chunk_base;               // 缓冲中第一个点的序号
+  uint32_t chunk_count;              // 缓冲中的点数
+};
+
+// 开始新的轨迹存储 (清空旧数据并创建溢出文件)
+bool track_store_open();
+
+// 结束存储，把内存中剩余的块全部写入溢出文件
+void track_store_close();
+
+// 丢弃所有点并删除溢出文件
+void track_store_clear();
+
+// 追加一个点 (仅在块池耗尽时才会同步写卡)
+bool track_store_append(const GnssPoint& point);
+
+// 把等待溢出的满块写入SD卡 (在GNSS解析路径之外调用)
+void track_store_flush_pending();
+
+// 点总数 / 已溢出到SD卡的点数
+uint32_t track_store_count();
+uint32_t track_store_spilled_count();
+
+// 顺序遍历所有点
+bool track_iter_begin(TrackIterator* it);
+bool track_iter_next(TrackIterator* it, GnssPoint* point);
+void track_iter_end(TrackIterator* it);
@@ -0,0 +1,432 @@
+/****************************************************************************
+ * gnss_track_writer.cpp
+ *
+ * 流式轨迹写入实现
+ * 暂存缓冲只按整扇区交给SD卡I/O线程追加，剩余不足一个扇区的数据留在缓冲里等待下一次，
+ * 断电时最多丢失一个同步间隔加不足一个扇区的轨迹点
+ * ***************************************************************************/
+#include "gnss_track_writer.h"
+#include "gnss_track_codec.h"
+#include "gnss_track_simplify.h"
+#include "gnss_ring.h"
+#include "perf_probe.h"
+#include "sd_io.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+static_assert(TRACK_WRITE_BUFFER_SIZE % TRACK_SECTOR_SIZE == 0 &&
+              TRACK_WRITE_BUFFER_SIZE >= 2 * TRACK_SECTOR_SIZE,
+              "TRACK_WRITE_BUFFER_SIZE必须为扇区大小的整数倍且至少两个扇区");
+
+// GPX结尾标签
+static const char GPX_FOOTER[] = "</trkseg></trk></gpx>\n";
+
+static bool g_open = false;                          // 是否正在记录
+static char g_path[128];                             // 轨迹文件路径
+static TrackFormat g_format = TRACK_DEFAULT_FORMAT;  // 当前文件格式
+static TrackCodecState g_codec;                      // 二进制编码状态
+static bool g_header_written = false;                // 二进制文件头是否已写入
+static char g_buffer[TRACK_WRITE_BUFFER_SIZE];       // 暂存缓冲
+static size_t g_len = 0;                             // 暂存缓冲中的字节数
+static uint32_t g_sync_interval = TRACK_SYNC_INTERVAL_SEC;
+static time_t g_last_sync = 0;                       // 上次fsync时间
+static uint32_t g_point_count = 0;                   // 已写入点数
+static TrackSimplifier g_simplifier;                 // 写入前抽稀
+static GnssRingReader g_reader;                      // GNSS历元读游标
+static pthread_mutex_t g_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * 完整写出指定数据 (恢复流程在I/O线程启动前直接写卡)
+ */
+static bool write_all(int fd, const char* data, size_t len)
+{
+  PERF_SCOPE(PERF_FILE_IO);
+
+  while (len > 0) {
+    ssize_t ret = write(fd, data, len);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      printf("[GNSS] 写入轨迹文件失败: %d\n", errno);
+      return false;
+    }
+    data += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+/**
+ * 写出缓冲中所有整扇区的数据 (调用者持有锁)
+ */
+static bool flush_sectors_locked()
+{
+  size_t aligned = g_len - (g_len % TRACK_SECTOR_SIZE);
+  if (aligned == 0) return true;
+
+  bool ok = sd_io_append(g_path, g_buffer, aligned, SD_IO_TRACK);
+
+  // 剩余数据移到缓冲开头
+  memmove(g_buffer, g_buffer + aligned, g_len - aligned);
+  g_len -= aligned;
+
+  return ok;
+}
+
+/**
+ * 向暂存缓冲追加数据 (调用者持有锁)
+ */
+static bool buffer_append_locked(const char* data, size_t len)
+{
+  bool ok = true;
+
+  while (len > 0) {
+    if (g_len == TRACK_WRITE_BUFFER_SIZE) {
+      ok = flush_sectors_locked() && ok;
+    }
+
+    size_t n = TRACK_WRITE_BUFFER_SIZE - g_len;
+    if (n > len) n = len;
+
+    memcpy(g_buffer + g_len, data, n);
+    g_len += n;
+    data += n;
+    len -= n;
+  }
+
+  return ok;
+}
+
+/**
+ * 把一个轨迹点格式化为GPX的trkpt元素
+ */
+int track_format_gpx_point(char* buf, size_t buf_size, const GnssPoint& point)
+{
+  char time_buf[32] = "";
+
+  if (point.utc_time > 0) {
+    struct tm tm_utc;
+    time_t t = point.utc_time;
+    gmtime_r(&t, &tm_utc);
+    snprintf(time_buf, sizeof(time_buf), "<time>%04d-%02d-%02dT%02d:%02d:%02d.%03uZ</time>",
+             tm_utc.tm_year + 1900, tm_utc.tm_mon + 1, tm_utc.tm_mday,
+             tm_utc.tm_hour, tm_utc.tm_min, tm_utc.tm_sec, (unsigned)point.utc_msec);
+  }
+
+  int n = snprintf(buf, buf_size,
+                   "<trkpt lat=\"%.9f\" lon=\"%.9f\"><ele>%.2f</ele>%s<speed>%.2f</speed></trkpt>\n",
+                   point.latitude, point.longitude, point.altitude, time_buf, point.speed);
+
+  if (n < 0) return 0;
+  return ((size_t)n < buf_size) ? n : (int)buf_size - 1;
+}
+
+/**
+ * 格式化GPX文件头，返回字节数
+ */
+static int format_gpx_header(char* buf, size_t buf_size, time_t t)
+{
+  int n = snprintf(buf, buf_size,
+                   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<gpx version=\"1.1\" creator=\"Spresense GNSS Odometer\">\n"
+                   "<trk><name>Track %ld</name><trkseg>\n", (long)t);
+  if (n < 0) return 0;
+  return ((size_t)n < buf_size) ? n : (int)buf_size - 1;
+}
+
+/**
+ * 打开轨迹文件并写入文件头
+ */
+bool track_writer_open(const char* filename, TrackFormat format)
+{
+  if (!filename) return false;
+
+  pthread_mutex_lock(&g_writer_mutex);
+
+  if (g_open) {
+    pthread_mutex_unlock(&g_writer_mutex);
+    printf("[GNSS] 已有打开的轨迹文件\n");
+    return false;
+  }
+  if (strlen(filename) >= sizeof(g_path)) {
+    pthread_mutex_unlock(&g_writer_mutex);
+    printf("[GNSS] 轨迹文件路径过长: %s\n", filename);
+    return false;
+  }
+
+  mkdir("/sd/tracks", 0777);
+
+  // 开始记录时直接创建文件，以便立即报告失败；之后的写入都交给I/O线程
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    pthread_mutex_unlock(&g_writer_mutex);
+    printf("[GNSS] 创建轨迹文件失败: %s\n", filename);
+    return false;
+  }
+  close(fd);
+
+  snprintf(g_path, sizeof(g_path), "%s", filename);
+  g_open = true;
+
+  // 记录正在写入的文件，供断电后恢复
+  char marker[sizeof(g_path) + 1];
+  int marker_len = snprintf(marker, sizeof(marker), "%s\n", filename);
+  sd_io_write_file(TRACK_RECORDING_MARKER, marker, marker_len, SD_IO_TRACK);
+
+  g_len = 0;
+  g_point_count = 0;
+  track_simplify_init(&g_simplifier, TRACK_SIMPLIFY_TOLERANCE_M);
+  g_format = format;
+  g_header_written = false;
+  g_last_sync = time(NULL);
+  gnss_ring_reader_init(&g_reader, true);
+
+  // 二进制文件头以第一个点为参考，等第一个点到达时再写
+  if (g_format == TRACK_FORMAT_GPX) {
+    // 文件头随第一个扇区写出，在此之前断电时由恢复流程补上
+    char header[192];
+    int n = format_gpx_header(header, sizeof(header), g_last_sync);
+    buffer_append_locked(header, n);
+  }
+
+  pthread_mutex_unlock(&g_writer_mutex);
+
+  printf("[GNSS] 开始写入轨迹: %s\n", filename);
+  return true;
+}
+
+/**
+ * 编码一个轨迹点放入暂存缓冲 (调用者持有锁)
+ */
+static bool write_point_locked(const GnssPoint& point)
+{
+  bool ok = true;
+  if (g_format == TRACK_FORMAT_BINARY) {
+    uint8_t record[TRACK_BIN_HEADER_SIZE + TRACK_BIN_MAX_RECORD];
+    size_t n = 0;
+    if (!g_header_written) {
+      n = track_encode_header(record, point, &g_codec);
+      g_header_written = true;
+    }
+    n += track_encode_point(record + n, point, &g_codec);
+    ok = buffer_append_locked((const char*)record, n);
+  } else {
+    char line[192];
+    int n = track_format_gpx_point(line, sizeof(line), point);
+    ok = buffer_append_locked(line, n);
+  }
+  g_point_count++;
+  return ok;
+}
+
+/**
+ * 追加一个轨迹点 (调用者持有锁，文件已打开)
+ * 先经过抽稀，直路上的大部分点不写入文件
+ */
+static bool append_locked(const GnssPoint& point)
+{
+  bool ok = true;
+  GnssPoint kept;
+  if (track_simplify_push(&g_simplifier, point, &kept)) {
+    ok = write_point_locked(kept);
+  }
+
+  // 定期把整扇区写出并同步，限制断电损失 (音频缓冲不足时I/O线程会稍后再写)
+  if (g_sync_interval > 0) {
+    time_t now = time(NULL);
+    if (now - g_last_sync >= (time_t)g_sync_interval) {
+      ok = flush_sectors_locked() && ok;
+      sd_io_sync(g_path, SD_IO_TRACK);
+      g_last_sync = now;
+    }
+  }
+
+  return ok;
+}
+
+/**
+ * 追加一个轨迹点
+ */
+bool track_writer_append(const GnssPoint& point)
+{
+  pthread_mutex_lock(&g_writer_mutex);
+  bool ok = g_open && append_locked(point);
+  pthread_mutex_unlock(&g_writer_mutex);
+  return ok;
+}
+
+/**
+ * 从GNSS历元缓冲取出新的轨迹点并写入 (调用者持有锁，文件已打开)
+ * 读游标和抽稀状态只在锁内使用，GNSS线程的定期写入和主线程的关闭不会同时取点
+ */
+static void drain_locked()
+{
+  GnssEpoch epoch;
+  uint32_t dropped = g_reader.dropped;
+
+  while (gnss_ring_read(&g_reader, &epoch)) {
+    append_locked(epoch.point);
+  }
+
+  if (g_reader.dropped != dropped) {
+    printf("[GNSS] 轨迹写入跟不上，丢失 %u 个点\n", (unsigned)(g_reader.dropped - dropped));
+  }
+}
+
+/**
+ * 从GNSS历元缓冲取出新的轨迹点并写入
+ */
+void track_writer_service()
+{
+  pthread_mutex_lock(&g_writer_mutex);
+  if (g_open) drain_locked();
+  pthread_mutex_unlock(&g_writer_mutex);
+}
+
+/**
+ * 写入结尾标签并关闭文件
+ */
+bool track_writer_close()
+{
+  pthread_mutex_lock(&g_writer_mutex);
+
+  if (!g_open) {
+    pthread_mutex_unlock(&g_writer_mutex);
+    return false;
+  }
+
+  // 取出缓冲中剩余的点，最后一个点总是保留
+  drain_locked();
+  bool ok = true;
+  GnssPoint last;
+  if (track_simplify_flush(&g_simplifier, &last)) {
+    ok = write_point_locked(last);
+  }
+
+  if (g_format == TRACK_FORMAT_GPX) {
+    ok = buffer_append_locked(GPX_FOOTER, sizeof(GPX_FOOTER) - 1) && ok;
+  }
+  ok = sd_io_append(g_path, g_buffer, g_len, SD_IO_TRACK) && ok;
+  g_len = 0;
+
+  // 同一类别的请求按顺序执行，标记文件在轨迹落盘关闭后才删除
+  sd_io_close(g_path, SD_IO_TRACK);
+  sd_io_unlink(TRACK_RECORDING_MARKER, SD_IO_TRACK);
+  g_open = false;
+
+  printf("[GNSS] 轨迹文件已关闭, %u 个点 (抽稀前 %u 个)\n",
+         (unsigned)g_point_count, (unsigned)g_simplifier.input);
+
+  pthread_mutex_unlock(&g_writer_mutex);
+  return ok;
+}
+
+/**
+ * 是否有打开的轨迹文件
+ */
+bool track_writer_is_open()
+{
+  pthread_mutex_lock(&g_writer_mutex);
+  bool open = g_open;
+  pthread_mutex_unlock(&g_writer_mutex);
+  return open;
+}
+
+/**
+ * 设置fsync间隔
+ */
+void track_writer_set_sync_interval(uint32_t seconds)
+{
+  g_sync_interval = seconds;
+  printf("[GNSS] 轨迹同步间隔: %u秒\n", seconds);
+}
+
+/**
+ * 补全上次意外中断的轨迹文件
+ * GPX截掉最后一个不完整的行，再补上结尾标签；第一个扇区还没写出时文件为空，
+ * 补写文件头，得到一条没有轨迹点的合法GPX；
+ * 二进制轨迹没有结尾标签，读取时会忽略末尾不完整的记录
+ */
+bool track_writer_recover()
+{
+  FILE* marker = fopen(TRACK_RECORDING_MARKER, "r");
+  if (!marker) return false;
+
+  char path[128] = {0};
+  bool has_path = fgets(path, sizeof(path), marker) != NULL;
+  fclose(marker);
+
+  char* nl = strchr(path, '\n');
+  if (nl) *nl = '\0';
+
+  if (!has_path || path[0] == '\0') {
+    unlink(TRACK_RECORDING_MARKER);
+    return false;
+  }
+
+  const char* ext = strrchr(path, '.');
+  if (ext && strcmp(ext, ".trk") == 0) {
+    printf("[GNSS] 上次轨迹记录未正常结束: %s\n", path);
+    unlink(TRACK_RECORDING_MARKER);
+    return true;
+  }
+
+  int fd = open(path, O_RDWR);
+  if (fd < 0) {
+    printf("[GNSS] 待恢复的轨迹文件不存在: %s\n", path);
+    unlink(TRACK_RECORDING_MARKER);
+    return false;
+  }
+
+  // 读取文件末尾一个扇区
+  char tail[TRACK_SECTOR_SIZE + 1];
+  off_t size = lseek(fd, 0, SEEK_END);
+  off_t start = size > TRACK_SECTOR_SIZE ? size - TRACK_SECTOR_SIZE : 0;
+  lseek(fd, start, SEEK_SET);
+
+  ssize_t n = read(fd, tail, TRACK_SECTOR_SIZE);
+  if (n < 0) n = 0;
+  tail[n] = '\0';
+
+  // 文件头总是第一个写出，开头不是文件头说明一个完整的扇区都没有写出
+  char head[5] = {0};
+  lseek(fd, 0, SEEK_SET);
+  bool has_header = read(fd, head, sizeof(head)) == (ssize_t)sizeof(head) &&
+                    memcmp(head, "<?xml", sizeof(head)) == 0;
+
+  bool ok = true;
+  if (!has_header) {
+    // 文件名按开始时间命名，文件头的时间取文件的修改时间即可
+    struct stat st;
+    time_t t = fstat(fd, &st) == 0 ? st.st_mtime : 0;
+    ftruncate(fd, 0);
+    lseek(fd, 0, SEEK_SET);
+
+    char header[192];
+    int len = format_gpx_header(header, sizeof(header), t);
+    ok = write_all(fd, header, len) && write_all(fd, GPX_FOOTER, sizeof(GPX_FOOTER) - 1);
+    fsync(fd);
+    printf("[GNSS] 已恢复中断的轨迹文件 (没有轨迹点): %s\n", path);
+  } else if (strstr(tail, "</gpx>") == NULL) {
+    // 截掉写了一半的行
+    char* last_nl = strrchr(tail, '\n');
+    off_t keep = last_nl ? start + (last_nl - tail) + 1 : start;
+    if (keep < size) {
+      ftruncate(fd, keep);
+    }
+
+    lseek(fd, keep, SEEK_SET);
+    ok = write_all(fd, GPX_FOOTER, sizeof(GPX_FOOTER) - 1);
+    fsync(fd);
+    printf("[GNSS] 已恢复中断的轨迹文件: %s\n", path);
+  }
+
+  close(fd);
+  unlink(TRACK_RECORDING_MARKER);
+  return ok;
+}
@@ -0,0 +1,69 @@
+/****************************************************************************
+ * gnss_track_writer.h
+ *
+ * 流式轨迹写入：开始记录时打开文件，轨迹点编码(二进制.trk或GPX)后先放入暂存缓冲，
+ * 攒满整扇区再写卡，并按设定间隔fsync；停止时只需写入结尾标签。
+ * 意外断电留下的未结束文件在下次启动时由恢复流程补全
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "gnss_data.h"
+
+// 暂存缓冲大小 (字节，按扇区整数倍写卡)
+#ifdef CONFIG_SPRESENSEWONG_TRACK_WRITE_BUFFER
+#define TRACK_WRITE_BUFFER_SIZE CONFIG_SPRESENSEWONG_TRACK_WRITE_BUFFER
+#else
+#define TRACK_WRITE_BUFFER_SIZE 4096
+#endif
+
+// 默认fsync间隔 (秒)
+#ifdef CONFIG_SPRESENSEWONG_TRACK_SYNC_INTERVAL
+#define TRACK_SYNC_INTERVAL_SEC CONFIG_SPRESENSEWONG_TRACK_SYNC_INTERVAL
+#else
+#define TRACK_SYNC_INTERVAL_SEC 10
+#endif
+
+// 记录时写入的轨迹格式
+enum TrackFormat {
+  TRACK_FORMAT_GPX,     // GPX文本，每点约150字节
+  TRACK_FORMAT_BINARY   // 紧凑二进制(见gnss_track_codec.h)，需要时再导出GPX/JSON
+};
+
+#ifdef CONFIG_SPRESENSEWONG_TRACK_BINARY
+#define TRACK_DEFAULT_FORMAT TRACK_FORMAT_BINARY
+#else
+#define TRACK_DEFAULT_FORMAT TRACK_FORMAT_GPX
+#endif
+
+// SD卡扇区大小
+#define TRACK_SECTOR_SIZE 512
+
+// 记录中标记文件，保存正在写入的轨迹文件路径
+#define TRACK_RECORDING_MARKER "/sd/tracks/.recording"
+
+// 打开轨迹文件并写入文件头
+bool track_writer_open(const char* filename, TrackFormat format = TRACK_DEFAULT_FORMAT);
+
+// 追加一个轨迹点
+bool track_writer_append(const GnssPoint& point);
+
+// 从GNSS历元缓冲取出新的轨迹点并写入 (GNSS线程在解析路径之外调用)
+void track_writer_service();
+
+// 取出缓冲中剩余的轨迹点，写入结尾标签并关闭文件 (可在任意线程调用)
+bool track_writer_close();
+
+// 是否有打开的轨迹文件
+bool track_writer_is_open();
+
+// 设置fsync间隔 (秒，0表示只在关闭时同步)
+void track_writer_set_sync_interval(uint32_t seconds);
+
+// 补全上次意外中断的轨迹文件 (启动时调用)
+bool track_writer_recover();
+
+// 把一个轨迹点格式化为GPX的trkpt元素，返回写入的字节数
+int track_format_gpx_point(char* buf, size_t buf_size, const GnssPoint& point);
@@ -0,0 +1,261 @@
+/****************************************************************************
+ * gnss_worker.cpp
+ *
+ * 行程分析线程实现
+ * 历元放在定长环形队列中，读取线程从不阻塞；操作请求一次只有一个，
+ * 提交者等待分析线程执行完毕，优先于排队的历元处理
+ * ***************************************************************************/
+#include "gnss_worker.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+// 线程状态 (由g_worker_mutex保护)
+enum WorkerState {
+  WORKER_STOPPED = 0,
+  WORKER_RUNNING,
+  WORKER_STOPPING          // 已请求停止，正在处理剩余消息或等待join
+};
+
+// 条件变量静态初始化且从不销毁，停止后仍在等待的调用者不会用到已销毁的对象
+static pthread_mutex_t g_worker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_call_mutex = PTHREAD_MUTEX_INITIALIZER;  // 同一时间只有一个操作请求
+static pthread_cond_t g_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cond = PTHREAD_COND_INITIALIZER;     // 操作完成或线程已停止
+static pthread_t g_worker_tid;
+static WorkerState g_state = WORKER_STOPPED;
+static GnssEpochFunc g_handler = nullptr;
+
+// 历元队列
+static GnssRawEpoch g_queue[GNSS_WORKER_QUEUE];
+static uint32_t g_head = 0;
+static uint32_t g_count = 0;
+
+// 操作请求
+static GnssWorkerFunc g_call_func = nullptr;
+static void* g_call_ctx = nullptr;
+static uint32_t g_done_seq = 0;
+
+static GnssWorkerStats g_stats;
+
+/**
+ * 分析线程：先执行操作请求，再按顺序处理历元，停止时处理完剩余的消息再退出
+ */
+static void* worker_thread(void* arg)
+{
+  (void)arg;
+
+  pthread_mutex_lock(&g_worker_mutex);
+  for (;;) {
+    while (g_state == WORKER_RUNNING && g_count == 0 && !g_call_func) {
+      pthread_cond_wait(&g_work_cond, &g_worker_mutex);
+    }
+
+    if (g_call_func) {
+      GnssWorkerFunc func = g_call_func;
+      void* ctx = g_call_ctx;
+      g_call_func = nullptr;
+      pthread_mutex_unlock(&g_worker_mutex);
+
+      func(ctx);
+
+      pthread_mutex_lock(&g_worker_mutex);
+      g_done_seq++;
+      g_stats.calls++;
+      pthread_cond_broadcast(&g_done_cond);
+      continue;
+    }
+
+    if (g_count > 0) {
+      GnssRawEpoch epoch = g_queue[g_head];
+      g_head = (g_head + 1) % GNSS_WORKER_QUEUE;
+      g_count--;
+      pthread_mutex_unlock(&g_worker_mutex);
+
+      g_handler(epoch);
+
+      pthread_mutex_lock(&g_worker_mutex);
+      g_stats.epochs++;
+      continue;
+    }
+
+    if (g_state != WORKER_RUNNING) break;
+  }
+  pthread_mutex_unlock(&g_worker_mutex);
+
+  return nullptr;
+}
+
+/**
+ * 等待正在停止的线程被join (调用时持有g_worker_mutex)
+ */
+static void wait_stopped_locked()
+{
+  while (g_state == WORKER_STOPPING) {
+    pthread_cond_wait(&g_done_cond, &g_worker_mutex);
+  }
+}
+
+/**
+ * 启动分析线程
+ */
+bool gnss_worker_start(GnssEpochFunc handler)
+{
+  if (!handler) return false;
+
+  pthread_mutex_lock(&g_worker_mutex);
+  wait_stopped_locked();
+  if (g_state == WORKER_RUNNING) {
+    pthread_mutex_unlock(&g_worker_mutex);
+    return true;
+  }
+
+  g_handler = handler;
+  g_head = 0;
+  g_count = 0;
+  g_call_func = nullptr;
+  memset(&g_stats, 0, sizeof(g_stats));
+
+  pthread_attr_t attr;
+  struct sched_param param;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, GNSS_WORKER_STACK_SIZE);
+  param.sched_priority = GNSS_WORKER_PRIORITY;
+  pthread_attr_setschedparam(&attr, &param);
+
+#ifdef CONFIG_SMP
+  // 固定在单独的核上，分析耗时不占用界面所在的核
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(GNSS_WORKER_CPU, &cpuset);
+  pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+#endif
+
+  // 持有锁创建线程，新线程在状态和g_worker_tid设置好之后才开始运行
+  g_state = WORKER_RUNNING;
+  int ret = pthread_create(&g_worker_tid, &attr, worker_thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    g_state = WORKER_STOPPED;
+    pthread_mutex_unlock(&g_worker_mutex);
+    printf("[GNSS] 创建分析线程失败: %d\n", ret);
+    return false;
+  }
+  pthread_mutex_unlock(&g_worker_mutex);
+
+  printf("[GNSS] 分析线程已启动 (CPU %d)\n", GNSS_WORKER_CPU);
+  return true;
+}
+
+/**
+ * 停止分析线程
+ */
+void gnss_worker_stop()
+{
+  pthread_mutex_lock(&g_worker_mutex);
+  if (g_state != WORKER_RUNNING) {
+    // 别的线程正在停止时等它完成，返回后线程一定已经退出
+    wait_stopped_locked();
+    pthread_mutex_unlock(&g_worker_mutex);
+    return;
+  }
+
+  g_state = WORKER_STOPPING;
+  pthread_t tid = g_worker_tid;
+  pthread_cond_signal(&g_work_cond);
+  pthread_mutex_unlock(&g_worker_mutex);
+
+  pthread_join(tid, nullptr);
+
+  pthread_mutex_lock(&g_worker_mutex);
+  g_state = WORKER_STOPPED;
+  pthread_cond_broadcast(&g_done_cond);
+  pthread_mutex_unlock(&g_worker_mutex);
+}
+
+/**
+ * 分析线程是否在运行 (正在停止时也返回true，线程可能仍在处理剩余的历元)
+ */
+bool gnss_worker_running()
+{
+  pthread_mutex_lock(&g_worker_mutex);
+  bool running = g_state != WORKER_STOPPED;
+  pthread_mutex_unlock(&g_worker_mutex);
+  return running;
+}
+
+/**
+ * 提交一个历元
+ */
+bool gnss_worker_post(const GnssRawEpoch& epoch)
+{
+  pthread_mutex_lock(&g_worker_mutex);
+  if (g_state != WORKER_RUNNING) {
+    pthread_mutex_unlock(&g_worker_mutex);
+    return false;
+  }
+
+  if (g_count == GNSS_WORKER_QUEUE) {
+    // 分析跟不上时丢弃新历元，读取线程不等待
+    g_stats.dropped++;
+    pthread_mutex_unlock(&g_worker_mutex);
+    return false;
+  }
+
+  g_queue[(g_head + g_count) % GNSS_WORKER_QUEUE] = epoch;
+  g_count++;
+  if (g_count > g_stats.max_queue) g_stats.max_queue = g_count;
+  pthread_cond_signal(&g_work_cond);
+  pthread_mutex_unlock(&g_worker_mutex);
+  return true;
+}
+
+/**
+ * 在分析线程中执行func并等待完成
+ */
+bool gnss_worker_run(GnssWorkerFunc func, void* ctx)
+{
+  // 分析线程自己 (包括停止前处理剩余请求时) 直接执行
+  pthread_mutex_lock(&g_worker_mutex);
+  bool self = g_state != WORKER_STOPPED && pthread_equal(pthread_self(), g_worker_tid);
+  pthread_mutex_unlock(&g_worker_mutex);
+  if (self) return false;
+
+  pthread_mutex_lock(&g_call_mutex);
+  pthread_mutex_lock(&g_worker_mutex);
+
+  // 正在停止时等到线程退出，之后调用者直接执行也不会和分析线程同时修改行程数据
+  wait_stopped_locked();
+  if (g_state != WORKER_RUNNING) {
+    pthread_mutex_unlock(&g_worker_mutex);
+    pthread_mutex_unlock(&g_call_mutex);
+    return false;
+  }
+
+  g_call_func = func;
+  g_call_ctx = ctx;
+  uint32_t target = g_done_seq + 1;
+  pthread_cond_signal(&g_work_cond);
+
+  // 分析线程停止前会处理完请求，这里一定能等到
+  while ((int32_t)(g_done_seq - target) < 0) {
+    pthread_cond_wait(&g_done_cond, &g_worker_mutex);
+  }
+
+  pthread_mutex_unlock(&g_worker_mutex);
+  pthread_mutex_unlock(&g_call_mutex);
+  return true;
+}
+
+/**
+ * 统计
+ */
+void gnss_worker_get_stats(GnssWorkerStats* stats)
+{
+  if (!stats) return;
+  pthread_mutex_lock(&g_worker_mutex);
+  *stats = g_stats;
+  pthread_mutex_unlock(&g_worker_mutex);
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+ * gnss_worker.h
+ *
+ * 行程分析线程：读取/dev/gps的线程只负责取出历元并放入消息队列，
+ * 里程、分段、停留判断、加速测量等分析都在这个线程中完成，结果以TripData快照发布。
+ * 内核支持SMP时该线程固定在最后一个核上运行，与界面和音频控制互不影响。
+ * 修改行程状态的操作也交给分析线程执行，行程数据只有一个写者
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gnss_data.h"
+
+// 消息队列长度 (10Hz下约0.8秒)
+#define GNSS_WORKER_QUEUE 8
+
+// 分析线程优先级 (低于界面和音频)
+#define GNSS_WORKER_PRIORITY 90
+
+// 分析线程栈大小
+#define GNSS_WORKER_STACK_SIZE 4096
+
+// 分析线程运行的核 (仅CONFIG_SMP时有效)
+#ifdef CONFIG_SPRESENSEWONG_GNSS_WORKER_CPU
+#define GNSS_WORKER_CPU CONFIG_SPRESENSEWONG_GNSS_WORKER_CPU
+#elif defined(CONFIG_SMP_NCPUS)
+#define GNSS_WORKER_CPU (CONFIG_SMP_NCPUS - 1)
+#else
+#define GNSS_WORKER_CPU 0
+#endif
+
+// 一个原始历元 (接收机数据换算成GnssPoint，尚未做任何分析)
+struct GnssRawEpoch {
+  uint64_t data_timestamp;   // 接收机的历元时间戳
+  uint8_t fixmode;           // 接收机的定位模式 (0为无效)
+  float hdop;                // 水平精度因子
+  GnssPoint point;
+};
+
+// 历元处理函数 (在分析线程中调用)
+typedef void (*GnssEpochFunc)(const GnssRawEpoch& epoch);
+
+// 在分析线程中执行的操作
+typedef void (*GnssWorkerFunc)(void* ctx);
+
+// 统计
+struct GnssWorkerStats {
+  uint32_t epochs;           // 处理的历元数
+  uint32_t dropped;          // 队列满时丢弃的历元数
+  uint32_t calls;            // 执行的操作数
+  uint32_t max_queue;        // 队列最大深度
+};
+
+// 启动分析线程
+bool gnss_worker_start(GnssEpochFunc handler);
+
+// 处理完队列中的消息后停止分析线程
+void gnss_worker_stop();
+
+// 分析线程是否在运行 (正在停止时也返回true)
+bool gnss_worker_running();
+
+// 提交一个历元 (不阻塞，队列满时丢弃并计数)
+bool gnss_worker_post(const GnssRawEpoch& epoch);
+
+// 在分析线程中执行func并等待完成
+// 分析线程未运行或调用者就是分析线程时返回false，由调用者直接执行；
+// 分析线程正在停止时先等它退出再返回false
+bool gnss_worker_run(GnssWorkerFunc func, void* ctx);
+
+// 统计
+void gnss_worker_get_stats(GnssWorkerStats* stats);
@@ -39,11 +39,4 @@ enum EQPreset {
   EQ_CUSTOM
 };
 
-static inline double deg2rad(double deg){return deg*M_PI/180.0;}
-static inline double haversine(double lat1,double lon1,double lat2,double lon2){
-  double dlat=deg2rad(lat2-lat1);
-  double dlon=deg2rad(lat2-lon1);
-  lat1=deg2rad(lat1);lat2=deg2rad(lat2);
-  double a=sin(dlat/2)*sin(dlat/2)+cos(lat1)*cos(lat2)*sin(dlon/2)*sin(dlon/2);
-  return 6371000*2*atan2(sqrt(a),sqrt(1-a));
-}
+// 距离计算统一使用 gnss_odometer/gnss_distance.h
@@ -0,0 +1,92 @@
+/****************************************************************************
+ * perf_probe.h
+ *
+ * 轻量性能探针：用DWT周期计数器给各子系统计时，
+ * 每个探针在固定内存中保存计数、最小/平均/最大值和对数直方图(用于估算p99)。
+ * 用法：在要计时的作用域开头写 PERF_SCOPE(PERF_LCD_FLUSH);
+ * 不便用作用域时记下 start = perf_now()，结束处 PERF_RECORD(id, start);
+ * 关闭CONFIG_SPRESENSEWONG_PERF后所有探针展开为空
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// CPU主频 (MHz)，用于把周期换算成微秒
+#define PERF_CPU_MHZ 156
+
+// 每个二进制数量级细分的直方图桶数 (2^PERF_SUB_BITS)
+#define PERF_SUB_BITS 2
+// 直方图覆盖的数量级数 (2^26周期约430ms)
+#define PERF_OCTAVES 26
+#define PERF_BUCKETS (PERF_OCTAVES << PERF_SUB_BITS)
+
+// 性能导出文件
+#define PERF_CSV_PATH "/sd/perf.csv"
+
+// 探针编号
+enum PerfProbeId {
+  PERF_GNSS_READ,      // 读取/dev/gps
+  PERF_TRIP_UPDATE,    // 行程数据更新
+  PERF_SCREEN_RENDER,  // 界面绘制 (含刷屏)
+  PERF_LCD_FLUSH,      // 缓冲区发送到LCD
+  PERF_LRC_LOOKUP,     // 歌词行查找
+  PERF_FILE_IO,        // SD卡读写
+  PERF_GLYPH_DECODE,   // 中文字形解码 (字形缓存未命中)
+  PERF_PROBE_COUNT
+};
+
+// 探针统计结果 (微秒)
+struct PerfStats {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t avg_us;
+  uint32_t max_us;
+  uint32_t p99_us;
+};
+
+#if defined(__arm__)
+// DWT周期计数器
+#define PERF_DWT_CYCCNT (*(volatile uint32_t*)0xE0001004)
+static inline uint32_t perf_now() { return PERF_DWT_CYCCNT; }
+#else
+uint32_t perf_now();
+#endif
+
+// 使能周期计数器并清空统计
+void perf_init();
+
+// 记录一次耗时 (周期数)
+void perf_record(PerfProbeId id, uint32_t cycles);
+
+// 读取统计结果
+void perf_get_stats(PerfProbeId id, PerfStats* stats);
+
+// 探针名称
+const char* perf_probe_name(PerfProbeId id);
+
+// 清空所有统计
+void perf_reset();
+
+// 导出为CSV
+bool perf_dump_csv(const char* path = PERF_CSV_PATH);
+
+// 作用域计时器
+class PerfScope {
+public:
+  explicit PerfScope(PerfProbeId id) : m_id(id), m_start(perf_now()) {}
+  ~PerfScope() { perf_record(m_id, perf_now() - m_start); }
+private:
+  PerfProbeId m_id;
+  uint32_t m_start;
+};
+
+#ifdef CONFIG_SPRESENSEWONG_PERF
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE(id) PerfScope PERF_CONCAT(perf_scope_, __LINE__)(id)
+#define PERF_RECORD(id, start) perf_record(id, perf_now() - (start))
+#else
+#define PERF_SCOPE(id) do {} while (0)
+#define PERF_RECORD(id, start) ((void)(start))
+#endif
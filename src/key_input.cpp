@@ -0,0 +1,262 @@
+/****************************************************************************
+ * key_input.cpp
+ * 
+ * 按键输入实现
+ * LPADC按Kconfig设定的频率由SCU定序器采样并写入FIFO，
+ * 这里每个采样周期取出FIFO中的数据，只用最新一个采样点判定按键
+ * ***************************************************************************/
+#include "key_input.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <arch/chip/scu.h>
+#include <arch/chip/adc.h>
+
+static int g_adc_fd = -1;
+static pthread_t g_input_tid;
+static volatile bool g_input_running = false;
+
+// 事件队列
+static KeyEvent g_queue[KEY_QUEUE_SIZE];
+static int g_queue_head = 0;
+static int g_queue_count = 0;
+static pthread_mutex_t g_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_queue_cond;
+
+/**
+ * 当前单调时间 (毫秒)
+ */
+static uint32_t now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/**
+ * 事件入队，队列满时丢弃最旧的事件
+ */
+static void queue_push(KeyCode key, KeyEventType type, uint32_t time_ms)
+{
+  pthread_mutex_lock(&g_queue_mutex);
+
+  if (g_queue_count == KEY_QUEUE_SIZE) {
+    g_queue_head = (g_queue_head + 1) % KEY_QUEUE_SIZE;
+    g_queue_count--;
+  }
+
+  KeyEvent* ev = &g_queue[(g_queue_head + g_queue_count) % KEY_QUEUE_SIZE];
+  ev->key = key;
+  ev->type = type;
+  ev->time_ms = time_ms;
+  g_queue_count++;
+
+  pthread_cond_signal(&g_queue_cond);
+  pthread_mutex_unlock(&g_queue_mutex);
+}
+
+/**
+ * 读取一次摇杆电压，换算为10位刻度 (0-1023)
+ */
+static bool read_adc(int* value)
+{
+  int16_t samples[16];
+  ssize_t n = read(g_adc_fd, samples, sizeof(samples));
+  if (n < (ssize_t)sizeof(int16_t)) return false;
+
+  // ADC输出为有符号16位，取最新一个采样点
+  int raw = samples[n / sizeof(int16_t) - 1];
+  *value = (raw + 32768) >> 6;
+  return true;
+}
+
+/**
+ * 采样线程：消抖并生成事件
+ */
+static void* input_thread(void* arg)
+{
+  KeyCode stable = KEY_NONE;     // 消抖后的按键
+  KeyCode candidate = KEY_NONE;  // 正在确认的按键
+  int same_count = 0;
+  uint32_t press_time = 0;
+  uint32_t next_repeat = 0;
+  bool long_sent = false;
+
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+
+  while (g_input_running) {
+    // 固定周期采样，不受处理耗时影响
+    next.tv_nsec += KEY_SAMPLE_MS * 1000000L;
+    if (next.tv_nsec >= 1000000000L) {
+      next.tv_sec++;
+      next.tv_nsec -= 1000000000L;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+
+    int value;
+    if (!read_adc(&value)) continue;
+
+    KeyCode key = (KeyCode)adc_to_key(value);
+    uint32_t now = now_ms();
+
+    // 消抖
+    if (key == candidate) {
+      if (same_count < KEY_DEBOUNCE_SAMPLES) same_count++;
+    } else {
+      candidate = key;
+      same_count = 1;
+    }
+
+    if (same_count >= KEY_DEBOUNCE_SAMPLES && candidate != stable) {
+      if (stable != KEY_NONE) {
+        queue_push(stable, KEY_EVENT_RELEASE, now);
+      }
+
+      stable = candidate;
+
+      if (stable != KEY_NONE) {
+        queue_push(stable, KEY_EVENT_PRESS, now);
+        press_time = now;
+        long_sent = false;
+      }
+      continue;
+    }
+
+    if (stable == KEY_NONE) continue;
+
+    // 长按与连发
+    if (!long_sent && now - press_time >= KEY_LONG_PRESS_MS) {
+      queue_push(stable, KEY_EVENT_LONG_PRESS, now);
+      long_sent = true;
+      next_repeat = now + KEY_REPEAT_MS;
+    } else if (long_sent && (stable == KEY_PREV || stable == KEY_NEXT) &&
+               (int32_t)(now - next_repeat) >= 0) {
+      queue_push(stable, KEY_EVENT_REPEAT, now);
+      next_repeat += KEY_REPEAT_MS;
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * 启动采样线程
+ */
+bool key_input_start()
+{
+  if (g_input_running) return true;
+
+  g_adc_fd = open(KEY_ADC_DEVPATH, O_RDONLY);
+  if (g_adc_fd < 0) {
+    printf("[按键] 打开ADC失败: %s, %d\n", KEY_ADC_DEVPATH, errno);
+    return false;
+  }
+
+  if (ioctl(g_adc_fd, ANIOC_CXD56_START, 0) < 0) {
+    printf("[按键] 启动ADC采样失败: %d\n", errno);
+    close(g_adc_fd);
+    g_adc_fd = -1;
+    return false;
+  }
+
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_queue_cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+
+  g_input_running = true;
+  if (pthread_create(&g_input_tid, nullptr, input_thread, nullptr) != 0) {
+    printf("[按键] 创建采样线程失败\n");
+    g_input_running = false;
+    ioctl(g_adc_fd, ANIOC_CXD56_STOP, 0);
+    close(g_adc_fd);
+    g_adc_fd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * 停止采样线程
+ */
+void key_input_stop()
+{
+  if (!g_input_running) return;
+
+  g_input_running = false;
+  pthread_join(g_input_tid, nullptr);
+
+  ioctl(g_adc_fd, ANIOC_CXD56_STOP, 0);
+  close(g_adc_fd);
+  g_adc_fd = -1;
+
+  // 唤醒仍在等待的线程
+  pthread_mutex_lock(&g_queue_mutex);
+  pthread_cond_broadcast(&g_queue_cond);
+  pthread_mutex_unlock(&g_queue_mutex);
+}
+
+/**
+ * 等待下一个事件
+ */
+bool key_input_wait(KeyEvent* event, int timeout_ms)
+{
+  if (!event) return false;
+
+  struct timespec deadline;
+  if (timeout_ms >= 0) {
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+
+  pthread_mutex_lock(&g_queue_mutex);
+
+  // 采样线程未运行时不会再有事件，按超时休眠避免调用者空转
+  if (g_queue_count == 0 && !g_input_running) {
+    pthread_mutex_unlock(&g_queue_mutex);
+    if (timeout_ms > 0) usleep(timeout_ms * 1000);
+    return false;
+  }
+
+  while (g_queue_count == 0 && g_input_running) {
+    if (timeout_ms < 0) {
+      pthread_cond_wait(&g_queue_cond, &g_queue_mutex);
+    } else if (pthread_cond_timedwait(&g_queue_cond, &g_queue_mutex, &deadline) == ETIMEDOUT) {
+      break;
+    }
+  }
+
+  bool ok = g_queue_count > 0;
+  if (ok) {
+    *event = g_queue[g_queue_head];
+    g_queue_head = (g_queue_head + 1) % KEY_QUEUE_SIZE;
+    g_queue_count--;
+  }
+
+  pthread_mutex_unlock(&g_queue_mutex);
+  return ok;
+}
+
+/**
+ * 丢弃未处理的事件
+ */
+void key_input_flush()
+{
+  pthread_mutex_lock(&g_queue_mutex);
+  g_queue_head = 0;
+  g_queue_count = 0;
+  pthread_mutex_unlock(&g_queue_mutex);
+}
@@ -0,0 +1,69 @@
+/****************************************************************************
+ * key_input.h
+ * 
+ * 按键输入：专用线程按固定周期采样摇杆ADC (LPADC由SCU定序器采样)，
+ * 消抖后检测按下/松开/长按/连发，事件放入队列供界面处理。
+ * 输入延迟与界面绘制耗时无关，主循环可以阻塞等待事件
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "common.h"
+
+// 摇杆ADC设备
+#define KEY_ADC_DEVPATH "/dev/lpadc0"
+
+// 采样周期 (毫秒)
+#ifdef CONFIG_SPRESENSEWONG_KEY_SAMPLE_MS
+#define KEY_SAMPLE_MS CONFIG_SPRESENSEWONG_KEY_SAMPLE_MS
+#else
+#define KEY_SAMPLE_MS 10
+#endif
+
+// 消抖：连续多少个采样相同才确认状态变化
+#define KEY_DEBOUNCE_SAMPLES 3
+
+// 长按判定时间 (毫秒)
+#ifdef CONFIG_SPRESENSEWONG_KEY_LONG_PRESS_MS
+#define KEY_LONG_PRESS_MS CONFIG_SPRESENSEWONG_KEY_LONG_PRESS_MS
+#else
+#define KEY_LONG_PRESS_MS 600
+#endif
+
+// 长按后连发间隔 (毫秒)
+#ifdef CONFIG_SPRESENSEWONG_KEY_REPEAT_MS
+#define KEY_REPEAT_MS CONFIG_SPRESENSEWONG_KEY_REPEAT_MS
+#else
+#define KEY_REPEAT_MS 150
+#endif
+
+// 事件队列容量
+#define KEY_QUEUE_SIZE 16
+
+// 按键事件类型
+enum KeyEventType {
+  KEY_EVENT_PRESS,       // 按下 (消抖后)
+  KEY_EVENT_RELEASE,     // 松开
+  KEY_EVENT_LONG_PRESS,  // 按住超过长按时间，只触发一次
+  KEY_EVENT_REPEAT       // 长按后的连发 (仅上一曲/下一曲)
+};
+
+// 按键事件
+struct KeyEvent {
+  KeyCode key;
+  KeyEventType type;
+  uint32_t time_ms;      // 事件发生时间 (单调时钟毫秒)
+};
+
+// 启动采样线程
+bool key_input_start();
+
+// 停止采样线程
+void key_input_stop();
+
+// 等待下一个事件，超时返回false (timeout_ms < 0 表示一直等待)
+bool key_input_wait(KeyEvent* event, int timeout_ms);
+
+// 丢弃队列中未处理的事件
+void key_input_flush();
@@ -91,7 +91,7 @@ bool main_menu_is_battery_charging()
  */
 void main_menu_draw(int selected_index)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -141,7 +141,7 @@ void main_menu_draw(int selected_index)
     }
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -0,0 +1,349 @@
+/****************************************************************************
+ * audio_stream.cpp
+ *
+ * 音频预读流实现
+ * 文件描述符只在预读线程空闲时更换；打开和排队只是交给预读线程一个新的描述符，
+ * 解码器取数据时只拷贝内存，不会被SD卡阻塞
+ * ***************************************************************************/
+#include "audio_stream.h"
+#include "perf_probe.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+static_assert(AUDIO_STREAM_BUFFERS >= 2, "AUDIO_STREAM_BUFFERS至少为2");
+
+// 缓冲块
+struct StreamChunk {
+  uint8_t data[AUDIO_STREAM_CHUNK_SIZE];
+  uint32_t len;           // 有效字节
+  uint32_t pos;           // 已被解码器取走的字节
+};
+
+static StreamChunk g_chunks[AUDIO_STREAM_BUFFERS];
+static int g_head = 0;              // 下一个待填充的块
+static int g_tail = 0;              // 下一个待取出的块
+static int g_count = 0;             // 已填充的块数
+static int g_fd = -1;               // 正在读取的文件
+static int g_next_fd = -1;          // 排队的下一个文件
+static uint32_t g_file_pos = 0;     // 下一次读取的文件偏移
+static bool g_reading = false;      // 预读线程是否正在读卡
+static AudioStreamStats g_stats;
+
+static pthread_mutex_t g_stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_data_cond;  // 有新数据或码流结束
+static pthread_cond_t g_work_cond;  // 有空闲块、新文件或读卡结束
+static pthread_t g_stream_tid;
+static bool g_running = false;
+
+static uint32_t monotonic_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+/**
+ * 丢弃缓冲和文件 (调用者持有锁且预读线程空闲)
+ */
+static void reset_locked()
+{
+  if (g_fd >= 0) close(g_fd);
+  if (g_next_fd >= 0) close(g_next_fd);
+  g_fd = -1;
+  g_next_fd = -1;
+  g_head = 0;
+  g_tail = 0;
+  g_count = 0;
+  g_file_pos = 0;
+}
+
+/**
+ * 等待预读线程完成当前的读卡 (调用者持有锁)
+ */
+static void wait_idle_locked()
+{
+  while (g_reading) {
+    pthread_cond_wait(&g_work_cond, &g_stream_mutex);
+  }
+}
+
+/**
+ * 预读线程：有空闲块就读下一块
+ */
+static void* stream_thread(void* arg)
+{
+  pthread_mutex_lock(&g_stream_mutex);
+
+  while (g_running) {
+    if (g_fd < 0 || g_count == AUDIO_STREAM_BUFFERS) {
+      pthread_cond_wait(&g_work_cond, &g_stream_mutex);
+      continue;
+    }
+
+    // 第一块读到块边界为止，之后每次读取都与文件中的块边界对齐
+    StreamChunk* chunk = &g_chunks[g_head];
+    int fd = g_fd;
+    size_t want = AUDIO_STREAM_CHUNK_SIZE - g_file_pos % AUDIO_STREAM_CHUNK_SIZE;
+    g_reading = true;
+    pthread_mutex_unlock(&g_stream_mutex);
+
+    uint32_t start = monotonic_us();
+    ssize_t n;
+    {
+      PERF_SCOPE(PERF_FILE_IO);
+      do {
+        n = read(fd, chunk->data, want);
+      } while (n < 0 && errno == EINTR);
+    }
+    uint32_t elapsed = monotonic_us() - start;
+
+    pthread_mutex_lock(&g_stream_mutex);
+    g_reading = false;
+    if (elapsed > g_stats.max_read_us) g_stats.max_read_us = elapsed;
+
+    if (n > 0) {
+      chunk->len = n;
+      chunk->pos = 0;
+      g_head = (g_head + 1) % AUDIO_STREAM_BUFFERS;
+      g_count++;
+      g_file_pos += n;
+      g_stats.chunks++;
+    } else {
+      if (n < 0) printf("[播放器] 读取音频失败: %d\n", errno);
+
+      // 当前文件读完，接上排队的下一个文件
+      close(g_fd);
+      g_fd = g_next_fd;
+      g_next_fd = -1;
+      g_file_pos = 0;
+    }
+
+    pthread_cond_broadcast(&g_data_cond);
+    pthread_cond_broadcast(&g_work_cond);
+  }
+
+  pthread_mutex_unlock(&g_stream_mutex);
+  return nullptr;
+}
+
+/**
+ * 启动预读线程
+ */
+bool audio_stream_start()
+{
+  if (g_running) return true;
+
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_data_cond, &cond_attr);
+  pthread_cond_init(&g_work_cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+
+  memset(&g_stats, 0, sizeof(g_stats));
+  g_running = true;
+
+  pthread_attr_t attr;
+  struct sched_param param;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, AUDIO_STREAM_STACK_SIZE);
+  param.sched_priority = AUDIO_STREAM_PRIORITY;
+  pthread_attr_setschedparam(&attr, &param);
+
+  int ret = pthread_create(&g_stream_tid, &attr, stream_thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    printf("[播放器] 创建预读线程失败: %d\n", ret);
+    g_running = false;
+    pthread_cond_destroy(&g_data_cond);
+    pthread_cond_destroy(&g_work_cond);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * 停止预读线程
+ */
+void audio_stream_stop()
+{
+  if (!g_running) return;
+
+  pthread_mutex_lock(&g_stream_mutex);
+  g_running = false;
+  pthread_cond_broadcast(&g_work_cond);
+  pthread_cond_broadcast(&g_data_cond);
+  pthread_mutex_unlock(&g_stream_mutex);
+
+  pthread_join(g_stream_tid, nullptr);
+
+  pthread_mutex_lock(&g_stream_mutex);
+  reset_locked();
+  pthread_mutex_unlock(&g_stream_mutex);
+
+  pthread_cond_destroy(&g_data_cond);
+  pthread_cond_destroy(&g_work_cond);
+}
+
+/**
+ * 从offset开始流式读取文件
+ */
+bool audio_stream_open(const char* filepath, uint32_t offset)
+{
+  if (!filepath) return false;
+
+  int fd = open(filepath, O_RDONLY);
+  if (fd < 0) {
+    printf("[播放器] 无法打开音频文件: %s\n", filepath);
+    return false;
+  }
+  if (offset > 0 && lseek(fd, offset, SEEK_SET) < 0) {
+    close(fd);
+    return false;
+  }
+
+  pthread_mutex_lock(&g_stream_mutex);
+  wait_idle_locked();
+  reset_locked();
+  g_fd = fd;
+  g_file_pos = offset;
+  pthread_cond_broadcast(&g_work_cond);
+  pthread_mutex_unlock(&g_stream_mutex);
+
+  return true;
+}
+
+/**
+ * 关闭当前文件
+ */
+void audio_stream_close()
+{
+  pthread_mutex_lock(&g_stream_mutex);
+  wait_idle_locked();
+  reset_locked();
+  pthread_cond_broadcast(&g_data_cond);
+  pthread_mutex_unlock(&g_stream_mutex);
+}
+
+/**
+ * 排队下一个文件
+ * 打开文件 (查找目录项) 在调用者线程完成，边界处预读线程直接接着读
+ */
+bool audio_stream_queue(const char* filepath)
+{
+  if (!filepath) return false;
+
+  int fd = open(filepath, O_RDONLY);
+  if (fd < 0) {
+    printf("[播放器] 无法打开下一首: %s\n", filepath);
+    return false;
+  }
+
+  pthread_mutex_lock(&g_stream_mutex);
+  if (g_next_fd >= 0) close(g_next_fd);
+
+  if (g_fd < 0 && !g_reading) {
+    // 当前文件已经读完，直接开始读下一个
+    g_fd = fd;
+    g_file_pos = 0;
+  } else {
+    g_next_fd = fd;
+  }
+  pthread_cond_broadcast(&g_work_cond);
+  pthread_mutex_unlock(&g_stream_mutex);
+
+  return true;
+}
+
+/**
+ * 解码器输入
+ * 缓冲为空时等待预读线程，超时计一次欠载后继续等待；只有文件全部读完才返回0
+ */
+size_t audio_stream_read(uint8_t* buf, size_t size)
+{
+  if (!buf || size == 0) return 0;
+
+  size_t copied = 0;
+  pthread_mutex_lock(&g_stream_mutex);
+
+  while (copied < size) {
+    if (g_count == 0) {
+      bool ended = g_fd < 0 && g_next_fd < 0 && !g_reading;
+      if (ended || copied > 0 || !g_running) break;
+
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      ts.tv_nsec += AUDIO_STREAM_READ_TIMEOUT_MS * 1000000L;
+      if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+      }
+      if (pthread_cond_timedwait(&g_data_cond, &g_stream_mutex, &ts) == ETIMEDOUT) {
+        g_stats.underruns++;
+      }
+      continue;
+    }
+
+    StreamChunk* chunk = &g_chunks[g_tail];
+    size_t n = chunk->len - chunk->pos;
+    if (n > size - copied) n = size - copied;
+
+    memcpy(buf + copied, chunk->data + chunk->pos, n);
+    chunk->pos += n;
+    copied += n;
+
+    if (chunk->pos == chunk->len) {
+      g_tail = (g_tail + 1) % AUDIO_STREAM_BUFFERS;
+      g_count--;
+      pthread_cond_broadcast(&g_work_cond);
+    }
+  }
+
+  pthread_mutex_unlock(&g_stream_mutex);
+  return copied;
+}
+
+/**
+ * 缓冲字节数 (调用者持有锁)
+ */
+static uint32_t buffered_locked()
+{
+  uint32_t bytes = 0;
+  for (int i = 0, idx = g_tail; i < g_count; i++, idx = (idx + 1) % AUDIO_STREAM_BUFFERS) {
+    bytes += g_chunks[idx].len - g_chunks[idx].pos;
+  }
+  return bytes;
+}
+
+/**
+ * 缓冲是否低于一半
+ */
+bool audio_stream_is_low()
+{
+  pthread_mutex_lock(&g_stream_mutex);
+  bool low = g_fd >= 0 &&
+             buffered_locked() < (uint32_t)AUDIO_STREAM_BUFFERS * AUDIO_STREAM_CHUNK_SIZE / 2;
+  pthread_mutex_unlock(&g_stream_mutex);
+  return low;
+}
+
+/**
+ * 统计
+ */
+void audio_stream_get_stats(AudioStreamStats* stats)
+{
+  if (!stats) return;
+
+  pthread_mutex_lock(&g_stream_mutex);
+  *stats = g_stats;
+  stats->buffered = buffered_locked();
+  pthread_mutex_unlock(&g_stream_mutex);
+}
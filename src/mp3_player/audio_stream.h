@@ -0,0 +1,66 @@
+/****************************************************************************
+ * audio_stream.h
+ *
+ * 音频预读流：专用线程按块对齐的大块顺序读取正在播放的文件，
+ * 放入多个缓冲组成的环，解码器从内存取数据，不直接访问SD卡。
+ * 轨迹/日志写卡的同时也有几百毫秒以上的音频余量，不会断音。
+ * 排队的下一首在当前文件读完后无缝接上，解码器看到的是连续的码流
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 单个缓冲大小 (字节，按此大小对齐读取，建议等于FAT簇大小)
+#ifdef CONFIG_SPRESENSEWONG_AUDIO_STREAM_CHUNK
+#define AUDIO_STREAM_CHUNK_SIZE CONFIG_SPRESENSEWONG_AUDIO_STREAM_CHUNK
+#else
+#define AUDIO_STREAM_CHUNK_SIZE 16384
+#endif
+
+// 缓冲数量 (2为双缓冲，3为三缓冲)
+#ifdef CONFIG_SPRESENSEWONG_AUDIO_STREAM_BUFFERS
+#define AUDIO_STREAM_BUFFERS CONFIG_SPRESENSEWONG_AUDIO_STREAM_BUFFERS
+#else
+#define AUDIO_STREAM_BUFFERS 3
+#endif
+
+// 预读线程优先级 (高于GNSS和日志写入)
+#define AUDIO_STREAM_PRIORITY 120
+
+// 预读线程栈大小
+#define AUDIO_STREAM_STACK_SIZE 2048
+
+// 解码器取数据时最多等待多久 (毫秒)，超时记为一次欠载
+#define AUDIO_STREAM_READ_TIMEOUT_MS 50
+
+// 统计
+struct AudioStreamStats {
+  uint32_t buffered;      // 当前缓冲的字节数
+  uint32_t underruns;     // 解码器取不到数据的次数
+  uint32_t chunks;        // 已读取的块数
+  uint32_t max_read_us;   // 单次读卡最长耗时
+};
+
+// 启动/停止预读线程
+bool audio_stream_start();
+void audio_stream_stop();
+
+// 从offset开始流式读取文件 (丢弃当前缓冲和排队的文件)
+bool audio_stream_open(const char* filepath, uint32_t offset);
+
+// 关闭当前文件
+void audio_stream_close();
+
+// 排队下一个文件：立即打开并在当前文件读完后接着读取
+bool audio_stream_queue(const char* filepath);
+
+// 解码器输入：从缓冲取数据，返回字节数，0表示码流结束
+size_t audio_stream_read(uint8_t* buf, size_t size);
+
+// 缓冲是否低于一半 (其他写卡操作可据此推迟非紧急的写入)
+bool audio_stream_is_low();
+
+// 统计
+void audio_stream_get_stats(AudioStreamStats* stats);
@@ -5,6 +5,10 @@
  * ***************************************************************************/
 #include "display.h"
 #include "common.h"
+#include "perf_probe.h"
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 /* 全局U8g2实例 */
 static u8g2_t g_u8g2;
@@ -18,6 +22,58 @@ static u8g2_t g_u8g2;
 #define LCD_BACKLIGHT_PIN 6  // 背光控制引脚
 #define LCD_BACKLIGHT_PWM 7  // PWM引脚，可能需要配置PWM模块
 
+/* 帧合成：ST7565为128x64，共8个页(行块)，每页16个8x8块 */
+#define LCD_MAX_BUFFER_SIZE 1024
+static uint8_t g_prev_frame[LCD_MAX_BUFFER_SIZE];  // 上一次发送到屏幕的内容
+static bool g_prev_valid = false;                   // 上一帧记录是否可用
+static pthread_mutex_t g_frame_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* 中文字体 (12像素，与6x12英文字体的行高一致) */
+#define LCD_CJK_FONT u8g2_font_wqy12_t_chinese2
+
+/* 字形缓存：组相联，按编码低位分组，每组4路，组内淘汰最久未用的 */
+#define LCD_GLYPH_SETS 32
+#define LCD_GLYPH_WAYS 4
+#define LCD_GLYPH_MAX_W 16
+#define LCD_GLYPH_MAX_H 16
+
+struct LcdGlyph {
+  uint16_t encoding;      // 字符编码，0为空
+  uint8_t w, h;           // 位图大小
+  int8_t x;               // 位图左边相对起点的偏移
+  int8_t top;             // 位图上边相对基线的偏移
+  int8_t dx;              // 步进
+  uint32_t last_used;
+  uint8_t bits[LCD_GLYPH_MAX_W / 8 * LCD_GLYPH_MAX_H];  // XBM格式
+};
+static LcdGlyph g_glyphs[LCD_GLYPH_SETS * LCD_GLYPH_WAYS];
+static uint32_t g_glyph_tick = 0;
+
+/* 标签缓存：整条标签渲染好的位图 */
+#define LCD_LABEL_CACHE_SIZE 16
+#define LCD_LABEL_MAX_W 128
+#define LCD_LABEL_STRIDE (LCD_LABEL_MAX_W / 8)
+
+struct LcdLabel {
+  const char* key;        // 字符串地址
+  uint32_t hash;          // 内容哈希 (地址相同内容变了也能发现)
+  uint8_t w, h;
+  int8_t top;             // 位图上边相对基线的偏移
+  uint32_t last_used;
+  uint8_t bits[LCD_LABEL_STRIDE * LCD_GLYPH_MAX_H];
+};
+static LcdLabel g_labels[LCD_LABEL_CACHE_SIZE];
+static uint32_t g_label_tick = 0;
+
+/* 中文字体行框 (第一次切换字体时记下) */
+static int g_cjk_ascent = 10;
+static int g_cjk_height = 12;
+
+static LcdGlyphStats g_glyph_stats;
+
+/* 本帧是否有正在滚动的跑马灯 */
+static bool g_marquee_pending = false;
+
 /* 背光设置 */
 static uint8_t g_backlight_brightness = 5;  // 当前背光亮度(0-5)
 static uint16_t g_backlight_timeout = 30;  // 背光自动关闭时间(秒)
@@ -43,6 +99,24 @@ void lcd_init()
   
   u8g2_ClearBuffer(&g_u8g2);
   u8g2_SendBuffer(&g_u8g2);
+  
+  /* 屏幕与空白缓冲区一致 */
+  memset(g_prev_frame, 0, sizeof(g_prev_frame));
+  g_prev_valid = true;
+}
+
+/**
+ * 离屏初始化：同样的全缓冲区和帧合成，发送到空的字节回调，不占用SPI和GPIO
+ */
+void lcd_init_offscreen() 
+{
+  u8g2_Setup_st7565_nhd_c12864_f(&g_u8g2, U8G2_R2, u8x8_byte_empty, u8x8_dummy_cb);
+  u8g2_InitDisplay(&g_u8g2);
+  u8g2_SetFont(&g_u8g2, u8g2_font_6x12_tr);
+  u8g2_ClearBuffer(&g_u8g2);
+  
+  memset(g_prev_frame, 0, sizeof(g_prev_frame));
+  g_prev_valid = true;
 }
 
 /**
@@ -50,8 +124,79 @@ void lcd_init()
  */
 void lcd_clear() 
 {
+  lcd_begin_frame();
   u8g2_ClearBuffer(&g_u8g2);
-  u8g2_SendBuffer(&g_u8g2);
+  lcd_end_frame();
+}
+
+/**
+ * 开始绘制一帧，独占绘制缓冲区
+ */
+u8g2_t* lcd_begin_frame() 
+{
+  pthread_mutex_lock(&g_frame_mutex);
+  g_marquee_pending = false;
+  return &g_u8g2;
+}
+
+/**
+ * 结束一帧，把变化的区域发送到LCD
+ * 逐页比较8x8块，每页只发送第一个到最后一个变化块之间的范围
+ */
+void lcd_end_frame() 
+{
+  PERF_SCOPE(PERF_LCD_FLUSH);
+  
+  uint8_t* buf = u8g2_GetBufferPtr(&g_u8g2);
+  int tile_w = u8g2_GetBufferTileWidth(&g_u8g2);
+  int tile_h = u8g2_GetBufferTileHeight(&g_u8g2);
+  int page_bytes = tile_w * 8;
+  
+  if (page_bytes * tile_h > LCD_MAX_BUFFER_SIZE) {
+    /* 缓冲区超出记录范围，只能整屏发送 */
+    u8g2_SendBuffer(&g_u8g2);
+    pthread_mutex_unlock(&g_frame_mutex);
+    return;
+  }
+  
+  if (!g_prev_valid) {
+    u8g2_SendBuffer(&g_u8g2);
+    memcpy(g_prev_frame, buf, page_bytes * tile_h);
+    g_prev_valid = true;
+    pthread_mutex_unlock(&g_frame_mutex);
+    return;
+  }
+  
+  for (int ty = 0; ty < tile_h; ty++) {
+    const uint8_t* cur = buf + ty * page_bytes;
+    uint8_t* prev = g_prev_frame + ty * page_bytes;
+    
+    int first = -1;
+    int last = -1;
+    for (int tx = 0; tx < tile_w; tx++) {
+      if (memcmp(cur + tx * 8, prev + tx * 8, 8) != 0) {
+        if (first < 0) first = tx;
+        last = tx;
+      }
+    }
+    
+    if (first >= 0) {
+      u8g2_UpdateDisplayArea(&g_u8g2, first, ty, last - first + 1, 1);
+      memcpy(prev + first * 8, cur + first * 8, (last - first + 1) * 8);
+    }
+  }
+  
+  pthread_mutex_unlock(&g_frame_mutex);
+}
+
+/**
+ * 丢弃上一帧记录 (屏幕内容可能已被外部改变，如唤醒、旋转)
+ */
+void lcd_invalidate() 
+{
+  pthread_mutex_lock(&g_frame_mutex);
+  g_prev_valid = false;
+  pthread_mutex_unlock(&g_frame_mutex);
 }
 
 /**
@@ -182,11 +327,10 @@ u8g2_t* get_display()
 
 /**
  * 设置中文字体
- * 使用unifont字库的中文字体支持
  */
 void lcd_set_chinese_font()
 {
-  u8g2_SetFont(&g_u8g2, u8g2_font_unifont_t_chinese2);
+  u8g2_SetFont(&g_u8g2, LCD_CJK_FONT);
 }
 
 /**
@@ -198,13 +342,425 @@ void lcd_set_english_font()
   u8g2_SetFont(&g_u8g2, u8g2_font_6x12_tr);
 }
 
+/**
+ * 取下一个UTF-8字符，非法序列返回'?'
+ */
+static uint32_t utf8_next(const char** text)
+{
+  const uint8_t* p = (const uint8_t*)*text;
+  uint32_t c = *p++;
+  
+  if (c >= 0x80 && c < 0xC0) {
+    *text = (const char*)p;
+    return '?';
+  }
+  
+  int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+  if (extra) c &= 0x3F >> extra;
+  while (extra-- > 0) {
+    if ((*p & 0xC0) != 0x80) {
+      *text = (const char*)p;
+      return '?';
+    }
+    c = (c << 6) | (*p++ & 0x3F);
+  }
+  
+  *text = (const char*)p;
+  return c;
+}
+
+/* 临时切换到中文字体 (只在字形缓存未命中时需要) */
+struct CjkFontSwitch {
+  const uint8_t* saved;   // 切换前的字体
+  bool active;
+};
+
+static void cjk_font_acquire(CjkFontSwitch* sw)
+{
+  if (sw->active) return;
+  sw->saved = g_u8g2.font;
+  sw->active = true;
+  u8g2_SetFont(&g_u8g2, LCD_CJK_FONT);
+  
+  /* 记下字体的行框，标签位图按它对齐 */
+  g_cjk_ascent = g_u8g2.font_info.max_char_height + g_u8g2.font_info.y_offset;
+  g_cjk_height = g_u8g2.font_info.max_char_height;
+  if (g_cjk_height > LCD_GLYPH_MAX_H) g_cjk_height = LCD_GLYPH_MAX_H;
+}
+
+static void cjk_font_release(CjkFontSwitch* sw)
+{
+  if (!sw->active) return;
+  if (sw->saved) u8g2_SetFont(&g_u8g2, sw->saved);
+  sw->active = false;
+}
+
+/* 按位读取u8g2字库数据 (低位在前) */
+struct GlyphBits {
+  const uint8_t* p;
+  uint8_t pos;
+};
+
+static uint8_t glyph_get_bits(GlyphBits* r, uint8_t cnt)
+{
+  uint8_t val = *r->p >> r->pos;
+  uint8_t end = r->pos + cnt;
+  if (end >= 8) {
+    r->p++;
+    val |= *r->p << (8 - r->pos);
+    end -= 8;
+  }
+  r->pos = end;
+  return val & ((1U << cnt) - 1);
+}
+
+static int8_t glyph_get_signed_bits(GlyphBits* r, uint8_t cnt)
+{
+  if (cnt == 0) return 0;
+  return (int8_t)glyph_get_bits(r, cnt) - (int8_t)(1 << (cnt - 1));
+}
+
+/**
+ * 在字形位图中画一段长度为len的像素，按字形宽度换行
+ */
+static void glyph_run(LcdGlyph* g, uint8_t width, uint8_t* px, uint8_t* py, uint8_t len, bool on)
+{
+  uint8_t stride = (g->w + 7) / 8;
+  while (len--) {
+    if (on && *px < g->w && *py < g->h) {
+      g->bits[*py * stride + *px / 8] |= 1 << (*px & 7);
+    }
+    if (++*px >= width) {
+      *px = 0;
+      (*py)++;
+    }
+  }
+}
+
+/**
+ * 把u8g2字库中的一个字形解码成XBM位图
+ * 字形数据：宽、高、x/y偏移、步进，之后是 (a个背景点, b个前景点) 的游程，重复位为1时重复同一对
+ */
+static void glyph_decode(const uint8_t* data, LcdGlyph* g)
+{
+  const u8g2_font_info_t* info = &g_u8g2.font_info;
+  GlyphBits r = {data, 0};
+  
+  uint8_t w = glyph_get_bits(&r, info->bits_per_char_width);
+  uint8_t h = glyph_get_bits(&r, info->bits_per_char_height);
+  int8_t x = glyph_get_signed_bits(&r, info->bits_per_char_x);
+  int8_t y = glyph_get_signed_bits(&r, info->bits_per_char_y);
+  int8_t d = glyph_get_signed_bits(&r, info->bits_per_delta_x);
+  
+  g->w = w < LCD_GLYPH_MAX_W ? w : LCD_GLYPH_MAX_W;
+  g->h = h < LCD_GLYPH_MAX_H ? h : LCD_GLYPH_MAX_H;
+  g->x = x;
+  g->top = -(h + y);
+  g->dx = d;
+  memset(g->bits, 0, sizeof(g->bits));
+  if (w == 0) return;
+  
+  uint8_t px = 0, py = 0;
+  while (py < h) {
+    uint8_t a = glyph_get_bits(&r, info->bits_per_0);
+    uint8_t b = glyph_get_bits(&r, info->bits_per_1);
+    do {
+      glyph_run(g, w, &px, &py, a, false);
+      glyph_run(g, w, &px, &py, b, true);
+    } while (glyph_get_bits(&r, 1) != 0);
+  }
+}
+
+/**
+ * 从缓存取字形，未命中时从字库解码并替换该组中最久未用的一项
+ */
+static const LcdGlyph* glyph_get(uint32_t c, CjkFontSwitch* sw)
+{
+  /* u8g2字库只有16位编码 */
+  if (c > 0xFFFF || c == 0) c = '?';
+  uint16_t encoding = (uint16_t)c;
+  
+  LcdGlyph* set = &g_glyphs[(encoding & (LCD_GLYPH_SETS - 1)) * LCD_GLYPH_WAYS];
+  LcdGlyph* victim = set;
+  g_glyph_tick++;
+  
+  for (int i = 0; i < LCD_GLYPH_WAYS; i++) {
+    if (set[i].encoding == encoding) {
+      set[i].last_used = g_glyph_tick;
+      g_glyph_stats.glyph_hits++;
+      return &set[i];
+    }
+    if (set[i].last_used < victim->last_used) victim = &set[i];
+  }
+  
+  PERF_SCOPE(PERF_GLYPH_DECODE);
+  g_glyph_stats.glyph_misses++;
+  cjk_font_acquire(sw);
+  
+  const uint8_t* data = u8g2_font_get_glyph_data(&g_u8g2, encoding);
+  if (data) {
+    glyph_decode(data, victim);
+  } else {
+    /* 字库里没有的字缓存为空字形，不再重复查找 */
+    memset(victim, 0, sizeof(*victim));
+  }
+  victim->encoding = encoding;
+  victim->last_used = g_glyph_tick;
+  return victim;
+}
+
+/**
+ * 绘制一个缓存的字形 (超出屏幕左上边界的字形不画)
+ */
+static void glyph_draw(int x, int y, const LcdGlyph* g)
+{
+  int left = x + g->x;
+  int top = y + g->top;
+  if (g->w == 0 || left < 0 || top < 0) return;
+  u8g2_DrawXBM(&g_u8g2, left, top, g->w, g->h, g->bits);
+}
+
 /**
  * 绘制UTF-8编码的文本
- * 用于显示中文等多字节字符
+ * 用于显示中文等多字节字符，字形从缓存中贴图
+ */
+int lcd_draw_utf8(int x, int y, const char* utf8_text)
+{
+  if (!utf8_text) return 0;
+  
+  /* 只画前景点，背景保持原样 (反色高亮时也能正确显示) */
+  uint8_t transparency = g_u8g2.bitmap_transparency;
+  u8g2_SetBitmapMode(&g_u8g2, 1);
+  
+  CjkFontSwitch sw = {nullptr, false};
+  int start = x;
+  while (*utf8_text) {
+    const LcdGlyph* g = glyph_get(utf8_next(&utf8_text), &sw);
+    glyph_draw(x, y, g);
+    x += g->dx;
+  }
+  cjk_font_release(&sw);
+  
+  u8g2_SetBitmapMode(&g_u8g2, transparency);
+  return x - start;
+}
+
+/**
+ * UTF-8文本宽度
+ */
+int lcd_get_utf8_width(const char* utf8_text)
+{
+  if (!utf8_text) return 0;
+  
+  CjkFontSwitch sw = {nullptr, false};
+  int width = 0;
+  while (*utf8_text) {
+    width += glyph_get(utf8_next(&utf8_text), &sw)->dx;
+  }
+  cjk_font_release(&sw);
+  return width;
+}
+
+/**
+ * 标签内容的哈希
+ */
+static uint32_t label_hash(const char* text)
+{
+  uint32_t h = 2166136261u;
+  while (*text) {
+    h ^= (uint8_t)*text++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/**
+ * 把一行文本渲染成位图 (stride字节一行，最宽max_w像素)，返回文本宽度
+ * top和h为位图相对基线的上边和行高，由中文字体的行框决定
+ */
+static int text_render(const char* text, uint8_t* bits, int stride, int max_w, int8_t* top, uint8_t* h)
+{
+  CjkFontSwitch sw = {nullptr, false};
+  cjk_font_acquire(&sw);
+  
+  memset(bits, 0, stride * LCD_GLYPH_MAX_H);
+  *top = -g_cjk_ascent;
+  *h = g_cjk_height;
+  
+  int x = 0;
+  while (*text && x < max_w) {
+    const LcdGlyph* g = glyph_get(utf8_next(&text), &sw);
+    uint8_t glyph_stride = (g->w + 7) / 8;
+    
+    for (int gy = 0; gy < g->h; gy++) {
+      int ly = g->top - *top + gy;
+      if (ly < 0 || ly >= *h) continue;
+      for (int gx = 0; gx < g->w; gx++) {
+        int lx = x + g->x + gx;
+        if (lx < 0 || lx >= max_w) continue;
+        if (g->bits[gy * glyph_stride + gx / 8] & (1 << (gx & 7))) {
+          bits[ly * stride + lx / 8] |= 1 << (lx & 7);
+        }
+      }
+    }
+    x += g->dx;
+  }
+  
+  cjk_font_release(&sw);
+  return x < max_w ? x : max_w;
+}
+
+/**
+ * 把整条标签渲染成一张位图
+ */
+static void label_render(LcdLabel* label, const char* text)
+{
+  label->w = text_render(text, label->bits, LCD_LABEL_STRIDE, LCD_LABEL_MAX_W, &label->top, &label->h);
+  
+  /* 按实际宽度重排成紧凑的XBM，绘制时一次贴图 */
+  uint8_t stride = (label->w + 7) / 8;
+  for (int row = 1; row < label->h; row++) {
+    memmove(label->bits + row * stride, label->bits + row * LCD_LABEL_STRIDE, stride);
+  }
+}
+
+/**
+ * 绘制固定标签
+ * 按字符串地址和内容哈希查找，命中时整条标签一次贴图
+ */
+void lcd_draw_label(int x, int y, const char* label)
+{
+  if (!label || !*label) return;
+  
+  uint32_t hash = label_hash(label);
+  LcdLabel* entry = nullptr;
+  LcdLabel* victim = &g_labels[0];
+  g_label_tick++;
+  
+  for (int i = 0; i < LCD_LABEL_CACHE_SIZE; i++) {
+    if (g_labels[i].key == label && g_labels[i].hash == hash) {
+      entry = &g_labels[i];
+      break;
+    }
+    if (g_labels[i].last_used < victim->last_used) victim = &g_labels[i];
+  }
+  
+  if (entry) {
+    g_glyph_stats.label_hits++;
+  } else {
+    g_glyph_stats.label_misses++;
+    entry = victim;
+    entry->key = label;
+    entry->hash = hash;
+    label_render(entry, label);
+  }
+  entry->last_used = g_label_tick;
+  
+  int top = y + entry->top;
+  if (entry->w == 0 || x < 0 || top < 0) return;
+  
+  uint8_t transparency = g_u8g2.bitmap_transparency;
+  u8g2_SetBitmapMode(&g_u8g2, 1);
+  
+  u8g2_DrawXBM(&g_u8g2, x, top, entry->w, entry->h, entry->bits);
+  
+  u8g2_SetBitmapMode(&g_u8g2, transparency);
+}
+
+/**
+ * 单调时钟毫秒数
+ */
+static uint32_t marquee_now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/**
+ * 初始化跑马灯
+ */
+void lcd_marquee_init(LcdMarquee* marquee)
+{
+  memset(marquee, 0, sizeof(*marquee));
+}
+
+/**
+ * 绘制跑马灯
+ * 文本变化时渲染一次到条带，之后每帧按时间算出偏移，从条带中取出窗口贴图
+ */
+void lcd_marquee_draw(LcdMarquee* marquee, int x, int y, int width, const char* text)
+{
+  if (!marquee || !text) return;
+  if (width > LCD_LABEL_MAX_W) width = LCD_LABEL_MAX_W;
+  if (width <= 0) return;
+  
+  uint32_t now = marquee_now_ms();
+  uint32_t hash = label_hash(text);
+  if (!marquee->valid || marquee->hash != hash) {
+    marquee->text_w = text_render(text, marquee->bits, LCD_MARQUEE_STRIDE, LCD_MARQUEE_MAX_W,
+                                  &marquee->top, &marquee->h);
+    marquee->hash = hash;
+    marquee->start_ms = now;
+    marquee->valid = true;
+  }
+  
+  int top = y + marquee->top;
+  if (marquee->text_w == 0 || x < 0 || top < 0) return;
+  
+  /* 放得下时不滚动 */
+  int offset = 0;
+  int period = marquee->text_w + LCD_MARQUEE_GAP;
+  if (marquee->text_w > width) {
+    /* 每一轮先在开头停留，再匀速滚过整条文本和间隔 */
+    uint32_t scroll_ms = (uint32_t)period * 1000 / LCD_MARQUEE_SPEED;
+    uint32_t t = (now - marquee->start_ms) % (LCD_MARQUEE_PAUSE_MS + scroll_ms);
+    if (t > LCD_MARQUEE_PAUSE_MS) {
+      offset = (t - LCD_MARQUEE_PAUSE_MS) * LCD_MARQUEE_SPEED / 1000;
+    }
+    g_marquee_pending = true;
+  }
+  
+  /* 从条带中取出窗口，条带末尾之后接间隔再从头开始 */
+  static uint8_t window[LCD_LABEL_STRIDE * LCD_GLYPH_MAX_H];
+  int window_stride = (width + 7) / 8;
+  memset(window, 0, sizeof(window));
+  
+  for (int row = 0; row < marquee->h; row++) {
+    const uint8_t* src = marquee->bits + row * LCD_MARQUEE_STRIDE;
+    uint8_t* dst = window + row * window_stride;
+    int sx = offset;
+    for (int dx = 0; dx < width; dx++) {
+      if (sx < marquee->text_w && (src[sx / 8] & (1 << (sx & 7)))) {
+        dst[dx / 8] |= 1 << (dx & 7);
+      }
+      if (++sx >= period) sx = 0;
+    }
+  }
+  
+  uint8_t transparency = g_u8g2.bitmap_transparency;
+  u8g2_SetBitmapMode(&g_u8g2, 1);
+  u8g2_DrawXBM(&g_u8g2, x, top, width, marquee->h, window);
+  u8g2_SetBitmapMode(&g_u8g2, transparency);
+}
+
+/**
+ * 上一帧是否有正在滚动的跑马灯 (只在渲染线程中调用)
+ */
+bool lcd_marquee_pending()
+{
+  return g_marquee_pending;
+}
+
+/**
+ * 字形缓存统计
  */
-void lcd_draw_utf8(int x, int y, const char* utf8_text)
+void lcd_get_glyph_stats(LcdGlyphStats* stats)
 {
-  u8g2_DrawUTF8(&g_u8g2, x, y, utf8_text);
+  if (!stats) return;
+  pthread_mutex_lock(&g_frame_mutex);
+  *stats = g_glyph_stats;
+  pthread_mutex_unlock(&g_frame_mutex);
 }
 
 /**
@@ -14,6 +14,7 @@ extern "C" {
 
 // LCD初始化和基本操作
 void lcd_init();
+void lcd_init_offscreen(); // 只绘制到缓冲区，不驱动LCD (基准测试用)
 void lcd_clear();
 void lcd_set_contrast(uint8_t contrast);
 void lcd_backlight(bool on);
@@ -23,6 +24,12 @@ uint8_t lcd_get_backlight_brightness(); // 获取当前背光亮度
 uint16_t lcd_get_backlight_timeout(); // 获取当前背光超时时间
 void lcd_update_backlight(); // 更新背光状态，检查超时
 
+// 帧合成：整帧绘制放在 lcd_begin_frame() / lcd_end_frame() 之间，
+// 期间独占绘制缓冲区；结束时只发送与上一帧不同的8像素行块，完全相同的帧不发送
+u8g2_t* lcd_begin_frame();
+void lcd_end_frame();
+void lcd_invalidate(); // 丢弃上一帧记录，下一帧整屏发送
+
 // 绘制工具函数
 void draw_battery_icon(int x, int y, int percent, bool charging);
 void draw_progress_bar(int x, int y, int width, int height, uint32_t pos, uint32_t total);
@@ -36,6 +43,45 @@ void draw_footer(const char* text);
 u8g2_t* get_display();
 
 // 中文字体支持
+// 中文文本使用字形缓存：每个字解码一次后保存为位图，之后直接贴图，不再查找和解码字库。
+// 固定的标签 (菜单项等字符串常量) 整条渲染成一张位图缓存，每帧只贴一次。
+// 以下绘制函数只能在 lcd_begin_frame() / lcd_end_frame() 之间调用，使用当前绘制颜色
 void lcd_set_chinese_font(); // 设置中文字体
 void lcd_set_english_font(); // 恢复英文字体
-void lcd_draw_utf8(int x, int y, const char* utf8_text); // 绘制UTF-8文本
+int lcd_draw_utf8(int x, int y, const char* utf8_text); // 绘制UTF-8文本 (y为基线)，返回宽度
+int lcd_get_utf8_width(const char* utf8_text); // UTF-8文本宽度
+void lcd_draw_label(int x, int y, const char* label); // 绘制固定标签 (内容不变的字符串)
+
+// 跑马灯：文本渲染一次到离屏的1bpp条带，每帧只从条带中取出滚动窗口贴到帧缓冲。
+// 只有跑马灯所在的行块变化，帧合成时只发送这几个块
+#define LCD_MARQUEE_MAX_W 512     // 条带最大宽度 (像素，更长的文本被截断)
+#define LCD_MARQUEE_STRIDE (LCD_MARQUEE_MAX_W / 8)
+#define LCD_MARQUEE_GAP 24        // 文本末尾与下一轮开头的间隔 (像素)
+#define LCD_MARQUEE_SPEED 30      // 滚动速度 (像素/秒)
+#define LCD_MARQUEE_PAUSE_MS 1500 // 每轮开始前的停留时间
+#define LCD_MARQUEE_FRAME_MS 50   // 滚动期间的刷新间隔
+
+struct LcdMarquee {
+  bool valid;
+  uint32_t hash;            // 文本内容哈希，变化时重新渲染
+  uint16_t text_w;          // 文本宽度
+  uint8_t h;
+  int8_t top;               // 条带上边相对基线的偏移
+  uint32_t start_ms;        // 文本开始显示的时间
+  uint8_t bits[LCD_MARQUEE_STRIDE * 16];
+};
+
+void lcd_marquee_init(LcdMarquee* marquee);
+// 在 (x, y) 开始的width像素宽窗口内显示text，放不下时滚动
+void lcd_marquee_draw(LcdMarquee* marquee, int x, int y, int width, const char* text);
+// 刚结束的一帧中是否有正在滚动的跑马灯 (渲染线程据此安排下一帧)
+bool lcd_marquee_pending();
+
+// 字形缓存统计
+struct LcdGlyphStats {
+  uint32_t glyph_hits;
+  uint32_t glyph_misses;
+  uint32_t label_hits;
+  uint32_t label_misses;
+};
+void lcd_get_glyph_stats(LcdGlyphStats* stats);
@@ -4,6 +4,8 @@
  * 文件系统模块实现
  * ***************************************************************************/
 #include "file_system.h"
+#include "music_library.h"
+#include "music_index.h"
 #include <stdio.h>
 #include <string.h>
 #include <dirent.h>
@@ -12,6 +14,7 @@
 #include <sys/stat.h>
 #include <sys/statfs.h>
 #include <algorithm>
+#include <set>
 
 /**
  * 获取SD卡信息
@@ -44,38 +47,64 @@ bool sd_get_info(SDCardInfo* info)
 }
 
 /**
- * 扫描音乐目录
+ * 扫描单个目录
+ * 修改时间和大小都与缓存一致的文件直接复用缓存中的元数据；
+ * 歌词文件从同一次readdir中识别，不再逐个access()
  */
-bool scan_music_directory(const char* dir_path, std::vector<MusicFile>* files) 
+bool scan_directory_entries(const char* dir_path, const MusicFileCache& cache,
+                            std::vector<MusicFile>* files, std::vector<std::string>* subdirs,
+                            uint32_t* parsed) 
 {
   if (!dir_path || !files) return false;
   
-  files->clear();
-  
   DIR* dir = opendir(dir_path);
   if (!dir) {
     printf("[文件系统] 无法打开目录: %s\n", dir_path);
     return false;
   }
   
+  size_t first = files->size();
+  std::set<std::string> lrc_names;  /* 不含扩展名的歌词文件名 */
+  
   struct dirent* entry;
   while ((entry = readdir(dir)) != nullptr) {
     std::string name = entry->d_name;
-    if (name == "." || name == "..") continue;
+    if (name.empty() || name[0] == '.') continue;  /* 跳过 . .. 和隐藏文件(索引等) */
+    
+    if (entry->d_type == DT_DIR) {
+      if (subdirs) subdirs->push_back(combine_path(dir_path, name));
+      continue;
+    }
     
-    /* 检查是否为MP3文件 */
     std::string ext = get_extension(name);
+    if (ext == "lrc" || ext == "LRC") {
+      lrc_names.insert(name.substr(0, name.size() - 4));
+      continue;
+    }
+    
+    /* 检查是否为MP3文件 */
     if (ext == "mp3" || ext == "MP3") {
       MusicFile file;
       file.filename = name;
       file.filepath = combine_path(dir_path, name);
+      file.has_lrc = false;
+      file.mtime = 0;
+      file.size = 0;
       
-      /* 检查是否有对应的LRC文件 */
-      std::string lrc_path = file.filepath.substr(0, file.filepath.size()-4) + ".lrc";
-      file.has_lrc = (access(lrc_path.c_str(), F_OK) == 0);
+      struct stat st;
+      if (stat(file.filepath.c_str(), &st) == 0) {
+        file.mtime = (uint32_t)st.st_mtime;
+        file.size = (uint32_t)st.st_size;
+      }
       
-      /* 解析MP3元数据 */
-      player_get_metadata(file.filepath.c_str(), &file.metadata);
+      /* 缓存命中则复用元数据，否则解析MP3 */
+      auto it = cache.find(file.filepath);
+      if (it != cache.end() && it->second.mtime == file.mtime && it->second.size == file.size) {
+        file.metadata = it->second.metadata;
+      } else {
+        player_get_metadata(file.filepath.c_str(), &file.metadata);
+        if (parsed) (*parsed)++;
+      }
       
       files->push_back(file);
     }
@@ -83,117 +112,51 @@ bool scan_music_directory(const char* dir_path, std::vector<MusicFile>* files)
   
   closedir(dir);
   
-  /* 按文件名排序 */
-  std::sort(files->begin(), files->end(), 
-    [](const MusicFile& a, const MusicFile& b) {
-      return a.filename < b.filename;
-    });
+  /* 歌词标记 */
+  for (size_t i = first; i < files->size(); i++) {
+    MusicFile& file = (*files)[i];
+    file.has_lrc = lrc_names.count(file.filename.substr(0, file.filename.size() - 4)) > 0;
+  }
   
-  printf("[文件系统] 扫描到 %zu 个MP3文件\n", files->size());
   return true;
 }
 
 /**
- * 解析LRC歌词文件
+ * 扫描音乐目录 (只扫描顶层，同步完成)
+ * 先读取索引作为缓存，顶层有新增、变化或删除时更新索引中的这一个目录
  */
-bool parse_lrc_file(const char* lrc_path, std::vector<LrcLine>* lyrics) 
+bool scan_music_directory(const char* dir_path, std::vector<MusicFile>* files) 
 {
-  if (!lrc_path || !lyrics) return false;
-  
-  lyrics->clear();
-  
-  FILE* f = fopen(lrc_path, "r");
-  if (!f) {
-    printf("[文件系统] 无法打开歌词文件: %s\n", lrc_path);
-    return false;
-  }
-  
-  char line[256];
-  while (fgets(line, sizeof(line), f)) {
-    char* p = line;
-    while (*p) {
-      /* 寻找时间标签 [mm:ss.xx] */
-      if (*p == '[') {
-        char* end = strchr(p, ']');
-        if (end) {
-          /* 尝试解析时间 */
-          int min = 0, sec = 0, msec = 0;
-          if (sscanf(p+1, "%d:%d.%d", &min, &sec, &msec) >= 2) {
-            uint32_t time_ms = min * 60000 + sec * 1000 + msec * 10;
-            
-            /* 提取歌词文本 */
-            char* text = end + 1;
-            /* 去除行尾换行符 */
-            char* nl = strchr(text, '\n');
-            if (nl) *nl = 0;
-            
-            LrcLine lrc_line;
-            lrc_line.time_ms = time_ms;
-            lrc_line.text = text;
-            
-            /* 如果歌词文本部分非空，则添加 */
-            if (!lrc_line.text.empty()) {
-              lyrics->push_back(lrc_line);
-            }
-          }
-          p = end + 1;
-        } else {
-          p++;
-        }
-      } else {
-        p++;
-      }
-    }
-  }
-  
-  fclose(f);
+  if (!dir_path || !files) return false;
   
-  /* 按时间排序歌词 */
-  std::sort(lyrics->begin(), lyrics->end(), 
-    [](const LrcLine& a, const LrcLine& b) {
-      return a.time_ms < b.time_ms;
-    });
+  /* 读取上次的索引 */
+  MusicLibrary lib;
+  bool has_index = music_index_load(dir_path, &lib);
+  if (!has_index) music_library_init(&lib);
   
-  printf("[文件系统] 解析到 %zu 行歌词\n", lyrics->size());
-  return !lyrics->empty();
-}
-
-/**
- * 根据当前播放时间查找对应歌词行
- */
-int find_lyric_line(const std::vector<LrcLine>& lyrics, uint32_t current_ms) 
-{
-  if (lyrics.empty()) return -1;
+  MusicFileCache cache;
+  music_library_dir_cache(lib, dir_path, &cache);
   
-  /* 二分查找最接近但不超过当前时间的歌词 */
-  int low = 0;
-  int high = lyrics.size() - 1;
+  files->clear();
   
-  /* 如果当前时间比第一条歌词还早，返回-1 */
-  if (current_ms < lyrics[0].time_ms) {
-    return -1;
+  uint32_t parsed = 0;
+  if (!scan_directory_entries(dir_path, cache, files, nullptr, &parsed)) {
+    return false;
   }
   
-  /* 如果当前时间比最后一条歌词还晚，返回最后一条 */
-  if (current_ms >= lyrics[high].time_ms) {
-    return high;
-  }
+  /* 按文件名排序 */
+  std::sort(files->begin(), files->end(), 
+    [](const MusicFile& a, const MusicFile& b) {
+      return a.filename < b.filename;
+    });
   
-  /* 二分查找 */
-  while (low <= high) {
-    int mid = (low + high) / 2;
-    
-    if (lyrics[mid].time_ms <= current_ms && 
-        (mid == lyrics.size()-1 || lyrics[mid+1].time_ms > current_ms)) {
-      return mid;
-    } else if (lyrics[mid].time_ms > current_ms) {
-      high = mid - 1;
-    } else {
-      low = mid + 1;
-    }
+  /* 有变化时回写索引，子目录的条目保持不变 */
+  if (music_library_replace_dir(&lib, dir_path, *files) || !has_index) {
+    music_index_save(dir_path, lib);
   }
   
-  return -1;
+  printf("[文件系统] 扫描到 %zu 个MP3文件, 新解析 %u 个\n", files->size(), (unsigned)parsed);
+  return true;
 }
 
 /**
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include <map>
 #include "player.h"
 
 // SD卡信息
@@ -27,22 +28,20 @@ struct MusicFile {
     std::string filename;  // 文件名(不含路径)
     AudioMetadata metadata;// 音频元数据
     bool has_lrc;          // 是否有对应歌词
-};
-
-// 歌词管理
-struct LrcLine {
-    uint32_t time_ms;      // 时间点(毫秒)
-    std::string text;      // 歌词文本
+    uint32_t mtime;        // 文件修改时间 (索引键)
+    uint32_t size;         // 文件大小 (索引键)
 };
 
 // 扫描音乐目录
 bool scan_music_directory(const char* dir_path, std::vector<MusicFile>* files);
 
-// 解析LRC歌词文件
-bool parse_lrc_file(const char* lrc_path, std::vector<LrcLine>* lyrics);
+// 扫描结果缓存 (完整路径 -> 上次的扫描结果)
+typedef std::map<std::string, MusicFile> MusicFileCache;
 
-// 根据当前播放时间查找对应歌词行
-int find_lyric_line(const std::vector<LrcLine>& lyrics, uint32_t current_ms);
+// 扫描单个目录，MP3追加到files，子目录追加到subdirs (可为空)，parsed累加新解析的文件数
+bool scan_directory_entries(const char* dir_path, const MusicFileCache& cache,
+                            std::vector<MusicFile>* files, std::vector<std::string>* subdirs,
+                            uint32_t* parsed);
 
 // 路径操作工具
 std::string get_filename_from_path(const std::string& path);
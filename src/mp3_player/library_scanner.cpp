@@ -0,0 +1,345 @@
+/****************************************************************************
+ * library_scanner.cpp
+ * 
+ * 后台音乐库扫描实现
+ * 音乐库按目录排序，扫完一个目录时替换该目录下的全部条目 (未变化的记录原样保留)；
+ * 检查点记录已扫描和待扫描的目录，恢复时已扫描目录的条目直接来自索引
+ * ***************************************************************************/
+#include "library_scanner.h"
+#include "music_index.h"
+#include "sd_io.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <algorithm>
+#include <set>
+
+static MusicLibrary g_library;                 // 音乐库
+static pthread_mutex_t g_library_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_library_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t g_version = 0;
+
+static std::string g_root;
+static pthread_t g_scan_tid;
+static volatile bool g_scanning = false;
+static volatile bool g_stop_request = false;
+
+/**
+ * 用一个目录的新扫描结果替换音乐库中该目录的条目，有变化返回true
+ */
+static bool merge_directory(const std::string& dir, const std::vector<MusicFile>& found)
+{
+  pthread_mutex_lock(&g_library_mutex);
+
+  bool changed = music_library_replace_dir(&g_library, dir.c_str(), found);
+  if (changed) {
+    g_version++;
+    pthread_cond_broadcast(&g_library_cond);
+  }
+
+  pthread_mutex_unlock(&g_library_mutex);
+  return changed;
+}
+
+/**
+ * 删除不在已扫描目录中的条目 (目录已被删除)
+ */
+static void prune_directories(const std::set<std::string>& visited)
+{
+  pthread_mutex_lock(&g_library_mutex);
+
+  // 删除可能触发整理并重新编号目录，先按路径收集
+  std::vector<std::string> gone;
+  for (size_t i = 0; i < g_library.dirs.size(); i++) {
+    const char* dir = music_library_dir(g_library, i);
+    if (visited.count(dir) == 0) gone.push_back(dir);
+  }
+
+  size_t removed = 0;
+  for (const std::string& dir : gone) {
+    removed += music_library_remove_dir(&g_library, music_library_find_dir(g_library, dir.c_str()));
+  }
+
+  if (removed > 0) {
+    g_version++;
+    pthread_cond_broadcast(&g_library_cond);
+  }
+  pthread_mutex_unlock(&g_library_mutex);
+}
+
+/**
+ * 检查点文件路径
+ */
+static std::string checkpoint_path()
+{
+  return combine_path(g_root, LIBRARY_SCAN_CHECKPOINT);
+}
+
+/**
+ * 把当前音乐库写入索引
+ */
+static void save_index()
+{
+  // 持锁只做序列化，写卡交给I/O线程，渲染线程不用等SD卡
+  std::string index;
+  pthread_mutex_lock(&g_library_mutex);
+  music_index_serialize(g_root.c_str(), g_library, &index);
+  pthread_mutex_unlock(&g_library_mutex);
+  sd_io_write_file(music_index_path(g_root.c_str()).c_str(), index.data(), index.size(), SD_IO_CONFIG);
+}
+
+/**
+ * 保存检查点：当前音乐库写入索引，目录进度写入检查点文件
+ * 每行一个目录，"V "为已扫描，"P "为待扫描
+ */
+static void save_checkpoint(const std::set<std::string>& visited,
+                            const std::vector<std::string>& pending)
+{
+  save_index();
+
+  // 检查点交给I/O线程，还没写出的旧检查点直接被新的替换
+  std::string text;
+  for (const std::string& dir : visited) {
+    text += "V " + dir + "\n";
+  }
+  for (const std::string& dir : pending) {
+    text += "P " + dir + "\n";
+  }
+  sd_io_write_file(checkpoint_path().c_str(), text.data(), text.size(), SD_IO_CONFIG);
+}
+
+/**
+ * 读取检查点
+ */
+static bool load_checkpoint(std::set<std::string>* visited, std::vector<std::string>* pending)
+{
+  std::string path = checkpoint_path();
+  FILE* f = fopen(path.c_str(), "r");
+  if (!f) return false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char* nl = strchr(line, '\n');
+    if (nl) *nl = '\0';
+    if (strlen(line) < 3 || line[1] != ' ') continue;
+
+    if (line[0] == 'V') {
+      visited->insert(line + 2);
+    } else if (line[0] == 'P') {
+      pending->push_back(line + 2);
+    }
+  }
+  fclose(f);
+
+  return !pending->empty();
+}
+
+/**
+ * 扫描线程
+ */
+static void* scan_thread(void* arg)
+{
+  std::set<std::string> visited;
+  std::vector<std::string> pending;   // 待扫描目录 (栈，深度优先)
+
+  if (load_checkpoint(&visited, &pending)) {
+    printf("[文件系统] 从断点继续扫描, 已完成 %zu 个目录\n", visited.size());
+  } else {
+    visited.clear();
+    pending.clear();
+    pending.push_back(g_root);
+  }
+
+  uint32_t parsed = 0;
+  int dirs_since_checkpoint = 0;
+  bool changed = false;
+
+  while (!pending.empty() && !g_stop_request) {
+    std::string dir = pending.back();
+    pending.pop_back();
+    if (visited.count(dir)) continue;
+
+    // 以音乐库中该目录的条目 (来自索引) 作为元数据缓存
+    MusicFileCache cache;
+    pthread_mutex_lock(&g_library_mutex);
+    music_library_dir_cache(g_library, dir.c_str(), &cache);
+    pthread_mutex_unlock(&g_library_mutex);
+
+    std::vector<MusicFile> found;
+    std::vector<std::string> subdirs;
+    uint32_t dir_parsed = 0;
+
+    if (scan_directory_entries(dir.c_str(), cache, &found, &subdirs, &dir_parsed)) {
+      // 逆序入栈，使子目录按名称顺序扫描
+      std::sort(subdirs.begin(), subdirs.end());
+      for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it) {
+        pending.push_back(*it);
+      }
+
+      changed = merge_directory(dir, found) || changed;
+      parsed += dir_parsed;
+    }
+    visited.insert(dir);
+
+    // 只在音乐库有变化时才值得保存检查点
+    if (++dirs_since_checkpoint >= LIBRARY_CHECKPOINT_DIRS && changed) {
+      save_checkpoint(visited, pending);
+      dirs_since_checkpoint = 0;
+      changed = false;
+    }
+  }
+
+  if (g_stop_request && !pending.empty()) {
+    save_checkpoint(visited, pending);
+    printf("[文件系统] 扫描中断，剩余 %zu 个目录\n", pending.size());
+  } else {
+    // 扫描完成只需要索引，删除上次中断留下的检查点
+    prune_directories(visited);
+    save_index();
+    sd_io_unlink(checkpoint_path().c_str(), SD_IO_CONFIG);
+    printf("[文件系统] 扫描完成: %zu 个目录, %zu 首歌曲, 新解析 %u 首\n",
+           visited.size(), library_count(), (unsigned)parsed);
+  }
+
+  pthread_mutex_lock(&g_library_mutex);
+  g_scanning = false;
+  pthread_cond_broadcast(&g_library_cond);
+  pthread_mutex_unlock(&g_library_mutex);
+
+  return nullptr;
+}
+
+/**
+ * 启动扫描
+ */
+bool library_scan_start(const char* root)
+{
+  if (!root || g_scanning) return false;
+
+  g_root = root;
+  g_stop_request = false;
+
+  // 先发布索引中的歌曲，扫描完成前即可播放
+  pthread_mutex_lock(&g_library_mutex);
+  if (!music_index_load(root, &g_library)) {
+    music_library_init(&g_library);
+  }
+  g_version++;
+  pthread_mutex_unlock(&g_library_mutex);
+
+  pthread_attr_t attr;
+  struct sched_param param;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, LIBRARY_SCAN_STACK_SIZE);
+  param.sched_priority = LIBRARY_SCAN_PRIORITY;
+  pthread_attr_setschedparam(&attr, &param);
+
+  g_scanning = true;
+  int ret = pthread_create(&g_scan_tid, &attr, scan_thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    printf("[文件系统] 创建扫描线程失败: %d\n", ret);
+    g_scanning = false;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * 停止扫描
+ */
+void library_scan_stop()
+{
+  if (!g_scanning) return;
+
+  g_stop_request = true;
+  pthread_join(g_scan_tid, nullptr);
+}
+
+/**
+ * 是否正在扫描
+ */
+bool library_is_scanning()
+{
+  return g_scanning;
+}
+
+void library_lock()
+{
+  pthread_mutex_lock(&g_library_mutex);
+}
+
+void library_unlock()
+{
+  pthread_mutex_unlock(&g_library_mutex);
+}
+
+const MusicLibrary& library_files()
+{
+  return g_library;
+}
+
+/**
+ * 歌曲数
+ */
+size_t library_count()
+{
+  pthread_mutex_lock(&g_library_mutex);
+  size_t count = music_library_count(g_library);
+  pthread_mutex_unlock(&g_library_mutex);
+  return count;
+}
+
+/**
+ * 展开一首歌曲的信息
+ */
+bool library_get_file(size_t index, MusicFile* file)
+{
+  if (!file) return false;
+
+  pthread_mutex_lock(&g_library_mutex);
+  bool ok = music_library_get(g_library, index, file);
+  pthread_mutex_unlock(&g_library_mutex);
+
+  return ok;
+}
+
+/**
+ * 音乐库版本号
+ */
+uint32_t library_version()
+{
+  pthread_mutex_lock(&g_library_mutex);
+  uint32_t version = g_version;
+  pthread_mutex_unlock(&g_library_mutex);
+  return version;
+}
+
+/**
+ * 等待音乐库中至少有count首歌曲
+ */
+bool library_wait_count(size_t count, int timeout_ms)
+{
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  pthread_mutex_lock(&g_library_mutex);
+  while (music_library_count(g_library) < count && g_scanning) {
+    if (pthread_cond_timedwait(&g_library_cond, &g_library_mutex, &deadline) != 0) break;
+  }
+  bool ok = music_library_count(g_library) >= count;
+  pthread_mutex_unlock(&g_library_mutex);
+
+  return ok;
+}
@@ -0,0 +1,52 @@
+/****************************************************************************
+ * library_scanner.h
+ * 
+ * 后台音乐库扫描：启动时先发布索引中的歌曲 (立即可播放)，
+ * 再由低优先级线程递归遍历子目录 (歌手/专辑)，每扫完一个目录就把结果
+ * 并入音乐库，浏览器随之逐步填充。
+ * 扫描进度定期写入检查点文件，中途断电后下次启动从断点继续
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vector>
+#include "music_library.h"
+
+// 检查点文件名 (位于音乐根目录)
+#define LIBRARY_SCAN_CHECKPOINT ".scan"
+
+// 扫描线程优先级 (低于主循环和渲染)
+#define LIBRARY_SCAN_PRIORITY 60
+
+// 扫描线程栈大小
+#define LIBRARY_SCAN_STACK_SIZE 4096
+
+// 每扫描多少个目录保存一次检查点
+#define LIBRARY_CHECKPOINT_DIRS 8
+
+// 启动扫描 (不阻塞)
+bool library_scan_start(const char* root);
+
+// 请求停止扫描并等待线程退出 (会先保存检查点)
+void library_scan_stop();
+
+// 是否正在扫描
+bool library_is_scanning();
+
+// 访问音乐库：library_files() 返回的引用只在持有锁期间有效
+void library_lock();
+void library_unlock();
+const MusicLibrary& library_files();
+
+// 歌曲数
+size_t library_count();
+
+// 展开一首歌曲的信息
+bool library_get_file(size_t index, MusicFile* file);
+
+// 音乐库内容每次变化时加1，界面可据此判断是否需要重绘
+uint32_t library_version();
+
+// 等待音乐库中至少有count首歌曲，超时或扫描结束返回当前是否满足
+bool library_wait_count(size_t count, int timeout_ms);
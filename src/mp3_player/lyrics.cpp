@@ -0,0 +1,237 @@
+/****************************************************************************
+ * lyrics.cpp
+ *
+ * LRC歌词实现
+ * 解析一遍完成：文本区按文件大小一次预留，每行开头连续的时间标签各产生一条记录，
+ * 文件本身已按时间排列时不再排序
+ * ***************************************************************************/
+#include "lyrics.h"
+#include "perf_probe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+/**
+ * 初始化
+ */
+void lyrics_init(Lyrics* lyrics)
+{
+  lyrics->text.clear();
+  lyrics->lines.clear();
+  lyrics->offset_ms = 0;
+  lyrics->cursor = -1;
+}
+
+/**
+ * 清空
+ */
+void lyrics_clear(Lyrics* lyrics)
+{
+  lyrics_init(lyrics);
+}
+
+/**
+ * 解析时间标签 mm:ss[.xx] (也接受mm:ss:xx和三位毫秒)，不是时间返回false
+ */
+static bool parse_time_tag(const char* p, const char* end, uint32_t* time_ms)
+{
+  if (p >= end || *p < '0' || *p > '9') return false;
+
+  uint32_t min = 0;
+  while (p < end && *p >= '0' && *p <= '9') min = min * 10 + (*p++ - '0');
+  if (p >= end || *p != ':') return false;
+  p++;
+
+  uint32_t sec = 0;
+  int digits = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    sec = sec * 10 + (*p++ - '0');
+    digits++;
+  }
+  if (digits == 0) return false;
+
+  // 小数部分按位数换算成毫秒
+  uint32_t frac = 0;
+  uint32_t scale = 100;
+  if (p < end && (*p == '.' || *p == ':')) {
+    p++;
+    while (p < end && *p >= '0' && *p <= '9') {
+      frac += (*p++ - '0') * scale;
+      scale /= 10;
+    }
+  }
+  if (p != end) return false;
+
+  *time_ms = min * 60000 + sec * 1000 + frac;
+  return true;
+}
+
+/**
+ * 解析一行：开头连续的标签，后面是文本
+ */
+static void parse_line(const char* line, const char* line_end, Lyrics* lyrics)
+{
+  const char* p = line;
+  size_t first = lyrics->lines.size();
+
+  while (p < line_end && *p == '[') {
+    const char* close = (const char*)memchr(p, ']', line_end - p);
+    if (!close) break;
+
+    uint32_t time_ms;
+    if (parse_time_tag(p + 1, close, &time_ms)) {
+      LyricLine rec;
+      rec.time_ms = time_ms;
+      rec.text = 0;
+      rec.len = 0;
+      rec.reserved = 0;
+      lyrics->lines.push_back(rec);
+    } else if (close - p > 8 && strncmp(p + 1, "offset:", 7) == 0) {
+      lyrics->offset_ms = (int32_t)strtol(p + 8, nullptr, 10);
+    }
+    p = close + 1;
+  }
+
+  if (lyrics->lines.size() == first) return;
+
+  // 去掉首尾空白
+  const char* end = line_end;
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+
+  // 没有文本的时间点不显示
+  if (p == end) {
+    lyrics->lines.resize(first);
+    return;
+  }
+
+  size_t len = end - p;
+  if (len > 0xFFFF) len = 0xFFFF;
+
+  uint32_t offset = lyrics->text.size();
+  lyrics->text.insert(lyrics->text.end(), p, p + len);
+  lyrics->text.push_back('\0');
+
+  for (size_t i = first; i < lyrics->lines.size(); i++) {
+    lyrics->lines[i].text = offset;
+    lyrics->lines[i].len = (uint16_t)len;
+  }
+}
+
+/**
+ * 解析内存中的LRC歌词
+ */
+bool lyrics_parse(const char* data, size_t len, Lyrics* lyrics)
+{
+  if (!data || !lyrics) return false;
+
+  lyrics_init(lyrics);
+  lyrics->text.reserve(len + 1);
+
+  // 偏移0留给空串
+  lyrics->text.push_back('\0');
+
+  const char* line = data;
+  const char* data_end = data + len;
+  while (line < data_end) {
+    const char* nl = (const char*)memchr(line, '\n', data_end - line);
+    const char* line_end = nl ? nl : data_end;
+    parse_line(line, line_end, lyrics);
+    if (!nl) break;
+    line = nl + 1;
+  }
+
+  // 应用[offset:]
+  if (lyrics->offset_ms != 0) {
+    for (size_t i = 0; i < lyrics->lines.size(); i++) {
+      int64_t t = (int64_t)lyrics->lines[i].time_ms - lyrics->offset_ms;
+      lyrics->lines[i].time_ms = t > 0 ? (uint32_t)t : 0;
+    }
+  }
+
+  // 多时间标签的行会打乱顺序，只在需要时排序
+  bool sorted = true;
+  for (size_t i = 1; i < lyrics->lines.size() && sorted; i++) {
+    sorted = lyrics->lines[i - 1].time_ms <= lyrics->lines[i].time_ms;
+  }
+  if (!sorted) {
+    std::stable_sort(lyrics->lines.begin(), lyrics->lines.end(),
+      [](const LyricLine& a, const LyricLine& b) {
+        return a.time_ms < b.time_ms;
+      });
+  }
+
+  printf("[歌词] 解析到 %zu 行歌词, 文本 %zu 字节\n", lyrics->lines.size(), lyrics->text.size());
+  return !lyrics->lines.empty();
+}
+
+/**
+ * 行数
+ */
+size_t lyrics_count(const Lyrics& lyrics)
+{
+  return lyrics.lines.size();
+}
+
+/**
+ * 第line行的文本
+ */
+const char* lyrics_text(const Lyrics& lyrics, int line)
+{
+  if (line < 0 || (size_t)line >= lyrics.lines.size()) return "";
+  return &lyrics.text[lyrics.lines[line].text];
+}
+
+/**
+ * 二分查找不晚于current_ms的最后一行
+ */
+static int search_line(const Lyrics& lyrics, uint32_t current_ms)
+{
+  std::vector<LyricLine>::const_iterator it =
+    std::upper_bound(lyrics.lines.begin(), lyrics.lines.end(), current_ms,
+      [](uint32_t t, const LyricLine& line) {
+        return t < line.time_ms;
+      });
+  return (int)(it - lyrics.lines.begin()) - 1;
+}
+
+/**
+ * 把游标移动到当前播放时间
+ * 正常播放时每帧最多前进一两行；时间回退或一次跳过很多行说明发生了定位，改用二分查找
+ */
+int lyrics_update(Lyrics* lyrics, uint32_t current_ms)
+{
+  PERF_SCOPE(PERF_LRC_LOOKUP);
+
+  int count = (int)lyrics->lines.size();
+  if (count == 0) return -1;
+
+  int cur = lyrics->cursor;
+  if (cur >= count || (cur >= 0 && current_ms < lyrics->lines[cur].time_ms)) {
+    lyrics->cursor = search_line(*lyrics, current_ms);
+    return lyrics->cursor;
+  }
+
+  int steps = 0;
+  while (cur + 1 < count && lyrics->lines[cur + 1].time_ms <= current_ms) {
+    if (++steps > LYRICS_SCAN_MAX) {
+      cur = search_line(*lyrics, current_ms);
+      break;
+    }
+    cur++;
+  }
+
+  lyrics->cursor = cur;
+  return cur;
+}
+
+/**
+ * 游标之后下一行的开始时间
+ */
+int64_t lyrics_next_time(const Lyrics& lyrics)
+{
+  size_t next = (size_t)(lyrics.cursor + 1);
+  if (next >= lyrics.lines.size()) return -1;
+  return lyrics.lines[next].time_ms;
+}
@@ -0,0 +1,51 @@
+/****************************************************************************
+ * lyrics.h
+ *
+ * LRC歌词：所有文本放在一块连续的文本区里，每个时间点是一条定长记录
+ * (时间, 文本偏移, 长度)，同一行的多个时间标签共用一份文本。
+ * 播放时只向前移动的游标每帧最多前进几行，回退或大跨度跳转 (定位播放) 时才二分查找
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <vector>
+
+// 游标向前逐行移动的最大行数，超过时改用二分查找
+#define LYRICS_SCAN_MAX 8
+
+// 一个时间点 (定长12字节)
+struct LyricLine {
+  uint32_t time_ms;       // 开始时间 (已应用[offset:])
+  uint32_t text;          // 文本在文本区中的偏移
+  uint16_t len;           // 文本长度 (不含结尾的'\0')
+  uint16_t reserved;
+};
+
+// 一首歌的歌词
+struct Lyrics {
+  std::vector<char> text;         // 文本区，每行以'\0'结尾
+  std::vector<LyricLine> lines;   // 按时间排序
+  int32_t offset_ms;              // [offset:]标签，正数表示歌词提前
+  int cursor;                     // 当前行，-1表示第一行之前
+};
+
+// 初始化/清空
+void lyrics_init(Lyrics* lyrics);
+void lyrics_clear(Lyrics* lyrics);
+
+// 解析内存中的LRC歌词 (不修改data)
+bool lyrics_parse(const char* data, size_t len, Lyrics* lyrics);
+
+// 行数
+size_t lyrics_count(const Lyrics& lyrics);
+
+// 第line行的文本 (越界返回空串)
+const char* lyrics_text(const Lyrics& lyrics, int line);
+
+// 把游标移动到当前播放时间，返回当前行 (-1表示还没到第一行)
+int lyrics_update(Lyrics* lyrics, uint32_t current_ms);
+
+// 游标之后下一行的开始时间，没有下一行返回-1
+int64_t lyrics_next_time(const Lyrics& lyrics);
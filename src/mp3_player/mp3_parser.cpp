@@ -0,0 +1,438 @@
+/****************************************************************************
+ * mp3_parser.cpp
+ *
+ * MP3时长与定位表解析实现
+ * 只支持Layer III (MPEG1/2/2.5)，文件通过带缓冲的顺序读取访问，
+ * 完整扫描时每2KB才读一次卡
+ * ***************************************************************************/
+#include "mp3_parser.h"
+#include "perf_probe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 帧头
+struct Mp3FrameHeader {
+  bool mpeg1;
+  bool mono;
+  uint32_t bitrate;       // bps
+  uint32_t sample_rate;
+  uint32_t samples;       // 每帧采样数
+  uint32_t frame_len;     // 帧长 (字节)
+};
+
+// 带缓冲的读取器
+struct Mp3Reader {
+  FILE* file;
+  uint8_t* buf;
+  uint32_t base;          // 缓冲对应的文件偏移
+  uint32_t len;           // 缓冲中的有效字节
+  uint32_t file_size;
+};
+
+// Layer III码率表 (kbps)
+static const uint16_t BITRATE_V1[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+static const uint16_t BITRATE_V2[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+static const uint32_t SAMPLE_RATE_V1[3] = {44100, 48000, 32000};
+
+/**
+ * 取得从off开始的n个字节，必要时重新填充缓冲
+ */
+static const uint8_t* reader_peek(Mp3Reader* r, uint32_t off, uint32_t n)
+{
+  if (n > MP3_READ_BUFFER || off + n > r->file_size) return nullptr;
+
+  if (off < r->base || off + n > r->base + r->len) {
+    PERF_SCOPE(PERF_FILE_IO);
+
+    if (fseek(r->file, off, SEEK_SET) != 0) return nullptr;
+    r->base = off;
+    r->len = fread(r->buf, 1, MP3_READ_BUFFER, r->file);
+    if (r->len < n) return nullptr;
+  }
+
+  return r->buf + (off - r->base);
+}
+
+static uint32_t get_be32(const uint8_t* p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint16_t get_be16(const uint8_t* p)
+{
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/**
+ * 解析帧头，不是有效的Layer III帧返回false
+ */
+static bool parse_frame_header(const uint8_t* h, Mp3FrameHeader* fh)
+{
+  if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+
+  uint8_t version = (h[1] >> 3) & 0x03;   // 0: MPEG2.5, 1: 保留, 2: MPEG2, 3: MPEG1
+  uint8_t layer = (h[1] >> 1) & 0x03;     // 1: Layer III
+  uint8_t br_index = h[2] >> 4;
+  uint8_t sr_index = (h[2] >> 2) & 0x03;
+
+  if (version == 1 || layer != 1 || br_index == 0 || br_index == 15 || sr_index == 3) {
+    return false;
+  }
+
+  fh->mpeg1 = version == 3;
+  fh->mono = (h[3] >> 6) == 3;
+  fh->bitrate = (fh->mpeg1 ? BITRATE_V1[br_index] : BITRATE_V2[br_index]) * 1000;
+  fh->sample_rate = SAMPLE_RATE_V1[sr_index] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+  fh->samples = fh->mpeg1 ? 1152 : 576;
+  fh->frame_len = fh->samples / 8 * fh->bitrate / fh->sample_rate + ((h[2] >> 1) & 0x01);
+
+  return true;
+}
+
+/**
+ * 跳过ID3v2标签，返回音频数据可能开始的位置
+ */
+static uint32_t skip_id3v2(Mp3Reader* r)
+{
+  const uint8_t* h = reader_peek(r, 0, 10);
+  if (!h || memcmp(h, "ID3", 3) != 0) return 0;
+
+  // 标签长度为4个7位字节 (syncsafe)
+  uint32_t size = ((uint32_t)(h[6] & 0x7F) << 21) | ((uint32_t)(h[7] & 0x7F) << 14) |
+                  ((uint32_t)(h[8] & 0x7F) << 7) | (h[9] & 0x7F);
+  size += 10;
+  if (h[5] & 0x10) size += 10;   // 标签尾
+  return size;
+}
+
+/**
+ * 查找第一个有效帧 (要求紧随其后的也是同格式的帧，避免把标签数据误认为帧头)
+ */
+static bool find_first_frame(Mp3Reader* r, uint32_t start, uint32_t* offset, Mp3FrameHeader* fh)
+{
+  uint32_t limit = start + MP3_SYNC_SEARCH_LIMIT;
+
+  for (uint32_t off = start; off < limit; off++) {
+    const uint8_t* h = reader_peek(r, off, 4);
+    if (!h) return false;
+    if (!parse_frame_header(h, fh)) continue;
+
+    Mp3FrameHeader next;
+    const uint8_t* nh = reader_peek(r, off + fh->frame_len, 4);
+    if (nh && (!parse_frame_header(nh, &next) ||
+               next.sample_rate != fh->sample_rate || next.mpeg1 != fh->mpeg1)) {
+      continue;
+    }
+
+    *offset = off;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * 尝试Xing/Info头
+ */
+static bool parse_xing(Mp3Reader* r, uint32_t off, const Mp3FrameHeader& fh, Mp3Info* info)
+{
+  // Xing头位于边信息之后
+  uint32_t side_info = fh.mpeg1 ? (fh.mono ? 17 : 32) : (fh.mono ? 9 : 17);
+  const uint8_t* x = reader_peek(r, off + 4 + side_info, 8 + 4 + 4 + 100);
+  if (!x || (memcmp(x, "Xing", 4) != 0 && memcmp(x, "Info", 4) != 0)) return false;
+
+  uint32_t flags = get_be32(x + 4);
+  const uint8_t* p = x + 8;
+  uint32_t frames = 0;
+  uint32_t bytes = 0;
+
+  if (flags & 0x01) {
+    frames = get_be32(p);
+    p += 4;
+  }
+  if (!(flags & 0x01) || frames == 0) return false;
+
+  if (flags & 0x02) {
+    bytes = get_be32(p);
+    p += 4;
+  }
+  if (bytes == 0 || off + bytes > r->file_size) bytes = r->file_size - off;
+
+  info->frames = frames;
+  mp3_seek_linear(&info->seek, off, bytes);
+
+  // 100项TOC按百分比给出，抽取为MP3_TOC_SIZE项
+  if (flags & 0x04) {
+    for (int i = 0; i < MP3_TOC_SIZE; i++) {
+      info->seek.toc[i] = p[i * 100 / MP3_TOC_SIZE];
+    }
+  }
+
+  info->source = MP3_INFO_XING;
+  return true;
+}
+
+/**
+ * 尝试VBRI头 (固定位于帧头后32字节)
+ */
+static bool parse_vbri(Mp3Reader* r, uint32_t off, Mp3Info* info)
+{
+  const uint8_t* v = reader_peek(r, off + 4 + 32, 26);
+  if (!v || memcmp(v, "VBRI", 4) != 0) return false;
+
+  uint32_t bytes = get_be32(v + 10);
+  uint32_t frames = get_be32(v + 14);
+  uint16_t entries = get_be16(v + 18);
+  uint16_t scale = get_be16(v + 20);
+  uint16_t entry_size = get_be16(v + 22);
+  uint16_t frames_per_entry = get_be16(v + 24);
+
+  if (frames == 0) return false;
+  if (bytes == 0 || off + bytes > r->file_size) bytes = r->file_size - off;
+
+  info->frames = frames;
+  mp3_seek_linear(&info->seek, off, bytes);
+  info->source = MP3_INFO_VBRI;
+
+  // VBRI表给出每段的字节数，累加后按等时间间隔取样
+  const uint8_t* table = nullptr;
+  if (entries > 0 && entry_size >= 1 && entry_size <= 4 && frames_per_entry > 0) {
+    table = reader_peek(r, off + 4 + 32 + 26, (uint32_t)entries * entry_size);
+  }
+  if (!table) return true;
+
+  uint64_t pos = 0;
+  int t = 0;
+  for (uint32_t k = 0; k < entries && t < MP3_TOC_SIZE; k++) {
+    uint32_t seg = 0;
+    for (int j = 0; j < entry_size; j++) {
+      seg = (seg << 8) | table[k * entry_size + j];
+    }
+    seg *= scale;
+
+    uint64_t seg_start = (uint64_t)k * frames_per_entry;
+    uint64_t seg_end = seg_start + frames_per_entry;
+
+    while (t < MP3_TOC_SIZE) {
+      uint64_t target = (uint64_t)frames * t / MP3_TOC_SIZE;
+      if (target >= seg_end && k + 1 < entries) break;
+
+      uint64_t in_seg = target > seg_start ? target - seg_start : 0;
+      if (in_seg > frames_per_entry) in_seg = frames_per_entry;
+      uint64_t at = pos + seg * in_seg / frames_per_entry;
+      uint64_t scaled = at * 256 / bytes;
+      info->seek.toc[t++] = scaled > 255 ? 255 : (uint8_t)scaled;
+    }
+
+    pos += seg;
+  }
+
+  return true;
+}
+
+/**
+ * 没有VBR头：检查开头若干帧，码率一致按CBR计算，否则逐帧扫描
+ */
+static bool scan_frames(Mp3Reader* r, uint32_t first, uint32_t end, const Mp3FrameHeader& first_fh,
+                        Mp3Info* info)
+{
+  // 按帧数等间隔记录位置，表满后隔一个丢一个并加倍间隔
+  const int MARKS = MP3_TOC_SIZE * 4;
+  uint32_t marks[MARKS];
+  int mark_count = 0;
+  uint32_t mark_step = 1;
+
+  uint32_t off = first;
+  uint32_t frames = 0;
+  bool cbr = true;
+  Mp3FrameHeader fh;
+
+  while (off + 4 <= end) {
+    const uint8_t* h = reader_peek(r, off, 4);
+    if (!h || !parse_frame_header(h, &fh) || fh.sample_rate != first_fh.sample_rate) {
+      // 帧中间夹杂的垃圾数据，尝试重新同步
+      Mp3FrameHeader resync;
+      uint32_t next;
+      if (!find_first_frame(r, off + 1, &next, &resync) || next >= end) break;
+      off = next;
+      continue;
+    }
+
+    if (fh.bitrate != first_fh.bitrate) cbr = false;
+
+    if (frames % mark_step == 0) {
+      if (mark_count == MARKS) {
+        for (int i = 0; i < MARKS / 2; i++) marks[i] = marks[i * 2];
+        mark_count = MARKS / 2;
+        mark_step *= 2;
+      }
+      if (frames % mark_step == 0) marks[mark_count++] = off;
+    }
+
+    frames++;
+    off += fh.frame_len;
+
+    // 开头的帧码率都一样，视为CBR，不再扫描剩余部分
+    if (cbr && frames == MP3_CBR_PROBE_FRAMES) {
+      uint32_t bytes = end - first;
+      info->frames = (uint32_t)((uint64_t)bytes * frames / (off - first));
+      mp3_seek_linear(&info->seek, first, bytes);
+      info->source = MP3_INFO_CBR;
+      return true;
+    }
+  }
+
+  if (frames == 0) return false;
+
+  uint32_t bytes = end - first;
+  info->frames = frames;
+  mp3_seek_linear(&info->seek, first, bytes);
+  info->source = cbr ? MP3_INFO_CBR : MP3_INFO_SCAN;
+
+  // 帧序号 -> 偏移，线性插值
+  for (int t = 0; t < MP3_TOC_SIZE; t++) {
+    uint64_t target = (uint64_t)frames * t / MP3_TOC_SIZE;
+    uint32_t m = target / mark_step;
+    uint32_t at;
+    if (m + 1 < (uint32_t)mark_count) {
+      at = marks[m] + (uint32_t)((uint64_t)(marks[m + 1] - marks[m]) * (target - m * mark_step) / mark_step);
+    } else {
+      at = marks[mark_count - 1];
+    }
+    uint64_t scaled = (uint64_t)(at - first) * 256 / bytes;
+    info->seek.toc[t] = scaled > 255 ? 255 : (uint8_t)scaled;
+  }
+
+  return true;
+}
+
+/**
+ * 解析MP3文件的时长和定位表
+ */
+bool mp3_parse_info(const char* filepath, Mp3Info* info)
+{
+  if (!filepath || !info) return false;
+
+  memset(info, 0, sizeof(*info));
+
+  FILE* f = fopen(filepath, "rb");
+  if (!f) return false;
+
+  // 扫描线程栈较小，缓冲从堆上分配
+  Mp3Reader r = {f, (uint8_t*)malloc(MP3_READ_BUFFER), 0, 0, 0};
+  if (!r.buf) {
+    fclose(f);
+    return false;
+  }
+
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  r.file_size = size > 0 ? (uint32_t)size : 0;
+
+  // 音频数据到ID3v1标签之前为止
+  uint32_t end = r.file_size;
+  const uint8_t* tag = end >= 128 ? reader_peek(&r, end - 128, 3) : nullptr;
+  if (tag && memcmp(tag, "TAG", 3) == 0) end -= 128;
+
+  uint32_t first = 0;
+  Mp3FrameHeader fh;
+  bool ok = find_first_frame(&r, skip_id3v2(&r), &first, &fh) && first < end;
+
+  if (ok) {
+    info->sample_rate = fh.sample_rate;
+    ok = parse_xing(&r, first, fh, info) ||
+         parse_vbri(&r, first, info) ||
+         scan_frames(&r, first, end, fh, info);
+  }
+
+  free(r.buf);
+  fclose(f);
+
+  if (!ok) {
+    printf("[播放器] 无法解析MP3帧: %s\n", filepath);
+    info->source = MP3_INFO_NONE;
+    return false;
+  }
+
+  info->duration_ms = (uint32_t)((uint64_t)info->frames * fh.samples * 1000 / fh.sample_rate);
+  if (info->duration_ms > 0) {
+    info->bitrate = (uint32_t)((uint64_t)info->seek.audio_bytes * 8000 / info->duration_ms);
+  }
+
+  return true;
+}
+
+/**
+ * 填充线性定位表
+ */
+void mp3_seek_linear(Mp3SeekInfo* seek, uint32_t audio_start, uint32_t audio_bytes)
+{
+  seek->audio_start = audio_start;
+  seek->audio_bytes = audio_bytes;
+  for (int i = 0; i < MP3_TOC_SIZE; i++) {
+    seek->toc[i] = (uint8_t)(i * 256 / MP3_TOC_SIZE);
+  }
+}
+
+/**
+ * 按定位表把播放时间换算为文件偏移
+ */
+uint32_t mp3_seek_offset(const Mp3SeekInfo& seek, uint32_t position_ms, uint32_t duration_ms)
+{
+  if (duration_ms == 0 || position_ms == 0) return seek.audio_start;
+  if (position_ms >= duration_ms) return seek.audio_start + seek.audio_bytes;
+
+  // 定位表项之间线性插值
+  uint64_t scaled = (uint64_t)position_ms * MP3_TOC_SIZE * 1024 / duration_ms;
+  uint32_t i = scaled / 1024;
+  uint32_t frac = scaled % 1024;
+  uint32_t a = seek.toc[i];
+  uint32_t b = (i + 1 < MP3_TOC_SIZE) ? seek.toc[i + 1] : 256;
+  if (b < a) b = a;
+
+  uint64_t pos = (uint64_t)a * 1024 + (uint64_t)(b - a) * frac;
+  return seek.audio_start + (uint32_t)(pos * seek.audio_bytes / (256 * 1024));
+}
+
+/**
+ * 查找下一个帧头 (只读取offset附近的一个缓冲)
+ */
+uint32_t mp3_align_frame(const char* filepath, uint32_t offset)
+{
+  if (!filepath) return offset;
+
+  FILE* f = fopen(filepath, "rb");
+  if (!f) return offset;
+
+  Mp3Reader r = {f, (uint8_t*)malloc(MP3_READ_BUFFER), 0, 0, 0};
+  if (!r.buf) {
+    fclose(f);
+    return offset;
+  }
+
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  r.file_size = size > 0 ? (uint32_t)size : 0;
+
+  // 定位表精度约为文件的1/256，帧头一般就在一帧之内
+  uint32_t aligned = offset;
+  Mp3FrameHeader fh;
+  uint32_t limit = offset + MP3_READ_BUFFER - 8;
+  for (uint32_t off = offset; off < limit; off++) {
+    const uint8_t* h = reader_peek(&r, off, 4);
+    if (!h) break;
+    if (!parse_frame_header(h, &fh)) continue;
+
+    Mp3FrameHeader next;
+    const uint8_t* nh = reader_peek(&r, off + fh.frame_len, 4);
+    if (nh && parse_frame_header(nh, &next) && next.sample_rate == fh.sample_rate) {
+      aligned = off;
+      break;
+    }
+  }
+
+  free(r.buf);
+  fclose(f);
+  return aligned;
+}
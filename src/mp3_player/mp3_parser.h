@@ -0,0 +1,61 @@
+/****************************************************************************
+ * mp3_parser.h
+ *
+ * MP3时长与定位表解析：依次尝试Xing/Info头、VBRI头，
+ * 都没有时检查开头若干帧，码率一致按CBR计算，否则完整扫描一遍帧头。
+ * 结果保存在音乐库索引里，每首歌只需解析一次
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 定位表项数 (每项对应 1/MP3_TOC_SIZE 的播放时长)
+#define MP3_TOC_SIZE 20
+
+// 读取缓冲大小
+#define MP3_READ_BUFFER 2048
+
+// 查找第一帧的最大范围 (ID3v2之后)
+#define MP3_SYNC_SEARCH_LIMIT 65536
+
+// 判断CBR时检查的帧数
+#define MP3_CBR_PROBE_FRAMES 64
+
+// 时长来源
+enum Mp3InfoSource {
+  MP3_INFO_NONE,    // 解析失败
+  MP3_INFO_XING,    // Xing/Info头
+  MP3_INFO_VBRI,    // VBRI头 (Fraunhofer)
+  MP3_INFO_CBR,     // 固定码率推算
+  MP3_INFO_SCAN     // 完整扫描帧头
+};
+
+// 定位信息：toc[i]为第 i/MP3_TOC_SIZE 时刻在音频数据中的位置 (以1/256为单位)
+struct Mp3SeekInfo {
+  uint32_t audio_start;          // 音频数据起始偏移 (含Xing/VBRI帧)
+  uint32_t audio_bytes;          // 音频数据字节数
+  uint8_t toc[MP3_TOC_SIZE];
+};
+
+// 解析结果
+struct Mp3Info {
+  uint32_t duration_ms;
+  uint32_t sample_rate;
+  uint32_t bitrate;              // 平均码率 (bps)
+  uint32_t frames;
+  Mp3InfoSource source;
+  Mp3SeekInfo seek;
+};
+
+// 解析MP3文件的时长和定位表
+bool mp3_parse_info(const char* filepath, Mp3Info* info);
+
+// 填充线性定位表 (CBR或没有定位信息时使用)
+void mp3_seek_linear(Mp3SeekInfo* seek, uint32_t audio_start, uint32_t audio_bytes);
+
+// 按定位表把播放时间换算为文件偏移
+uint32_t mp3_seek_offset(const Mp3SeekInfo& seek, uint32_t position_ms, uint32_t duration_ms);
+
+// 从offset开始查找下一个帧头，返回帧对齐的偏移 (找不到时原样返回)
+uint32_t mp3_align_frame(const char* filepath, uint32_t offset);
@@ -0,0 +1,258 @@
+/****************************************************************************
+ * music_index.cpp
+ * 
+ * 音乐库索引实现
+ * 加载时整个文件一次读入内存再解析，避免大量小块读取
+ * ***************************************************************************/
+#include "music_index.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MUSIC_INDEX_HEADER_SIZE 12
+
+/**
+ * 索引文件路径
+ */
+std::string music_index_path(const char* dir_path)
+{
+  return combine_path(dir_path, MUSIC_INDEX_NAME);
+}
+
+/**
+ * 顺序解析工具
+ */
+struct IndexReader {
+  const uint8_t* pos;
+  const uint8_t* end;
+};
+
+static bool read_u32(IndexReader* r, uint32_t* v)
+{
+  if (r->end - r->pos < 4) return false;
+  *v = (uint32_t)r->pos[0] | ((uint32_t)r->pos[1] << 8) |
+       ((uint32_t)r->pos[2] << 16) | ((uint32_t)r->pos[3] << 24);
+  r->pos += 4;
+  return true;
+}
+
+static bool read_string(IndexReader* r, char* buf, size_t buf_size)
+{
+  if (r->end - r->pos < 2) return false;
+  size_t len = (size_t)r->pos[0] | ((size_t)r->pos[1] << 8);
+  r->pos += 2;
+
+  if ((size_t)(r->end - r->pos) < len) return false;
+  size_t n = len < buf_size - 1 ? len : buf_size - 1;
+  memcpy(buf, r->pos, n);
+  buf[n] = '\0';
+  r->pos += len;
+  return true;
+}
+
+static void write_u16(std::string* out, uint16_t v)
+{
+  char b[2] = {(char)v, (char)(v >> 8)};
+  out->append(b, 2);
+}
+
+static void write_u32(std::string* out, uint32_t v)
+{
+  char b[4] = {(char)v, (char)(v >> 8), (char)(v >> 16), (char)(v >> 24)};
+  out->append(b, 4);
+}
+
+static void write_string(std::string* out, const char* s)
+{
+  size_t len = strlen(s);
+  if (len > 0xFFFF) len = 0xFFFF;
+  write_u16(out, (uint16_t)len);
+  out->append(s, len);
+}
+
+/**
+ * 读取索引
+ */
+bool music_index_load(const char* dir_path, MusicLibrary* lib)
+{
+  if (!dir_path || !lib) return false;
+
+  std::string path = music_index_path(dir_path);
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+
+  struct stat st;
+  if (fstat(fileno(f), &st) != 0 || st.st_size < MUSIC_INDEX_HEADER_SIZE) {
+    fclose(f);
+    return false;
+  }
+
+  uint8_t* data = (uint8_t*)malloc(st.st_size);
+  if (!data) {
+    fclose(f);
+    printf("[文件系统] 索引过大，内存不足\n");
+    return false;
+  }
+
+  size_t n = fread(data, 1, st.st_size, f);
+  fclose(f);
+
+  IndexReader r = {data, data + n};
+  uint32_t count = 0;
+
+  bool ok = n == (size_t)st.st_size && memcmp(data, MUSIC_INDEX_MAGIC, 4) == 0;
+  if (ok && (data[4] | (data[5] << 8)) != MUSIC_INDEX_VERSION) {
+    // 旧版本的时长是估算值，需要重新解析
+    free(data);
+    printf("[文件系统] 音乐索引版本不符，将重新扫描\n");
+    return false;
+  }
+
+  if (ok) {
+    r.pos += 8;
+    ok = read_u32(&r, &count);
+  }
+
+  if (ok) {
+    music_library_init(lib);
+    lib->tracks.reserve(count);
+
+    // 解析用的缓冲放在循环外，逐条追加到音乐库时不产生临时字符串
+    char rel_path[256], title[128], artist[128], album[128], dir[320];
+
+    for (uint32_t i = 0; i < count && ok; i++) {
+      uint32_t mtime, size, duration_ms;
+
+      ok = read_u32(&r, &mtime) &&
+           read_u32(&r, &size) &&
+           read_u32(&r, &duration_ms) &&
+           r.pos < r.end;
+      if (!ok) break;
+
+      uint8_t flags = *r.pos++ & (MUSIC_FLAG_LRC | MUSIC_FLAG_COVER);
+
+      ok = read_string(&r, rel_path, sizeof(rel_path)) &&
+           read_string(&r, title, sizeof(title)) &&
+           read_string(&r, artist, sizeof(artist)) &&
+           read_string(&r, album, sizeof(album));
+      if (!ok) break;
+
+      Mp3SeekInfo seek;
+      ok = read_u32(&r, &seek.audio_start) &&
+           read_u32(&r, &seek.audio_bytes) &&
+           r.end - r.pos >= MP3_TOC_SIZE;
+      if (!ok) break;
+      memcpy(seek.toc, r.pos, MP3_TOC_SIZE);
+      r.pos += MP3_TOC_SIZE;
+
+      // 相对路径拆成子目录和文件名
+      const char* name = rel_path;
+      char* slash = strrchr(rel_path, '/');
+      if (slash) {
+        *slash = '\0';
+        name = slash + 1;
+        snprintf(dir, sizeof(dir), "%s/%s", dir_path, rel_path);
+      } else {
+        snprintf(dir, sizeof(dir), "%s", dir_path);
+      }
+
+      music_library_add(lib, dir, name, title, artist, album, duration_ms, mtime, size, flags, seek);
+    }
+  }
+
+  free(data);
+
+  if (!ok) {
+    printf("[文件系统] 音乐索引损坏，将重新扫描: %s\n", path.c_str());
+    music_library_clear(lib);
+    return false;
+  }
+
+  music_library_sort(lib);
+  printf("[文件系统] 从索引加载 %zu 首歌曲\n", music_library_count(*lib));
+  return true;
+}
+
+/**
+ * 把索引序列化到内存
+ */
+void music_index_serialize(const char* dir_path, const MusicLibrary& lib, std::string* out)
+{
+  out->clear();
+  if (!dir_path) return;
+
+  size_t dir_len = strlen(dir_path);
+
+  out->append(MUSIC_INDEX_MAGIC, 4);
+  write_u16(out, MUSIC_INDEX_VERSION);
+  write_u16(out, 0);
+  write_u32(out, (uint32_t)music_library_count(lib));
+
+  char rel_path[320];
+  for (size_t i = 0; i < music_library_count(lib); i++) {
+    const MusicTrack& t = music_library_track(lib, i);
+
+    // 保存相对音乐目录的路径，换卡或改挂载点后仍然有效
+    const char* dir = music_library_dir(lib, t.dir);
+    if (strncmp(dir, dir_path, dir_len) == 0) {
+      dir += dir_len;
+      if (*dir == '/') dir++;
+    }
+    if (*dir) {
+      snprintf(rel_path, sizeof(rel_path), "%s/%s", dir, music_library_str(lib, t.name));
+    } else {
+      snprintf(rel_path, sizeof(rel_path), "%s", music_library_str(lib, t.name));
+    }
+
+    write_u32(out, t.mtime);
+    write_u32(out, t.size);
+    write_u32(out, t.duration_ms);
+    out->push_back((char)t.flags);
+    write_string(out, rel_path);
+    write_string(out, music_library_str(lib, t.title));
+    write_string(out, music_library_str(lib, t.artist));
+    write_string(out, music_library_str(lib, t.album));
+    write_u32(out, t.seek.audio_start);
+    write_u32(out, t.seek.audio_bytes);
+    out->append((const char*)t.seek.toc, MP3_TOC_SIZE);
+  }
+}
+
+/**
+ * 写入索引
+ */
+bool music_index_save(const char* dir_path, const MusicLibrary& lib)
+{
+  if (!dir_path) return false;
+
+  std::string data;
+  music_index_serialize(dir_path, lib, &data);
+
+  std::string path = music_index_path(dir_path);
+  std::string tmp_path = path + ".tmp";
+
+  FILE* f = fopen(tmp_path.c_str(), "wb");
+  if (!f) {
+    printf("[文件系统] 创建索引失败: %s\n", tmp_path.c_str());
+    return false;
+  }
+
+  bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  ok = (fclose(f) == 0) && ok;
+
+  if (!ok) {
+    printf("[文件系统] 写入索引失败: %s\n", tmp_path.c_str());
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  unlink(path.c_str());
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    printf("[文件系统] 替换索引失败: %s\n", path.c_str());
+    return false;
+  }
+
+  return true;
+}
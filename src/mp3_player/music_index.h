@@ -0,0 +1,36 @@
+/****************************************************************************
+ * music_index.h
+ * 
+ * 音乐库索引：把扫描结果(元数据、时长、歌词标记)保存在 <音乐目录>/.index，
+ * 以路径 + 修改时间 + 文件大小为键。启动时一次顺序读取整个索引，
+ * 只有新增或变化的文件才需要重新解析
+ *
+ * 文件格式 (小端)：
+ *   "MIDX" | 版本(u16) | 保留(u16) | 条目数(u32)
+ *   每个条目：修改时间(u32) | 大小(u32) | 时长(u32, 毫秒) | 标志(u8, bit0歌词 bit1封面)
+ *            | 路径 | 标题 | 艺术家 | 专辑  (字符串均为 长度(u16) + 字节)
+ *            | 音频起始偏移(u32) | 音频字节数(u32) | 定位表(MP3_TOC_SIZE字节)
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vector>
+#include <string>
+#include "music_library.h"
+
+#define MUSIC_INDEX_NAME    ".index"
+#define MUSIC_INDEX_MAGIC   "MIDX"
+#define MUSIC_INDEX_VERSION 2
+
+// 读取音乐目录下的索引到音乐库 (加载后已排序)，失败或格式不符返回false
+bool music_index_load(const char* dir_path, MusicLibrary* lib);
+
+// 索引文件路径
+std::string music_index_path(const char* dir_path);
+
+// 把索引序列化到out (格式同上)，可在持锁时调用，写卡交给调用者
+void music_index_serialize(const char* dir_path, const MusicLibrary& lib, std::string* out);
+
+// 写入索引 (先写临时文件再改名，中途断电不会留下损坏的索引)
+bool music_index_save(const char* dir_path, const MusicLibrary& lib);
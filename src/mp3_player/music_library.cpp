@@ -0,0 +1,504 @@
+/****************************************************************************
+ * music_library.cpp
+ *
+ * 紧凑音乐库存储实现
+ * 字符串只追加不回收，删除记录时累计无用字节，超过一半时整体重建一次
+ * ***************************************************************************/
+#include "music_library.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// 驻留哈希表初始槽数 (2的幂)
+#define MUSIC_POOL_INITIAL_SLOTS 256
+
+// 池小于该大小时不整理
+#define MUSIC_COMPACT_MIN_BYTES (4 * MUSIC_POOL_CHUNK_SIZE)
+
+static_assert(sizeof(MusicTrack) == 60, "MusicTrack大小不对");
+
+/**
+ * 字符串池
+ */
+static const char* pool_str(const MusicStringPool& pool, uint32_t ref)
+{
+  return &pool.chunks[ref / MUSIC_POOL_CHUNK_SIZE][ref % MUSIC_POOL_CHUNK_SIZE];
+}
+
+static void pool_reset(MusicStringPool* pool)
+{
+  pool->chunks.clear();
+  pool->chunks.push_back(std::vector<char>(MUSIC_POOL_CHUNK_SIZE));
+
+  // 引用0固定为空字符串
+  pool->chunks[0][0] = '\0';
+  pool->used = 1;
+  pool->bytes = 0;
+  pool->slots.assign(MUSIC_POOL_INITIAL_SLOTS, 0);
+  pool->interned = 0;
+}
+
+static uint32_t pool_append(MusicStringPool* pool, const char* s, size_t len)
+{
+  if (len == 0) return MUSIC_STR_EMPTY;
+  if (len > MUSIC_POOL_CHUNK_SIZE - 1) len = MUSIC_POOL_CHUNK_SIZE - 1;
+
+  if (pool->used + len + 1 > MUSIC_POOL_CHUNK_SIZE) {
+    pool->chunks.push_back(std::vector<char>(MUSIC_POOL_CHUNK_SIZE));
+    pool->used = 0;
+  }
+
+  uint32_t chunk = pool->chunks.size() - 1;
+  char* dst = &pool->chunks[chunk][pool->used];
+  memcpy(dst, s, len);
+  dst[len] = '\0';
+
+  uint32_t ref = chunk * MUSIC_POOL_CHUNK_SIZE + pool->used;
+  pool->used += len + 1;
+  pool->bytes += len + 1;
+  return ref;
+}
+
+static uint32_t hash_str(const char* s, size_t len)
+{
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ (uint8_t)s[i]) * 16777619u;
+  }
+  return h;
+}
+
+static void pool_grow_slots(MusicStringPool* pool)
+{
+  std::vector<uint32_t> slots(pool->slots.size() * 2, 0);
+  size_t mask = slots.size() - 1;
+
+  for (uint32_t ref : pool->slots) {
+    if (ref == 0) continue;
+    const char* s = pool_str(*pool, ref);
+    size_t i = hash_str(s, strlen(s)) & mask;
+    while (slots[i] != 0) i = (i + 1) & mask;
+    slots[i] = ref;
+  }
+
+  pool->slots.swap(slots);
+}
+
+/**
+ * 驻留字符串，相同内容只保存一份
+ */
+static uint32_t pool_intern(MusicStringPool* pool, const char* s, size_t len)
+{
+  if (len == 0) return MUSIC_STR_EMPTY;
+  if (len > MUSIC_POOL_CHUNK_SIZE - 1) len = MUSIC_POOL_CHUNK_SIZE - 1;
+
+  // 装载率超过3/4时扩容
+  if ((pool->interned + 1) * 4 > pool->slots.size() * 3) {
+    pool_grow_slots(pool);
+  }
+
+  size_t mask = pool->slots.size() - 1;
+  for (size_t i = hash_str(s, len) & mask; ; i = (i + 1) & mask) {
+    uint32_t ref = pool->slots[i];
+    if (ref == 0) {
+      ref = pool_append(pool, s, len);
+      pool->slots[i] = ref;
+      pool->interned++;
+      return ref;
+    }
+
+    const char* p = pool_str(*pool, ref);
+    if (strncmp(p, s, len) == 0 && p[len] == '\0') return ref;
+  }
+}
+
+/**
+ * 记录工具
+ */
+static const char* track_dir(const MusicLibrary& lib, const MusicTrack& t)
+{
+  return pool_str(lib.pool, lib.dirs[t.dir]);
+}
+
+static const char* track_name(const MusicLibrary& lib, const MusicTrack& t)
+{
+  return pool_str(lib.pool, t.name);
+}
+
+static uint32_t track_owned_bytes(const MusicLibrary& lib, const MusicTrack& t)
+{
+  // 文件名和标题不驻留，删除记录后成为无用字节
+  uint32_t n = 0;
+  if (t.name != MUSIC_STR_EMPTY) n += strlen(pool_str(lib.pool, t.name)) + 1;
+  if (t.title != MUSIC_STR_EMPTY) n += strlen(pool_str(lib.pool, t.title)) + 1;
+  return n;
+}
+
+/**
+ * 按目录路径查找该目录第一条记录的位置
+ */
+static size_t dir_lower_bound(const MusicLibrary& lib, const char* dir_path)
+{
+  auto it = std::lower_bound(lib.tracks.begin(), lib.tracks.end(), dir_path,
+    [&lib](const MusicTrack& t, const char* path) {
+      return strcmp(track_dir(lib, t), path) < 0;
+    });
+  return it - lib.tracks.begin();
+}
+
+/**
+ * 查找或新建目录号
+ */
+static uint16_t dir_id(MusicLibrary* lib, const char* dir_path)
+{
+  // 批量追加时同一目录的歌曲总是连续出现，先比较最后一个目录
+  if (!lib->dirs.empty() &&
+      strcmp(pool_str(lib->pool, lib->dirs.back()), dir_path) == 0) {
+    return lib->dirs.size() - 1;
+  }
+
+  uint16_t dir = music_library_find_dir(*lib, dir_path);
+  if (dir != MUSIC_DIR_NONE) return dir;
+
+  if (lib->dirs.size() >= MUSIC_DIR_NONE) {
+    printf("[文件系统] 目录过多: %s\n", dir_path);
+    return MUSIC_DIR_NONE;
+  }
+
+  lib->dirs.push_back(pool_intern(&lib->pool, dir_path, strlen(dir_path)));
+  return lib->dirs.size() - 1;
+}
+
+/**
+ * 生成一条记录 (字符串写入池，记录本身不加入库)
+ */
+static MusicTrack make_track(MusicLibrary* lib, uint16_t dir, const char* name,
+                             const char* title, const char* artist, const char* album,
+                             uint32_t duration_ms, uint32_t mtime, uint32_t size, uint8_t flags,
+                             const Mp3SeekInfo& seek)
+{
+  MusicTrack t;
+  t.dir = dir;
+  t.flags = flags;
+  t.reserved = 0;
+  t.name = pool_append(&lib->pool, name, strlen(name));
+  t.title = pool_append(&lib->pool, title, strlen(title));
+  t.artist = pool_intern(&lib->pool, artist, strlen(artist));
+  t.album = pool_intern(&lib->pool, album, strlen(album));
+  t.duration_ms = duration_ms;
+  t.mtime = mtime;
+  t.size = size;
+  t.seek = seek;
+  return t;
+}
+
+static uint8_t file_flags(const MusicFile& file)
+{
+  return (file.has_lrc ? MUSIC_FLAG_LRC : 0) | (file.metadata.has_cover ? MUSIC_FLAG_COVER : 0);
+}
+
+/**
+ * 初始化/清空
+ */
+void music_library_init(MusicLibrary* lib)
+{
+  pool_reset(&lib->pool);
+  lib->dirs.clear();
+  lib->tracks.clear();
+  lib->dead_bytes = 0;
+}
+
+void music_library_clear(MusicLibrary* lib)
+{
+  music_library_init(lib);
+  lib->dirs.shrink_to_fit();
+  lib->tracks.shrink_to_fit();
+}
+
+/**
+ * 访问
+ */
+size_t music_library_count(const MusicLibrary& lib)
+{
+  return lib.tracks.size();
+}
+
+const MusicTrack& music_library_track(const MusicLibrary& lib, size_t index)
+{
+  return lib.tracks[index];
+}
+
+const char* music_library_str(const MusicLibrary& lib, uint32_t ref)
+{
+  return pool_str(lib.pool, ref);
+}
+
+const char* music_library_dir(const MusicLibrary& lib, uint16_t dir)
+{
+  return dir < lib.dirs.size() ? pool_str(lib.pool, lib.dirs[dir]) : "";
+}
+
+/**
+ * 拼出完整路径
+ */
+size_t music_library_path(const MusicLibrary& lib, size_t index, char* buf, size_t buf_size)
+{
+  if (index >= lib.tracks.size() || buf_size == 0) return 0;
+
+  const MusicTrack& t = lib.tracks[index];
+  const char* dir = track_dir(lib, t);
+  size_t dir_len = strlen(dir);
+  const char* sep = (dir_len > 0 && dir[dir_len - 1] != '/') ? "/" : "";
+
+  int n = snprintf(buf, buf_size, "%s%s%s", dir, sep, track_name(lib, t));
+  if (n < 0) return 0;
+  return ((size_t)n < buf_size) ? n : buf_size - 1;
+}
+
+/**
+ * 展开为MusicFile
+ */
+bool music_library_get(const MusicLibrary& lib, size_t index, MusicFile* file)
+{
+  if (!file || index >= lib.tracks.size()) return false;
+
+  const MusicTrack& t = lib.tracks[index];
+  file->filename = track_name(lib, t);
+  file->filepath = combine_path(track_dir(lib, t), file->filename);
+  file->metadata.title = pool_str(lib.pool, t.title);
+  file->metadata.artist = pool_str(lib.pool, t.artist);
+  file->metadata.album = pool_str(lib.pool, t.album);
+  file->metadata.duration_ms = t.duration_ms;
+  file->metadata.has_cover = (t.flags & MUSIC_FLAG_COVER) != 0;
+  file->has_lrc = (t.flags & MUSIC_FLAG_LRC) != 0;
+  file->mtime = t.mtime;
+  file->size = t.size;
+  file->metadata.seek = t.seek;
+  return true;
+}
+
+/**
+ * 追加一首歌曲
+ */
+bool music_library_add(MusicLibrary* lib, const char* dir_path, const char* name,
+                       const char* title, const char* artist, const char* album,
+                       uint32_t duration_ms, uint32_t mtime, uint32_t size, uint8_t flags,
+                       const Mp3SeekInfo& seek)
+{
+  if (!lib || !dir_path || !name || name[0] == '\0') return false;
+
+  uint16_t dir = dir_id(lib, dir_path);
+  if (dir == MUSIC_DIR_NONE) return false;
+
+  lib->tracks.push_back(make_track(lib, dir, name, title ? title : "", artist ? artist : "",
+                                   album ? album : "", duration_ms, mtime, size, flags, seek));
+  return true;
+}
+
+bool music_library_add_file(MusicLibrary* lib, const MusicFile& file)
+{
+  std::string dir = get_directory_from_path(file.filepath);
+  std::string name = file.filename.empty() ? get_filename_from_path(file.filepath) : file.filename;
+
+  return music_library_add(lib, dir.c_str(), name.c_str(), file.metadata.title.c_str(),
+                           file.metadata.artist.c_str(), file.metadata.album.c_str(),
+                           file.metadata.duration_ms, file.mtime, file.size, file_flags(file),
+                           file.metadata.seek);
+}
+
+/**
+ * 排序 (只交换定长记录，不分配内存)
+ */
+void music_library_sort(MusicLibrary* lib)
+{
+  const MusicLibrary& l = *lib;
+  std::sort(lib->tracks.begin(), lib->tracks.end(),
+    [&l](const MusicTrack& a, const MusicTrack& b) {
+      if (a.dir != b.dir) return strcmp(track_dir(l, a), track_dir(l, b)) < 0;
+      return strcmp(track_name(l, a), track_name(l, b)) < 0;
+    });
+}
+
+/**
+ * 查找目录号
+ */
+uint16_t music_library_find_dir(const MusicLibrary& lib, const char* dir_path)
+{
+  for (size_t i = 0; i < lib.dirs.size(); i++) {
+    if (strcmp(pool_str(lib.pool, lib.dirs[i]), dir_path) == 0) return i;
+  }
+  return MUSIC_DIR_NONE;
+}
+
+/**
+ * 按完整路径查找歌曲
+ */
+size_t music_library_find(const MusicLibrary& lib, const char* path)
+{
+  if (!path) return MUSIC_TRACK_NONE;
+  
+  const char* slash = strrchr(path, '/');
+  if (!slash) return MUSIC_TRACK_NONE;
+  
+  // 目录可能带或不带结尾的'/' (见music_library_path)
+  std::string dir_path(path, slash - path);
+  uint16_t dir = music_library_find_dir(lib, dir_path.c_str());
+  if (dir == MUSIC_DIR_NONE) {
+    dir_path += '/';
+    dir = music_library_find_dir(lib, dir_path.c_str());
+    if (dir == MUSIC_DIR_NONE) return MUSIC_TRACK_NONE;
+  }
+  
+  const char* name = slash + 1;
+  size_t lo = dir_lower_bound(lib, dir_path.c_str());
+  size_t hi = lo;
+  while (hi < lib.tracks.size() && lib.tracks[hi].dir == dir) hi++;
+  
+  auto first = lib.tracks.begin() + lo;
+  auto last = lib.tracks.begin() + hi;
+  auto it = std::lower_bound(first, last, name,
+    [&lib](const MusicTrack& t, const char* n) {
+      return strcmp(track_name(lib, t), n) < 0;
+    });
+  if (it == last || strcmp(track_name(lib, *it), name) != 0) return MUSIC_TRACK_NONE;
+  return it - lib.tracks.begin();
+}
+
+/**
+ * 把一个目录的歌曲放入扫描缓存
+ */
+void music_library_dir_cache(const MusicLibrary& lib, const char* dir_path, MusicFileCache* cache)
+{
+  uint16_t dir = music_library_find_dir(lib, dir_path);
+  if (dir == MUSIC_DIR_NONE) return;
+
+  for (size_t i = dir_lower_bound(lib, dir_path);
+       i < lib.tracks.size() && lib.tracks[i].dir == dir; i++) {
+    MusicFile file;
+    music_library_get(lib, i, &file);
+    (*cache)[file.filepath] = file;
+  }
+}
+
+/**
+ * 替换一个目录的歌曲
+ */
+bool music_library_replace_dir(MusicLibrary* lib, const char* dir_path,
+                               const std::vector<MusicFile>& files)
+{
+  if (!lib || !dir_path) return false;
+
+  uint16_t dir = music_library_find_dir(*lib, dir_path);
+  size_t lo = dir_lower_bound(*lib, dir_path);
+  size_t hi = lo;
+  while (hi < lib->tracks.size() && dir != MUSIC_DIR_NONE && lib->tracks[hi].dir == dir) hi++;
+
+  if (files.empty() && lo == hi) return false;
+  if (dir == MUSIC_DIR_NONE) {
+    dir = dir_id(lib, dir_path);
+    if (dir == MUSIC_DIR_NONE) return false;
+  }
+
+  std::vector<MusicTrack> fresh;
+  std::vector<bool> kept(hi - lo, false);
+  fresh.reserve(files.size());
+  bool changed = files.size() != hi - lo;
+
+  for (const MusicFile& file : files) {
+    const char* name = file.filename.c_str();
+    uint8_t flags = file_flags(file);
+
+    // 原记录按文件名有序，二分查找
+    auto first = lib->tracks.begin() + lo;
+    auto last = lib->tracks.begin() + hi;
+    auto it = std::lower_bound(first, last, name,
+      [lib](const MusicTrack& t, const char* n) {
+        return strcmp(track_name(*lib, t), n) < 0;
+      });
+
+    if (it != last && strcmp(track_name(*lib, *it), name) == 0 &&
+        it->mtime == file.mtime && it->size == file.size && it->flags == flags) {
+      kept[it - first] = true;
+      fresh.push_back(*it);
+      continue;
+    }
+
+    changed = true;
+    fresh.push_back(make_track(lib, dir, name, file.metadata.title.c_str(),
+                               file.metadata.artist.c_str(), file.metadata.album.c_str(),
+                               file.metadata.duration_ms, file.mtime, file.size, flags,
+                               file.metadata.seek));
+  }
+
+  for (size_t i = 0; i < kept.size() && !changed; i++) {
+    changed = !kept[i];
+  }
+  if (!changed) return false;
+
+  for (size_t i = 0; i < kept.size(); i++) {
+    if (!kept[i]) lib->dead_bytes += track_owned_bytes(*lib, lib->tracks[lo + i]);
+  }
+
+  const MusicLibrary& l = *lib;
+  std::sort(fresh.begin(), fresh.end(),
+    [&l](const MusicTrack& a, const MusicTrack& b) {
+      return strcmp(track_name(l, a), track_name(l, b)) < 0;
+    });
+
+  lib->tracks.erase(lib->tracks.begin() + lo, lib->tracks.begin() + hi);
+  lib->tracks.insert(lib->tracks.begin() + lo, fresh.begin(), fresh.end());
+
+  music_library_compact(lib);
+  return true;
+}
+
+/**
+ * 删除一个目录的所有歌曲
+ */
+size_t music_library_remove_dir(MusicLibrary* lib, uint16_t dir)
+{
+  if (!lib || dir >= lib->dirs.size()) return 0;
+
+  size_t lo = dir_lower_bound(*lib, pool_str(lib->pool, lib->dirs[dir]));
+  size_t hi = lo;
+  while (hi < lib->tracks.size() && lib->tracks[hi].dir == dir) {
+    lib->dead_bytes += track_owned_bytes(*lib, lib->tracks[hi]);
+    hi++;
+  }
+  if (hi == lo) return 0;
+
+  lib->tracks.erase(lib->tracks.begin() + lo, lib->tracks.begin() + hi);
+  music_library_compact(lib);
+  return hi - lo;
+}
+
+/**
+ * 整理字符串池：按原顺序把所有记录复制到新池
+ */
+void music_library_compact(MusicLibrary* lib)
+{
+  if (!lib || lib->pool.bytes < MUSIC_COMPACT_MIN_BYTES ||
+      lib->dead_bytes * 2 < lib->pool.bytes) {
+    return;
+  }
+
+  MusicLibrary fresh;
+  music_library_init(&fresh);
+  fresh.tracks.reserve(lib->tracks.size());
+
+  for (const MusicTrack& t : lib->tracks) {
+    const MusicLibrary& l = *lib;
+    music_library_add(&fresh, track_dir(l, t), track_name(l, t), pool_str(l.pool, t.title),
+                      pool_str(l.pool, t.artist), pool_str(l.pool, t.album),
+                      t.duration_ms, t.mtime, t.size, t.flags, t.seek);
+  }
+
+  printf("[文件系统] 整理音乐库字符串池: %u -> %u 字节\n",
+         (unsigned)lib->pool.bytes, (unsigned)fresh.pool.bytes);
+
+  std::swap(lib->pool, fresh.pool);
+  lib->dirs.swap(fresh.dirs);
+  lib->tracks.swap(fresh.tracks);
+  lib->dead_bytes = 0;
+}
@@ -0,0 +1,112 @@
+/****************************************************************************
+ * music_library.h
+ * 
+ * 紧凑音乐库存储：所有字符串放在按块分配的字符串池里，
+ * 目录路径、艺术家、专辑驻留去重，歌曲按定长记录保存，用下标访问。
+ * 几千首歌曲只占几十个4KB块和一个记录数组，不会因为大量小字符串把堆碎片化
+ *
+ * 记录按 (目录路径, 文件名) 排序，同一目录的歌曲总是连续存放
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <vector>
+#include "file_system.h"
+
+// 字符串池块大小 (单个字符串超过块大小会被截断)
+#define MUSIC_POOL_CHUNK_SIZE 4096
+
+// 空字符串的引用
+#define MUSIC_STR_EMPTY 0
+
+// 未找到目录
+#define MUSIC_DIR_NONE 0xFFFF
+
+// 未找到歌曲
+#define MUSIC_TRACK_NONE ((size_t)-1)
+
+// 歌曲标志
+#define MUSIC_FLAG_LRC   0x01
+#define MUSIC_FLAG_COVER 0x02
+
+// 字符串池：引用 = 块号 * MUSIC_POOL_CHUNK_SIZE + 块内偏移
+struct MusicStringPool {
+  std::vector<std::vector<char> > chunks;
+  uint32_t used;                  // 最后一块已用字节
+  uint32_t bytes;                 // 字符串总字节数
+  std::vector<uint32_t> slots;    // 驻留哈希表 (存引用，0为空槽)
+  uint32_t interned;              // 驻留字符串数
+};
+
+// 歌曲记录 (定长60字节)
+struct MusicTrack {
+  uint16_t dir;           // 目录号
+  uint8_t flags;          // MUSIC_FLAG_*
+  uint8_t reserved;
+  uint32_t name;          // 文件名
+  uint32_t title;         // 标题
+  uint32_t artist;        // 艺术家 (驻留)
+  uint32_t album;         // 专辑 (驻留)
+  uint32_t duration_ms;   // 时长
+  uint32_t mtime;         // 文件修改时间 (索引键)
+  uint32_t size;          // 文件大小 (索引键)
+  Mp3SeekInfo seek;       // 定位表
+};
+
+// 音乐库
+struct MusicLibrary {
+  MusicStringPool pool;
+  std::vector<uint32_t> dirs;       // 目录完整路径 (驻留)，下标为目录号
+  std::vector<MusicTrack> tracks;   // 按 (目录路径, 文件名) 排序
+  uint32_t dead_bytes;              // 已删除记录留在池中的字节数
+};
+
+// 初始化/清空
+void music_library_init(MusicLibrary* lib);
+void music_library_clear(MusicLibrary* lib);
+
+// 歌曲数
+size_t music_library_count(const MusicLibrary& lib);
+
+// 取记录和字符串 (返回的指针在库下一次修改前有效)
+const MusicTrack& music_library_track(const MusicLibrary& lib, size_t index);
+const char* music_library_str(const MusicLibrary& lib, uint32_t ref);
+const char* music_library_dir(const MusicLibrary& lib, uint16_t dir);
+
+// 拼出完整路径，返回长度
+size_t music_library_path(const MusicLibrary& lib, size_t index, char* buf, size_t buf_size);
+
+// 展开为MusicFile (界面和播放器使用)
+bool music_library_get(const MusicLibrary& lib, size_t index, MusicFile* file);
+
+// 追加一首歌曲 (不保持排序，批量追加后调用music_library_sort)
+bool music_library_add(MusicLibrary* lib, const char* dir_path, const char* name,
+                       const char* title, const char* artist, const char* album,
+                       uint32_t duration_ms, uint32_t mtime, uint32_t size, uint8_t flags,
+                       const Mp3SeekInfo& seek);
+bool music_library_add_file(MusicLibrary* lib, const MusicFile& file);
+
+// 按 (目录路径, 文件名) 排序
+void music_library_sort(MusicLibrary* lib);
+
+// 查找目录号，不存在返回MUSIC_DIR_NONE
+uint16_t music_library_find_dir(const MusicLibrary& lib, const char* dir_path);
+
+// 按完整路径查找歌曲的下标，不存在返回MUSIC_TRACK_NONE
+// (下标随扫描合并目录而变化，跨越库修改保存的应是路径)
+size_t music_library_find(const MusicLibrary& lib, const char* path);
+
+// 把一个目录的歌曲放入扫描缓存
+void music_library_dir_cache(const MusicLibrary& lib, const char* dir_path, MusicFileCache* cache);
+
+// 用新的扫描结果替换一个目录的歌曲，未变化的记录原样保留，有变化返回true
+bool music_library_replace_dir(MusicLibrary* lib, const char* dir_path,
+                               const std::vector<MusicFile>& files);
+
+// 删除一个目录的所有歌曲，返回删除的数量
+size_t music_library_remove_dir(MusicLibrary* lib, uint16_t dir);
+
+// 池中已删除的字符串超过一半时整理
+void music_library_compact(MusicLibrary* lib);
@@ -4,6 +4,7 @@
  * 音频播放模块实现
  * ***************************************************************************/
 #include "player.h"
+#include "audio_stream.h"
 #include <stdio.h>
 #include <string.h>
 #include <audio/audio_high_level_api.h>
@@ -17,6 +18,17 @@ static LoopMode g_loop_mode = LOOP_SEQUENTIAL;
 static EQPreset g_current_eq = EQ_FLAT;
 static int8_t g_custom_eq[8] = {0};  /* 8段EQ自定义参数 */
 static uint32_t g_current_duration = 0;  /* 当前文件时长(毫秒) */
+static Mp3SeekInfo g_current_seek;       /* 当前文件定位表 */
+static char g_current_path[256] = "";    /* 当前文件路径 */
+static uint32_t g_position_base = 0;     /* 当前曲目在解码器中起始处的播放时间(毫秒) */
+static uint32_t g_track_start = 0;       /* 当前曲目开始时解码器的累计位置(毫秒) */
+static bool g_activated = false;         /* 播放器是否已激活 */
+
+/* 排队的下一首 */
+static bool g_has_next = false;
+static char g_next_path[256] = "";
+static uint32_t g_next_duration = 0;
+static Mp3SeekInfo g_next_seek;
 
 /**
  * 初始化播放器
@@ -47,6 +59,12 @@ bool player_init()
     /* 非致命错误，继续 */
   }
   
+  /* 启动预读线程 */
+  if (!audio_stream_start()) {
+    AS_audio_finalize();
+    return false;
+  }
+  
   g_initialized = true;
   return true;
 }
@@ -60,15 +78,65 @@ void player_deinit()
   
   AS_StopPlayer();
   AS_audio_finalize();
+  audio_stream_stop();
   g_initialized = false;
+  g_activated = false;
   g_playing = false;
   g_paused = false;
+  g_has_next = false;
+}
+
+/**
+ * 解码器输入回调：从预读缓冲取码流
+ */
+static int decoder_read(uint8_t* buf, uint32_t size)
+{
+  return (int)audio_stream_read(buf, size);
+}
+
+/**
+ * 从offset处的帧开始解码
+ * 文件由预读线程读取，解码器通过AS_AddPlayerStream注册的回调从内存取数据
+ */
+static bool decoder_open(const char* filepath, uint32_t offset)
+{
+  if (!audio_stream_open(filepath, offset)) {
+    return false;
+  }
+  
+  if (AS_AddPlayerStream(decoder_read) < 0) {
+    printf("[播放器] 加载文件失败!\n");
+    audio_stream_close();
+    return false;
+  }
+  
+  /* 新的解码会话，之前排队的文件随audio_stream_open一起丢弃 */
+  g_track_start = 0;
+  g_has_next = false;
+  return true;
+}
+
+/**
+ * 取得时长和定位表，优先使用音乐库中缓存的结果
+ */
+static void load_track_info(const char* filepath, const AudioMetadata* metadata,
+                            uint32_t* duration_ms, Mp3SeekInfo* seek)
+{
+  if (metadata && metadata->duration_ms > 0) {
+    *duration_ms = metadata->duration_ms;
+    *seek = metadata->seek;
+  } else {
+    Mp3Info info;
+    mp3_parse_info(filepath, &info);
+    *duration_ms = info.duration_ms;
+    *seek = info.seek;
+  }
 }
 
 /**
  * 加载音频文件
  */
-bool player_load_file(const char* filepath)
+bool player_load_file(const char* filepath, const AudioMetadata* metadata)
 {
   if (!g_initialized) {
     if (!player_init()) return false;
@@ -82,25 +150,33 @@ bool player_load_file(const char* filepath)
   g_playing = false;
   g_paused = false;
   
-  /* 激活播放器 */
-  if (AS_ActivatePlayer(AS_SETPLAYER_SAMPLE_RATE_AUTO) < 0) {
-    printf("[播放器] 激活失败!\n");
-    return false;
+  /* 只在第一次加载时激活播放器，之后换曲不再重新激活 */
+  if (!g_activated) {
+    if (AS_ActivatePlayer(AS_SETPLAYER_SAMPLE_RATE_AUTO) < 0) {
+      printf("[播放器] 激活失败!\n");
+      return false;
+    }
+    
+    /* 应用当前EQ设置 */
+    player_set_equalizer(g_current_eq);
+    
+    /* 设置音量 */
+    AS_SetPlayerVolume(g_volume);
+    
+    g_activated = true;
   }
   
-  /* 应用当前EQ设置 */
-  player_set_equalizer(g_current_eq);
-  
-  /* 设置音量 */
-  AS_SetPlayerVolume(g_volume);
-  
   /* 加载文件 */
   printf("[播放器] 加载文件: %s\n", filepath);
-  if (AS_AddPlayerFile(filepath) < 0) {
-    printf("[播放器] 加载文件失败!\n");
+  if (!decoder_open(filepath, 0)) {
     return false;
   }
   
+  snprintf(g_current_path, sizeof(g_current_path), "%s", filepath);
+  g_position_base = 0;
+  
+  load_track_info(filepath, metadata, &g_current_duration, &g_current_seek);
+  
   return true;
 }
 
@@ -128,8 +204,10 @@ void player_stop()
   if (!g_initialized || !g_playing) return;
   
   AS_StopPlayer();
+  audio_stream_close();
   g_playing = false;
   g_paused = false;
+  g_has_next = false;
 }
 
 /**
@@ -277,18 +355,115 @@ uint32_t player_get_position_ms()
 {
   if (!g_initialized || !g_playing) return 0;
   
-  return AS_getPlayerPosition();
+  /* 解码器位置在排队的曲目之间累计，减去当前曲目开始时的位置 */
+  uint32_t decoder_ms = AS_getPlayerPosition();
+  uint32_t position = g_position_base + (decoder_ms > g_track_start ? decoder_ms - g_track_start : 0);
+  
+  /* 已进入下一首但还没有切换时，停在当前曲目的结尾 */
+  if (g_has_next && g_current_duration > 0 && position > g_current_duration) {
+    position = g_current_duration;
+  }
+  return position;
+}
+
+/**
+ * 把下一首排入解码队列
+ * 预读线程读完当前文件后直接接着读下一首，解码器看到的是连续的码流，
+ * 当前曲目解码结束后直接接着解码，不重新激活播放器
+ */
+bool player_queue_next(const char* filepath, const AudioMetadata* metadata)
+{
+  if (!g_initialized || !g_playing || !filepath) return false;
+  
+  if (!audio_stream_queue(filepath)) {
+    return false;
+  }
+  
+  snprintf(g_next_path, sizeof(g_next_path), "%s", filepath);
+  load_track_info(filepath, metadata, &g_next_duration, &g_next_seek);
+  g_has_next = true;
+  
+  printf("[播放器] 下一首已排队: %s\n", filepath);
+  return true;
+}
+
+/**
+ * 是否有排队的下一首
+ */
+bool player_has_queued()
+{
+  return g_has_next;
+}
+
+/**
+ * 当前曲目播完、解码器已进入排队的下一首时切换曲目信息
+ */
+bool player_take_track_change()
+{
+  if (!g_initialized || !g_playing || !g_has_next || g_current_duration == 0) return false;
+  
+  uint32_t decoder_ms = AS_getPlayerPosition();
+  uint32_t position = g_position_base + (decoder_ms > g_track_start ? decoder_ms - g_track_start : 0);
+  if (position < g_current_duration) return false;
+  
+  /* 下一首从当前曲目结束时的解码器位置开始 */
+  g_track_start += g_current_duration - g_position_base;
+  g_position_base = 0;
+  
+  snprintf(g_current_path, sizeof(g_current_path), "%s", g_next_path);
+  g_current_duration = g_next_duration;
+  g_current_seek = g_next_seek;
+  g_has_next = false;
+  
+  printf("[播放器] 无缝切换到: %s\n", g_current_path);
+  return true;
+}
+
+/**
+ * 跳转到指定播放位置
+ * 按定位表算出偏移，再在附近找到帧头，解码器直接从该帧开始，不需要从头解码
+ */
+bool player_seek_ms(uint32_t position_ms)
+{
+  if (!g_initialized || g_current_path[0] == '\0') return false;
+  
+  if (g_current_duration > 0 && position_ms >= g_current_duration) {
+    position_ms = g_current_duration - 1;
+  }
+  
+  uint32_t offset = mp3_seek_offset(g_current_seek, position_ms, g_current_duration);
+  offset = mp3_align_frame(g_current_path, offset);
+  
+  bool was_playing = g_playing;
+  bool was_paused = g_paused;
+  
+  if (g_playing) {
+    AS_StopPlayer();
+    g_playing = false;
+  }
+  
+  if (!decoder_open(g_current_path, offset)) {
+    g_paused = false;
+    return false;
+  }
+  g_position_base = position_ms;
+  
+  // 恢复跳转前的播放状态
+  if (was_playing) {
+    g_paused = false;
+    player_start();
+    if (was_paused) player_pause();
+  }
+  
+  return true;
 }
 
 /**
  * 获取当前文件总时长(毫秒)
- * 注意：这个函数在Spresense SDK中可能不稳定
+ * 硬件API不提供时长，使用加载时从音乐库或MP3头得到的值
  */
 uint32_t player_get_duration_ms()
 {
-  /* 目前硬件API不直接支持获取时长，需要将文件完整解析一遍
-   * 此处可能需要依赖外部计算或缓存的值
-   */
   return g_current_duration;
 }
 
@@ -310,7 +485,7 @@ LoopMode player_get_loop_mode()
 
 /**
  * 解析音频元数据
- * 简单实现，仅支持ID3v1
+ * 标签仅支持ID3v1，时长来自MP3帧信息
  */
 bool player_get_metadata(const char* filepath, AudioMetadata* metadata)
 {
@@ -322,6 +497,7 @@ bool player_get_metadata(const char* filepath, AudioMetadata* metadata)
   metadata->album = "";
   metadata->duration_ms = 0;
   metadata->has_cover = false;
+  mp3_seek_linear(&metadata->seek, 0, 0);
   
   /* 提取文件名作为默认标题 */
   const char* filename = strrchr(filepath, '/');
@@ -367,18 +543,11 @@ bool player_get_metadata(const char* filepath, AudioMetadata* metadata)
   
   fclose(f);
   
-  /* 简单按照比特率估算时长 
-   * 注意：这只是粗略估计，实际情况可能有误差
-   */
-  struct stat st;
-  if (stat(filepath, &st) == 0) {
-    size_t file_size = st.st_size;
-    /* 假设MP3的平均比特率为128kbps */
-    metadata->duration_ms = (uint32_t)((file_size * 8) / 128000);
-    
-    /* 缓存时长供其他函数使用 */
-    g_current_duration = metadata->duration_ms;
-  }
+  /* 从Xing/VBRI头或帧头得到准确时长和定位表，不影响正在播放的曲目 */
+  Mp3Info info;
+  mp3_parse_info(filepath, &info);
+  metadata->duration_ms = info.duration_ms;
+  metadata->seek = info.seek;
   
   return true;
 }
@@ -9,13 +9,23 @@
 #include <stdbool.h>
 #include <string>
 #include "common.h"
+#include "mp3_parser.h"
 
 // 播放器初始化/关闭
 bool player_init();
 void player_deinit();
 
-// 播放控制
-bool player_load_file(const char* filepath);
+struct AudioMetadata;
+
+// 距结尾多久时预取下一首 (毫秒)
+#ifdef CONFIG_SPRESENSEWONG_PLAYER_PREFETCH_MS
+#define PLAYER_PREFETCH_MS CONFIG_SPRESENSEWONG_PLAYER_PREFETCH_MS
+#else
+#define PLAYER_PREFETCH_MS 10000
+#endif
+
+// 播放控制 (提供音乐库中的元数据时直接使用其中的时长和定位表，否则现场解析)
+bool player_load_file(const char* filepath, const AudioMetadata* metadata = nullptr);
 void player_start();
 void player_stop();
 void player_pause();
@@ -35,6 +45,16 @@ bool player_is_paused();
 uint32_t player_get_position_ms();
 uint32_t player_get_duration_ms();
 
+// 跳转到指定播放位置 (毫秒)，按定位表直接定位到帧边界
+bool player_seek_ms(uint32_t position_ms);
+
+// 无缝播放：把下一首排入解码队列，当前曲目结束后解码不中断
+bool player_queue_next(const char* filepath, const AudioMetadata* metadata);
+bool player_has_queued();
+
+// 解码器已进入排队的下一首时切换当前曲目信息并返回true (主循环定期调用)
+bool player_take_track_change();
+
 // 设置循环模式
 void player_set_loop_mode(LoopMode mode);
 LoopMode player_get_loop_mode();
@@ -46,6 +66,7 @@ struct AudioMetadata {
     std::string album;
     uint32_t duration_ms;
     bool has_cover;
+    Mp3SeekInfo seek;      // 定位表
 };
 
 bool player_get_metadata(const char* filepath, AudioMetadata* metadata);
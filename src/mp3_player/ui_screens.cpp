@@ -12,6 +12,10 @@
 /* 当前界面 */
 static AppScreen g_current_screen = SCREEN_PLAYER;
 
+/* 歌曲标题和当前歌词行的跑马灯 */
+static LcdMarquee g_title_marquee;
+static LcdMarquee g_lyric_marquee;
+
 /**
  * 界面初始化
  */
@@ -19,6 +23,8 @@ void ui_init()
 {
   /* 初始化LCD */
   lcd_init();
+  lcd_marquee_init(&g_title_marquee);
+  lcd_marquee_init(&g_lyric_marquee);
   g_current_screen = SCREEN_PLAYER;
 }
 
@@ -85,7 +91,7 @@ static const char* get_eq_mode_name(EQPreset eq)
 void ui_draw_lockscreen(int battery_percent, bool charging, 
                        const char* current_title, bool is_playing)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -101,8 +107,7 @@ void ui_draw_lockscreen(int battery_percent, bool charging,
   
   /* 显示歌曲信息 */
   if (current_title && *current_title) {
-    u8g2_SetFont(u8g2, u8g2_font_6x12_tr);
-    u8g2_DrawStr(u8g2, 5, 48, current_title);
+    lcd_draw_utf8(5, 48, current_title);
     
     /* 如果正在播放，显示播放图标 */
     if (is_playing) {
@@ -114,7 +119,7 @@ void ui_draw_lockscreen(int battery_percent, bool charging,
     }
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -124,7 +129,7 @@ void ui_draw_player_screen(const MusicFile& file, uint32_t position_ms,
                          uint8_t volume, LoopMode loop_mode, EQPreset eq_mode,
                          int battery_percent, bool charging)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -143,12 +148,12 @@ void ui_draw_player_screen(const MusicFile& file, uint32_t position_ms,
   
   /* 歌曲标题 */
   u8g2_SetFont(u8g2, u8g2_font_6x12_tr);
-  std::string title = file.metadata.title.empty() ? file.filename : file.metadata.title;
-  u8g2_DrawStr(u8g2, 0, 22, title.c_str());
+  const std::string& title = file.metadata.title.empty() ? file.filename : file.metadata.title;
+  lcd_marquee_draw(&g_title_marquee, 0, 22, 128, title.c_str());
   
   /* 艺术家 */
   if (!file.metadata.artist.empty()) {
-    u8g2_DrawStr(u8g2, 0, 34, file.metadata.artist.c_str());
+    lcd_draw_utf8(0, 34, file.metadata.artist.c_str());
   }
   
   /* 进度条 */
@@ -165,31 +170,30 @@ void ui_draw_player_screen(const MusicFile& file, uint32_t position_ms,
   /* 音量指示 */
   draw_volume_indicator(80, 47, 30, 8, volume);
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
  * 绘制歌词显示
  */
-void ui_draw_lyrics_screen(const std::vector<LrcLine>& lyrics, 
+void ui_draw_lyrics_screen(Lyrics* lyrics, 
                           uint32_t current_ms, const char* title)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
   /* 显示标题 */
-  u8g2_SetFont(u8g2, u8g2_font_5x8_tr);
-  u8g2_DrawStr(u8g2, 0, 8, title ? title : "歌词显示");
+  lcd_draw_utf8(0, 10, title ? title : "歌词显示");
   
-  /* 查找当前播放歌词行 */
-  int current_line = find_lyric_line(lyrics, current_ms);
+  /* 移动到当前播放歌词行 (正常播放时不用查找) */
+  int current_line = lyrics_update(lyrics, current_ms);
+  int count = (int)lyrics_count(*lyrics);
   
   /* 如果没有歌词或还没到第一句 */
-  if (lyrics.empty() || current_line < 0) {
-    u8g2_SetFont(u8g2, u8g2_font_6x12_tr);
-    u8g2_DrawStr(u8g2, 20, 32, "暂无歌词");
-    u8g2_SendBuffer(u8g2);
+  if (count == 0 || current_line < 0) {
+    lcd_draw_label(20, 34, "暂无歌词");
+    lcd_end_frame();
     return;
   }
   
@@ -197,69 +201,63 @@ void ui_draw_lyrics_screen(const std::vector<LrcLine>& lyrics,
    * - 当前行在中间加亮显示
    * - 显示前后各1行(如果有)
    */
-  u8g2_SetFont(u8g2, u8g2_font_6x12_tr);
-  
   /* 前一行歌词 */
   if (current_line > 0) {
-    u8g2_DrawStr(u8g2, 10, 20, lyrics[current_line-1].text.c_str());
+    lcd_draw_utf8(10, 22, lyrics_text(*lyrics, current_line-1));
   }
   
-  /* 当前行歌词(反色显示) */
-  int y_pos = 32;
-  int width = u8g2_GetStrWidth(u8g2, lyrics[current_line].text.c_str());
+  /* 当前行歌词(反色显示)，放不下时滚动 */
+  int y_pos = 34;
+  const char* text = lyrics_text(*lyrics, current_line);
+  int width = lcd_get_utf8_width(text);
+  if (width > 124) width = 124;
   int x_pos = (128 - width) / 2;
-  if (x_pos < 0) x_pos = 0;
   
   u8g2_DrawBox(u8g2, x_pos-2, y_pos-10, width+4, 12);
   u8g2_SetDrawColor(u8g2, 0);
-  u8g2_DrawStr(u8g2, x_pos, y_pos, lyrics[current_line].text.c_str());
+  lcd_marquee_draw(&g_lyric_marquee, x_pos, y_pos, width, text);
   u8g2_SetDrawColor(u8g2, 1);
   
   /* 后一行歌词 */
-  if (current_line < (int)lyrics.size() - 1) {
-    u8g2_DrawStr(u8g2, 10, 44, lyrics[current_line+1].text.c_str());
+  if (current_line < count - 1) {
+    lcd_draw_utf8(10, 46, lyrics_text(*lyrics, current_line+1));
   }
   
   /* 下一行歌词(如果有) */
-  if (current_line < (int)lyrics.size() - 2) {
-    u8g2_DrawStr(u8g2, 10, 56, lyrics[current_line+2].text.c_str());
+  if (current_line < count - 2) {
+    lcd_draw_utf8(10, 58, lyrics_text(*lyrics, current_line+2));
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
  * 绘制文件浏览器
  */
-void ui_draw_browser(const std::vector<MusicFile>& files, 
+void ui_draw_browser(const char* const* names, size_t count,
                     size_t current_index, size_t start_index)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
   /* 顶部标题 */
   u8g2_SetFont(u8g2, u8g2_font_6x12_tr);
   char header[32];
-  snprintf(header, sizeof(header), "音乐文件 (%zu)", files.size());
+  snprintf(header, sizeof(header), "音乐文件 (%zu)", count);
   u8g2_DrawStr(u8g2, 0, 10, header);
   
   /* 列表条目 */
-  if (files.empty()) {
+  if (count == 0) {
     u8g2_DrawStr(u8g2, 10, 30, "没有音乐文件");
   } else {
     /* 每页显示4个文件 */
-    const size_t items_per_page = 4;
-    
-    /* 确保不超出范围 */
-    if (start_index >= files.size()) {
-      start_index = 0;
-    }
+    const size_t items_per_page = UI_BROWSER_PAGE_ITEMS;
     
     /* 显示文件列表 */
     size_t end_index = start_index + items_per_page;
-    if (end_index > files.size()) {
-      end_index = files.size();
+    if (end_index > count) {
+      end_index = count;
     }
     
     for (size_t i = start_index; i < end_index; i++) {
@@ -272,12 +270,15 @@ void ui_draw_browser(const std::vector<MusicFile>& files,
       }
       
       /* 限制显示长度 */
-      std::string display_name = files[i].filename;
-      if (display_name.length() > 20) {
-        display_name = display_name.substr(0, 17) + "...";
+      const char* name = names[i - start_index];
+      char display_name[24];
+      if (strlen(name) > 20) {
+        snprintf(display_name, sizeof(display_name), "%.17s...", name);
+      } else {
+        snprintf(display_name, sizeof(display_name), "%s", name);
       }
       
-      u8g2_DrawStr(u8g2, 5, y_pos, display_name.c_str());
+      u8g2_DrawStr(u8g2, 5, y_pos, display_name);
       
       /* 恢复颜色 */
       if (i == current_index) {
@@ -286,16 +287,16 @@ void ui_draw_browser(const std::vector<MusicFile>& files,
     }
     
     /* 如果有更多文件，显示滚动指示 */
-    if (files.size() > items_per_page) {
+    if (count > items_per_page) {
       /* 计算滚动条 */
-      int scroll_height = 64 / (files.size() / items_per_page + 1);
-      int scroll_pos = 12 + (64 - scroll_height) * start_index / (files.size() - items_per_page);
+      int scroll_height = 64 / (count / items_per_page + 1);
+      int scroll_pos = 12 + (64 - scroll_height) * start_index / (count - items_per_page);
       
       u8g2_DrawBox(u8g2, 126, scroll_pos, 2, scroll_height);
     }
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -304,7 +305,7 @@ void ui_draw_browser(const std::vector<MusicFile>& files,
 void ui_draw_settings(int selected_item, LoopMode loop_mode, 
                     EQPreset eq_mode, uint32_t sleep_minutes, bool include_backlight)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -378,7 +379,7 @@ void ui_draw_settings(int selected_item, LoopMode loop_mode,
     }
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -386,7 +387,7 @@ void ui_draw_settings(int selected_item, LoopMode loop_mode,
  */
 void ui_draw_eq_screen(const int8_t* eq_bands, int num_bands, int selected_band)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -455,7 +456,7 @@ void ui_draw_eq_screen(const int8_t* eq_bands, int num_bands, int selected_band)
     u8g2_DrawStr(u8g2, (128 - value_width) / 2, 15, value_str);
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -463,7 +464,7 @@ void ui_draw_eq_screen(const int8_t* eq_bands, int num_bands, int selected_band)
  */
 void ui_draw_sd_info(const SDCardInfo& sd_info)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -490,7 +491,7 @@ void ui_draw_sd_info(const SDCardInfo& sd_info)
   /* 绘制存储条 */
   draw_progress_bar(5, 54, 118, 8, sd_info.used_mb, sd_info.total_mb);
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -498,7 +499,7 @@ void ui_draw_sd_info(const SDCardInfo& sd_info)
  */
 void ui_draw_backlight_settings(int selected_item, uint8_t brightness, uint16_t timeout_seconds)
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -578,7 +579,7 @@ void ui_draw_backlight_settings(int selected_item, uint8_t brightness, uint16_t
     }
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
 }
 
 /**
@@ -586,7 +587,9 @@ void ui_draw_backlight_settings(int selected_item, uint8_t brightness, uint16_t
  */
 void ui_update()
 {
-  u8g2_UpdateDisplay(get_display());
+  lcd_invalidate();
+  lcd_begin_frame();
+  lcd_end_frame();
 }
 
 /**
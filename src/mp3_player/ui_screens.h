@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 #include "file_system.h"
+#include "music_library.h"
+#include "lyrics.h"
 
 // 应用界面状态
 enum AppScreen {
@@ -35,11 +37,16 @@ void ui_draw_player_screen(const MusicFile& file, uint32_t position_ms,
                           int battery_percent, bool charging);
 
 // 歌词显示
-void ui_draw_lyrics_screen(const std::vector<LrcLine>& lyrics, 
+// (会把歌词游标移到current_ms)
+void ui_draw_lyrics_screen(Lyrics* lyrics, 
                            uint32_t current_ms, const char* title);
 
+// 文件浏览器每页条目数
+#define UI_BROWSER_PAGE_ITEMS 4
+
 // 文件浏览器
-void ui_draw_browser(const std::vector<MusicFile>& files, 
+// (names为从start_index开始的一页文件名，调用者在音乐库锁内复制，绘制时不用持锁)
+void ui_draw_browser(const char* const* names, size_t count,
                      size_t current_index, size_t start_index);
 
 // 系统设置界面
@@ -0,0 +1,209 @@
+/****************************************************************************
+ * perf_probe.cpp
+ *
+ * 性能探针实现
+ * 每次记录只在极短的临界区内更新几个计数 (目标板上关中断，不会被调度出去)，
+ * 探针可在任意线程调用；直方图桶按"最高位 + 其后2位"划分，相对误差不超过25%
+ * ***************************************************************************/
+#include "perf_probe.h"
+#include "sd_io.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+#if defined(__arm__)
+#include <nuttx/irq.h>
+#define PERF_LOCK()   irqstate_t perf_flags = enter_critical_section()
+#define PERF_UNLOCK() leave_critical_section(perf_flags)
+#else
+#include <pthread.h>
+static pthread_mutex_t g_perf_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define PERF_LOCK()   pthread_mutex_lock(&g_perf_mutex)
+#define PERF_UNLOCK() pthread_mutex_unlock(&g_perf_mutex)
+#endif
+
+// 单个探针的统计数据
+struct PerfProbe {
+  uint32_t count;
+  uint64_t sum;
+  uint32_t min;
+  uint32_t max;
+  uint32_t buckets[PERF_BUCKETS];
+};
+
+static PerfProbe g_probes[PERF_PROBE_COUNT];
+
+static const char* const g_probe_names[PERF_PROBE_COUNT] = {
+  "gnss_read",
+  "trip_update",
+  "render",
+  "lcd_flush",
+  "lrc_lookup",
+  "file_io",
+  "glyph_decode"
+};
+
+#if !defined(__arm__)
+/**
+ * 非ARM平台用单调时钟模拟周期计数
+ */
+uint32_t perf_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000ull * PERF_CPU_MHZ + ts.tv_nsec * PERF_CPU_MHZ / 1000);
+}
+#endif
+
+/**
+ * 周期数换算为微秒
+ */
+static uint32_t cycles_to_us(uint64_t cycles)
+{
+  return (uint32_t)(cycles / PERF_CPU_MHZ);
+}
+
+/**
+ * 周期数对应的直方图桶
+ */
+static int bucket_index(uint32_t cycles)
+{
+  if (cycles < (1u << PERF_SUB_BITS)) return cycles;
+
+  int msb = 31 - __builtin_clz(cycles);
+  int sub = (cycles >> (msb - PERF_SUB_BITS)) & ((1 << PERF_SUB_BITS) - 1);
+  int index = ((msb - PERF_SUB_BITS + 1) << PERF_SUB_BITS) + sub;
+
+  return index < PERF_BUCKETS ? index : PERF_BUCKETS - 1;
+}
+
+/**
+ * 桶的上界 (周期数)
+ */
+static uint64_t bucket_upper(int index)
+{
+  if (index < (1 << PERF_SUB_BITS)) return index;
+
+  int msb = (index >> PERF_SUB_BITS) + PERF_SUB_BITS - 1;
+  uint64_t sub = index & ((1 << PERF_SUB_BITS) - 1);
+  uint64_t base = (1ull << msb) | (sub << (msb - PERF_SUB_BITS));
+
+  return base + (1ull << (msb - PERF_SUB_BITS)) - 1;
+}
+
+/**
+ * 使能周期计数器
+ */
+void perf_init()
+{
+#if defined(__arm__)
+  volatile uint32_t* demcr = (volatile uint32_t*)0xE000EDFC;
+  volatile uint32_t* dwt_ctrl = (volatile uint32_t*)0xE0001000;
+  *demcr |= (1u << 24);   // TRCENA
+  *dwt_ctrl |= 1u;        // CYCCNTENA
+#endif
+  perf_reset();
+}
+
+/**
+ * 清空所有统计
+ */
+void perf_reset()
+{
+  PERF_LOCK();
+  memset(g_probes, 0, sizeof(g_probes));
+  for (int i = 0; i < PERF_PROBE_COUNT; i++) {
+    g_probes[i].min = UINT32_MAX;
+  }
+  PERF_UNLOCK();
+}
+
+/**
+ * 记录一次耗时
+ */
+void perf_record(PerfProbeId id, uint32_t cycles)
+{
+  if (id >= PERF_PROBE_COUNT) return;
+
+  PerfProbe* p = &g_probes[id];
+  int bucket = bucket_index(cycles);
+
+  PERF_LOCK();
+  p->count++;
+  p->sum += cycles;
+  p->buckets[bucket]++;
+  if (cycles < p->min) p->min = cycles;
+  if (cycles > p->max) p->max = cycles;
+  PERF_UNLOCK();
+}
+
+/**
+ * 读取统计结果
+ */
+void perf_get_stats(PerfProbeId id, PerfStats* stats)
+{
+  if (!stats) return;
+  memset(stats, 0, sizeof(*stats));
+  if (id >= PERF_PROBE_COUNT) return;
+
+  // 拷贝一份再计算，避免长时间占用临界区
+  PerfProbe snapshot;
+  PERF_LOCK();
+  snapshot = g_probes[id];
+  PERF_UNLOCK();
+
+  const PerfProbe* p = &snapshot;
+  uint32_t count = p->count;
+  if (count == 0) return;
+
+  stats->count = count;
+  stats->min_us = cycles_to_us(p->min);
+  stats->max_us = cycles_to_us(p->max);
+  stats->avg_us = cycles_to_us(p->sum / count);
+
+  // 从低到高累计到99%所在的桶
+  uint32_t target = count - count / 100;
+  uint32_t acc = 0;
+  for (int i = 0; i < PERF_BUCKETS; i++) {
+    acc += p->buckets[i];
+    if (acc >= target) {
+      uint64_t upper = bucket_upper(i);
+      if (upper > p->max) upper = p->max;
+      stats->p99_us = cycles_to_us(upper);
+      break;
+    }
+  }
+}
+
+/**
+ * 探针名称
+ */
+const char* perf_probe_name(PerfProbeId id)
+{
+  return id < PERF_PROBE_COUNT ? g_probe_names[id] : "?";
+}
+
+/**
+ * 导出为CSV (由I/O线程写卡，按键处理不用等SD卡)
+ */
+bool perf_dump_csv(const char* path)
+{
+  std::string csv = "probe,count,min_us,avg_us,p99_us,max_us\n";
+  for (int i = 0; i < PERF_PROBE_COUNT; i++) {
+    PerfStats st;
+    perf_get_stats((PerfProbeId)i, &st);
+    char line[96];
+    snprintf(line, sizeof(line), "%s,%u,%u,%u,%u,%u\n", g_probe_names[i],
+             (unsigned)st.count, (unsigned)st.min_us, (unsigned)st.avg_us,
+             (unsigned)st.p99_us, (unsigned)st.max_us);
+    csv += line;
+  }
+
+  if (!sd_io_write_file(path, csv.data(), csv.size(), SD_IO_STATS)) {
+    printf("[PERF] 导出性能数据失败: %s\n", path);
+    return false;
+  }
+  printf("[PERF] 性能数据已提交导出: %s\n", path);
+  return true;
+}
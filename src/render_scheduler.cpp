@@ -0,0 +1,177 @@
+/****************************************************************************
+ * render_scheduler.cpp
+ * 
+ * 渲染调度实现
+ * 等待使用单调时钟，系统时间被GNSS校准时不会造成提前或延迟刷新
+ * ***************************************************************************/
+#include "render_scheduler.h"
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+static pthread_t g_render_tid;
+static pthread_mutex_t g_render_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_render_cond;
+static bool g_render_running = false;
+static bool g_render_pending = true;     // 启动后先绘制一帧
+static uint32_t g_frame_count = 0;
+static RenderDrawFunc g_draw = nullptr;
+static RenderPolicyFunc g_policy = nullptr;
+
+/**
+ * 当前单调时间 (毫秒)
+ */
+static uint64_t now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * 毫秒转换为timespec
+ */
+static void ms_to_timespec(uint64_t ms, struct timespec* ts)
+{
+  ts->tv_sec = ms / 1000;
+  ts->tv_nsec = (ms % 1000) * 1000000;
+}
+
+/**
+ * 渲染线程
+ */
+static void* render_thread(void* arg)
+{
+  uint64_t next_periodic = 0;   // 周期刷新的下一个时刻
+  uint64_t deadline = 0;        // 下一次刷新的时刻，0表示只等事件
+
+  pthread_mutex_lock(&g_render_mutex);
+
+  while (g_render_running) {
+    // 等待重绘请求或截止时间
+    while (g_render_running && !g_render_pending) {
+      if (deadline == 0) {
+        pthread_cond_wait(&g_render_cond, &g_render_mutex);
+      } else {
+        if (now_ms() >= deadline) break;
+        struct timespec ts;
+        ms_to_timespec(deadline, &ts);
+        pthread_cond_timedwait(&g_render_cond, &g_render_mutex, &ts);
+      }
+    }
+
+    if (!g_render_running) break;
+    g_render_pending = false;
+    pthread_mutex_unlock(&g_render_mutex);
+
+    g_draw();
+    g_frame_count++;
+
+    // 按当前界面的策略安排下一帧
+    RenderPolicy policy = g_policy();
+    uint64_t now = now_ms();
+
+    switch (policy.mode) {
+      case RENDER_PERIODIC:
+        if (policy.ms == 0) policy.ms = 1;
+        if (next_periodic == 0 || next_periodic > now + policy.ms) {
+          next_periodic = now + policy.ms;
+        } else {
+          while (next_periodic <= now) next_periodic += policy.ms;
+        }
+        deadline = next_periodic;
+        break;
+
+      case RENDER_DEADLINE:
+        next_periodic = 0;
+        deadline = now + policy.ms;
+        break;
+
+      case RENDER_ON_EVENT:
+      default:
+        next_periodic = 0;
+        deadline = 0;
+        break;
+    }
+
+    pthread_mutex_lock(&g_render_mutex);
+  }
+
+  pthread_mutex_unlock(&g_render_mutex);
+  return nullptr;
+}
+
+/**
+ * 启动渲染线程
+ */
+bool render_start(RenderDrawFunc draw, RenderPolicyFunc policy)
+{
+  if (!draw || !policy || g_render_running) return false;
+
+  g_draw = draw;
+  g_policy = policy;
+
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_render_cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+
+  g_render_running = true;
+  g_render_pending = true;
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, RENDER_STACK_SIZE);
+
+  int ret = pthread_create(&g_render_tid, &attr, render_thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    printf("[渲染] 创建渲染线程失败: %d\n", ret);
+    g_render_running = false;
+    pthread_cond_destroy(&g_render_cond);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * 停止渲染线程
+ */
+void render_stop()
+{
+  pthread_mutex_lock(&g_render_mutex);
+  if (!g_render_running) {
+    pthread_mutex_unlock(&g_render_mutex);
+    return;
+  }
+  g_render_running = false;
+  pthread_cond_signal(&g_render_cond);
+  pthread_mutex_unlock(&g_render_mutex);
+
+  pthread_join(g_render_tid, nullptr);
+  pthread_cond_destroy(&g_render_cond);
+}
+
+/**
+ * 请求重绘
+ */
+void render_request()
+{
+  pthread_mutex_lock(&g_render_mutex);
+  g_render_pending = true;
+  if (g_render_running) {
+    pthread_cond_signal(&g_render_cond);
+  }
+  pthread_mutex_unlock(&g_render_mutex);
+}
+
+/**
+ * 已绘制的帧数
+ */
+uint32_t render_frame_count()
+{
+  return g_frame_count;
+}
@@ -0,0 +1,45 @@
+/****************************************************************************
+ * render_scheduler.h
+ * 
+ * 渲染调度：所有界面都由唯一的渲染线程绘制。
+ * 当前界面通过策略回调声明刷新方式 (仅事件 / 固定周期 / 指定截止时间)，
+ * 渲染线程睡眠到下一个截止时间或被事件(按键、新的定位历元等)唤醒
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 渲染线程栈大小
+#define RENDER_STACK_SIZE 4096
+
+// 刷新方式
+enum RenderMode {
+  RENDER_ON_EVENT,   // 只在收到重绘请求时刷新 (设置页、列表等静态界面)
+  RENDER_PERIODIC,   // 按固定周期刷新，相位不受事件打断 (指南针等)
+  RENDER_DEADLINE    // 在指定时间后刷新一次 (时钟跳秒、歌词换行)
+};
+
+// 界面刷新策略
+struct RenderPolicy {
+  RenderMode mode;
+  uint32_t ms;       // 周期或距下一次刷新的毫秒数，RENDER_ON_EVENT时忽略
+};
+
+// 绘制当前界面
+typedef void (*RenderDrawFunc)();
+
+// 查询当前界面的刷新策略 (每帧绘制后调用)
+typedef RenderPolicy (*RenderPolicyFunc)();
+
+// 启动渲染线程
+bool render_start(RenderDrawFunc draw, RenderPolicyFunc policy);
+
+// 停止渲染线程并等待其退出
+void render_stop();
+
+// 请求尽快重绘 (任意线程可调用，多次请求会合并为一帧)
+void render_request();
+
+// 已绘制的帧数
+uint32_t render_frame_count();
@@ -0,0 +1,747 @@
+/****************************************************************************
+ * sd_io.cpp
+ *
+ * SD卡读写调度实现
+ * 请求队列由锁保护，文件句柄只由I/O线程访问，读写卡时不持锁
+ * ***************************************************************************/
+#include "sd_io.h"
+#include "audio_stream.h"
+#include "perf_probe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// 请求类型
+enum SdIoOp {
+  SD_IO_OP_APPEND,
+  SD_IO_OP_WRITE_AT,
+  SD_IO_OP_WRITE,
+  SD_IO_OP_READ,
+  SD_IO_OP_SYNC,
+  SD_IO_OP_CLOSE,
+  SD_IO_OP_UNLINK
+};
+
+// 请求
+struct SdIoRequest {
+  SdIoRequest* next;
+  SdIoOp op;
+  SdIoClass cls;
+  char path[SD_IO_PATH_MAX];
+  char* data;
+  size_t len;
+  size_t cap;
+  uint32_t offset;         // SD_IO_OP_WRITE_AT的写入位置
+  SdIoReadFunc func;
+  void* ctx;
+  uint64_t submit_ms;
+};
+
+// 每个类别一个先进先出队列
+struct SdIoQueue {
+  SdIoRequest* head;
+  SdIoRequest* tail;
+};
+
+// 保持打开的文件 (path为空表示空闲)
+struct SdIoHandle {
+  char path[SD_IO_PATH_MAX];
+  int fd;
+  bool dirty;              // 有未fsync的数据
+  uint64_t dirty_ms;       // 第一次写入未同步数据的时间
+  uint64_t used_ms;        // 最近使用时间
+};
+
+// 音频缓冲不足时各类别最多推迟多久 (毫秒)
+static const uint32_t DEFER_MS[SD_IO_CLASS_COUNT] = {0, 2000, 10000, 10000};
+
+// 推迟期间检查音频缓冲的间隔 (毫秒)
+#define DEFER_POLL_MS 20
+
+// 统计/设置类提交者最多等待空间的时间 (毫秒)
+#define SUBMIT_WAIT_MS 1000
+
+static SdIoQueue g_queues[SD_IO_CLASS_COUNT];
+static SdIoHandle g_handles[SD_IO_MAX_HANDLES];
+static size_t g_queued_bytes = 0;
+static uint32_t g_seq = 0;               // 每次提交加一，I/O线程据此判断是否有新请求
+static uint32_t g_dirty_count = 0;       // 有未同步数据的文件数
+static bool g_busy = false;              // I/O线程正在执行请求
+static bool g_sync_all = false;          // 有人在等待全部落盘
+static bool g_running = false;
+static bool g_started = false;
+static SdIoStats g_stats;
+
+static pthread_mutex_t g_io_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cond;       // 有新请求
+static pthread_cond_t g_done_cond;       // 有请求完成或同步完成
+static pthread_t g_io_tid;
+
+/**
+ * 当前单调时间 (毫秒)
+ */
+static uint64_t now_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * 毫秒转换为timespec
+ */
+static void ms_to_timespec(uint64_t ms, struct timespec* ts)
+{
+  ts->tv_sec = ms / 1000;
+  ts->tv_nsec = (ms % 1000) * 1000000;
+}
+
+/**
+ * 完整写出指定数据
+ */
+static bool write_all(int fd, const char* data, size_t len, const char* path)
+{
+  PERF_SCOPE(PERF_FILE_IO);
+
+  while (len > 0) {
+    ssize_t ret = write(fd, data, len);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      printf("[SD] 写入失败: %s (%d)\n", path, errno);
+      return false;
+    }
+    data += ret;
+    len -= ret;
+  }
+  g_stats.writes++;
+  return true;
+}
+
+/**
+ * 同步一个文件
+ */
+static void sync_handle(SdIoHandle* h)
+{
+  if (!h->dirty) return;
+
+  {
+    PERF_SCOPE(PERF_FILE_IO);
+    fsync(h->fd);
+  }
+  h->dirty = false;
+  g_stats.syncs++;
+}
+
+/**
+ * 同步并关闭一个文件
+ */
+static void close_handle(SdIoHandle* h)
+{
+  if (h->path[0] == '\0') return;
+
+  sync_handle(h);
+  close(h->fd);
+  h->fd = -1;
+  h->path[0] = '\0';
+}
+
+/**
+ * 查找已打开的文件
+ */
+static SdIoHandle* find_handle(const char* path)
+{
+  for (int i = 0; i < SD_IO_MAX_HANDLES; i++) {
+    if (g_handles[i].path[0] && strcmp(g_handles[i].path, path) == 0) {
+      return &g_handles[i];
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * 取得用于写入的文件，没有打开时打开 (句柄已满时关闭最久未用的)
+ * 不使用O_APPEND，追加和定位写入共用同一个句柄
+ */
+static SdIoHandle* get_handle(const char* path, uint64_t now)
+{
+  SdIoHandle* h = find_handle(path);
+  if (h) {
+    h->used_ms = now;
+    return h;
+  }
+
+  h = &g_handles[0];
+  for (int i = 0; i < SD_IO_MAX_HANDLES; i++) {
+    if (g_handles[i].path[0] == '\0') {
+      h = &g_handles[i];
+      break;
+    }
+    if (g_handles[i].used_ms < h->used_ms) h = &g_handles[i];
+  }
+  close_handle(h);
+
+  h->fd = open(path, O_WRONLY | O_CREAT, 0666);
+  if (h->fd < 0) {
+    printf("[SD] 无法打开文件: %s (%d)\n", path, errno);
+    return nullptr;
+  }
+  snprintf(h->path, sizeof(h->path), "%s", path);
+  h->dirty = false;
+  h->used_ms = now;
+  g_stats.opens++;
+  return h;
+}
+
+/**
+ * 同步到期的文件，force时同步全部
+ * 返回下一个文件到期的时间，没有未同步的文件时返回0
+ */
+static uint64_t sync_due_handles(uint64_t now, bool force)
+{
+  uint64_t next_due = 0;
+  for (int i = 0; i < SD_IO_MAX_HANDLES; i++) {
+    SdIoHandle* h = &g_handles[i];
+    if (h->path[0] == '\0' || !h->dirty) continue;
+
+    uint64_t due = h->dirty_ms + SD_IO_SYNC_INTERVAL_MS;
+    if (force || due <= now) {
+      sync_handle(h);
+    } else if (next_due == 0 || due < next_due) {
+      next_due = due;
+    }
+  }
+  return next_due;
+}
+
+/**
+ * 未同步的文件数
+ */
+static uint32_t count_dirty()
+{
+  uint32_t count = 0;
+  for (int i = 0; i < SD_IO_MAX_HANDLES; i++) {
+    if (g_handles[i].path[0] && g_handles[i].dirty) count++;
+  }
+  return count;
+}
+
+/**
+ * 整文件替换：写入临时文件并同步，再替换原文件
+ */
+static void write_file(const SdIoRequest* req)
+{
+  SdIoHandle* h = find_handle(req->path);
+  if (h) close_handle(h);
+
+  char tmp_path[SD_IO_PATH_MAX + 4];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", req->path);
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    printf("[SD] 无法创建文件: %s (%d)\n", tmp_path, errno);
+    return;
+  }
+  g_stats.opens++;
+
+  bool ok = write_all(fd, req->data, req->len, tmp_path);
+  {
+    PERF_SCOPE(PERF_FILE_IO);
+    fsync(fd);
+  }
+  g_stats.syncs++;
+  close(fd);
+
+  if (!ok) {
+    unlink(tmp_path);
+    return;
+  }
+
+  // FAT改名不会覆盖已有文件
+  unlink(req->path);
+  if (rename(tmp_path, req->path) != 0) {
+    printf("[SD] 替换文件失败: %s\n", req->path);
+  }
+}
+
+/**
+ * 读取整个文件并回调
+ */
+static void read_file(const SdIoRequest* req)
+{
+  char* data = nullptr;
+  size_t len = 0;
+
+  int fd = open(req->path, O_RDONLY);
+  if (fd >= 0) {
+    g_stats.opens++;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size <= SD_IO_READ_MAX) {
+      data = (char*)malloc(st.st_size + 1);
+    }
+    if (data) {
+      PERF_SCOPE(PERF_FILE_IO);
+      while (len < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + len, st.st_size - len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += n;
+      }
+      data[len] = '\0';
+    }
+    close(fd);
+  }
+
+  req->func(req->ctx, data, len);
+  free(data);
+}
+
+/**
+ * 执行一个请求
+ */
+static void execute_request(const SdIoRequest* req, uint64_t now)
+{
+  SdIoHandle* h;
+
+  switch (req->op) {
+    case SD_IO_OP_APPEND:
+    case SD_IO_OP_WRITE_AT:
+      h = get_handle(req->path, now);
+      if (!h) break;
+      if (req->op == SD_IO_OP_APPEND) {
+        lseek(h->fd, 0, SEEK_END);
+      } else if (lseek(h->fd, req->offset, SEEK_SET) < 0) {
+        printf("[SD] 定位失败: %s (%d)\n", req->path, errno);
+        break;
+      }
+      if (write_all(h->fd, req->data, req->len, req->path) && !h->dirty) {
+        h->dirty = true;
+        h->dirty_ms = now;
+      }
+      break;
+
+    case SD_IO_OP_WRITE:
+      write_file(req);
+      break;
+
+    case SD_IO_OP_READ:
+      read_file(req);
+      break;
+
+    case SD_IO_OP_SYNC:
+      h = find_handle(req->path);
+      if (h) sync_handle(h);
+      break;
+
+    case SD_IO_OP_CLOSE:
+      h = find_handle(req->path);
+      if (h) close_handle(h);
+      break;
+
+    case SD_IO_OP_UNLINK:
+      h = find_handle(req->path);
+      if (h) close_handle(h);
+      unlink(req->path);
+      break;
+  }
+}
+
+static void free_request(SdIoRequest* req)
+{
+  free(req->data);
+  free(req);
+}
+
+/**
+ * 所有队列是否为空 (调用者持有锁)
+ */
+static bool queues_empty_locked()
+{
+  for (int c = 0; c < SD_IO_CLASS_COUNT; c++) {
+    if (g_queues[c].head) return false;
+  }
+  return true;
+}
+
+/**
+ * 取出优先级最高的可执行请求 (调用者持有锁)
+ * 音频缓冲不足时非音频请求推迟到最长期限，wake返回需要再次检查的时间
+ */
+static SdIoRequest* pop_request_locked(uint64_t now, uint64_t* wake)
+{
+  bool audio_low = g_running && g_queued_bytes < SD_IO_QUEUE_LIMIT && audio_stream_is_low();
+
+  for (int c = 0; c < SD_IO_CLASS_COUNT; c++) {
+    SdIoRequest* req = g_queues[c].head;
+    if (!req) continue;
+
+    if (audio_low && c != SD_IO_AUDIO) {
+      uint64_t due = req->submit_ms + DEFER_MS[c];
+      if (now < due) {
+        uint64_t poll = now + DEFER_POLL_MS;
+        uint64_t t = due < poll ? due : poll;
+        if (*wake == 0 || t < *wake) *wake = t;
+        continue;
+      }
+    }
+
+    g_queues[c].head = req->next;
+    if (!g_queues[c].head) g_queues[c].tail = nullptr;
+    g_queued_bytes -= req->len;
+    return req;
+  }
+  return nullptr;
+}
+
+/**
+ * I/O线程
+ */
+static void* io_thread(void* arg)
+{
+  pthread_mutex_lock(&g_io_mutex);
+
+  for (;;) {
+    uint64_t now = now_ms();
+    uint64_t wake = 0;
+
+    SdIoRequest* req = pop_request_locked(now, &wake);
+    if (req) {
+      g_busy = true;
+      pthread_mutex_unlock(&g_io_mutex);
+
+      execute_request(req, now);
+      uint32_t dirty = count_dirty();
+      uint32_t wait = (uint32_t)(now_ms() - req->submit_ms);
+      SdIoClass cls = req->cls;
+      free_request(req);
+
+      pthread_mutex_lock(&g_io_mutex);
+      if (wait > g_stats.max_wait_ms[cls]) g_stats.max_wait_ms[cls] = wait;
+      g_busy = false;
+      g_dirty_count = dirty;
+      pthread_cond_broadcast(&g_done_cond);
+      continue;
+    }
+
+    // 没有可执行的请求时批量同步到期的文件
+    bool force = g_sync_all || !g_running;
+    uint32_t seq = g_seq;
+    g_busy = true;
+    pthread_mutex_unlock(&g_io_mutex);
+
+    uint64_t sync_due = sync_due_handles(now, force);
+    uint32_t dirty = count_dirty();
+
+    pthread_mutex_lock(&g_io_mutex);
+    g_busy = false;
+    g_dirty_count = dirty;
+    if (force) g_sync_all = false;
+    pthread_cond_broadcast(&g_done_cond);
+
+    if (!g_running && queues_empty_locked()) break;
+    if (seq != g_seq) continue;
+
+    if (sync_due != 0 && (wake == 0 || sync_due < wake)) wake = sync_due;
+
+    if (wake == 0) {
+      pthread_cond_wait(&g_work_cond, &g_io_mutex);
+    } else {
+      struct timespec ts;
+      ms_to_timespec(wake, &ts);
+      pthread_cond_timedwait(&g_work_cond, &g_io_mutex, &ts);
+    }
+  }
+
+  pthread_mutex_unlock(&g_io_mutex);
+
+  for (int i = 0; i < SD_IO_MAX_HANDLES; i++) {
+    close_handle(&g_handles[i]);
+  }
+  return nullptr;
+}
+
+/**
+ * 同一文件在该类别队列中最后一个请求 (调用者持有锁)
+ */
+static SdIoRequest* last_request_locked(const char* path, SdIoClass cls)
+{
+  SdIoRequest* last = nullptr;
+  for (SdIoRequest* r = g_queues[cls].head; r; r = r->next) {
+    if (strcmp(r->path, path) == 0) last = r;
+  }
+  return last;
+}
+
+/**
+ * 提交请求，能合并时合并到排队中的请求
+ */
+static bool submit(SdIoOp op, const char* path, const void* data, size_t len,
+                   SdIoClass cls, SdIoReadFunc func = nullptr, void* ctx = nullptr,
+                   uint32_t offset = 0)
+{
+  if (!path || cls >= SD_IO_CLASS_COUNT) return false;
+  if (strlen(path) >= SD_IO_PATH_MAX) {
+    printf("[SD] 路径过长: %s\n", path);
+    return false;
+  }
+
+  pthread_mutex_lock(&g_io_mutex);
+  g_stats.submitted++;
+
+  // 统计/设置类的大量写入在排队数据过多时等待，轨迹和音频从不等待
+  if (g_started && cls >= SD_IO_STATS && g_queued_bytes + len > SD_IO_QUEUE_LIMIT) {
+    struct timespec ts;
+    ms_to_timespec(now_ms() + SUBMIT_WAIT_MS, &ts);
+    while (g_queued_bytes > 0 && g_queued_bytes + len > SD_IO_QUEUE_LIMIT) {
+      if (pthread_cond_timedwait(&g_done_cond, &g_io_mutex, &ts) == ETIMEDOUT) break;
+    }
+  }
+
+  if (g_started) {
+    SdIoRequest* last = last_request_locked(path, cls);
+
+    // 追加合并到同一文件最后一个还没写出的追加请求
+    if (op == SD_IO_OP_APPEND && last && last->op == SD_IO_OP_APPEND && last->len + len <= SD_IO_COALESCE_MAX) {
+      if (last->len + len > last->cap) {
+        size_t cap = last->cap * 2;
+        if (cap < last->len + len) cap = last->len + len;
+        char* grown = (char*)realloc(last->data, cap);
+        if (!grown) {
+          pthread_mutex_unlock(&g_io_mutex);
+          return false;
+        }
+        last->data = grown;
+        last->cap = cap;
+      }
+      memcpy(last->data + last->len, data, len);
+      last->len += len;
+      g_queued_bytes += len;
+      g_stats.coalesced++;
+      pthread_mutex_unlock(&g_io_mutex);
+      return true;
+    }
+
+    // 还没写出的整文件替换、同一位置同样长度的定位写入 (如文件头) 直接换成新内容
+    bool same_slot = op == SD_IO_OP_WRITE_AT && last && last->op == SD_IO_OP_WRITE_AT &&
+                     last->offset == offset && last->len == len;
+    if (same_slot || (op == SD_IO_OP_WRITE && last && last->op == SD_IO_OP_WRITE)) {
+      char* copy = (char*)malloc(len > 0 ? len : 1);
+      if (!copy) {
+        pthread_mutex_unlock(&g_io_mutex);
+        return false;
+      }
+      memcpy(copy, data, len);
+      free(last->data);
+      g_queued_bytes = g_queued_bytes - last->len + len;
+      last->data = copy;
+      last->len = len;
+      last->cap = len;
+      g_stats.coalesced++;
+      pthread_mutex_unlock(&g_io_mutex);
+      return true;
+    }
+
+    // 连续的同步/关闭只需要一次
+    if (op == SD_IO_OP_SYNC && last && (last->op == SD_IO_OP_SYNC || last->op == SD_IO_OP_CLOSE)) {
+      g_stats.coalesced++;
+      pthread_mutex_unlock(&g_io_mutex);
+      return true;
+    }
+  }
+
+  SdIoRequest* req = (SdIoRequest*)malloc(sizeof(SdIoRequest));
+  char* copy = len > 0 ? (char*)malloc(len) : nullptr;
+  if (!req || (len > 0 && !copy)) {
+    pthread_mutex_unlock(&g_io_mutex);
+    free(req);
+    free(copy);
+    printf("[SD] 内存不足, 请求被丢弃: %s\n", path);
+    return false;
+  }
+
+  if (len > 0) memcpy(copy, data, len);
+  req->next = nullptr;
+  req->op = op;
+  req->cls = cls;
+  snprintf(req->path, sizeof(req->path), "%s", path);
+  req->data = copy;
+  req->len = len;
+  req->cap = len;
+  req->offset = offset;
+  req->func = func;
+  req->ctx = ctx;
+  req->submit_ms = now_ms();
+
+  // 没有I/O线程时在调用者线程中直接执行 (只在启动前和停止后，不持锁以便回调再提交请求)
+  if (!g_started) {
+    pthread_mutex_unlock(&g_io_mutex);
+    execute_request(req, req->submit_ms);
+    free_request(req);
+    return true;
+  }
+
+  SdIoQueue* q = &g_queues[cls];
+  if (q->tail) {
+    q->tail->next = req;
+  } else {
+    q->head = req;
+  }
+  q->tail = req;
+  g_queued_bytes += len;
+  g_seq++;
+
+  pthread_cond_signal(&g_work_cond);
+  pthread_mutex_unlock(&g_io_mutex);
+  return true;
+}
+
+/**
+ * 启动I/O线程
+ */
+bool sd_io_start()
+{
+  if (g_started) return true;
+
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&g_work_cond, &cond_attr);
+  pthread_cond_init(&g_done_cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+
+  g_running = true;
+  g_started = true;
+
+  pthread_attr_t attr;
+  struct sched_param param;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, SD_IO_STACK_SIZE);
+  param.sched_priority = SD_IO_PRIORITY;
+  pthread_attr_setschedparam(&attr, &param);
+
+  int ret = pthread_create(&g_io_tid, &attr, io_thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  if (ret != 0) {
+    printf("[SD] 创建I/O线程失败: %d\n", ret);
+    g_running = false;
+    g_started = false;
+    pthread_cond_destroy(&g_work_cond);
+    pthread_cond_destroy(&g_done_cond);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * 停止I/O线程
+ */
+void sd_io_stop()
+{
+  pthread_mutex_lock(&g_io_mutex);
+  if (!g_started) {
+    pthread_mutex_unlock(&g_io_mutex);
+    return;
+  }
+  g_running = false;
+  pthread_cond_broadcast(&g_work_cond);
+  pthread_mutex_unlock(&g_io_mutex);
+
+  pthread_join(g_io_tid, nullptr);
+
+  pthread_mutex_lock(&g_io_mutex);
+  g_started = false;
+  pthread_cond_broadcast(&g_done_cond);
+  pthread_mutex_unlock(&g_io_mutex);
+
+  pthread_cond_destroy(&g_work_cond);
+  pthread_cond_destroy(&g_done_cond);
+}
+
+bool sd_io_append(const char* path, const void* data, size_t len, SdIoClass cls)
+{
+  if (!data || len == 0) return len == 0;
+  return submit(SD_IO_OP_APPEND, path, data, len, cls);
+}
+
+bool sd_io_write_at(const char* path, uint32_t offset, const void* data, size_t len, SdIoClass cls)
+{
+  if (!data || len == 0) return len == 0;
+  return submit(SD_IO_OP_WRITE_AT, path, data, len, cls, nullptr, nullptr, offset);
+}
+
+bool sd_io_write_file(const char* path, const void* data, size_t len, SdIoClass cls)
+{
+  if (!data && len > 0) return false;
+  return submit(SD_IO_OP_WRITE, path, data, len, cls);
+}
+
+bool sd_io_read_file(const char* path, SdIoClass cls, SdIoReadFunc func, void* ctx)
+{
+  if (!func) return false;
+  return submit(SD_IO_OP_READ, path, nullptr, 0, cls, func, ctx);
+}
+
+bool sd_io_sync(const char* path, SdIoClass cls)
+{
+  return submit(SD_IO_OP_SYNC, path, nullptr, 0, cls);
+}
+
+bool sd_io_close(const char* path, SdIoClass cls)
+{
+  return submit(SD_IO_OP_CLOSE, path, nullptr, 0, cls);
+}
+
+bool sd_io_unlink(const char* path, SdIoClass cls)
+{
+  return submit(SD_IO_OP_UNLINK, path, nullptr, 0, cls);
+}
+
+/**
+ * 等待所有请求完成并落盘
+ */
+bool sd_io_flush(uint32_t timeout_ms)
+{
+  pthread_mutex_lock(&g_io_mutex);
+  if (!g_started) {
+    pthread_mutex_unlock(&g_io_mutex);
+    return true;
+  }
+
+  struct timespec ts;
+  ms_to_timespec(now_ms() + timeout_ms, &ts);
+
+  g_sync_all = true;
+  pthread_cond_signal(&g_work_cond);
+
+  bool done = true;
+  while (!queues_empty_locked() || g_busy || g_dirty_count > 0 || g_sync_all) {
+    if (!g_started || pthread_cond_timedwait(&g_done_cond, &g_io_mutex, &ts) == ETIMEDOUT) {
+      done = queues_empty_locked() && !g_busy && g_dirty_count == 0;
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&g_io_mutex);
+  return done;
+}
+
+/**
+ * 统计
+ */
+void sd_io_get_stats(SdIoStats* stats)
+{
+  if (!stats) return;
+
+  pthread_mutex_lock(&g_io_mutex);
+  *stats = g_stats;
+  stats->queued_bytes = g_queued_bytes;
+  pthread_mutex_unlock(&g_io_mutex);
+}
@@ -0,0 +1,98 @@
+/****************************************************************************
+ * sd_io.h
+ *
+ * SD卡读写调度：除音频码流外的写卡和小文件读取都交给唯一的I/O线程，
+ * 调用者只提交请求 (数据被复制)，不会在SD卡上阻塞。
+ * 请求按类别优先级处理，同一文件的追加会合并成一次写入，
+ * 追加和定位写入的文件保持打开，fsync按间隔批量进行，整文件替换只保留最新的版本。
+ * 音频缓冲不足时低优先级的请求会推迟，把SD卡让给音频预读线程
+ * ***************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 请求类别 (数值越小优先级越高，同一文件只应使用一个类别)
+enum SdIoClass {
+  SD_IO_AUDIO,     // 播放相关的读取 (歌词等，音频码流本身由预读线程读取)
+  SD_IO_TRACK,     // 轨迹追加
+  SD_IO_STATS,     // 行程统计、加速记录等
+  SD_IO_CONFIG,    // 设置、扫描进度等
+  SD_IO_CLASS_COUNT
+};
+
+// 自动fsync间隔 (毫秒，追加的数据最多在这么久之后落盘)
+#ifdef CONFIG_SPRESENSEWONG_SD_IO_SYNC_MS
+#define SD_IO_SYNC_INTERVAL_MS CONFIG_SPRESENSEWONG_SD_IO_SYNC_MS
+#else
+#define SD_IO_SYNC_INTERVAL_MS 5000
+#endif
+
+// I/O线程优先级 (低于音频预读线程)
+#define SD_IO_PRIORITY 100
+
+// I/O线程栈大小
+#define SD_IO_STACK_SIZE 4096
+
+// 最大路径长度
+#define SD_IO_PATH_MAX 256
+
+// 同时保持打开的文件数
+#define SD_IO_MAX_HANDLES 4
+
+// 同一文件的连续追加合并到这个大小为止
+#define SD_IO_COALESCE_MAX 8192
+
+// 排队数据超过该值时不再为音频推迟，统计/设置类的提交者等待空间
+#define SD_IO_QUEUE_LIMIT 32768
+
+// 读取文件的最大大小
+#define SD_IO_READ_MAX 65536
+
+// 读取完成回调 (在I/O线程中调用)，data以'\0'结尾且可以修改，读取失败时为nullptr
+typedef void (*SdIoReadFunc)(void* ctx, char* data, size_t len);
+
+// 统计
+struct SdIoStats {
+  uint32_t submitted;                      // 提交的请求数
+  uint32_t coalesced;                      // 被合并的请求数
+  uint32_t writes;                         // 实际写卡次数
+  uint32_t syncs;                          // fsync次数
+  uint32_t opens;                          // 打开文件次数
+  uint32_t queued_bytes;                   // 排队中的数据量
+  uint32_t max_wait_ms[SD_IO_CLASS_COUNT]; // 各类别从提交到完成的最长时间
+};
+
+// 启动I/O线程 (未启动时请求在调用者线程中直接执行)
+bool sd_io_start();
+
+// 处理完所有请求、同步并关闭文件后停止I/O线程
+void sd_io_stop();
+
+// 追加数据到文件末尾 (文件不存在时创建)
+bool sd_io_append(const char* path, const void* data, size_t len, SdIoClass cls);
+
+// 在文件的指定位置写入 (不截断文件，适合固定大小记录的环形日志)
+bool sd_io_write_at(const char* path, uint32_t offset, const void* data, size_t len, SdIoClass cls);
+
+// 用新内容替换整个文件 (先写临时文件再改名，排队中的旧版本直接被替换)
+bool sd_io_write_file(const char* path, const void* data, size_t len, SdIoClass cls);
+
+// 读取整个文件，完成后调用func
+bool sd_io_read_file(const char* path, SdIoClass cls, SdIoReadFunc func, void* ctx);
+
+// 尽快同步追加到该文件的数据
+bool sd_io_sync(const char* path, SdIoClass cls);
+
+// 同步并关闭该文件
+bool sd_io_close(const char* path, SdIoClass cls);
+
+// 删除文件
+bool sd_io_unlink(const char* path, SdIoClass cls);
+
+// 等待所有请求完成并落盘，超时返回false
+bool sd_io_flush(uint32_t timeout_ms);
+
+// 统计
+void sd_io_get_stats(SdIoStats* stats);
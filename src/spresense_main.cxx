@@ -33,10 +33,22 @@
 #include "display.h"
 #include "player.h"
 #include "file_system.h"
+#include "lyrics.h"
+#include "library_scanner.h"
 #include "ui_screens.h"
 #include "gnss_data.h"
+#include "gnss_track_writer.h"
+#include "gnss_track_codec.h"
+#include "gnss_distance.h"
+#include "gnss_power.h"
+#include "gnss_accel_log.h"
+#include "perf_probe.h"
+#include "bench.h"
 #include "gnss_screens.h"
 #include "main_menu.h"
+#include "render_scheduler.h"
+#include "sd_io.h"
+#include "key_input.h"
 #include "common.h"
 
 // 应用状态定义
@@ -46,10 +58,27 @@ static GnssScreen g_gnss_screen = GNSS_SCREEN_ODOMETER;  // GNSS当前界面
 static uint32_t g_screen_timeout_sec = 30;  // 屏幕自动锁定时间(秒)
 static char g_track_filename[64];           // 当前轨迹文件名
 static bool g_show_about = false;           // 是否显示关于界面
-static int g_accel_history_index = 0;       // 加速度历史记录索引
+static bool g_show_perf_stats = false;      // 是否显示性能统计界面
+static Lyrics g_lyrics;                     // 当前歌曲的歌词 (音乐库锁保护)
+static uint32_t g_lyrics_request = 0;       // 最近一次歌词读取的序号，用于丢弃过期结果
+static uint32_t g_lyrics_version = 0;       // 歌词每次替换加一 (音乐库锁保护)
+static Lyrics g_render_lyrics;              // 渲染线程的歌词副本 (只在渲染线程使用)
+static uint32_t g_render_lyrics_version = 0;
+// 当前歌曲和已排入解码队列的下一首按完整路径记录：后台扫描合并目录时下标会变，
+// 用到时在音乐库锁内查出下标。当前歌曲会被渲染线程读取，修改和读取都持有音乐库锁；
+// 排队的下一首只在主线程使用，不加锁
+static std::string g_cur_path;
+static MusicFile g_queued_file;             // 已排入解码队列的下一首 (路径为空表示没有)
+static bool g_scrubbing = false;            // 是否正在长按快进/快退
+static bool g_scrub_held = false;           // 本次按下是否已触发长按
+static uint32_t g_scrub_target_ms = 0;      // 快进/快退的目标位置
+static int g_scrub_repeats = 0;             // 本次长按的连发次数
 
-// 线程相关
-static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+// GNSS线程发布给渲染线程的最新定位
+static pthread_mutex_t g_gnss_view_mutex = PTHREAD_MUTEX_INITIALIZER;
+static GnssPoint g_gnss_view_point;
+static bool g_gnss_view_has_position = false;
+static int g_accel_history_index = 0;       // 加速度历史记录索引
 
 // 前向声明
 static void* gnss_thread(void*);
@@ -58,12 +87,14 @@ static void handle_gnss_keys(KeyCode key);
 static void handle_system_settings(KeyCode key);
 static void draw_about_screen();
 static void draw_system_settings(int selected_item);
+static void draw_perf_stats();
 
 // 系统设置选项
 enum SystemSetting {
   SYS_SCREEN_TIMEOUT,
   SYS_SLEEP_TIMER,
   SYS_BACKLIGHT,     // 背光设置
+  SYS_PERF_STATS,    // 性能统计
   SYS_FORMAT_SD,
   SYS_BACK
 };
@@ -85,22 +116,45 @@ static bool check_auto_lock()
 }
 
 /**
- * 保存轨迹文件，自动生成文件名
+ * 开始记录轨迹，自动生成文件名并打开流式写入
  */
-static void save_current_track() 
+static void start_track_recording() 
 {
   time_t now = time(nullptr);
   struct tm* tm = localtime(&now);
   
-  sprintf(g_track_filename, "/sd/tracks/track_%04d%02d%02d_%02d%02d%02d.gpx",
+  sprintf(g_track_filename, "/sd/tracks/track_%04d%02d%02d_%02d%02d%02d.%s",
           tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
-          tm->tm_hour, tm->tm_min, tm->tm_sec);
+          tm->tm_hour, tm->tm_min, tm->tm_sec,
+          TRACK_DEFAULT_FORMAT == TRACK_FORMAT_BINARY ? "trk" : "gpx");
+  
+  gnss_start_recording();
   
-  // 确保目录存在
-  mkdir("/sd/tracks", 0777);
+  // 轨迹点在记录过程中持续写入，停止时只需补结尾
+  track_writer_open(g_track_filename);
+}
+
+/**
+ * 停止记录轨迹，关闭轨迹文件
+ */
+static void stop_track_recording() 
+{
+  gnss_stop_recording();
+  track_writer_close();
+}
+
+/**
+ * 导出最近一次记录的二进制轨迹为GPX (按需生成，已导出则直接复用)
+ * 导出在后台线程中进行，按键处理不等待SD卡
+ */
+static void export_current_track() 
+{
+  const char* ext = strrchr(g_track_filename, '.');
+  if (!ext || strcmp(ext, ".trk") != 0) return;
   
-  // 保存轨迹
-  gnss_save_track(g_track_filename);
+  char gpx_path[64];
+  track_export_path(g_track_filename, TRACK_EXPORT_GPX, gpx_path, sizeof(gpx_path));
+  track_export_start(g_track_filename, gpx_path, TRACK_EXPORT_GPX);
 }
 
 /**
@@ -108,26 +162,32 @@ static void save_current_track()
  */
 static void draw_system_settings(int selected_item) 
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
   // 标题
   u8g2_SetFont(u8g2, u8g2_font_6x12_tr);
-  u8g2_DrawStr(u8g2, 30, 10, "系统设置");
+  lcd_draw_label(30, 10, "系统设置");
   
   // 设置项
   const char* items[] = {
     "屏幕超时",
     "睡眠定时",
     "背光设置",
+    "性能统计",
     "格式化SD卡",
     "返回"
   };
   const int items_count = sizeof(items) / sizeof(items[0]);
   
-  for (int i = 0; i < items_count; i++) {
-    int y_pos = 25 + i * 12;
+  // 一屏最多显示4项，选中项超出时向下滚动
+  const int visible_count = 4;
+  int first = selected_item - visible_count + 1;
+  if (first < 0) first = 0;
+  
+  for (int i = first; i < items_count && i < first + visible_count; i++) {
+    int y_pos = 25 + (i - first) * 12;
     
     // 选中项反色显示
     if (i == selected_item) {
@@ -135,7 +195,7 @@ static void draw_system_settings(int selected_item)
       u8g2_SetDrawColor(u8g2, 0);
     }
     
-    u8g2_DrawStr(u8g2, 5, y_pos, items[i]);
+    lcd_draw_label(5, y_pos, items[i]);
     
     // 显示当前值
     char value_buf[32] = {0};
@@ -150,8 +210,8 @@ static void draw_system_settings(int selected_item)
     }
     
     if (value_buf[0] != '\0') {
-      int x_pos = 128 - u8g2_GetStrWidth(u8g2, value_buf) - 5;
-      u8g2_DrawStr(u8g2, x_pos, y_pos, value_buf);
+      int x_pos = 128 - lcd_get_utf8_width(value_buf) - 5;
+      lcd_draw_utf8(x_pos, y_pos, value_buf);
     }
     
     // 恢复颜色
@@ -160,7 +220,36 @@ static void draw_system_settings(int selected_item)
     }
   }
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
+}
+
+/**
+ * 绘制性能统计界面
+ * 每行一个探针：平均/p99/最大耗时 (微秒)
+ */
+static void draw_perf_stats() 
+{
+  u8g2_t* u8g2 = lcd_begin_frame();
+  
+  u8g2_ClearBuffer(u8g2);
+  
+  u8g2_SetFont(u8g2, u8g2_font_5x7_tr);
+  u8g2_DrawStr(u8g2, 0, 7, "probe    avg  p99  max us");
+  u8g2_DrawHLine(u8g2, 0, 9, 128);
+  
+  // 5x7字体按7像素行距排列，7个探针的最后一行基线在y=58，不超出64像素的屏幕
+  static_assert(16 + (PERF_PROBE_COUNT - 1) * 7 <= 63, "性能探针过多，一屏显示不下");
+  for (int i = 0; i < PERF_PROBE_COUNT; i++) {
+    PerfStats st;
+    perf_get_stats((PerfProbeId)i, &st);
+    
+    char line[40];
+    snprintf(line, sizeof(line), "%-8.8s%5u%5u%6u", perf_probe_name((PerfProbeId)i),
+             (unsigned)st.avg_us, (unsigned)st.p99_us, (unsigned)st.max_us);
+    u8g2_DrawStr(u8g2, 0, 16 + i * 7, line);
+  }
+  
+  lcd_end_frame();
 }
 
 /**
@@ -168,7 +257,7 @@ static void draw_system_settings(int selected_item)
  */
 static void draw_about_screen() 
 {
-  u8g2_t* u8g2 = get_display();
+  u8g2_t* u8g2 = lcd_begin_frame();
   
   u8g2_ClearBuffer(u8g2);
   
@@ -183,7 +272,251 @@ static void draw_about_screen()
   u8g2_DrawStr(u8g2, 5, 49, "日期: 2025-05-08");
   u8g2_DrawStr(u8g2, 5, 61, "按任意键返回");
   
-  u8g2_SendBuffer(u8g2);
+  lcd_end_frame();
+}
+
+/**
+ * 按循环模式选出下一首
+ * automatic为true表示当前曲目自然播完：单曲循环重复当前曲目，顺序播放到最后一首后停止
+ */
+static int pick_track_index(int cur, bool forward, bool automatic)
+{
+  int count = (int)library_count();
+  if (count == 0) return -1;
+  if (cur < 0 || cur >= count) return 0;
+  
+  switch (player_get_loop_mode()) {
+    case LOOP_REPEAT_ONE:
+      if (automatic) return cur;
+      break;
+      
+    case LOOP_SHUFFLE:
+      if (count > 1) {
+        // 随机选一首，不重复当前曲目
+        int next = rand() % (count - 1);
+        return next >= cur ? next + 1 : next;
+      }
+      return cur;
+      
+    case LOOP_SEQUENTIAL:
+      if (automatic && cur == count - 1) return -1;
+      break;
+  }
+  
+  return forward ? (cur + 1) % count : (cur + count - 1) % count;
+}
+
+// 歌词读取请求
+struct LyricsRequest {
+  uint32_t id;
+  std::string base;     // 去掉扩展名的歌曲路径
+  bool upper;           // 是否已改为读取.LRC
+};
+
+/**
+ * 歌词读取完成 (I/O线程中调用)，.lrc不存在时再读.LRC
+ */
+static void lyrics_loaded(void* ctx, char* data, size_t len)
+{
+  LyricsRequest* req = (LyricsRequest*)ctx;
+  
+  Lyrics lyrics;
+  if (!(data && lyrics_parse(data, len, &lyrics)) && !req->upper) {
+    req->upper = true;
+    if (sd_io_read_file((req->base + ".LRC").c_str(), SD_IO_AUDIO, lyrics_loaded, req)) return;
+  }
+  
+  // 读取期间已经换了歌时丢弃结果
+  library_lock();
+  bool current = req->id == g_lyrics_request;
+  if (current) {
+    std::swap(g_lyrics, lyrics);
+    g_lyrics_version++;
+  }
+  library_unlock();
+  
+  if (current) render_request();
+  delete req;
+}
+
+/**
+ * 加载歌曲对应的歌词 (渲染线程通过sync_render_lyrics取副本)
+ * 先清空旧歌词，文件由I/O线程读取，读完后替换
+ */
+static void load_lyrics(const MusicFile& file)
+{
+  library_lock();
+  uint32_t id = ++g_lyrics_request;
+  lyrics_clear(&g_lyrics);
+  g_lyrics_version++;
+  library_unlock();
+  
+  if (!file.has_lrc) return;
+  
+  LyricsRequest* req = new LyricsRequest{id, file.filepath.substr(0, file.filepath.size() - 4), false};
+  if (!sd_io_read_file((req->base + ".lrc").c_str(), SD_IO_AUDIO, lyrics_loaded, req)) {
+    delete req;
+  }
+}
+
+/**
+ * 设置当前歌曲
+ */
+static void set_current_track(const std::string& path)
+{
+  library_lock();
+  g_cur_path = path;
+  library_unlock();
+}
+
+/**
+ * 当前歌曲在音乐库中的下标，不在库中返回-1 (调用者持有音乐库锁)
+ */
+static int current_track_index_locked()
+{
+  if (g_cur_path.empty()) return -1;
+  size_t index = music_library_find(library_files(), g_cur_path.c_str());
+  return index == MUSIC_TRACK_NONE ? -1 : (int)index;
+}
+
+/**
+ * 当前歌曲在音乐库中的下标
+ */
+static int current_track_index()
+{
+  library_lock();
+  int index = current_track_index_locked();
+  library_unlock();
+  return index;
+}
+
+/**
+ * 播放音乐库中的一首歌曲
+ */
+static void play_track(int index)
+{
+  MusicFile file;
+  if (index < 0 || !library_get_file(index, &file)) return;
+  if (!player_load_file(file.filepath.c_str(), &file.metadata)) return;
+  
+  player_start();
+  set_current_track(file.filepath);
+  g_queued_file.filepath.clear();
+  load_lyrics(file);
+}
+
+static void prev_track()
+{
+  play_track(pick_track_index(current_track_index(), false, false));
+}
+
+static void next_track()
+{
+  play_track(pick_track_index(current_track_index(), true, false));
+}
+
+/**
+ * 无缝播放：接近结尾时把下一首排入解码队列，解码器进入下一首后同步当前曲目
+ * 返回距下一次需要检查的时间(毫秒)，主循环以此作为等待按键的超时
+ */
+static int service_playback()
+{
+  if (player_take_track_change()) {
+    set_current_track(g_queued_file.filepath);
+    load_lyrics(g_queued_file);
+    g_queued_file.filepath.clear();
+    render_request();
+  }
+  
+  uint32_t duration = player_get_duration_ms();
+  if (!player_is_playing() || player_is_paused() || duration == 0) return 1000;
+  
+  uint32_t pos = player_get_position_ms();
+  uint32_t remain = pos < duration ? duration - pos : 0;
+  
+  if (!player_has_queued()) {
+    if (remain > PLAYER_PREFETCH_MS) {
+      uint32_t until_prefetch = remain - PLAYER_PREFETCH_MS;
+      return until_prefetch < 1000 ? (int)until_prefetch : 1000;
+    }
+    
+    int next = pick_track_index(current_track_index(), true, true);
+    MusicFile file;
+    if (next < 0 || !library_get_file(next, &file) ||
+        !player_queue_next(file.filepath.c_str(), &file.metadata)) {
+      return 1000;
+    }
+    g_queued_file = file;
+  }
+  
+  // 已排队：在曲目结尾醒来切换界面
+  if (remain >= 1000) return 1000;
+  return remain > 10 ? (int)remain : 10;
+}
+
+/**
+ * 快进/快退每次连发的步长，按住越久步长越大
+ */
+static uint32_t scrub_step_ms(int repeats)
+{
+  if (repeats < 8) return 5000;
+  if (repeats < 20) return 15000;
+  if (repeats < 40) return 60000;
+  return 180000;
+}
+
+/**
+ * 播放界面的上一曲/下一曲：点按切换曲目，按住快退/快进，松开时跳转
+ * 返回true表示事件已处理
+ */
+static bool handle_player_seek_keys(const KeyEvent& event)
+{
+  if (event.key != KEY_PREV && event.key != KEY_NEXT) return false;
+  if (main_menu_is_locked() || g_show_about) return false;
+  if (main_menu_get_mode() != APP_MODE_MP3 || ui_get_current_screen() != SCREEN_PLAYER) return false;
+  
+  switch (event.type) {
+    case KEY_EVENT_PRESS:
+      // 等到松开或长按时才知道是哪种操作
+      g_scrub_held = false;
+      break;
+      
+    case KEY_EVENT_LONG_PRESS:
+      g_scrub_held = true;
+      g_scrubbing = player_is_playing();
+      g_scrub_target_ms = player_get_position_ms();
+      g_scrub_repeats = 0;
+      break;
+      
+    case KEY_EVENT_REPEAT:
+      if (g_scrubbing) {
+        uint32_t step = scrub_step_ms(g_scrub_repeats++);
+        uint32_t duration = player_get_duration_ms();
+        if (event.key == KEY_NEXT) {
+          g_scrub_target_ms += step;
+          if (duration > 0 && g_scrub_target_ms > duration) g_scrub_target_ms = duration;
+        } else {
+          g_scrub_target_ms = g_scrub_target_ms > step ? g_scrub_target_ms - step : 0;
+        }
+      }
+      break;
+      
+    case KEY_EVENT_RELEASE:
+      if (g_scrubbing) {
+        player_seek_ms(g_scrub_target_ms);
+        g_scrubbing = false;
+      } else if (!g_scrub_held) {
+        if (event.key == KEY_PREV) {
+          prev_track();
+        } else {
+          next_track();
+        }
+      }
+      g_scrub_held = false;
+      break;
+  }
+  
+  return true;
 }
 
 /**
@@ -194,18 +527,15 @@ static void handle_mp3_keys(KeyCode key)
   // MP3模式下各界面的按键处理
   switch (ui_get_current_screen()) {
     case SCREEN_PLAYER:
-      if (key == KEY_PREV) {
-        prev_track();
-      } else if (key == KEY_NEXT) {
-        next_track();
-      } else if (key == KEY_SELECT) {
+      // 上一曲/下一曲在handle_player_seek_keys中区分点按和长按
+      if (key == KEY_SELECT) {
         if (player_is_playing()) {
           if (player_is_paused()) {
             player_resume();
           } else {
             player_pause();
           }
-        } else if (g_cur_index >= 0) {
+        } else if (current_track_index() >= 0) {
           player_start();
         }
       } else if (key == KEY_BACK) {
@@ -251,12 +581,13 @@ static void handle_gnss_keys(KeyCode key)
       if (key == KEY_SELECT) {
         // 开始/停止记录
         if (gnss_is_recording()) {
-          gnss_stop_recording();
-          // 自动保存轨迹
-          save_current_track();
+          stop_track_recording();
         } else {
-          gnss_start_recording();
+          start_track_recording();
         }
+      } else if (key == KEY_BACK && !gnss_is_recording()) {
+        // 保存轨迹：按需导出GPX
+        export_current_track();
       }
       break;
       
@@ -290,12 +621,8 @@ static void handle_gnss_keys(KeyCode key)
       
     case GNSS_SCREEN_ACCEL_TEST:
       if (key == KEY_SELECT) {
-        // 重置加速测试 - 重置行程数据中的加速记录
-        const TripData* trip = gnss_get_trip_data();
-        if (trip) {
-          // 在gnss_data.cpp中添加重置加速测试的接口
-          gnss_reset_trip();
-        }
+        // 重置加速测试 - 重置行程数据中的加速记录 (由分析线程执行)
+        gnss_reset_trip();
       }
       break;
       
@@ -317,7 +644,19 @@ static void handle_system_settings(KeyCode key)
   // 外部声明的变量
   extern bool g_in_backlight_settings;
   
-  const int settings_count = 5; // 屏幕超时、睡眠定时、背光设置、格式化SD卡、返回
+  const int settings_count = 6; // 屏幕超时、睡眠定时、背光设置、性能统计、格式化SD卡、返回
+  
+  // 性能统计界面：确认键导出CSV，下一项清空统计，后退键返回
+  if (g_show_perf_stats) {
+    if (key == KEY_SELECT) {
+      perf_dump_csv();
+    } else if (key == KEY_NEXT) {
+      perf_reset();
+    } else if (key == KEY_BACK) {
+      g_show_perf_stats = false;
+    }
+    return;
+  }
   
   switch (key) {
     case KEY_PREV:
@@ -374,14 +713,13 @@ static void handle_system_settings(KeyCode key)
           // 进入背光设置界面
           g_in_backlight_settings = true;
           
-          // 重置背光设置菜单索引
+          // 重置背光设置菜单索引 (界面由渲染线程绘制)
           extern int g_backlight_menu_index;
           g_backlight_menu_index = 0;
-          
-          // 显示背光设置界面
-          extern uint8_t g_backlight_brightness;
-          extern uint16_t g_backlight_timeout;
-          ui_draw_backlight_settings(g_backlight_menu_index, g_backlight_brightness, g_backlight_timeout);
+          break;
+        
+        case SYS_PERF_STATS:
+          g_show_perf_stats = true;
           break;
         
         case SYS_FORMAT_SD:
@@ -419,120 +757,311 @@ static void* gnss_thread(void* arg)
   gnss_set_update_rate(GNSS_RATE_1HZ);
   
   GnssPoint point;
-  const TripData* trip_data;
   
-  // GNSS处理循环
+  // GNSS处理循环：每次唤醒处理一个定位历元
   while (g_running) {
-    // 获取最新定位
-    bool has_position = gnss_get_position(&point);
+    // 等待下一个定位历元，超时设为两个定位周期，保证g_running能及时生效
+    int timeout_ms = 2 * (int)gnss_get_cycle_ms();
+    bool has_position = gnss_wait_position(&point, timeout_ms);
     
-    // 获取行程数据
-    trip_data = gnss_get_trip_data();
-    
-    // 更新位置数据    
+    // 里程、分段和加速测量由分析线程处理，这里只把定位点交给界面
+    // 发布给渲染线程 (码表等界面按定位频率刷新)
+    pthread_mutex_lock(&g_gnss_view_mutex);
     if (has_position) {
-      last_fix_time = time(nullptr);
+      g_gnss_view_point = point;
+    }
+    g_gnss_view_has_position = has_position;
+    pthread_mutex_unlock(&g_gnss_view_mutex);
+    
+    if (main_menu_get_mode() == APP_MODE_GNSS) {
+      render_request();
+    }
+    
+    // 写SD卡放在解析路径之后
+    if (gnss_is_recording()) {
+      track_writer_service();
+      gnss_flush_track();
+    }
+    
+    // 省电调度：停车降速，没人需要定位时暂停
+    bool viewing = main_menu_get_mode() == APP_MODE_GNSS && !main_menu_is_locked();
+    gnss_power_service(gnss_is_recording(), viewing);
+  }
+  
+  // 关闭GNSS
+  gnss_stop();
+  gnss_deinit();
+  
+  return nullptr;
+}
+
+/**
+ * 绘制GNSS界面 (渲染线程)
+ * 位置取GNSS线程发布的最新历元，行程数据取只读快照
+ */
+static void render_gnss_screen() 
+{
+  static TripData trip_snapshot;  // 只在渲染线程使用，复用容器内存
+  const TripData* trip_data =
+      gnss_get_trip_snapshot(&trip_snapshot) ? &trip_snapshot : nullptr;
+  
+  pthread_mutex_lock(&g_gnss_view_mutex);
+  GnssPoint point = g_gnss_view_point;
+  bool has_position = g_gnss_view_has_position;
+  pthread_mutex_unlock(&g_gnss_view_mutex);
+  
+  // 根据当前界面绘制
+  switch (gnss_get_current_screen()) {
+    case GNSS_SCREEN_ODOMETER:
+      gnss_draw_odometer(has_position ? &point : nullptr, trip_data, gnss_is_recording());
+      break;
       
-      // 当前速度(km/h)
-      float current_speed_kmh = point.speed * 3.6f;
+    case GNSS_SCREEN_COMPASS:
+      gnss_draw_compass(has_position ? &point : nullptr);
+      break;
       
-      // 检测百米加速
-      gnss_detect_acceleration();
+    case GNSS_SCREEN_TRACKING:
+      gnss_draw_tracking(gnss_is_recording(), 
+                        gnss_is_recording() ? gnss_get_track_point_count() : 0, 
+                        trip_data);
+      break;
       
-      // 如果已在加速度测量中，监测并更新测量状态
-      if (g_trip_data.measuring_acceleration) {
-        gnss_check_acceleration_measurement(point);
-      }
-      // 自动检测加速度：从静止状态到行驶状态的自动检测
-      else {
-        // 如果从静止(<2km/h)变为移动(>5km/h)，则自动开始测量加速度
-        if (was_stopped && current_speed_kmh > 5.0f) {
-          printf("[GNSS] 检测到从静止到移动，自动开始加速度测量\n");
-          gnss_start_acceleration_measurement();
+    case GNSS_SCREEN_TRIP_DATA:
+      gnss_draw_trip_data(trip_data);
+      break;
+      
+    case GNSS_SCREEN_SETTINGS:
+      gnss_draw_settings(g_rate, g_settings_index);
+      break;
+      
+    case GNSS_SCREEN_ACCEL_TEST:
+      gnss_draw_accel_test(trip_data, 
+                          has_position ? point.speed : 0.0f);
+      break;
+      
+    case GNSS_SCREEN_SEGMENT:
+      gnss_draw_segment_settings(
+          gnss_is_segment_enabled(),
+          gnss_get_segment_option(),
+          gnss_get_segment_custom_time(),
+          g_segment_index);
+      break;
+      
+    case GNSS_SCREEN_HISTORY:
+      // 历史分段列表界面
+      gnss_draw_history_list(g_history_files, g_history_index);
+      break;
+      
+    case GNSS_SCREEN_SEGMENT_DETAIL:
+      // 分段详情界面
+      gnss_draw_segment_detail(g_loaded_segments, g_detail_index);
+      break;
+      
+    case GNSS_SCREEN_ACCELERATION:
+      // 加速度历史记录界面
+      gnss_draw_acceleration_history(g_accel_history_index);
+      break;
+  }
+}
+
+/**
+ * 歌词有更新时复制到渲染线程的副本 (渲染线程调用)
+ * 换歌时才复制一次，绘制和刷屏期间不用持有音乐库锁
+ */
+static void sync_render_lyrics()
+{
+  library_lock();
+  if (g_render_lyrics_version != g_lyrics_version) {
+    g_render_lyrics = g_lyrics;
+    g_render_lyrics_version = g_lyrics_version;
+  }
+  library_unlock();
+}
+
+/**
+ * 绘制当前界面 (渲染线程的唯一绘制入口)
+ */
+static void render_current_screen() 
+{
+  if (main_menu_is_locked()) return;
+  
+  PERF_SCOPE(PERF_SCREEN_RENDER);
+  
+  if (g_show_about) {
+    draw_about_screen();
+    return;
+  }
+  
+  switch (main_menu_get_mode()) {
+    case APP_MODE_MENU:
+      main_menu_draw(g_menu_index);
+      break;
+      
+    case APP_MODE_MP3: {
+      // 后台扫描会改动音乐库：持锁只复制要显示的内容，绘制和刷屏前释放，
+      // I/O线程的歌词回调不用等SPI刷屏。复用静态对象，字符串容量保留下来，逐帧刷新时不再分配
+      static MusicFile current;
+      static std::string title;
+      static std::string page[UI_BROWSER_PAGE_ITEMS];
+      AppScreen screen = ui_get_current_screen();
+      size_t count = 0;
+      size_t cur = 0;
+      size_t start = 0;
+      bool playing = false;
+      
+      library_lock();
+      const MusicLibrary& lib = library_files();
+      int cur_index = current_track_index_locked();
+      bool has_current = cur_index >= 0;
+      
+      if (screen == SCREEN_BROWSER) {
+        count = music_library_count(lib);
+        cur = has_current ? cur_index : 0;
+        start = cur - cur % UI_BROWSER_PAGE_ITEMS;
+        for (size_t i = 0; i < UI_BROWSER_PAGE_ITEMS && start + i < count; i++) {
+          page[i] = music_library_str(lib, music_library_track(lib, start + i).name);
         }
+      } else if (!has_current) {
+        // 音乐库尚未就绪
+      } else if (screen == SCREEN_LYRICS) {
+        title = music_library_str(lib, music_library_track(lib, cur_index).title);
+      } else if (player_is_playing()) {
+        music_library_get(lib, cur_index, &current);
+        playing = true;
       }
+      library_unlock();
       
-      // 更新状态
-      was_stopped = (current_speed_kmh < 2.0f);
-      prev_speed_kmh = current_speed_kmh;
-    } else {
-      // 如果20秒没有定位，显示搜索定位
-      time_t now = time(nullptr);
-      if (difftime(now, last_fix_time) > 20) {
-        // 失去定位超过20秒
-        // 如果在测量加速度，则取消测量
-        if (g_trip_data.measuring_acceleration) {
-          gnss_stop_acceleration_measurement(false);
+      if (screen == SCREEN_BROWSER) {
+        const char* names[UI_BROWSER_PAGE_ITEMS];
+        for (size_t i = 0; i < UI_BROWSER_PAGE_ITEMS; i++) {
+          names[i] = page[i].c_str();
         }
+        ui_draw_browser(names, count, cur, start);
+      } else if (has_current && screen == SCREEN_LYRICS) {
+        sync_render_lyrics();
+        ui_draw_lyrics_screen(&g_render_lyrics, player_get_position_ms(), title.c_str());
+      } else if (playing) {
+        uint32_t position = g_scrubbing ? g_scrub_target_ms : player_get_position_ms();
+        ui_draw_player_screen(current, position, 
+                              player_get_volume(), player_get_loop_mode(), 
+                              EQ_CUSTOM, g_battery_percent, g_battery_charging);
       }
+      break;
     }
-    
-    // 更新界面（仅在GNSS模式下）
-    if (main_menu_get_mode() == APP_MODE_GNSS) {
-      // 根据当前界面绘制
+      
+    case APP_MODE_GNSS:
+      render_gnss_screen();
+      break;
+      
+    case APP_MODE_SYSTEM: {
+      extern bool g_in_backlight_settings;
+      extern int g_backlight_menu_index;
+      extern uint8_t g_backlight_brightness;
+      extern uint16_t g_backlight_timeout;
+      
+      if (g_in_backlight_settings) {
+        ui_draw_backlight_settings(g_backlight_menu_index, g_backlight_brightness, g_backlight_timeout);
+      } else if (g_show_perf_stats) {
+        draw_perf_stats();
+      } else {
+        draw_system_settings(g_system_setting_index);
+      }
+      break;
+    }
+  }
+}
+
+/**
+ * 当前界面的刷新策略
+ * 按键、定位历元等事件总会触发重绘，这里只声明事件之外的定时刷新
+ */
+static RenderPolicy screen_render_policy() 
+{
+  RenderPolicy on_event = {RENDER_ON_EVENT, 0};
+  
+  if (main_menu_is_locked()) return on_event;
+  
+  // 时钟类界面在下一次跳秒时刷新
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  RenderPolicy next_second = {RENDER_DEADLINE, (uint32_t)(1000 - ts.tv_nsec / 1000000)};
+  
+  if (g_show_about) return on_event;
+  
+  switch (main_menu_get_mode()) {
+    case APP_MODE_MENU:
+      return next_second;
+      
+    case APP_MODE_MP3: {
+      // 扫描期间浏览器随音乐库增长刷新
+      if (ui_get_current_screen() == SCREEN_BROWSER) {
+        if (!library_is_scanning()) return on_event;
+        RenderPolicy scanning = {RENDER_PERIODIC, 500};
+        return scanning;
+      }
+      
+      if (!player_is_playing() || player_is_paused()) return on_event;
+      
+      uint32_t pos = player_get_position_ms();
+      if (ui_get_current_screen() == SCREEN_LYRICS) {
+        // 歌词在下一行开始时刷新，游标同时移到当前行，绘制时不用再查找
+        sync_render_lyrics();
+        lyrics_update(&g_render_lyrics, pos);
+        int64_t next = lyrics_next_time(g_render_lyrics);
+        if (next < 0) return on_event;
+        RenderPolicy lyric = {RENDER_DEADLINE, (uint32_t)(next - pos)};
+        return lyric;
+      }
+      
+      // 播放进度按秒显示
+      RenderPolicy progress = {RENDER_DEADLINE, 1000 - pos % 1000};
+      return progress;
+    }
+      
+    case APP_MODE_GNSS:
       switch (gnss_get_current_screen()) {
-        case GNSS_SCREEN_ODOMETER:
-          gnss_draw_odometer(has_position ? &point : nullptr, trip_data, gnss_is_recording());
-          break;
-          
-        case GNSS_SCREEN_COMPASS:
-          gnss_draw_compass(has_position ? &point : nullptr);
-          break;
+        case GNSS_SCREEN_COMPASS: {
+          // 指南针10Hz刷新
+          RenderPolicy compass = {RENDER_PERIODIC, 100};
+          return compass;
+        }
           
+        case GNSS_SCREEN_ODOMETER:
         case GNSS_SCREEN_TRACKING:
-          gnss_draw_tracking(gnss_is_recording(), 
-                            gnss_is_recording() ? g_track_points.size() : 0, 
-                            trip_data);
-          break;
-          
         case GNSS_SCREEN_TRIP_DATA:
-          gnss_draw_trip_data(trip_data);
-          break;
-          
-        case GNSS_SCREEN_SETTINGS:
-          gnss_draw_settings(g_rate, g_settings_index);
-          break;
-          
         case GNSS_SCREEN_ACCEL_TEST:
-          gnss_draw_accel_test(trip_data, 
-                              has_position ? point.speed : 0.0f);
-          break;
-          
-        case GNSS_SCREEN_SEGMENT:
-          gnss_draw_segment_settings(
-              gnss_is_segment_enabled(),
-              gnss_get_segment_option(),
-              gnss_get_segment_custom_time(),
-              g_segment_index);
-          break;
-          
-        case GNSS_SCREEN_HISTORY:
-          // 历史分段列表界面
-          gnss_draw_history_list(g_history_files, g_history_index);
-          break;
-          
-        case GNSS_SCREEN_SEGMENT_DETAIL:
-          // 分段详情界面
-          gnss_draw_segment_detail(g_loaded_segments, g_detail_index);
-          break;
+          // 随定位历元刷新；没有定位时仍需要走时
+          return next_second;
           
-        case GNSS_SCREEN_ACCELERATION:
-          // 加速度历史记录界面
-          gnss_draw_acceleration_history(g_accel_history_index);
-          break;
+        default:
+          // 设置、列表类界面只在按键时刷新
+          return on_event;
       }
-    }
-    
-    // 延时，避免过高CPU使用率
-    // 根据更新频率设置休眠时间
-    usleep(50 * 1000); // 50ms
+      
+    case APP_MODE_SYSTEM:
+      if (g_show_perf_stats) {
+        RenderPolicy stats = {RENDER_PERIODIC, 1000};
+        return stats;
+      }
+      return on_event;
   }
   
-  // 关闭GNSS
-  gnss_stop();
-  gnss_deinit();
+  return on_event;
+}
+
+/**
+ * 刷新策略：界面自身的策略，跑马灯滚动期间至少按滚动间隔刷新
+ */
+static RenderPolicy current_render_policy() 
+{
+  RenderPolicy policy = screen_render_policy();
+  if (!lcd_marquee_pending()) return policy;
   
-  return nullptr;
+  if (policy.mode == RENDER_ON_EVENT || policy.ms > LCD_MARQUEE_FRAME_MS) {
+    policy.mode = RENDER_DEADLINE;
+    policy.ms = LCD_MARQUEE_FRAME_MS;
+  }
+  return policy;
 }
 
 /**
@@ -540,11 +1069,21 @@ static void* gnss_thread(void* arg)
  */
 extern "C" int spresense_main(int argc, char* argv[]) 
 {
+  perf_init();
+  
+  // 基准测试模式: spresensewong bench [次数] | bench <测试项> [参数...] (见bench.h)
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    return bench_main(argc - 1, argv + 1);
+  }
+  
   printf("[Spresense] 多功能系统启动...\n");
   
   // 初始化显示
   lcd_init();
   
+  // 启动SD卡I/O线程，之后的写卡和歌词读取都由它完成
+  sd_io_start();
+  
   // 初始化主菜单
   main_menu_init();
   
@@ -554,23 +1093,50 @@ extern "C" int spresense_main(int argc, char* argv[])
   // 初始化GNSS界面
   gnss_screens_init();
   
-  // 扫描SD卡音乐文件
-  std::vector<MusicFile> music_files;
-  scan_music_directory("/sd/MUSIC", &music_files);
+  // 补全上次意外断电时未结束的轨迹文件
+  track_writer_recover();
+  
+  // 加速记录日志由I/O线程读入内存，历史界面不读卡
+  accel_log_init();
+  
+  // 后台扫描SD卡音乐文件，索引中的歌曲立即可用
+  library_scan_start("/sd/MUSIC");
   
   // 创建GNSS线程
   pthread_t gnss_tid;
   pthread_create(&gnss_tid, nullptr, gnss_thread, nullptr);
   
   // 如果有音乐文件，预加载第一首
-  if (!music_files.empty()) {
-    player_load_file(music_files[0].filepath.c_str());
+  // 没有索引时最多等待1秒，让扫描找到第一首
+  MusicFile first_file;
+  if (library_wait_count(1, 1000) && library_get_file(0, &first_file) &&
+      player_load_file(first_file.filepath.c_str(), &first_file.metadata)) {
+    set_current_track(first_file.filepath);
+    load_lyrics(first_file);
   }
   
+  // 启动渲染线程，之后所有界面都由渲染线程绘制
+  render_start(render_current_screen, current_render_policy);
+  
+  // 启动按键采样
+  key_input_start();
+  
   // 主循环
   while (g_running) {
-    // 读取按键
-    KeyCode key = (KeyCode)adc_to_key(analogRead(ANALOG_PIN));
+    // 等待按键事件，超时后照常做电池和锁屏检查
+    // 按下和长按连发都作为一次按键处理，松开和长按本身不触发操作
+    // (播放界面的上一曲/下一曲除外，按住用于快进/快退)
+    KeyCode key = KEY_NONE;
+    KeyEvent event;
+    int wait_ms = service_playback();
+    if (key_input_wait(&event, wait_ms)) {
+      gnss_power_notify_activity();
+      if (handle_player_seek_keys(event)) {
+        render_request();
+      } else if (event.type == KEY_EVENT_PRESS || event.type == KEY_EVENT_REPEAT) {
+        key = event.key;
+      }
+    }
     
     // 更新电池状态
     main_menu_update_battery();
@@ -580,18 +1146,13 @@ extern "C" int spresense_main(int argc, char* argv[])
       if (key != KEY_NONE) {
         main_menu_lock_screen(false);
       }
-    } else {
+    } else if (key != KEY_NONE) {
       // 根据当前模式处理按键
       AppMode mode = main_menu_get_mode();
       
       if (g_show_about) {
         // 关于界面，任意键返回
-        if (key != KEY_NONE) {
-          g_show_about = false;
-        }
-        
-        // 绘制关于界面
-        draw_about_screen();
+        g_show_about = false;
       } else {
         switch (mode) {
           case APP_MODE_MENU:
@@ -599,59 +1160,50 @@ extern "C" int spresense_main(int argc, char* argv[])
             main_menu_handle_key(key);
             
             // 检查是否需要显示关于界面
-            if (mode == APP_MODE_MENU && g_menu_index == 3 && key == KEY_SELECT) {
+            if (main_menu_get_mode() == APP_MODE_MENU && g_menu_index == 3 && key == KEY_SELECT) {
               g_show_about = true;
-            } else {
-              // 绘制主菜单
-              main_menu_draw(g_menu_index);
             }
             break;
             
           case APP_MODE_MP3:
             // MP3模式按键处理
             handle_mp3_keys(key);
-            
-            // 更新MP3界面
-            if (player_is_playing()) {
-              uint32_t pos = player_get_position_ms();
-              
-              // 绘制播放界面
-              ui_draw_player_screen(g_music_files[g_cur_index], pos, 
-                                  player_get_volume(), player_get_loop_mode(), 
-                                  EQ_CUSTOM, g_battery_percent, g_battery_charging);
-            }
             break;
             
           case APP_MODE_GNSS:
             // GNSS模式按键处理
             handle_gnss_keys(key);
-            // 注意：GNSS界面在GNSS线程中更新
             break;
             
           case APP_MODE_SYSTEM:
             // 系统设置模式按键处理
             handle_system_settings(key);
-            
-            // 绘制系统设置界面
-            draw_system_settings(g_system_setting_index);
             break;
         }
       }
     }
     
+    // 按键后立即重绘，按键到画面的延迟只取决于一帧的绘制时间
+    if (key != KEY_NONE) {
+      render_request();
+    }
+    
     // 检查自动锁屏
     check_auto_lock();
-    
-    // 短暂休眠
-    usleep(50 * 1000); // 50ms
   }
   
-  // 等待GNSS线程结束
+  // 等待输入、渲染和GNSS线程结束
+  key_input_stop();
+  render_stop();
+  library_scan_stop();
   pthread_join(gnss_tid, nullptr);
   
   // 清理资源
   player_deinit();
   
+  // 写出所有排队的数据并关闭文件
+  sd_io_stop();
+  
   printf("[Spresense] 多功能系统已退出\n");
   return 0;
 }